@@ -0,0 +1,78 @@
+/*****************************************************
+*	FileSkeletonSource.cpp
+*
+*	Skeleton frames played back from a skeleton log.
+*****************************************************/
+
+#include "FileSkeletonSource.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/* Longest gap between recorded frames honored when pacing playback. Covers sensor pauses without stalling replay. */
+#define FILE_SOURCE_MAX_DELAY_MS	1000
+
+FileSkeletonSource::FileSkeletonSource(const char* path, bool realtime) :
+	path(path),
+	realtime(realtime),
+	nextFrame(0),
+	waitRemaining(-1)
+{
+}
+
+FileSkeletonSource::~FileSkeletonSource()
+{
+	Close();
+}
+
+int FileSkeletonSource::Open()
+{
+	nextFrame = 0;
+	waitRemaining = -1;
+	return reader.Open(path);
+}
+
+static void sleepMs(int64_t ms)
+{
+	if (ms <= 0) return;
+#ifdef _WIN32
+	Sleep((DWORD)ms);
+#else
+	usleep((useconds_t)(ms * 1000));
+#endif
+}
+
+int FileSkeletonSource::GetNextFrame(skeletonFrame* frame, int timeout_ms)
+{
+	const skeletonFrame* next;
+
+	next = reader.getFrame(nextFrame);
+	if (next == NULL) return SKELETON_SOURCE_END;
+
+	if (realtime && nextFrame > 0) {
+		if (waitRemaining < 0) {
+			waitRemaining = next->timestamp - reader.getFrame(nextFrame - 1)->timestamp;
+			if (waitRemaining > FILE_SOURCE_MAX_DELAY_MS) waitRemaining = FILE_SOURCE_MAX_DELAY_MS;
+		}
+		/* Next frame is not due before the timeout. Wait out the timeout like a live sensor would. */
+		if (waitRemaining > timeout_ms) {
+			sleepMs(timeout_ms);
+			waitRemaining -= timeout_ms;
+			return SKELETON_SOURCE_TIMEOUT;
+		}
+		sleepMs(waitRemaining);
+	}
+
+	*frame = *next;
+	nextFrame++;
+	waitRemaining = -1;
+	return SKELETON_SOURCE_FRAME;
+}
+
+void FileSkeletonSource::Close()
+{
+	reader.Close();
+}
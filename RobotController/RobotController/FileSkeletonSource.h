@@ -0,0 +1,32 @@
+/*****************************************************
+*	FileSkeletonSource.h
+*
+*	Skeleton frames played back from a skeleton log,
+*	either paced by the recorded timestamps or as fast
+*	as the consumer can take them.
+*****************************************************/
+
+#pragma once
+
+#include "SkeletonSource.h"
+#include "SkeletonLog.h"
+
+class FileSkeletonSource : public SkeletonSource
+{
+public:
+	/* Public Functions */
+	FileSkeletonSource(const char* path, bool realtime);
+	~FileSkeletonSource();
+
+	int Open();
+	int GetNextFrame(skeletonFrame* frame, int timeout_ms);
+	void Close();
+
+private:
+	/* Private Variables */
+	const char*			path;
+	bool				realtime;
+	SkeletonLogReader	reader;
+	uint64_t			nextFrame;
+	int64_t				waitRemaining;	// ms until nextFrame is due when pacing, -1 if not yet computed
+};
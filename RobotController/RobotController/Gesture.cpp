@@ -1,333 +1,750 @@
-/*****************************************************
-*	Gesture.cpp
-*
-*	Kinect Gesture Recognition
-*
-*	Author: Charles Hartsell
-*			Ben Yett
-*
-*	Date:	4-3-17
-*****************************************************/
-
-#include "stdafx.h"
-
-#include "Gesture.h"
-#include "StateMachineDefs.h"
-#include <strsafe.h>
-#include <math.h>
-#include <windows.h>
-#include <NuiApi.h>
-#include <NuiSkeleton.h>
-#include <iostream>    
-#include <stdlib.h>
-#include <string>
-#include <fstream>
-
-#define WAIT_FOR_FRAME_TIME_MS	50
-
-Gesture::Gesture() :
-	m_pNuiSensor(NULL),
-	m_hNextSkeletonEvent(INVALID_HANDLE_VALUE),
-	m_pSkeletonStreamHandle(INVALID_HANDLE_VALUE)
-{
-	clearall();
-	user_input = NULL_CMD_MASK;
-	user_arg = 0.0;
-}
-
-Gesture::~Gesture()
-{
-	if (m_pNuiSensor)
-	{
-		m_pNuiSensor->NuiShutdown();
-	}
-
-	if (m_hNextSkeletonEvent && (m_hNextSkeletonEvent != INVALID_HANDLE_VALUE))
-	{
-		CloseHandle(m_hNextSkeletonEvent);
-	}
-}
-
-/* Basic functions for external access to private variables 
- *  NOTE:	The values of user_input and user_arg are reset each time determine_gesture() function is called
- *			These values should be read after every call of Update() before calling Update() again to ensure no input is missed. 		 
- */
-int Gesture::getUserInput()
-{
-	return user_input;
-}
-double Gesture::getUserArg()
-{
-	return user_arg;
-}
-
-void Gesture::ProcessSkeleton()
-{
-	NUI_SKELETON_FRAME skeletonFrame = { 0 };
-	int i;
-
-	HRESULT hr = m_pNuiSensor->NuiSkeletonGetNextFrame(0, &skeletonFrame);
-	if (FAILED(hr))
-	{
-		printf("ProcessSkeleton failed.\n");
-		return;
-	}
-
-	/* smooth out the skeleton data */
-	m_pNuiSensor->NuiTransformSmooth(&skeletonFrame, NULL);
-
-	/* Look if Kinect is currently tracking any skeletons. 6 is maximum number of skeletons Kinect will track. Take first available and stop. */
-	for (i = 0; i < 6; i++){
-		if (skeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED){
-			this->determine_gesture(skeletonFrame.SkeletonData[i]);
-			break;
-		}
-	}
-}
-
-/// <summary>
-/// Main processing function
-/// </summary>
-void Gesture::Update()
-{
-	/* Clear any previous user_input and user_arg */
-	user_input = NULL_CMD_MASK;
-	user_arg = 0.0;
-
-	if (NULL == m_pNuiSensor)
-	{
-		return;
-	}
-
-	/* Wait for new frame to become available from Kinect. Timeout: WAIT_FOR_FRAME_TIME_MS */
-	if (WAIT_OBJECT_0 == WaitForSingleObject(m_hNextSkeletonEvent, WAIT_FOR_FRAME_TIME_MS))
-	{
-		ProcessSkeleton();
-	}
-}
-
-void Gesture::determine_gesture(const NUI_SKELETON_DATA & skeleton)
-{
-	/* Extract desired skeleton data from argument struct */
-	const Vector4& rh = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT];
-	const Vector4& lh = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HAND_LEFT];
-	const Vector4& rs = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_SHOULDER_RIGHT];
-	const Vector4& re = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_ELBOW_RIGHT];
-	const Vector4& le = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_ELBOW_LEFT];
-	const Vector4& rhip = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HIP_RIGHT];
-	const Vector4& lhip = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HIP_LEFT];
-
-	/* Determine gesture and set user_input and user_arg as appropriate */
-	// Following 2 if loops allow us to reset variables when that arm is not in use, prevents unexpected results
-	if (rh.y < rhip.y) {
-		mana = 0;
-		manb = 0;
-		stop = 0;
-		turncount = 0;
-		result = 0;
-	}
-	if (lh.y < lhip.y) {
-		autoa = 0;
-		autob = 0;
-		turncount = 0;
-		result = 0;
-	}
-	// When hands are both above hips, recognized as a turn, returns angle measurement based on hand placement every frame
-	if (rh.y > rhip.y && lh.y > lhip.y && rh.y != lh.y) {
-		backwarda = 0;
-		backwardb = 0;
-		forwarda = 0;
-		forwardb = 0;
-		autoa = 0;
-		autob = 0;
-		mana = 0;
-		manb = 0;
-		stop = 0;
-		turncount++;
-		if (rh.x == lh.x) {
-			if (lh.y > rh.y) {
-				result -= PI / 2;
-			}
-			else {
-				result += PI / 2;
-			}
-		}
-		else if (rh.x>lh.x) {
-			result += atan((rh.y - lh.y) / (rh.x - lh.x));
-		}
-		if (turncount == 1) {
-			user_arg = result / 1;
-			if(user_arg < 0) user_input |= TURN_R_CMD_MASK;
-			else user_input |= TURN_L_CMD_MASK;
-			clearall();
-		}
-	}
-	// Used to prevent turning from occuring continuously
-	else user_input |= STOP_TURN_CMD_MASK;
-	// When the user's right hand is 0.15m above the right shoulder for 5 frames, return the stop command
-	if (rh.y > (rs.y + 0.15)) {
-		backwarda = 0;
-		backwardb = 0;
-		if (stop == 5) {
-			clearall();
-			user_input |= STOP_CMD_MASK;
-		}
-		else if (stop <= 4) {
-			stop++;
-		}
-	}
-	// After 2 motions with the right hand calling the robot towards you, returns the forward command
-	if (rh.y > re.y && forwarda > 0) {
-		backwarda = 0;
-		backwardb = 0;
-		if (forwarda == 2) {
-			user_input |= FORWARD_CMD_MASK;
-			clearall();
-		}
-		else {
-			forwardb = 1;
-		}
-	}
-	else if (rh.y < re.y) {
-		if (forwardb == 1) {
-			forwarda = 2;
-		}
-		else {
-			forwarda = 1;
-		}
-	}
-	// After 2 motions with the left hand sending the robot away, returns the backward command
-	if (lh.y < le.y && backwarda > 0) {
-		forwarda = 0;
-		forwardb = 0;
-		if (backwarda == 2) {
-			user_input |= REVERSE_CMD_MASK;
-			clearall();
-		}
-		else {
-			backwardb = 1;
-		}
-	}
-	else if (lh.y > le.y) {
-		if (backwardb == 1) {
-			backwarda = 2;
-		}
-		else {
-			backwarda = 1;
-		}
-	}
-	// After 2 waves of the left hand, returns the auto command
-	if (lh.x > le.x && autoa > 0 && lh.y > le.y) {
-		mana = 0;
-		manb = 0;
-		if (autoa == 2) {
-			user_input |= AUTO_MODE_CMD_MASK;
-			clearall();
-		}
-		else {
-			autob = 1;
-		}
-	}
-	else if (lh.x < le.x && lh.y > le.y) {
-		if (autob == 1) {
-			autoa = 2;
-		}
-		else {
-			autoa = 1;
-		}
-	}
-	// After 2 waves of the right hand, returns the manual command
-	if (rh.x < re.x && mana > 0 && rh.y > re.y) {
-		autoa = 0;
-		autob = 0;
-		if (mana == 2) {
-			user_input |= MANUAL_MODE_CMD_MASK;
-			clearall();
-		}
-		else {
-			manb = 1;
-		}
-	}
-	else if (rh.x > re.x && rh.y > re.y) {
-		if (manb == 1) {
-			mana = 2;
-		}
-		else {
-			mana = 1;
-		}
-	}
-}
-
-/// <summary>
-/// Create the first connected Kinect found 
-/// </summary>
-/// <returns>indicates success or failure</returns>
-HRESULT Gesture::CreateFirstConnected()
-{
-	INuiSensor * pNuiSensor;
-
-	int iSensorCount = 0;
-	HRESULT hr = NuiGetSensorCount(&iSensorCount);
-	if (FAILED(hr))
-	{
-		return hr;
-	}
-
-	// Look at each Kinect sensor
-	for (int i = 0; i < iSensorCount; ++i)
-	{
-		// Create the sensor so we can check status, if we can't create it, move on to the next
-		hr = NuiCreateSensorByIndex(i, &pNuiSensor);
-		if (FAILED(hr))
-		{
-			continue;
-		}
-
-		// Get the status of the sensor, and if connected, then we can initialize it
-		hr = pNuiSensor->NuiStatus();
-		if (S_OK == hr)
-		{
-			m_pNuiSensor = pNuiSensor;
-			break;
-		}
-
-		// This sensor wasn't OK, so release it since we're not using it
-		pNuiSensor->Release();
-	}
-
-	if (NULL != m_pNuiSensor)
-	{
-		// Initialize the Kinect and specify that we'll be using skeleton
-		hr = m_pNuiSensor->NuiInitialize(NUI_INITIALIZE_FLAG_USES_SKELETON);
-		if (SUCCEEDED(hr))
-		{
-			// Create an event that will be signaled when skeleton data is available
-			m_hNextSkeletonEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
-
-			// Open a skeleton stream to receive skeleton data
-			hr = m_pNuiSensor->NuiSkeletonTrackingEnable(m_hNextSkeletonEvent, 0);
-		}
-	}
-
-	if (NULL == m_pNuiSensor || FAILED(hr))
-	{
-		printf("No ready Kinect found!\n");
-		return E_FAIL;
-	}
-
-	return hr;
-}
-
-void Gesture::clearall() {
-	stop = 0;
-	forwarda = 0;
-	forwardb = 0;
-	backwarda = 0;
-	backwardb = 0;
-	autoa = 0;
-	autob = 0;
-	mana = 0;
-	manb = 0;
-	result = 0;
-	turncount = 0;
-}
+/*****************************************************
+*	Gesture.cpp
+*
+*	Kinect Gesture Recognition
+*
+*	Author: Charles Hartsell
+*			Ben Yett
+*
+*	Date:	4-3-17
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "Gesture.h"
+#include "StateMachineDefs.h"
+#include "LatencyTrace.h"
+#include <math.h>
+#include <iostream>    
+#include <stdlib.h>
+#include <string>
+#include <fstream>
+
+#define WAIT_FOR_FRAME_TIME_MS	50
+
+/*****************************************************
+*	Gesture definitions, evaluated in GESTURE_ID order.
+*	Adding a gesture means adding a row here (and a
+*	GESTURE_ID); the per-frame code does not change.
+*	Counts are the defaults, compileGestures takes
+*	them from gestureParams.
+*****************************************************/
+static const gestureDef gestureDefs[GESTURE_COUNT] = {
+	/* Turn: both hands above the hips at different heights. Hand slope gives the angle. */
+	{ GESTURE_TYPE_CONTINUOUS, GESTURE_P_TURN, 0, 0,
+		0, 0,
+		TURN_L_CMD_MASK, TURN_R_CMD_MASK, STOP_TURN_CMD_MASK },
+	/* Stop: right hand GESTURE_STOP_MARGIN above the right shoulder */
+	{ GESTURE_TYPE_HOLD, GESTURE_P_RH_ABOVE_RS, 0, GESTURE_STOP_HOLD_FRAMES,
+		GESTURE_P_RH_BELOW_RHIP, GESTURE_BIT(GESTURE_ID_REVERSE),
+		STOP_CMD_MASK, 0, 0 },
+	/* Forward: right hand beckons twice (down below the elbow, up above it), starting over once it drops below the hip */
+	{ GESTURE_TYPE_SEQUENCE, GESTURE_P_RH_ABOVE_RE, GESTURE_P_RH_BELOW_RE, GESTURE_SEQUENCE_COUNT,
+		GESTURE_P_RH_BELOW_RHIP, GESTURE_BIT(GESTURE_ID_REVERSE),
+		FORWARD_CMD_MASK, 0, 0 },
+	/* Reverse: left hand pushes away twice (up above the elbow, down below it), starting over once it drops below the hip */
+	{ GESTURE_TYPE_SEQUENCE, GESTURE_P_LH_BELOW_LE, GESTURE_P_LH_ABOVE_LE, GESTURE_SEQUENCE_COUNT,
+		GESTURE_P_LH_BELOW_LHIP, GESTURE_BIT(GESTURE_ID_FORWARD),
+		REVERSE_CMD_MASK, 0, 0 },
+	/* Auto mode: left hand waves twice */
+	{ GESTURE_TYPE_SEQUENCE, GESTURE_P_AUTO_OUT, GESTURE_P_AUTO_IN, GESTURE_WAVE_COUNT,
+		GESTURE_P_LH_BELOW_LHIP, GESTURE_BIT(GESTURE_ID_MANUAL),
+		AUTO_MODE_CMD_MASK, 0, 0 },
+	/* Manual mode: right hand waves twice */
+	{ GESTURE_TYPE_SEQUENCE, GESTURE_P_MANUAL_OUT, GESTURE_P_MANUAL_IN, GESTURE_WAVE_COUNT,
+		GESTURE_P_RH_BELOW_RHIP, GESTURE_BIT(GESTURE_ID_AUTO),
+		MANUAL_MODE_CMD_MASK, 0, 0 },
+};
+
+/* Automatons built from gestureDefs with the default parameters before main() runs */
+static gestureMachine gestureMachines[GESTURE_COUNT];
+
+static int compileGestureDefs()
+{
+	gestureParams params;
+
+	Gesture::getDefaultParams(&params);
+	if (Gesture::compileGestures(params, gestureMachines) != 0) {
+		printf("ERROR: Gesture definitions are invalid.\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int gestureDefsCompiled = compileGestureDefs();
+
+Gesture::Gesture() :
+	smoothing(true),
+	arbitration(GESTURE_ARBITRATE_LONGEST),
+	frameID(0),
+	frameTime(0),
+	source(NULL)
+{
+	getDefaultParams(&params);
+	memcpy(machines, gestureMachines, sizeof(machines));
+	memset(&frameStats, 0x00, sizeof(frameStats));
+	lastTimestamp = 0;
+	lastFrameNumber = 0;
+	clearall();
+	user_input = NULL_CMD_MASK;
+	user_arg = 0.0;
+	user_confidence = 0.0;
+	user_prediction = NULL_CMD_MASK;
+	prediction_confidence = 0.0;
+}
+
+Gesture::Gesture(SkeletonSource* source) :
+	smoothing(true),
+	arbitration(GESTURE_ARBITRATE_LONGEST),
+	frameID(0),
+	frameTime(0),
+	source(source)
+{
+	getDefaultParams(&params);
+	memcpy(machines, gestureMachines, sizeof(machines));
+	memset(&frameStats, 0x00, sizeof(frameStats));
+	lastTimestamp = 0;
+	lastFrameNumber = 0;
+	clearall();
+	user_input = NULL_CMD_MASK;
+	user_arg = 0.0;
+	user_confidence = 0.0;
+	user_prediction = NULL_CMD_MASK;
+	prediction_confidence = 0.0;
+}
+
+Gesture::~Gesture()
+{
+	recorder.Close();
+}
+
+/* Basic functions for external access to private variables 
+ *  NOTE:	The values of user_input and user_arg are reset each time determine_gesture() function is called
+ *			These values should be read after every call of Update() before calling Update() again to ensure no input is missed. 		 
+ */
+int Gesture::getUserInput()
+{
+	return user_input;
+}
+double Gesture::getUserArg()
+{
+	return user_arg;
+}
+double Gesture::getUserConfidence()
+{
+	return user_confidence;
+}
+uint16_t Gesture::getUserPrediction(double* confidence)
+{
+	*confidence = prediction_confidence;
+	return user_prediction;
+}
+
+uint32_t Gesture::getFrameID()
+{
+	return frameID;
+}
+
+int64_t Gesture::getFrameTime()
+{
+	return frameTime;
+}
+
+const gestureFrameStats & Gesture::getFrameStats()
+{
+	return frameStats;
+}
+
+/* Timestamps give the elapsed time. Sources without them (equal timestamps) fall back to frame numbers.
+ * A timestamp going backwards is a restarted replay, not a gap. */
+int Gesture::countFrame(const skeletonFrame & frame)
+{
+	int64_t steps = 1;
+
+	if (frameStats.received > 0) {
+		if (frame.timestamp > lastTimestamp) steps = (frame.timestamp - lastTimestamp + GESTURE_FRAME_MS / 2) / GESTURE_FRAME_MS;
+		else if (frame.timestamp == lastTimestamp && frame.frameNumber > lastFrameNumber) steps = frame.frameNumber - lastFrameNumber;
+		if (steps < 1) steps = 1;
+	}
+	frameStats.received++;
+	if (steps > 1) {
+		frameStats.dropped += steps - 1;
+		frameStats.gaps++;
+	}
+	lastTimestamp = frame.timestamp;
+	lastFrameNumber = frame.frameNumber;
+
+	return (steps > GESTURE_MAX_CATCHUP_FRAMES + 1) ? GESTURE_MAX_CATCHUP_FRAMES + 1 : (int)steps;
+}
+
+void Gesture::setArbitration(int policy)
+{
+	arbitration = policy;
+}
+
+int Gesture::getArbitration()
+{
+	return arbitration;
+}
+
+uint32_t Gesture::getOperatorID()
+{
+	if (operatorTrack < 0) return 0;
+	return tracks[operatorTrack].trackingID;
+}
+
+int Gesture::getTrackedCount()
+{
+	int i, n = 0;
+
+	for (i = 0; i < SKELETON_COUNT; i++) {
+		if (tracks[i].active) n++;
+	}
+	return n;
+}
+
+int Gesture::parseArbitration(const char* name)
+{
+	if (strcmp(name, "longest") == 0) return GESTURE_ARBITRATE_LONGEST;
+	if (strcmp(name, "closest") == 0) return GESTURE_ARBITRATE_CLOSEST;
+	if (strcmp(name, "claim") == 0) return GESTURE_ARBITRATE_CLAIM;
+	return -1;
+}
+
+int Gesture::startRecording(const char* path)
+{
+	return recorder.Open(path);
+}
+
+void Gesture::stopRecording()
+{
+	recorder.Close();
+}
+
+int Gesture::setParams(const gestureParams & params)
+{
+	gestureMachine compiled[GESTURE_COUNT];
+	int i;
+
+	if (compileGestures(params, compiled) != 0) return -1;
+	memcpy(machines, compiled, sizeof(machines));
+	this->params = params;
+	for (i = 0; i < SKELETON_COUNT; i++) clearGestureState(&tracks[i].state);
+	return 0;
+}
+
+const gestureParams & Gesture::getParams()
+{
+	return params;
+}
+
+void Gesture::getDefaultParams(gestureParams* params)
+{
+	params->stopMargin = GESTURE_STOP_MARGIN;
+	params->stopHoldFrames = GESTURE_STOP_HOLD_FRAMES;
+	params->sequenceCount = GESTURE_SEQUENCE_COUNT;
+	params->waveCount = GESTURE_WAVE_COUNT;
+	params->turnDeadband = GESTURE_TURN_DEADBAND;
+	params->commitConfidence = GESTURE_COMMIT_CONFIDENCE;
+}
+
+void Gesture::setSmoothing(bool enable)
+{
+	smoothing = enable;
+	filter.Reset();
+}
+
+bool Gesture::getSmoothing()
+{
+	return smoothing;
+}
+
+SkeletonFilter* Gesture::getFilter()
+{
+	return &filter;
+}
+
+int Gesture::loadTemplates(const char* path)
+{
+	return templates.Load(path);
+}
+
+int Gesture::getTemplateCount()
+{
+	return templates.getCount();
+}
+
+void Gesture::ProcessFrame(const skeletonFrame & raw)
+{
+	skeletonFrame smoothed;
+	gestureTrack* track;
+	int i, op, steps;
+
+	user_input = NULL_CMD_MASK;
+	user_arg = 0.0;
+	user_confidence = 0.0;
+	user_prediction = NULL_CMD_MASK;
+	prediction_confidence = 0.0;
+
+	steps = countFrame(raw);
+	if (smoothing) filter.Apply(raw, &smoothed);
+	const skeletonFrame& frame = smoothing ? smoothed : raw;
+
+	/* Run every tracked skeleton (Kinect tracks at most 6) through its own recognizer so a bystander cannot disturb the operator's counters */
+	for (i = 0; i < SKELETON_COUNT; i++) tracks[i].seen = false;
+	for (i = 0; i < SKELETON_COUNT; i++){
+		const skeletonData& skeleton = frame.skeletons[i];
+		if (skeleton.trackingState != SKELETON_TRACKED) continue;
+
+		track = findTrack(skeleton.trackingID);
+		if (track == NULL) continue;
+		this->determine_gesture(track, skeleton, steps);
+	}
+
+	/* People who left the field of view give up their recognizer (and control) */
+	for (i = 0; i < SKELETON_COUNT; i++) {
+		if (tracks[i].active && !tracks[i].seen) {
+			tracks[i].active = false;
+			if (operatorTrack == i) operatorTrack = -1;
+		}
+	}
+
+	/* Only the operator's commands reach the robot. Nothing is sent on the frame control changes hands. */
+	op = chooseOperator();
+	if (op != operatorTrack) {
+		operatorTrack = op;
+		return;
+	}
+	if (operatorTrack >= 0) {
+		user_input = tracks[operatorTrack].input;
+		user_arg = tracks[operatorTrack].arg;
+		user_confidence = tracks[operatorTrack].confidence;
+		user_prediction = tracks[operatorTrack].prediction;
+		prediction_confidence = tracks[operatorTrack].predictionConfidence;
+	}
+}
+
+/* Recognizer for trackingID, starting a fresh one if this person is new */
+gestureTrack* Gesture::findTrack(uint32_t trackingID)
+{
+	int i;
+	gestureTrack* track = NULL;
+
+	for (i = 0; i < SKELETON_COUNT; i++) {
+		if (tracks[i].active && tracks[i].trackingID == trackingID) return &tracks[i];
+		if (!tracks[i].active && track == NULL) track = &tracks[i];
+	}
+	if (track != NULL) {
+		memset(track, 0x00, sizeof(gestureTrack));
+		matchers[track - tracks].Reset();
+		track->active = true;
+		track->trackingID = trackingID;
+	}
+	return track;
+}
+
+/* Index of the track that should control the robot this frame, -1 for nobody */
+int Gesture::chooseOperator()
+{
+	int i, best;
+
+	best = operatorTrack;
+	for (i = 0; i < SKELETON_COUNT; i++) {
+		if (!tracks[i].active) continue;
+		switch (arbitration) {
+		case GESTURE_ARBITRATE_CLOSEST:
+			if (best < 0 || tracks[i].z < tracks[best].z) best = i;
+			break;
+		case GESTURE_ARBITRATE_CLAIM:
+			if (tracks[i].claimFrames == GESTURE_CLAIM_HOLD_FRAMES) best = i;
+			break;
+		default:
+			if (best < 0 || tracks[i].framesTracked > tracks[best].framesTracked) best = i;
+			break;
+		}
+	}
+	return best;
+}
+
+/// <summary>
+/// Main processing function
+/// </summary>
+int Gesture::Update()
+{
+	skeletonFrame frame;
+	int result;
+
+	/* Clear any previous user_input and user_arg */
+	user_input = NULL_CMD_MASK;
+	user_arg = 0.0;
+	user_confidence = 0.0;
+	user_prediction = NULL_CMD_MASK;
+	prediction_confidence = 0.0;
+
+	if (NULL == source)
+	{
+		return SKELETON_SOURCE_ERROR;
+	}
+
+	/* Wait for new frame to become available from source. Timeout: WAIT_FOR_FRAME_TIME_MS */
+	result = source->GetNextFrame(&frame, WAIT_FOR_FRAME_TIME_MS);
+	if (result == SKELETON_SOURCE_FRAME)
+	{
+		frameTime = LatencyTrace::Now();
+		if (++frameID == 0) frameID = 1;
+		if (recorder.isOpen()) recorder.WriteFrame(frame);
+		ProcessFrame(frame);
+	}
+	return result;
+}
+
+void Gesture::determine_gesture(gestureTrack* track, const skeletonData & skeleton, int steps)
+{
+	uint32_t predicates;
+	double angle, confidence;
+	int i;
+
+	track->seen = true;
+	/* Someone who just appeared has no missed frames to make up */
+	if (track->framesTracked == 0) steps = 1;
+	track->framesTracked += steps;
+	track->z = skeleton.position.z;
+
+	/* Features every recognizer below reads. Velocity needs the previous frame of the same person. */
+	if (track->framesTracked == 1) computeFeatures(skeleton, &track->features);
+	else updateFeatures(skeleton, steps * GESTURE_FRAME_MS / 1000.0f, &track->features);
+
+	/* chooseOperator claims on the frame the hold reaches GESTURE_CLAIM_HOLD_FRAMES, so a gap must not step over it */
+	if (!isClaimPose(track->features)) track->claimFrames = 0;
+	else if (track->claimFrames < GESTURE_CLAIM_HOLD_FRAMES && track->claimFrames + steps > GESTURE_CLAIM_HOLD_FRAMES) track->claimFrames = GESTURE_CLAIM_HOLD_FRAMES;
+	else track->claimFrames += steps;
+
+	predicates = evaluatePredicates(track->features, params, &angle);
+
+	/* Steer from the running estimate while the turn pose is held, starting afresh with each turn */
+	if ((predicates & GESTURE_P_TURN) == GESTURE_P_TURN) angle = updateTurn(&track->turn, track->features, &confidence);
+	else {
+		clearTurn(&track->turn);
+		confidence = 0.0;
+	}
+
+	track->arg = 0.0;
+	track->input = NULL_CMD_MASK;
+	for (i = 0; i < steps; i++) track->input |= stepGesture(machines, &track->state, predicates, angle, &track->arg);
+	track->prediction = predictGesture(machines, track->state, &track->predictionConfidence);
+
+	if (templates.getCount() > 0) {
+		float features[TEMPLATE_FEATURES];
+		TemplateMatcher* matcher = &matchers[track - tracks];
+
+		TemplateLibrary::extractFeatures(track->features, features);
+		matcher->Push(features);
+		track->input |= matcher->Match(templates);
+	}
+
+	if (track->input & (TURN_L_CMD_MASK | TURN_R_CMD_MASK)) track->confidence = confidence;
+	else if (track->input & ~STOP_TURN_CMD_MASK) track->confidence = commitConfidence(machines, track->input);
+	else track->confidence = 0.0;
+}
+
+/* Claim gesture: both hands above the head */
+bool Gesture::isClaimPose(const gestureFeatures & f)
+{
+	return (f.y[SKELETON_POSITION_HAND_RIGHT] > f.y[SKELETON_POSITION_HEAD]) && (f.y[SKELETON_POSITION_HAND_LEFT] > f.y[SKELETON_POSITION_HEAD]);
+}
+
+uint32_t Gesture::evaluatePredicates(const skeletonData & skeleton, double* angle)
+{
+	gestureParams params;
+
+	getDefaultParams(&params);
+	return evaluatePredicates(skeleton, params, angle);
+}
+
+uint32_t Gesture::evaluatePredicates(const skeletonData & skeleton, const gestureParams & params, double* angle)
+{
+	gestureFeatures features;
+
+	computeFeatures(skeleton, &features);
+	return evaluatePredicates(features, params, angle);
+}
+
+/* Evaluate every joint relation used by the gesture rules. Stateless, so it can also be run in bulk (see GestureBatch). */
+uint32_t Gesture::evaluatePredicates(const gestureFeatures & f, const gestureParams & params, double* angle)
+{
+	uint32_t p = 0;
+
+	/* Joints used by the rules, in shoulder widths */
+	const float rhx = f.x[SKELETON_POSITION_HAND_RIGHT], rhy = f.y[SKELETON_POSITION_HAND_RIGHT];
+	const float lhx = f.x[SKELETON_POSITION_HAND_LEFT], lhy = f.y[SKELETON_POSITION_HAND_LEFT];
+	const float rsy = f.y[SKELETON_POSITION_SHOULDER_RIGHT];
+	const float rex = f.x[SKELETON_POSITION_ELBOW_RIGHT], rey = f.y[SKELETON_POSITION_ELBOW_RIGHT];
+	const float lex = f.x[SKELETON_POSITION_ELBOW_LEFT], ley = f.y[SKELETON_POSITION_ELBOW_LEFT];
+	const float rhipy = f.y[SKELETON_POSITION_HIP_RIGHT];
+	const float lhipy = f.y[SKELETON_POSITION_HIP_LEFT];
+
+	if (rhy > rhipy) p |= GESTURE_P_RH_ABOVE_RHIP;
+	if (rhy < rhipy) p |= GESTURE_P_RH_BELOW_RHIP;
+	if (lhy > lhipy) p |= GESTURE_P_LH_ABOVE_LHIP;
+	if (lhy < lhipy) p |= GESTURE_P_LH_BELOW_LHIP;
+	if (fabs(rhy - lhy) > params.turnDeadband) p |= GESTURE_P_HANDS_Y_DIFFER;
+	if (rhy > (rsy + params.stopMargin)) p |= GESTURE_P_RH_ABOVE_RS;
+	if (rhy > rey) p |= GESTURE_P_RH_ABOVE_RE;
+	if (rhy < rey) p |= GESTURE_P_RH_BELOW_RE;
+	if (rhx > rex) p |= GESTURE_P_RH_RIGHT_OF_RE;
+	if (rhx < rex) p |= GESTURE_P_RH_LEFT_OF_RE;
+	if (lhy > ley) p |= GESTURE_P_LH_ABOVE_LE;
+	if (lhy < ley) p |= GESTURE_P_LH_BELOW_LE;
+	if (lhx > lex) p |= GESTURE_P_LH_RIGHT_OF_LE;
+	if (lhx < lex) p |= GESTURE_P_LH_LEFT_OF_LE;
+
+	/* Turn angle from hand placement. Only used when both hands are above the hips. */
+	if (rhx == lhx) {
+		if (lhy > rhy) *angle = -PI / 2;
+		else *angle = PI / 2;
+	}
+	else if (rhx > lhx) {
+		*angle = atan((rhy - lhy) / (rhx - lhx));
+	}
+	else *angle = 0.0;
+
+	return p;
+}
+
+/* Exponential average of the hand vector, and of its direction for the steadiness half of the confidence */
+double Gesture::updateTurn(gestureTurn* t, const gestureFeatures & f, double* confidence)
+{
+	const float a = (float)GESTURE_TURN_SMOOTHING;
+	float dx, dy, length, ux, uy, spread, steadiness;
+
+	dx = f.x[SKELETON_POSITION_HAND_RIGHT] - f.x[SKELETON_POSITION_HAND_LEFT];
+	dy = f.y[SKELETON_POSITION_HAND_RIGHT] - f.y[SKELETON_POSITION_HAND_LEFT];
+	length = sqrtf(dx * dx + dy * dy);
+	ux = (length > 0.0f) ? dx / length : 0.0f;
+	uy = (length > 0.0f) ? dy / length : 0.0f;
+
+	if (!t->active) {
+		t->dx = dx;
+		t->dy = dy;
+		t->ux = ux;
+		t->uy = uy;
+		t->active = true;
+	}
+	else {
+		t->dx += a * (dx - t->dx);
+		t->dy += a * (dy - t->dy);
+		t->ux += a * (ux - t->ux);
+		t->uy += a * (uy - t->uy);
+	}
+
+	spread = sqrtf(t->dx * t->dx + t->dy * t->dy) / (float)GESTURE_TURN_FULL_SPREAD;
+	if (spread > 1.0f) spread = 1.0f;
+	steadiness = sqrtf(t->ux * t->ux + t->uy * t->uy);
+	if (steadiness > 1.0f) steadiness = 1.0f;
+	*confidence = spread * steadiness;
+
+	/* Crossed hands steer the same way as uncrossed ones, so the angle never leaves +-PI/2 */
+	return atan2(t->dy, fabsf(t->dx));
+}
+
+void Gesture::clearTurn(gestureTurn* t)
+{
+	memset(t, 0x00, sizeof(gestureTurn));
+}
+
+/* Advance every gesture automaton by one frame. Returns the recognized command mask and sets *arg for turns.
+ * Table lookups only, so every frame costs the same whatever the gestures are doing. */
+uint16_t Gesture::stepGesture(gestureState* s, uint32_t p, double angle, double* arg)
+{
+	return stepGesture(gestureMachines, s, p, angle, arg);
+}
+
+uint16_t Gesture::stepGesture(const gestureMachine* machines, gestureState* s, uint32_t p, double angle, double* arg)
+{
+	const gestureMachine* m;
+	uint16_t input = NULL_CMD_MASK;
+	uint64_t states = s->states;
+	int i, shift, symbol, state, entry, action, neg, angleFired;
+
+	neg = (angle < 0) ? GESTURE_ACT_NEG : 0;
+	angleFired = 0;
+	for (i = 0; i < GESTURE_COUNT; i++) {
+		m = &machines[i];
+		shift = i * GESTURE_STATE_BITS;
+
+		/* Arm not in use resets, prevents unexpected results */
+		state = ((p & m->release) != 0) ? 0 : (int)((states >> shift) & (GESTURE_MAX_STATES - 1));
+
+		symbol = (((p & m->pose) == m->pose) << 1) | ((p & m->startPose) == m->startPose);
+		entry = m->transition[state][symbol];
+		action = entry >> GESTURE_STATE_BITS;
+
+		states = (states & ~((uint64_t)(GESTURE_MAX_STATES - 1) << shift)) | ((uint64_t)(entry & (GESTURE_MAX_STATES - 1)) << shift);
+		states &= m->keep[action & (GESTURE_ACT_RESET | GESTURE_ACT_FIRE)];
+		input |= m->output[action | neg];
+		angleFired |= m->angleArg & action;
+	}
+
+	if (angleFired & GESTURE_ACT_FIRE) *arg = angle;
+	s->states = states;
+	return input;
+}
+
+void Gesture::clearGestureState(gestureState* s)
+{
+	s->states = 0;
+}
+
+uint16_t Gesture::predictGesture(const gestureMachine* machines, const gestureState & s, double* confidence)
+{
+	uint16_t prediction = NULL_CMD_MASK;
+	float best = 0.0f, progress;
+	int i;
+
+	for (i = 0; i < GESTURE_COUNT; i++) {
+		progress = machines[i].progress[(s.states >> (i * GESTURE_STATE_BITS)) & (GESTURE_MAX_STATES - 1)];
+		if (progress > best) {
+			best = progress;
+			prediction = machines[i].output[GESTURE_ACT_FIRE];
+		}
+	}
+	*confidence = best;
+	return prediction;
+}
+
+double Gesture::commitConfidence(const gestureMachine* machines, uint16_t input)
+{
+	float commit = 1.0f;
+	int i;
+
+	for (i = 0; i < GESTURE_COUNT; i++) {
+		if ((machines[i].output[GESTURE_ACT_FIRE] & input) && machines[i].commit < commit) commit = machines[i].commit;
+	}
+	return commit;
+}
+
+int Gesture::compileGestures(const gestureParams & params, gestureMachine* machines)
+{
+	gestureDef def;
+	int i;
+
+	for (i = 0; i < GESTURE_COUNT; i++) {
+		def = gestureDefs[i];
+		if (i == GESTURE_ID_STOP) def.count = params.stopHoldFrames;
+		else if (i == GESTURE_ID_FORWARD || i == GESTURE_ID_REVERSE) def.count = params.sequenceCount;
+		else if (i == GESTURE_ID_AUTO || i == GESTURE_ID_MANUAL) def.count = params.waveCount;
+		if (compileGesture(def, params.commitConfidence, &machines[i]) != 0) return -1;
+	}
+	return 0;
+}
+
+int Gesture::compileGesture(const gestureDef & def, gestureMachine* m)
+{
+	return compileGesture(def, 1.0, m);
+}
+
+/* Expand a definition into a transition table over (state, symbol).
+ * SEQUENCE states: even = waiting for startPose, odd = waiting for pose. State 2 * count - 1 fires on pose.
+ * Each state is the number of half-repetitions done, so with early commit the gesture fires on
+ * whichever half-repetition first brings it to commitConfidence. */
+int Gesture::compileGesture(const gestureDef & def, double commitConfidence, gestureMachine* m)
+{
+	int states, state, symbol, pose, start, next, action, commitSteps, j;
+
+	memset(m, 0x00, sizeof(gestureMachine));
+	if (def.pose == 0 || !(commitConfidence > 0.0 && commitConfidence <= 1.0)) return -1;
+
+	switch (def.type) {
+	case GESTURE_TYPE_CONTINUOUS:
+		states = 1;
+		break;
+	case GESTURE_TYPE_HOLD:
+		states = def.count + 1;
+		break;
+	case GESTURE_TYPE_SEQUENCE:
+		if (def.startPose == 0) return -1;
+		states = 2 * def.count;
+		break;
+	default:
+		return -1;
+	}
+	if (def.count < 0 || states < 1 || states > GESTURE_MAX_STATES) return -1;
+
+	/* Half-repetitions needed before a SEQUENCE fires, at least one */
+	commitSteps = states;
+	if (def.type == GESTURE_TYPE_SEQUENCE) {
+		commitSteps = (int)ceil(commitConfidence * states - 1e-9);
+		if (commitSteps < 1) commitSteps = 1;
+	}
+
+	m->pose = def.pose;
+	m->startPose = def.startPose;		// 0: symbol bit 0 is always set and ignored
+	m->release = def.release;
+	m->angleArg = (def.type == GESTURE_TYPE_CONTINUOUS && def.commandNeg != 0) ? GESTURE_ACT_FIRE : 0;
+
+	for (state = 0; state < GESTURE_MAX_STATES; state++) {
+		for (symbol = 0; symbol < GESTURE_SYMBOLS; symbol++) {
+			pose = (symbol >> 1) & 1;
+			start = (def.startPose != 0) && (symbol & 1);
+			next = state;
+			action = 0;
+
+			if (state < states) {
+				switch (def.type) {
+				case GESTURE_TYPE_CONTINUOUS:
+					action = pose ? GESTURE_ACT_FIRE : GESTURE_ACT_IDLE;
+					break;
+				case GESTURE_TYPE_HOLD:
+					if (!pose) break;
+					action = GESTURE_ACT_RESET;
+					if (state == def.count) action |= GESTURE_ACT_FIRE;
+					else next = state + 1;
+					break;
+				case GESTURE_TYPE_SEQUENCE:
+					/* Pose only counts once a repetition has started. Otherwise look for startPose. */
+					if (pose && state > 0) {
+						action = GESTURE_ACT_RESET;
+						if ((state & 1) && state + 1 >= commitSteps) action |= GESTURE_ACT_FIRE;
+						else if (state & 1) next = state + 1;
+					}
+					else if (start && !(state & 1)) {
+						if (state + 1 >= commitSteps) action = GESTURE_ACT_FIRE;
+						else next = state + 1;
+					}
+					break;
+				}
+			}
+			if (action & GESTURE_ACT_FIRE) next = 0;
+			m->transition[state][symbol] = (uint8_t)(next | (action << GESTURE_STATE_BITS));
+		}
+	}
+
+	/* Partial match confidence: HOLD frames held, SEQUENCE half-repetitions done (CONTINUOUS has no partial match) */
+	for (state = 0; state < states; state++) m->progress[state] = (float)state / (float)states;
+	m->commit = (float)commitSteps / (float)states;
+
+	/* State bits kept after each action. Resets clear the listed gestures, firing clears every gesture. */
+	m->keep[0] = ~(uint64_t)0;
+	m->keep[GESTURE_ACT_RESET] = ~(uint64_t)0;
+	for (j = 0; j < GESTURE_COUNT; j++) {
+		if (def.resets & GESTURE_BIT(j)) m->keep[GESTURE_ACT_RESET] &= ~((uint64_t)(GESTURE_MAX_STATES - 1) << (j * GESTURE_STATE_BITS));
+	}
+	m->keep[GESTURE_ACT_FIRE] = 0;
+	m->keep[GESTURE_ACT_RESET | GESTURE_ACT_FIRE] = 0;
+
+	/* Reported command for each action, and for each action with a negative angle */
+	for (action = 0; action < GESTURE_ACTIONS; action++) {
+		if (action & GESTURE_ACT_FIRE) m->output[action] = ((action & GESTURE_ACT_NEG) && m->angleArg) ? def.commandNeg : def.command;
+		if (action & GESTURE_ACT_IDLE) m->output[action] |= def.idleCommand;
+	}
+
+	return 0;
+}
+
+void Gesture::clearall() {
+	int i;
+
+	memset(tracks, 0x00, sizeof(tracks));
+	for (i = 0; i < SKELETON_COUNT; i++) matchers[i].Reset();
+	operatorTrack = -1;
+}
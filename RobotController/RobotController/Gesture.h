@@ -1,64 +1,344 @@
-/*****************************************************
-*	Gesture.h
-*
-*	Kinect Gesture Recognition
-*
-*	Author: Charles Hartsell
-*			Ben Yett
-*
-*	Date:	4-3-17
-*****************************************************/
-
-#pragma once
-
-#include <windows.h>
-#include <NuiApi.h>
-
-/* Gesture Turning parameters */
-#define GESTURE_MAX_TURN_L PI/2
-#define GESTURE_MAX_TURN_R -PI/2
-
-public class Gesture
-{
-public:
-	/* Public Functions */
-	Gesture();
-	~Gesture();
-	void Update();
-	int getUserInput();
-	double getUserArg();
-
-	/// <summary>
-	/// Create the first connected Kinect found 
-	/// </summary>
-	/// <returns>S_OK on success, otherwise failure code</returns>
-	HRESULT                 CreateFirstConnected();
-
-	/* Public Variables */
-
-private:
-	/* Private Functions */
-	void clearall();
-
-	/// <summary>
-	/// Handle new skeleton data
-	/// </summary>
-	void                    ProcessSkeleton();
-
-	/// <summary>
-	/// Gesture recognition using skeleton data
-	/// </summary>
-	void determine_gesture(const NUI_SKELETON_DATA & skeleton);
-	
-
-	/* Private Variables */
-	int stop, forwarda, forwardb, backwarda, backwardb, autoa, autob, mana, manb, turncount;
-	int user_input;
-	double user_arg, result;
-
-	INuiSensor*             m_pNuiSensor;
-
-	HANDLE                  m_pSkeletonStreamHandle;
-	HANDLE                  m_hNextSkeletonEvent;
-
-};
+/*****************************************************
+*	Gesture.h
+*
+*	Kinect Gesture Recognition
+*
+*	Author: Charles Hartsell
+*			Ben Yett
+*
+*	Date:	4-3-17
+*****************************************************/
+
+#pragma once
+
+#include "GestureFeatures.h"
+#include "SkeletonDefs.h"
+#include "SkeletonFilter.h"
+#include "SkeletonLog.h"
+#include "SkeletonSource.h"
+#include "TemplateMatcher.h"
+
+/* Gesture Turning parameters */
+#define GESTURE_MAX_TURN_L PI/2
+#define GESTURE_MAX_TURN_R -PI/2
+#define GESTURE_TURN_SMOOTHING		0.5		// weight of the newest frame in the steering average
+#define GESTURE_TURN_FULL_SPREAD	0.75	// hand separation (shoulder widths) at which the steering angle is fully trusted
+
+/* Frame timing. Holds are counted in sensor frame periods taken from the frame timestamps, so frames
+ * dropped by the sensor or a stalled thread still count. Longer gaps are made up only this far. */
+#define GESTURE_FRAME_MS			33		// Kinect skeleton frame period
+#define GESTURE_MAX_CATCHUP_FRAMES	5
+
+/* Gesture Stop parameters. Distances in the rules are in shoulder widths (see GestureFeatures.h). */
+#define GESTURE_STOP_MARGIN			0.4		// right hand must be above right shoulder, about 0.15 m on an adult
+#define GESTURE_STOP_HOLD_FRAMES	5
+
+/* Gesture repetition parameters */
+#define GESTURE_SEQUENCE_COUNT		2		// forward beckons, reverse pushes
+#define GESTURE_WAVE_COUNT			2		// auto and manual mode waves
+
+/* Early commit: a SEQUENCE gesture fires once this fraction of its half-repetitions is done, 1.0 waits for all of them */
+#define GESTURE_COMMIT_CONFIDENCE	1.0
+
+/* Gesture Turning dead band */
+#define GESTURE_TURN_DEADBAND		0.2		// shoulder widths hands must differ in height to turn, so hands resting level (on the hips) do not
+
+/* Joint relation predicates. Evaluated once per skeleton per frame from its features by Gesture::evaluatePredicates. */
+#define GESTURE_P_RH_ABOVE_RHIP		0x0001
+#define GESTURE_P_RH_BELOW_RHIP		0x0002
+#define GESTURE_P_LH_ABOVE_LHIP		0x0004
+#define GESTURE_P_LH_BELOW_LHIP		0x0008
+#define GESTURE_P_HANDS_Y_DIFFER	0x0010
+#define GESTURE_P_RH_ABOVE_RS		0x0020
+#define GESTURE_P_RH_ABOVE_RE		0x0040
+#define GESTURE_P_RH_BELOW_RE		0x0080
+#define GESTURE_P_RH_RIGHT_OF_RE	0x0100
+#define GESTURE_P_RH_LEFT_OF_RE		0x0200
+#define GESTURE_P_LH_ABOVE_LE		0x0400
+#define GESTURE_P_LH_BELOW_LE		0x0800
+#define GESTURE_P_LH_RIGHT_OF_LE	0x1000
+#define GESTURE_P_LH_LEFT_OF_LE		0x2000
+
+/* Predicate combinations used by the rules */
+#define GESTURE_P_TURN			(GESTURE_P_RH_ABOVE_RHIP | GESTURE_P_LH_ABOVE_LHIP | GESTURE_P_HANDS_Y_DIFFER)
+#define GESTURE_P_AUTO_OUT		(GESTURE_P_LH_RIGHT_OF_LE | GESTURE_P_LH_ABOVE_LE)
+#define GESTURE_P_AUTO_IN		(GESTURE_P_LH_LEFT_OF_LE | GESTURE_P_LH_ABOVE_LE)
+#define GESTURE_P_MANUAL_OUT	(GESTURE_P_RH_LEFT_OF_RE | GESTURE_P_RH_ABOVE_RE)
+#define GESTURE_P_MANUAL_IN		(GESTURE_P_RH_RIGHT_OF_RE | GESTURE_P_RH_ABOVE_RE)
+
+/* Gesture definition types */
+#define GESTURE_TYPE_CONTINUOUS		0	// reported every frame the pose is held
+#define GESTURE_TYPE_HOLD			1	// reported once the pose has been held for count frames
+#define GESTURE_TYPE_SEQUENCE		2	// reported after count repetitions of startPose followed by pose
+
+/* Gestures, in evaluation order. Index into gestureDefs and gestureState. */
+#define GESTURE_ID_TURN			0
+#define GESTURE_ID_STOP			1
+#define GESTURE_ID_FORWARD		2
+#define GESTURE_ID_REVERSE		3
+#define GESTURE_ID_AUTO			4
+#define GESTURE_ID_MANUAL		5
+#define GESTURE_COUNT			6
+#define GESTURE_BIT(id)			(1 << (id))
+
+/* Largest automaton a definition can compile to (HOLD: count + 1 states, SEQUENCE: 2 * count states).
+ * Each gesture's state is a 4 bit field of gestureState, so at most 16 gestures. */
+#define GESTURE_MAX_STATES		16
+#define GESTURE_STATE_BITS		4
+
+/* Declarative description of one gesture. See gestureDefs in Gesture.cpp. */
+typedef struct {
+	int			type;			// GESTURE_TYPE_*
+	uint32_t	pose;			// predicates that must all hold
+	uint32_t	startPose;		// SEQUENCE: predicates that must all hold to start each repetition
+	int			count;			// HOLD: frames held, SEQUENCE: repetitions
+	uint32_t	release;		// predicate that clears this gesture's progress
+	uint32_t	resets;			// GESTURE_BITs of gestures whose progress is cleared while this one advances
+	uint16_t	command;		// reported on completion (CONTINUOUS: while held with angle >= 0)
+	uint16_t	commandNeg;		// CONTINUOUS: reported while held with angle < 0, with the angle as argument
+	uint16_t	idleCommand;	// CONTINUOUS: reported while not held
+}gestureDef;
+
+/* Actions of a compiled transition */
+#define GESTURE_ACT_RESET		0x01	// clear the progress of the gestures in resets
+#define GESTURE_ACT_FIRE		0x02	// report the command and clear the progress of every gesture
+#define GESTURE_ACT_IDLE		0x04	// report idleCommand
+#define GESTURE_ACT_NEG			0x08	// output index only: angle < 0
+#define GESTURE_ACTIONS			16
+
+/* Input symbols of a compiled gesture: bit 1 = pose holds, bit 0 = startPose holds */
+#define GESTURE_SYMBOLS			4
+
+/* Table-driven automaton compiled from a gestureDef */
+typedef struct {
+	uint32_t	pose;
+	uint32_t	startPose;
+	uint32_t	release;
+	uint8_t		angleArg;										// GESTURE_ACT_FIRE if firing reports the turn angle as the argument
+	uint8_t		transition[GESTURE_MAX_STATES][GESTURE_SYMBOLS];	// next state | action << GESTURE_STATE_BITS
+	uint64_t	keep[(GESTURE_ACT_RESET | GESTURE_ACT_FIRE) + 1];	// gestureState bits left after each action
+	uint16_t	output[GESTURE_ACTIONS];						// command mask reported for each action
+	float		progress[GESTURE_MAX_STATES];					// confidence of a partial match in each state
+	float		commit;											// confidence when the command is reported
+}gestureMachine;
+
+/* Recognizer progress for one tracked skeleton, GESTURE_STATE_BITS of automaton state per gesture */
+typedef struct {
+	uint64_t states;
+}gestureState;
+
+/* Recognizer tuning. Defaults are the GESTURE_* values above; see Gesture::setParams. */
+typedef struct {
+	double		stopMargin;			// GESTURE_STOP_MARGIN
+	int			stopHoldFrames;		// GESTURE_STOP_HOLD_FRAMES
+	int			sequenceCount;		// GESTURE_SEQUENCE_COUNT
+	int			waveCount;			// GESTURE_WAVE_COUNT
+	double		turnDeadband;		// GESTURE_TURN_DEADBAND
+	double		commitConfidence;	// GESTURE_COMMIT_CONFIDENCE, in (0, 1]
+}gestureParams;
+
+/* Streaming steering estimate for one tracked skeleton, see Gesture::updateTurn */
+typedef struct {
+	bool		active;			// false until the first frame of a turn
+	float		dx, dy;			// averaged right hand minus left hand
+	float		ux, uy;			// averaged unit direction of the hands, its length measures steadiness
+}gestureTurn;
+
+/* Frame counters for monitoring */
+typedef struct {
+	uint64_t	received;		// frames processed
+	uint64_t	dropped;		// frame periods missing between them
+	uint64_t	gaps;			// times one or more frames went missing
+}gestureFrameStats;
+
+/* Operator arbitration. Every tracked skeleton runs its own recognizer, only the operator's commands are used. */
+#define GESTURE_ARBITRATE_LONGEST	0	// skeleton tracked for the most consecutive frames
+#define GESTURE_ARBITRATE_CLOSEST	1	// skeleton nearest the sensor
+#define GESTURE_ARBITRATE_CLAIM		2	// last skeleton to hold the claim gesture (both hands above head)
+#define GESTURE_CLAIM_HOLD_FRAMES	15
+
+/* Recognizer state for one tracked person, kept while the sensor keeps their tracking ID */
+typedef struct {
+	bool			active;
+	bool			seen;
+	uint32_t		trackingID;
+	uint32_t		framesTracked;
+	int				claimFrames;
+	float			z;
+	gestureFeatures	features;		// this frame's, see GestureFeatures.h
+	uint16_t		input;
+	double			arg;
+	double			confidence;
+	uint16_t		prediction;
+	double			predictionConfidence;
+	gestureState	state;
+	gestureTurn		turn;
+}gestureTrack;
+
+class Gesture
+{
+public:
+	/* Public Functions */
+	Gesture();
+	Gesture(SkeletonSource* source);
+	~Gesture();
+
+	/// <summary>
+	/// Wait for the next frame from the source and run recognition on it. The source is not owned.
+	/// </summary>
+	/// <returns>The source's SKELETON_SOURCE_* result, SKELETON_SOURCE_ERROR without a source</returns>
+	int Update();
+	int getUserInput();
+	double getUserArg();
+
+	/// <summary>
+	/// Confidence in [0, 1] of getUserInput(). Turns: low while the hands are close together or
+	/// the angle is jumping. Sequences: fraction of the motion seen when they were reported, below 1
+	/// when committed early. 1 for other commands, 0 when there is no command.
+	/// </summary>
+	double getUserConfidence();
+
+	/// <summary>
+	/// The operator's most advanced partial match, updated every frame
+	/// </summary>
+	/// <returns>Command the partial match would report, NULL_CMD_MASK if none. *confidence is its progress in [0, 1).</returns>
+	uint16_t getUserPrediction(double* confidence);
+
+	/* Trace ID (starting at 1) and LatencyTrace::Now() receive time of the last frame taken from the source */
+	uint32_t getFrameID();
+	int64_t getFrameTime();
+
+	/* Frames received and dropped since construction, from the sensor timestamps of processed frames */
+	const gestureFrameStats & getFrameStats();
+
+	/* Operator selection. getOperatorID() returns 0 when nobody is in control. */
+	void setArbitration(int policy);
+	int getArbitration();
+	uint32_t getOperatorID();
+	int getTrackedCount();
+
+	/// <summary>
+	/// Parse "longest", "closest" or "claim"
+	/// </summary>
+	/// <returns>GESTURE_ARBITRATE_* value, -1 if name is unknown</returns>
+	static int parseArbitration(const char* name);
+
+	/// <summary>
+	/// Retune the recognizer. Every tracked person's gesture progress is cleared.
+	/// </summary>
+	/// <returns>0 on success, -1 if a count is too large for the automatons (previous parameters are kept)</returns>
+	int setParams(const gestureParams & params);
+	const gestureParams & getParams();
+	static void getDefaultParams(gestureParams* params);
+
+	/* Joint smoothing applied to every frame before recognition, on by default. Recordings hold the raw frames. */
+	void setSmoothing(bool enable);
+	bool getSmoothing();
+	SkeletonFilter* getFilter();
+
+	/// <summary>
+	/// Run gesture recognition on one skeleton frame. Used by Update() for frames
+	/// from the source and directly by replay tools for recorded frames.
+	/// </summary>
+	void ProcessFrame(const skeletonFrame & frame);
+
+	/// <summary>
+	/// Record every frame received from the source to a skeleton log
+	/// </summary>
+	/// <returns>0 on success, -1 on failure</returns>
+	int startRecording(const char* path);
+	void stopRecording();
+
+	/// <summary>
+	/// Load recorded gesture templates (see TemplateMatcher.h). Every tracked person's recent
+	/// motion is matched against them each frame alongside the pose rules. Template commands
+	/// carry no argument.
+	/// </summary>
+	/// <returns>0 on success, -1 on failure</returns>
+	int loadTemplates(const char* path);
+	int getTemplateCount();
+
+	/* Recognizer building blocks, shared with GestureBatch. The short forms use the default parameters,
+	 * the skeleton forms compute the features first. */
+	static uint32_t evaluatePredicates(const skeletonData & skeleton, double* angle);
+	static uint32_t evaluatePredicates(const skeletonData & skeleton, const gestureParams & params, double* angle);
+	static uint32_t evaluatePredicates(const gestureFeatures & features, const gestureParams & params, double* angle);
+	static uint16_t stepGesture(gestureState* state, uint32_t predicates, double angle, double* arg);
+	static uint16_t stepGesture(const gestureMachine* machines, gestureState* state, uint32_t predicates, double angle, double* arg);
+	static void clearGestureState(gestureState* state);
+
+	/* Most advanced partial match in state and its progress. commitConfidence is the lowest commit of the gestures reporting input. */
+	static uint16_t predictGesture(const gestureMachine* machines, const gestureState & state, double* confidence);
+	static double commitConfidence(const gestureMachine* machines, uint16_t input);
+
+	/// <summary>
+	/// Fold one frame into a steering estimate. O(1) per frame and free of divisions by the
+	/// hand separation, so it stays defined when the hands line up vertically. Gesture uses
+	/// it for the turn argument; evaluatePredicates still reports the instantaneous angle.
+	/// </summary>
+	/// <returns>Steering angle in [GESTURE_MAX_TURN_R, GESTURE_MAX_TURN_L], positive when the right hand is higher</returns>
+	static double updateTurn(gestureTurn* turn, const gestureFeatures & features, double* confidence);
+	static void clearTurn(gestureTurn* turn);
+
+	/// <summary>
+	/// Build the automatons of every gesture in gestureDefs with counts taken from params
+	/// </summary>
+	/// <returns>0 on success, -1 if a count is too large</returns>
+	static int compileGestures(const gestureParams & params, gestureMachine* machines);
+
+	/// <summary>
+	/// Build the automaton for one gesture definition. Early commit (commitConfidence
+	/// below 1) applies to SEQUENCE definitions.
+	/// </summary>
+	/// <returns>0 on success, -1 if the definition is invalid or too large</returns>
+	static int compileGesture(const gestureDef & def, gestureMachine* machine);
+	static int compileGesture(const gestureDef & def, double commitConfidence, gestureMachine* machine);
+	static bool isClaimPose(const gestureFeatures & features);
+
+	/* Public Variables */
+
+private:
+	/* Private Functions */
+	void clearall();
+
+	/// <summary>
+	/// Gesture recognition using skeleton data. steps is the number of frame periods since the
+	/// previous frame; the automatons advance once for each, as if the missing frames held this pose.
+	/// </summary>
+	void determine_gesture(gestureTrack* track, const skeletonData & skeleton, int steps);
+
+	/// <summary>
+	/// Count a frame and detect a gap since the previous one
+	/// </summary>
+	/// <returns>Frame periods elapsed since the previous frame, at least 1</returns>
+	int countFrame(const skeletonFrame & frame);
+
+	gestureTrack* findTrack(uint32_t trackingID);
+	int chooseOperator();
+
+
+	/* Private Variables */
+	gestureTrack tracks[SKELETON_COUNT];
+	TemplateMatcher matchers[SKELETON_COUNT];	// parallel to tracks
+	TemplateLibrary templates;
+	SkeletonFilter filter;
+	bool smoothing;
+	gestureParams params;
+	gestureMachine machines[GESTURE_COUNT];
+	int operatorTrack;			// index into tracks, -1 when nobody is in control
+	int arbitration;
+	int user_input;
+	double user_arg;
+	double user_confidence;
+	uint16_t user_prediction;
+	double prediction_confidence;
+	uint32_t frameID;
+	int64_t frameTime;
+	gestureFrameStats frameStats;
+	int64_t lastTimestamp;
+	uint32_t lastFrameNumber;
+
+	SkeletonSource*         source;
+	SkeletonLogWriter       recorder;
+
+};
@@ -0,0 +1,490 @@
+/*****************************************************
+*	GestureBatch.cpp
+*
+*	SIMD gesture recognition over structure-of-arrays
+*	skeleton batches. Each lane steps the compiled
+*	gesture automatons (Gesture::compileGestures) by
+*	table lookup, as Gesture::stepGesture does.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "GestureBatch.h"
+#include "StateMachineDefs.h"
+
+#include <cfloat>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GESTURE_BATCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GESTURE_BATCH_SSE2
+#endif
+
+/* SIMD kernels must be compiled as native code when building with /clr */
+#ifdef _MANAGED
+#pragma managed(push, off)
+#endif
+
+/*****************************************************
+*	Lane helpers. vf holds floats, vi holds int32 values
+*	or comparison masks (all ones = true).
+*****************************************************/
+#if defined(GESTURE_BATCH_AVX2)
+
+#define LANES 8
+typedef __m256	vf;
+typedef __m256i	vi;
+
+static inline vf vf_load(const float* p) { return _mm256_loadu_ps(p); }
+static inline void vf_store(float* p, vf a) { _mm256_storeu_ps(p, a); }
+static inline vf vf_set(float a) { return _mm256_set1_ps(a); }
+static inline vf vf_add(vf a, vf b) { return _mm256_add_ps(a, b); }
+static inline vf vf_sub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+static inline vf vf_mul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+static inline vf vf_div(vf a, vf b) { return _mm256_div_ps(a, b); }
+static inline vf vf_and(vf a, vf b) { return _mm256_and_ps(a, b); }
+static inline vf vf_xor(vf a, vf b) { return _mm256_xor_ps(a, b); }
+static inline vf vf_sel(vi m, vf a, vf b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(m)); }
+static inline vi vf_gt(vf a, vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+static inline vi vf_lt(vf a, vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+static inline vi vf_eq(vf a, vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+static inline vi vf_neq(vf a, vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_NEQ_UQ)); }
+
+/* a > b + margin, compared in double precision like the scalar rule */
+static inline vi vf_gt_margin(vf a, vf b, double margin)
+{
+	const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+	__m256d m = _mm256_set1_pd(margin);
+	__m256d lo = _mm256_cmp_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(a)),
+		_mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(b)), m), _CMP_GT_OQ);
+	__m256d hi = _mm256_cmp_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(a, 1)),
+		_mm256_add_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(b, 1)), m), _CMP_GT_OQ);
+	__m128 lo4 = _mm256_castps256_ps128(_mm256_permutevar8x32_ps(_mm256_castpd_ps(lo), pack));
+	__m128 hi4 = _mm256_castps256_ps128(_mm256_permutevar8x32_ps(_mm256_castpd_ps(hi), pack));
+	return _mm256_castps_si256(_mm256_insertf128_ps(_mm256_castps128_ps256(lo4), hi4, 1));
+}
+
+static inline vi vi_load(const int32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void vi_store(int32_t* p, vi a) { _mm256_storeu_si256((__m256i*)p, a); }
+static inline vi vi_set(int32_t a) { return _mm256_set1_epi32(a); }
+static inline vi vi_zero() { return _mm256_setzero_si256(); }
+static inline vi vi_and(vi a, vi b) { return _mm256_and_si256(a, b); }
+static inline vi vi_or(vi a, vi b) { return _mm256_or_si256(a, b); }
+static inline vi vi_andnot(vi m, vi a) { return _mm256_andnot_si256(m, a); }	// a where m is false, else 0
+static inline vi vi_add(vi a, vi b) { return _mm256_add_epi32(a, b); }
+static inline vi vi_eq(vi a, vi b) { return _mm256_cmpeq_epi32(a, b); }
+static inline vi vi_gt(vi a, vi b) { return _mm256_cmpgt_epi32(a, b); }
+static inline vi vi_sel(vi m, vi a, vi b) { return _mm256_blendv_epi8(b, a, m); }
+static inline vi vi_shl(vi a, int n) { return _mm256_slli_epi32(a, n); }
+static inline vi vi_shr(vi a, int n) { return _mm256_srli_epi32(a, n); }
+
+/* table[index] from blocks of 8 entries, by permuting each block in registers. Gathers are much slower on some CPUs. */
+static inline vi vi_lookup(const int32_t* table, int blocks, vi index)
+{
+	vi r = _mm256_permutevar8x32_epi32(vi_load(table), index);
+	vi block;
+	int k;
+
+	if (blocks == 1) return r;
+	if (blocks == 2) {
+		/* Bit 3 of the index picks the block, moved to the sign bit blendv_ps tests */
+		return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(r),
+			_mm256_castsi256_ps(_mm256_permutevar8x32_epi32(vi_load(table + 8), index)), _mm256_castsi256_ps(vi_shl(index, 28))));
+	}
+	block = vi_shr(index, 3);
+	for (k = 1; k < blocks; k++) {
+		r = vi_sel(vi_eq(block, vi_set(k)), _mm256_permutevar8x32_epi32(vi_load(table + 8 * k), index), r);
+	}
+	return r;
+}
+
+#elif defined(GESTURE_BATCH_SSE2)
+
+#define LANES 4
+typedef __m128	vf;
+typedef __m128i	vi;
+
+static inline vf vf_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void vf_store(float* p, vf a) { _mm_storeu_ps(p, a); }
+static inline vf vf_set(float a) { return _mm_set1_ps(a); }
+static inline vf vf_add(vf a, vf b) { return _mm_add_ps(a, b); }
+static inline vf vf_sub(vf a, vf b) { return _mm_sub_ps(a, b); }
+static inline vf vf_mul(vf a, vf b) { return _mm_mul_ps(a, b); }
+static inline vf vf_div(vf a, vf b) { return _mm_div_ps(a, b); }
+static inline vf vf_and(vf a, vf b) { return _mm_and_ps(a, b); }
+static inline vf vf_xor(vf a, vf b) { return _mm_xor_ps(a, b); }
+static inline vf vf_sel(vi m, vf a, vf b)
+{
+	__m128 mf = _mm_castsi128_ps(m);
+	return _mm_or_ps(_mm_and_ps(mf, a), _mm_andnot_ps(mf, b));
+}
+static inline vi vf_gt(vf a, vf b) { return _mm_castps_si128(_mm_cmpgt_ps(a, b)); }
+static inline vi vf_lt(vf a, vf b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+static inline vi vf_eq(vf a, vf b) { return _mm_castps_si128(_mm_cmpeq_ps(a, b)); }
+static inline vi vf_neq(vf a, vf b) { return _mm_castps_si128(_mm_cmpneq_ps(a, b)); }
+
+/* a > b + margin, compared in double precision like the scalar rule */
+static inline vi vf_gt_margin(vf a, vf b, double margin)
+{
+	__m128d m = _mm_set1_pd(margin);
+	__m128d lo = _mm_cmpgt_pd(_mm_cvtps_pd(a), _mm_add_pd(_mm_cvtps_pd(b), m));
+	__m128d hi = _mm_cmpgt_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), _mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(b, b)), m));
+	return _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(lo), _mm_castpd_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+static inline vi vi_load(const int32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void vi_store(int32_t* p, vi a) { _mm_storeu_si128((__m128i*)p, a); }
+static inline vi vi_set(int32_t a) { return _mm_set1_epi32(a); }
+static inline vi vi_zero() { return _mm_setzero_si128(); }
+static inline vi vi_and(vi a, vi b) { return _mm_and_si128(a, b); }
+static inline vi vi_or(vi a, vi b) { return _mm_or_si128(a, b); }
+static inline vi vi_andnot(vi m, vi a) { return _mm_andnot_si128(m, a); }	// a where m is false, else 0
+static inline vi vi_add(vi a, vi b) { return _mm_add_epi32(a, b); }
+static inline vi vi_eq(vi a, vi b) { return _mm_cmpeq_epi32(a, b); }
+static inline vi vi_gt(vi a, vi b) { return _mm_cmpgt_epi32(a, b); }
+static inline vi vi_sel(vi m, vi a, vi b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+static inline vi vi_shl(vi a, int n) { return _mm_slli_epi32(a, n); }
+static inline vi vi_shr(vi a, int n) { return _mm_srli_epi32(a, n); }
+static inline vi vi_lookup(const int32_t* table, int blocks, vi index)
+{
+	int32_t k[LANES];
+
+	_mm_storeu_si128((__m128i*)k, index);
+	return _mm_setr_epi32(table[k[0]], table[k[1]], table[k[2]], table[k[3]]);
+}
+
+#else
+
+/* Scalar fallback. One lane, masks are 0 or -1. */
+#define LANES 1
+typedef float	vf;
+typedef int32_t	vi;
+
+static inline vf vf_load(const float* p) { return *p; }
+static inline void vf_store(float* p, vf a) { *p = a; }
+static inline vf vf_set(float a) { return a; }
+static inline vf vf_add(vf a, vf b) { return a + b; }
+static inline vf vf_sub(vf a, vf b) { return a - b; }
+static inline vf vf_mul(vf a, vf b) { return a * b; }
+static inline vf vf_div(vf a, vf b) { return a / b; }
+static inline vf vf_and(vf a, vf b) { int32_t x, y; memcpy(&x, &a, 4); memcpy(&y, &b, 4); x &= y; memcpy(&a, &x, 4); return a; }
+static inline vf vf_xor(vf a, vf b) { int32_t x, y; memcpy(&x, &a, 4); memcpy(&y, &b, 4); x ^= y; memcpy(&a, &x, 4); return a; }
+static inline vf vf_sel(vi m, vf a, vf b) { return m ? a : b; }
+static inline vi vf_gt(vf a, vf b) { return (a > b) ? -1 : 0; }
+static inline vi vf_lt(vf a, vf b) { return (a < b) ? -1 : 0; }
+static inline vi vf_eq(vf a, vf b) { return (a == b) ? -1 : 0; }
+static inline vi vf_neq(vf a, vf b) { return (a != b) ? -1 : 0; }
+static inline vi vf_gt_margin(vf a, vf b, double margin) { return (a > (b + margin)) ? -1 : 0; }
+
+static inline vi vi_load(const int32_t* p) { return *p; }
+static inline void vi_store(int32_t* p, vi a) { *p = a; }
+static inline vi vi_set(int32_t a) { return a; }
+static inline vi vi_zero() { return 0; }
+static inline vi vi_and(vi a, vi b) { return a & b; }
+static inline vi vi_or(vi a, vi b) { return a | b; }
+static inline vi vi_andnot(vi m, vi a) { return ~m & a; }
+static inline vi vi_add(vi a, vi b) { return a + b; }
+static inline vi vi_eq(vi a, vi b) { return (a == b) ? -1 : 0; }
+static inline vi vi_gt(vi a, vi b) { return (a > b) ? -1 : 0; }
+static inline vi vi_sel(vi m, vi a, vi b) { return m ? a : b; }
+static inline vi vi_shl(vi a, int n) { return a << n; }
+static inline vi vi_shr(vi a, int n) { return (int32_t)((uint32_t)a >> n); }
+static inline vi vi_lookup(const int32_t* table, int blocks, vi index) { return table[index]; }
+
+#endif
+
+/* Lanes where all bits of mask are set in p */
+static inline vi vi_test(vi p, int32_t mask)
+{
+	return vi_eq(vi_and(p, vi_set(mask)), vi_set(mask));
+}
+
+/* Predicate bit for lanes where m is true */
+static inline vi vi_bit(vi m, int32_t bit)
+{
+	return vi_and(m, vi_set(bit));
+}
+
+/* atan(dy / dx) for lanes with dx > 0. Cephes atanf range reduction and polynomial (max error ~1e-7 rad),
+ * with the reduction folded into the numerator and denominator so each lane needs only one division. */
+static inline vf vf_atan_ratio(vf dy, vf dx)
+{
+	const vf signBit = vf_set(-0.0f);
+	vf sign = vf_and(dy, signBit);
+	vf ady = vf_xor(dy, sign);
+	vi big = vf_gt(ady, vf_mul(dx, vf_set(2.414213562373095f)));
+	vi mid = vf_gt(ady, vf_mul(dx, vf_set(0.4142135623730950f)));
+	vf num = vf_sel(big, vf_xor(dx, signBit), vf_sel(mid, vf_sub(ady, dx), ady));
+	vf den = vf_sel(big, ady, vf_sel(mid, vf_add(ady, dx), dx));
+	vf xr = vf_div(num, den);
+	vf y = vf_sel(big, vf_set(1.5707963267948966f), vf_sel(mid, vf_set(0.7853981633974483f), vf_set(0.0f)));
+	vf z = vf_mul(xr, xr);
+	vf p = vf_set(8.05374449538e-2f);
+	p = vf_sub(vf_mul(p, z), vf_set(1.38776856032e-1f));
+	p = vf_add(vf_mul(p, z), vf_set(1.99777106478e-1f));
+	p = vf_sub(vf_mul(p, z), vf_set(3.33329491539e-1f));
+	p = vf_add(vf_mul(vf_mul(p, z), xr), xr);
+	return vf_xor(vf_add(y, p), sign);
+}
+
+/* Predicates (Gesture::evaluatePredicates) and turn angle of the lanes at k */
+static inline vi lanePredicates(const float* const* jointX, const float* const* jointY, int k, double stopMargin, vf turnThreshold,
+	vf* angle)
+{
+	vf rhx = vf_load(&jointX[GESTURE_BATCH_RH][k]),		rhy = vf_load(&jointY[GESTURE_BATCH_RH][k]);
+	vf lhx = vf_load(&jointX[GESTURE_BATCH_LH][k]),		lhy = vf_load(&jointY[GESTURE_BATCH_LH][k]);
+	vf rsy = vf_load(&jointY[GESTURE_BATCH_RS][k]);
+	vf rex = vf_load(&jointX[GESTURE_BATCH_RE][k]),		rey = vf_load(&jointY[GESTURE_BATCH_RE][k]);
+	vf lex = vf_load(&jointX[GESTURE_BATCH_LE][k]),		ley = vf_load(&jointY[GESTURE_BATCH_LE][k]);
+	vf rhipy = vf_load(&jointY[GESTURE_BATCH_RHIP][k]);
+	vf lhipy = vf_load(&jointY[GESTURE_BATCH_LHIP][k]);
+	vf handsDy = vf_sub(rhy, lhy);
+
+	vi p = vi_bit(vf_gt(rhy, rhipy), GESTURE_P_RH_ABOVE_RHIP);
+	p = vi_or(p, vi_bit(vf_lt(rhy, rhipy), GESTURE_P_RH_BELOW_RHIP));
+	p = vi_or(p, vi_bit(vf_gt(lhy, lhipy), GESTURE_P_LH_ABOVE_LHIP));
+	p = vi_or(p, vi_bit(vf_lt(lhy, lhipy), GESTURE_P_LH_BELOW_LHIP));
+	p = vi_or(p, vi_bit(vf_gt(vf_xor(handsDy, vf_and(handsDy, vf_set(-0.0f))), turnThreshold), GESTURE_P_HANDS_Y_DIFFER));
+	p = vi_or(p, vi_bit(vf_gt_margin(rhy, rsy, stopMargin), GESTURE_P_RH_ABOVE_RS));
+	p = vi_or(p, vi_bit(vf_gt(rhy, rey), GESTURE_P_RH_ABOVE_RE));
+	p = vi_or(p, vi_bit(vf_lt(rhy, rey), GESTURE_P_RH_BELOW_RE));
+	p = vi_or(p, vi_bit(vf_gt(rhx, rex), GESTURE_P_RH_RIGHT_OF_RE));
+	p = vi_or(p, vi_bit(vf_lt(rhx, rex), GESTURE_P_RH_LEFT_OF_RE));
+	p = vi_or(p, vi_bit(vf_gt(lhy, ley), GESTURE_P_LH_ABOVE_LE));
+	p = vi_or(p, vi_bit(vf_lt(lhy, ley), GESTURE_P_LH_BELOW_LE));
+	p = vi_or(p, vi_bit(vf_gt(lhx, lex), GESTURE_P_LH_RIGHT_OF_LE));
+	p = vi_or(p, vi_bit(vf_lt(lhx, lex), GESTURE_P_LH_LEFT_OF_LE));
+
+	vi xEqual = vf_eq(rhx, lhx);
+	vi xGreater = vf_gt(rhx, lhx);
+	vf a = vf_sel(xGreater, vf_atan_ratio(handsDy, vf_sub(rhx, lhx)), vf_set(0.0f));
+	*angle = vf_sel(xEqual, vf_sel(vf_gt(lhy, rhy), vf_set((float)(-PI / 2)), vf_set((float)(PI / 2))), a);
+	return p;
+}
+
+/* One gesture automaton step (Gesture::stepGesture) for a lane group */
+static inline void laneStep(const gestureBatchMachine* m, int shift, vi p, vi neg, vi* state, vi* input, vi* angleFired)
+{
+	const vi stateMask = vi_set(GESTURE_MAX_STATES - 1);
+
+	/* Arm not in use resets */
+	vi current = vi_and(vi_eq(vi_and(p, vi_set(m->release)), vi_zero()), vi_and(vi_shr(*state, shift), stateMask));
+	vi symbol = vi_or(vi_and(vi_test(p, m->pose), vi_set(2)), vi_and(vi_test(p, m->startPose), vi_set(1)));
+	vi entry = vi_lookup(m->transition, m->transitionBlocks, vi_or(vi_shl(current, 2), symbol));
+	vi action = vi_shr(entry, GESTURE_STATE_BITS);
+
+	*state = vi_or(vi_andnot(vi_set((GESTURE_MAX_STATES - 1) << shift), *state), vi_shl(vi_and(entry, stateMask), shift));
+	*state = vi_and(*state, vi_lookup(m->keep, 1, vi_and(action, vi_set(GESTURE_ACT_RESET | GESTURE_ACT_FIRE))));
+	*input = vi_or(*input, vi_lookup(m->output, m->outputBlocks, vi_or(action, neg)));
+	*angleFired = vi_or(*angleFired, vi_and(action, vi_set(m->angleArg)));
+}
+
+void GestureBatch::Evaluate()
+{
+	Evaluate(jointX, jointY);
+}
+
+void GestureBatch::Evaluate(const float* const x[GESTURE_BATCH_JOINTS], const float* const y[GESTURE_BATCH_JOINTS])
+{
+	const double stopMargin = params.stopMargin;
+	const vf turnThreshold = vf_set(this->turnThreshold);
+	int i, j, g;
+
+	/* Two lane groups at a time: their automaton steps are independent, so interleaving them hides each one's
+	 * table lookup latency */
+	for (i = 0; i < count; i += 2 * LANES) {
+		j = i + LANES;
+		vf angleI, angleJ;
+		vi pI = lanePredicates(x, y, i, stopMargin, turnThreshold, &angleI);
+		vi pJ = lanePredicates(x, y, j, stopMargin, turnThreshold, &angleJ);
+		vi negI = vi_bit(vf_lt(angleI, vf_set(0.0f)), GESTURE_ACT_NEG);
+		vi negJ = vi_bit(vf_lt(angleJ, vf_set(0.0f)), GESTURE_ACT_NEG);
+		vi stateI = vi_load(&states[i]), stateJ = vi_load(&states[j]);
+		vi inputI = vi_zero(), inputJ = vi_zero(), firedI = vi_zero(), firedJ = vi_zero();
+
+		/* Each gesture sees the progress the ones before it cleared */
+		for (g = 0; g < GESTURE_COUNT; g++) {
+			laneStep(&machines[g], g * GESTURE_STATE_BITS, pI, negI, &stateI, &inputI, &firedI);
+			laneStep(&machines[g], g * GESTURE_STATE_BITS, pJ, negJ, &stateJ, &inputJ, &firedJ);
+		}
+
+		vi_store(&predicates[i], pI);
+		vi_store(&predicates[j], pJ);
+		vi_store(&states[i], stateI);
+		vi_store(&states[j], stateJ);
+		vi_store(&userInput[i], inputI);
+		vi_store(&userInput[j], inputJ);
+		vf_store(&userArg[i], vf_sel(vi_test(firedI, GESTURE_ACT_FIRE), angleI, vf_set(0.0f)));
+		vf_store(&userArg[j], vf_sel(vi_test(firedJ, GESTURE_ACT_FIRE), angleJ, vf_set(0.0f)));
+	}
+}
+
+#ifdef _MANAGED
+#pragma managed(pop)
+#endif
+
+GestureBatch::GestureBatch(int capacity) :
+	count(0)
+{
+	gestureParams defaults;
+	int j, arrays;
+	char* p;
+
+	/* Round up so Evaluate() never has a partial step of two lane groups. Padding lanes hold zeros and are ignored. */
+	this->capacity = ((capacity + 2 * LANES - 1) / (2 * LANES)) * (2 * LANES);
+
+	arrays = 2 * GESTURE_BATCH_JOINTS + 4;
+	storage = calloc((size_t)arrays * this->capacity, sizeof(int32_t));
+	if (storage == NULL) {
+		printf("ERROR: GestureBatch failed to allocate memory for %d skeletons.\n", capacity);
+		this->capacity = 0;
+	}
+
+	p = (char*)storage;
+#define NEXT_ARRAY(type) (type*)p; p += this->capacity * sizeof(int32_t)
+	for (j = 0; j < GESTURE_BATCH_JOINTS; j++) {
+		jointX[j] = NEXT_ARRAY(float);
+		jointY[j] = NEXT_ARRAY(float);
+	}
+	states = NEXT_ARRAY(int32_t);
+	predicates = NEXT_ARRAY(int32_t);
+	userInput = NEXT_ARRAY(int32_t);
+	userArg = NEXT_ARRAY(float);
+#undef NEXT_ARRAY
+
+	Gesture::getDefaultParams(&defaults);
+	setParams(defaults);
+}
+
+GestureBatch::~GestureBatch()
+{
+	free(storage);
+}
+
+int GestureBatch::getCapacity()
+{
+	return capacity;
+}
+
+int GestureBatch::getCount()
+{
+	return count;
+}
+
+void GestureBatch::setCount(int count)
+{
+	if (count < 0) count = 0;
+	if (count > capacity) count = capacity;
+	this->count = count;
+}
+
+void GestureBatch::setSkeleton(int index, const skeletonData & skeleton)
+{
+	static const int jointIndex[GESTURE_BATCH_JOINTS] = {
+		SKELETON_POSITION_HAND_RIGHT, SKELETON_POSITION_HAND_LEFT, SKELETON_POSITION_SHOULDER_RIGHT,
+		SKELETON_POSITION_ELBOW_RIGHT, SKELETON_POSITION_ELBOW_LEFT, SKELETON_POSITION_HIP_RIGHT, SKELETON_POSITION_HIP_LEFT
+	};
+	gestureFeatures features;
+	int j;
+
+	computeFeatures(skeleton, &features);
+	for (j = 0; j < GESTURE_BATCH_JOINTS; j++) {
+		jointX[j][index] = features.x[jointIndex[j]];
+		jointY[j][index] = features.y[jointIndex[j]];
+	}
+}
+
+float* GestureBatch::getJointX(int joint)
+{
+	return jointX[joint];
+}
+
+float* GestureBatch::getJointY(int joint)
+{
+	return jointY[joint];
+}
+
+void GestureBatch::resetState(int index)
+{
+	states[index] = 0;
+}
+
+void GestureBatch::resetAll()
+{
+	int i;
+
+	for (i = 0; i < capacity; i++) resetState(i);
+}
+
+void GestureBatch::getState(int index, gestureState* state)
+{
+	state->states = (uint32_t)states[index];
+}
+
+int GestureBatch::setParams(const gestureParams & params)
+{
+	gestureMachine compiled[GESTURE_COUNT];
+	gestureBatchMachine* m;
+	uint32_t reachable, more;
+	int g, k, state, symbol, last;
+
+	if (Gesture::compileGestures(params, compiled) != 0) return -1;
+	for (g = 0; g < GESTURE_COUNT; g++) {
+		m = &machines[g];
+		memset(m, 0x00, sizeof(gestureBatchMachine));
+		m->pose = (int32_t)compiled[g].pose;
+		m->startPose = (int32_t)compiled[g].startPose;
+		m->release = (int32_t)compiled[g].release;
+		m->angleArg = compiled[g].angleArg;
+		for (k = 0; k < GESTURE_MAX_STATES * GESTURE_SYMBOLS; k++) m->transition[k] = compiled[g].transition[k / GESTURE_SYMBOLS][k % GESTURE_SYMBOLS];
+		m->outputBlocks = 1;
+		for (k = 0; k < GESTURE_ACTIONS; k++) {
+			m->output[k] = compiled[g].output[k];
+			if (compiled[g].output[k] != compiled[g].output[k & ~GESTURE_ACT_NEG]) m->outputBlocks = GESTURE_ACTIONS / 8;
+		}
+		for (k = 0; k <= (GESTURE_ACT_RESET | GESTURE_ACT_FIRE); k++) m->keep[k] = (int32_t)(uint32_t)compiled[g].keep[k];
+
+		/* Only states reachable from 0 are looked up */
+		reachable = 1;
+		do {
+			more = reachable;
+			for (state = 0; state < GESTURE_MAX_STATES; state++) {
+				if (!(reachable & (1u << state))) continue;
+				for (symbol = 0; symbol < GESTURE_SYMBOLS; symbol++) more |= 1u << (compiled[g].transition[state][symbol] & (GESTURE_MAX_STATES - 1));
+			}
+			if (more == reachable) break;
+			reachable = more;
+		} while (1);
+		for (last = GESTURE_MAX_STATES - 1; !(reachable & (1u << last)); last--);
+		m->transitionBlocks = ((last + 1) * GESTURE_SYMBOLS + 7) / 8;
+	}
+	this->params = params;
+
+	/* A float exceeds the dead band exactly when it exceeds the largest float not above it */
+	turnThreshold = (float)params.turnDeadband;
+	if ((double)turnThreshold > params.turnDeadband) turnThreshold = nextafterf(turnThreshold, -FLT_MAX);
+	resetAll();
+	return 0;
+}
+
+const gestureParams & GestureBatch::getParams()
+{
+	return params;
+}
+
+uint16_t GestureBatch::getUserInput(int index)
+{
+	return (uint16_t)userInput[index];
+}
+
+double GestureBatch::getUserArg(int index)
+{
+	return userArg[index];
+}
+
+uint32_t GestureBatch::getPredicates(int index)
+{
+	return (uint32_t)predicates[index];
+}
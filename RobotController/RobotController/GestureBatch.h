@@ -0,0 +1,116 @@
+/*****************************************************
+*	GestureBatch.h
+*
+*	Gesture recognition for many skeletons at once.
+*	Joints and gesture automaton states are stored as
+*	structure-of-arrays so the predicate comparisons,
+*	turn angle and automaton steps run in SIMD lanes
+*	(AVX2 when compiled with it, otherwise SSE2).
+*
+*	Joints are body-normalized like gestureFeatures
+*	(GestureFeatures.h): shoulder widths from the
+*	shoulder center.
+*
+*	The automatons are the gestureMachines compiled
+*	from gestureDefs and gestureParams, so every slot
+*	produces the same commands as Gesture::stepGesture
+*	with the same parameters. Turn angles use a
+*	polynomial atan and agree with the scalar path to
+*	within 1e-6 rad.
+*****************************************************/
+
+#pragma once
+
+#include "Gesture.h"
+
+/* Joints read by the gesture rules. Index into GestureBatch joint arrays. */
+#define GESTURE_BATCH_RH		0
+#define GESTURE_BATCH_LH		1
+#define GESTURE_BATCH_RS		2
+#define GESTURE_BATCH_RE		3
+#define GESTURE_BATCH_LE		4
+#define GESTURE_BATCH_RHIP		5
+#define GESTURE_BATCH_LHIP		6
+#define GESTURE_BATCH_JOINTS	7
+
+/* Each slot's automaton states are packed into 32 bits like gestureState */
+#if GESTURE_COUNT * GESTURE_STATE_BITS > 32
+#error GestureBatch packs the state of every gesture into 32 bits
+#endif
+
+/* A gestureMachine with its tables widened to int32 lanes, each padded to whole 8 entry blocks so a lane can look
+ * an entry up in registers */
+typedef struct {
+	int32_t		pose;
+	int32_t		startPose;
+	int32_t		release;
+	int32_t		angleArg;
+	int32_t		transitionBlocks;									// 8 entry blocks of transition the reachable states use
+	int32_t		transition[GESTURE_MAX_STATES * GESTURE_SYMBOLS];	// by state * GESTURE_SYMBOLS + symbol
+	int32_t		outputBlocks;										// 1 when the output ignores GESTURE_ACT_NEG
+	int32_t		output[GESTURE_ACTIONS];
+	int32_t		keep[8];											// by action & (GESTURE_ACT_RESET | GESTURE_ACT_FIRE)
+}gestureBatchMachine;
+
+class GestureBatch
+{
+public:
+	/* Public Functions */
+	GestureBatch(int capacity);
+	~GestureBatch();
+
+	int getCapacity();
+	int getCount();
+	void setCount(int count);
+
+	/* Normalize one skeleton into slot index. Loaders that already hold normalized SoA data can write getJointX/Y directly. */
+	void setSkeleton(int index, const skeletonData & skeleton);
+	float* getJointX(int joint);
+	float* getJointY(int joint);
+
+	/* Clear the gesture progress of one slot (new person in that slot) or of all slots */
+	void resetState(int index);
+	void resetAll();
+	void getState(int index, gestureState* state);
+
+	/// <summary>
+	/// Retune the recognizer, as Gesture::setParams. Every slot's gesture progress is cleared.
+	/// </summary>
+	/// <returns>0 on success, -1 if a count is too large for the automatons (previous parameters are kept)</returns>
+	int setParams(const gestureParams & params);
+	const gestureParams & getParams();
+
+	/// <summary>
+	/// Evaluate predicates, turn angle and gesture automatons for slots [0, count)
+	/// </summary>
+	void Evaluate();
+
+	/* Same, reading joints from caller owned SoA arrays instead of copying them in. Each array must
+	 * hold getCapacity() floats; entries past getCount() are read but their results are ignored. */
+	void Evaluate(const float* const x[GESTURE_BATCH_JOINTS], const float* const y[GESTURE_BATCH_JOINTS]);
+
+	/* Results of the last Evaluate() */
+	uint16_t getUserInput(int index);
+	double getUserArg(int index);
+	uint32_t getPredicates(int index);
+
+private:
+	/* Private Variables */
+	int			capacity;		// rounded up to a whole number of SIMD lane pairs
+	int			count;
+	float*		jointX[GESTURE_BATCH_JOINTS];
+	float*		jointY[GESTURE_BATCH_JOINTS];
+
+	/* Automaton states of every gesture, packed as in gestureState */
+	int32_t*	states;
+	gestureParams		params;
+	float				turnThreshold;		// largest float not above params.turnDeadband
+	gestureBatchMachine	machines[GESTURE_COUNT];
+
+	/* Outputs */
+	int32_t*	predicates;
+	int32_t*	userInput;
+	float*		userArg;
+
+	void*		storage;
+};
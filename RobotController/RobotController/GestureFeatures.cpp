@@ -0,0 +1,69 @@
+/*****************************************************
+*	GestureFeatures.cpp
+*
+*	Body-normalized joint features.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "GestureFeatures.h"
+#include <math.h>
+#include <string.h>
+
+/* Shoulder width of the skeleton, bounded below */
+static float shoulderWidth(const skeletonData & skeleton)
+{
+	const skeletonJoint & left = skeleton.joints[SKELETON_POSITION_SHOULDER_LEFT];
+	const skeletonJoint & right = skeleton.joints[SKELETON_POSITION_SHOULDER_RIGHT];
+	float width;
+
+	width = sqrtf((right.x - left.x) * (right.x - left.x) + (right.y - left.y) * (right.y - left.y) + (right.z - left.z) * (right.z - left.z));
+	return (width < FEATURE_MIN_SHOULDER_WIDTH) ? FEATURE_MIN_SHOULDER_WIDTH : width;
+}
+
+void computeFeatures(const skeletonData & skeleton, gestureFeatures* f)
+{
+	const skeletonJoint & center = skeleton.joints[SKELETON_POSITION_SHOULDER_CENTER];
+	float scale;
+	int j;
+
+	f->shoulderWidth = shoulderWidth(skeleton);
+	f->distance = skeleton.position.z;
+	scale = 1.0f / f->shoulderWidth;
+	for (j = 0; j < SKELETON_POSITION_COUNT; j++) {
+		f->x[j] = (skeleton.joints[j].x - center.x) * scale;
+		f->y[j] = (skeleton.joints[j].y - center.y) * scale;
+		f->z[j] = (skeleton.joints[j].z - center.z) * scale;
+	}
+	memset(f->vx, 0x00, sizeof(f->vx));
+	memset(f->vy, 0x00, sizeof(f->vy));
+	memset(f->vz, 0x00, sizeof(f->vz));
+}
+
+void updateFeatures(const skeletonData & skeleton, float dt, gestureFeatures* f)
+{
+	const skeletonJoint & center = skeleton.joints[SKELETON_POSITION_SHOULDER_CENTER];
+	float scale, rate, x, y, z;
+	int j;
+
+	if (dt <= 0.0f) {
+		computeFeatures(skeleton, f);
+		return;
+	}
+
+	f->shoulderWidth = shoulderWidth(skeleton);
+	f->distance = skeleton.position.z;
+	scale = 1.0f / f->shoulderWidth;
+	rate = 1.0f / dt;
+	for (j = 0; j < SKELETON_POSITION_COUNT; j++) {
+		x = (skeleton.joints[j].x - center.x) * scale;
+		y = (skeleton.joints[j].y - center.y) * scale;
+		z = (skeleton.joints[j].z - center.z) * scale;
+		f->vx[j] = (x - f->x[j]) * rate;
+		f->vy[j] = (y - f->y[j]) * rate;
+		f->vz[j] = (z - f->z[j]) * rate;
+		f->x[j] = x;
+		f->y[j] = y;
+		f->z[j] = z;
+	}
+}
@@ -0,0 +1,44 @@
+/*****************************************************
+*	GestureFeatures.h
+*
+*	Body-normalized joint features. Computed once per
+*	tracked skeleton per frame and read by every
+*	recognizer (pose rules, turn estimate, templates,
+*	claim pose), so a new recognizer costs no extra
+*	joint arithmetic.
+*
+*	Positions are relative to the shoulder center and
+*	measured in shoulder widths, so the rules behave the
+*	same for tall and short operators at any distance
+*	from the sensor. Axes stay the sensor's: x to the
+*	sensor's left, y up, z away from the sensor.
+*****************************************************/
+
+#pragma once
+
+#include "SkeletonDefs.h"
+
+#define FEATURE_MIN_SHOULDER_WIDTH	0.1f	// m, keeps features finite when the shoulders are mis-tracked
+
+/* One skeleton's features, structure-of-arrays by joint index (SKELETON_POSITION_*) */
+typedef struct {
+	float	x[SKELETON_POSITION_COUNT];		// shoulder widths from the shoulder center
+	float	y[SKELETON_POSITION_COUNT];
+	float	z[SKELETON_POSITION_COUNT];
+	float	vx[SKELETON_POSITION_COUNT];	// shoulder widths per second, 0 until a previous frame is known
+	float	vy[SKELETON_POSITION_COUNT];
+	float	vz[SKELETON_POSITION_COUNT];
+	float	shoulderWidth;					// m
+	float	distance;						// m, skeleton position z
+}gestureFeatures;
+
+/// <summary>
+/// Normalize the joints of one skeleton. Velocities are cleared.
+/// </summary>
+void computeFeatures(const skeletonData & skeleton, gestureFeatures* features);
+
+/// <summary>
+/// Replace features holding the previous frame of the same person, dt seconds earlier,
+/// with this frame's, velocities included
+/// </summary>
+void updateFeatures(const skeletonData & skeleton, float dt, gestureFeatures* features);
@@ -0,0 +1,122 @@
+/*****************************************************
+*	InputQueue.cpp
+*
+*	Bounded multi-producer, single-consumer queue of
+*	state machine inputs.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "InputQueue.h"
+
+#define INPUT_QUEUE_MASK	(INPUT_QUEUE_CAPACITY - 1)
+
+/* Full barrier compare-and-swap, increment and ordered load/store of the 32 bit counters.
+ * Positions wrap around; differences are taken as signed. */
+#ifdef _WIN32
+static inline int32_t counterCompareExchange(inputQueueCounter* c, int32_t value, int32_t expected)
+{
+	return (int32_t)InterlockedCompareExchange(c, (LONG)value, (LONG)expected);
+}
+static inline void counterIncrement(inputQueueCounter* c) { InterlockedIncrement(c); }
+static inline int32_t counterLoad(inputQueueCounter* c) { int32_t v = *c; MemoryBarrier(); return v; }
+static inline void counterStore(inputQueueCounter* c, int32_t v) { MemoryBarrier(); *c = v; }
+#else
+static inline int32_t counterCompareExchange(inputQueueCounter* c, int32_t value, int32_t expected)
+{
+	return __sync_val_compare_and_swap(c, expected, value);
+}
+static inline void counterIncrement(inputQueueCounter* c) { __sync_fetch_and_add(c, 1); }
+static inline int32_t counterLoad(inputQueueCounter* c) { return __atomic_load_n(c, __ATOMIC_ACQUIRE); }
+static inline void counterStore(inputQueueCounter* c, int32_t v) { __atomic_store_n(c, v, __ATOMIC_RELEASE); }
+#endif
+
+InputQueue::InputQueue()
+{
+	int i;
+
+	/* Slot i is free for the producer claiming position i */
+	for (i = 0; i < INPUT_QUEUE_CAPACITY; i++) {
+		slots[i].sequence = i;
+		memset(&slots[i].event, 0x00, sizeof(inputEvent));
+	}
+	tail = 0;
+	head = 0;
+	pushed = 0;
+	overflows = 0;
+	maxDepth = 0;
+}
+
+int InputQueue::Push(const inputEvent & e)
+{
+	inputQueueSlot* slot;
+	int32_t position, sequence, diff;
+
+	position = counterLoad(&tail);
+	while (1) {
+		slot = &slots[position & INPUT_QUEUE_MASK];
+		sequence = counterLoad(&slot->sequence);
+		diff = (int32_t)((uint32_t)sequence - (uint32_t)position);
+		if (diff == 0) {
+			/* Slot is free at this position, claim it */
+			if (counterCompareExchange(&tail, (int32_t)((uint32_t)position + 1), position) == position) break;
+			position = counterLoad(&tail);
+		}
+		else if (diff < 0) {
+			/* Slot still holds the input from one lap ago */
+			counterIncrement(&overflows);
+			return -1;
+		}
+		else position = counterLoad(&tail);
+	}
+
+	slot->event = e;
+	counterStore(&slot->sequence, (int32_t)((uint32_t)position + 1));
+	counterIncrement(&pushed);
+	return 0;
+}
+
+bool InputQueue::Pop(inputEvent* e)
+{
+	inputQueueSlot* slot;
+	int32_t position, depth;
+
+	position = head;
+	slot = &slots[position & INPUT_QUEUE_MASK];
+	if (counterLoad(&slot->sequence) != (int32_t)((uint32_t)position + 1)) return false;
+
+	depth = (int32_t)((uint32_t)counterLoad(&tail) - (uint32_t)position);
+	if (depth > maxDepth) maxDepth = depth;
+
+	*e = slot->event;
+	/* Free the slot for the producer one lap ahead */
+	counterStore(&slot->sequence, (int32_t)((uint32_t)position + INPUT_QUEUE_CAPACITY));
+	head = (int32_t)((uint32_t)position + 1);
+	return true;
+}
+
+int InputQueue::getDepth()
+{
+	return (int)((uint32_t)counterLoad(&tail) - (uint32_t)counterLoad(&head));
+}
+
+int InputQueue::getMaxDepth()
+{
+	return maxDepth;
+}
+
+uint32_t InputQueue::getPushed()
+{
+	return (uint32_t)pushed;
+}
+
+uint32_t InputQueue::getOverflows()
+{
+	return (uint32_t)overflows;
+}
+
+void InputQueue::Print(FILE* out)
+{
+	fprintf(out, "Input queue: %lu pushed, %d waiting, %d most waiting, %lu dropped (full)\n", (unsigned long)getPushed(),
+		getDepth(), getMaxDepth(), (unsigned long)getOverflows());
+}
@@ -0,0 +1,84 @@
+/*****************************************************
+*	InputQueue.h
+*
+*	Bounded lock-free queue of timestamped state
+*	machine inputs. The gesture and Gazebo listener
+*	threads push, the main loop pops, so every gesture
+*	command and sensor change reaches the FSM in order
+*	instead of being ORed into one input per tick.
+*
+*	Slots carry a sequence number (Vyukov's bounded
+*	queue): a producer claims a position with one
+*	compare-and-swap and publishes the slot by writing
+*	its sequence, so producers never wait on each other
+*	or on the consumer. A full queue drops the new
+*	input and counts the overflow.
+*****************************************************/
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define INPUT_QUEUE_CAPACITY	256		// power of two
+
+/* Input sources */
+#define INPUT_SOURCE_GESTURE	0
+#define INPUT_SOURCE_SENSOR		1
+
+typedef struct {
+	uint16_t	input;			// StateMachineDefs.h masks. For INPUT_SOURCE_SENSOR, all sensors that are tripped now.
+	int			source;			// INPUT_SOURCE_*
+	double		arg;			// turn angle for gesture commands
+	double		confidence;		// Gesture::getUserConfidence() for gesture commands
+	uint32_t	frameID;		// trace ID of the skeleton frame that produced the command, 0 when untraced
+	int64_t		frameTime;		// LatencyTrace::Now() when that frame was received
+	int64_t		postTime;		// LatencyTrace::Now() when the input was pushed
+}inputEvent;
+
+#ifdef _WIN32
+typedef volatile LONG	inputQueueCounter;
+#else
+typedef volatile int32_t	inputQueueCounter;
+#endif
+
+typedef struct {
+	inputQueueCounter	sequence;
+	inputEvent			event;
+}inputQueueSlot;
+
+class InputQueue
+{
+public:
+	InputQueue();
+
+	/// <summary>
+	/// Queue an input. Any number of threads may push at once.
+	/// </summary>
+	/// <returns>0 on success, -1 if the queue is full and the input was dropped</returns>
+	int Push(const inputEvent & e);
+
+	/// <summary>
+	/// Oldest input. Only one thread may pop.
+	/// </summary>
+	/// <returns>true if an input was returned, false if the queue is empty</returns>
+	bool Pop(inputEvent* e);
+
+	/* Inputs waiting now, and the most seen waiting by Pop */
+	int getDepth();
+	int getMaxDepth();
+	uint32_t getPushed();
+	uint32_t getOverflows();
+
+	void Print(FILE* out);
+
+private:
+	inputQueueSlot		slots[INPUT_QUEUE_CAPACITY];
+	inputQueueCounter	tail;		// next position to claim by producers
+	inputQueueCounter	head;		// next position to pop, written by the consumer only
+	inputQueueCounter	pushed;
+	inputQueueCounter	overflows;
+	int					maxDepth;
+};
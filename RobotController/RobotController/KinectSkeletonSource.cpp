@@ -0,0 +1,156 @@
+/*****************************************************
+*	KinectSkeletonSource.cpp
+*
+*	Skeleton frames from a Kinect v1 sensor using the
+*	Kinect SDK v1.8. Windows only.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "KinectSkeletonSource.h"
+
+#ifdef _WIN32
+
+#include <NuiSkeleton.h>
+
+KinectSkeletonSource::KinectSkeletonSource() :
+	m_pNuiSensor(NULL),
+	m_hNextSkeletonEvent(INVALID_HANDLE_VALUE),
+	m_pSkeletonStreamHandle(INVALID_HANDLE_VALUE)
+{
+}
+
+KinectSkeletonSource::~KinectSkeletonSource()
+{
+	Close();
+}
+
+/* Copy SDK skeleton frame into the portable frame type used for recognition and recording */
+static void convertSkeletonFrame(const NUI_SKELETON_FRAME & in, skeletonFrame & out)
+{
+	int i, j;
+
+	out.timestamp = in.liTimeStamp.QuadPart;
+	out.frameNumber = in.dwFrameNumber;
+	out.flags = in.dwFlags;
+
+	for (i = 0; i < SKELETON_COUNT; i++) {
+		const NUI_SKELETON_DATA& src = in.SkeletonData[i];
+		skeletonData& dst = out.skeletons[i];
+
+		dst.trackingState = src.eTrackingState;
+		dst.trackingID = src.dwTrackingID;
+		dst.position.x = src.Position.x;
+		dst.position.y = src.Position.y;
+		dst.position.z = src.Position.z;
+		for (j = 0; j < SKELETON_POSITION_COUNT; j++) {
+			dst.joints[j].x = src.SkeletonPositions[j].x;
+			dst.joints[j].y = src.SkeletonPositions[j].y;
+			dst.joints[j].z = src.SkeletonPositions[j].z;
+		}
+	}
+}
+
+int KinectSkeletonSource::GetNextFrame(skeletonFrame* frame, int timeout_ms)
+{
+	NUI_SKELETON_FRAME nuiFrame = { 0 };
+
+	if (NULL == m_pNuiSensor)
+	{
+		return SKELETON_SOURCE_ERROR;
+	}
+
+	/* Wait for new frame to become available from Kinect */
+	if (WAIT_OBJECT_0 != WaitForSingleObject(m_hNextSkeletonEvent, timeout_ms))
+	{
+		return SKELETON_SOURCE_TIMEOUT;
+	}
+
+	HRESULT hr = m_pNuiSensor->NuiSkeletonGetNextFrame(0, &nuiFrame);
+	if (FAILED(hr))
+	{
+		printf("ProcessSkeleton failed.\n");
+		return SKELETON_SOURCE_ERROR;
+	}
+
+	/* Raw joints. Smoothing is done by the Gesture class's SkeletonFilter so it applies to every source. */
+	convertSkeletonFrame(nuiFrame, *frame);
+	return SKELETON_SOURCE_FRAME;
+}
+
+/// <summary>
+/// Create the first connected Kinect found
+/// </summary>
+/// <returns>indicates success or failure</returns>
+int KinectSkeletonSource::Open()
+{
+	INuiSensor * pNuiSensor;
+
+	int iSensorCount = 0;
+	HRESULT hr = NuiGetSensorCount(&iSensorCount);
+	if (FAILED(hr))
+	{
+		return -1;
+	}
+
+	// Look at each Kinect sensor
+	for (int i = 0; i < iSensorCount; ++i)
+	{
+		// Create the sensor so we can check status, if we can't create it, move on to the next
+		hr = NuiCreateSensorByIndex(i, &pNuiSensor);
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		// Get the status of the sensor, and if connected, then we can initialize it
+		hr = pNuiSensor->NuiStatus();
+		if (S_OK == hr)
+		{
+			m_pNuiSensor = pNuiSensor;
+			break;
+		}
+
+		// This sensor wasn't OK, so release it since we're not using it
+		pNuiSensor->Release();
+	}
+
+	if (NULL != m_pNuiSensor)
+	{
+		// Initialize the Kinect and specify that we'll be using skeleton
+		hr = m_pNuiSensor->NuiInitialize(NUI_INITIALIZE_FLAG_USES_SKELETON);
+		if (SUCCEEDED(hr))
+		{
+			// Create an event that will be signaled when skeleton data is available
+			m_hNextSkeletonEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+			// Open a skeleton stream to receive skeleton data
+			hr = m_pNuiSensor->NuiSkeletonTrackingEnable(m_hNextSkeletonEvent, 0);
+		}
+	}
+
+	if (NULL == m_pNuiSensor || FAILED(hr))
+	{
+		printf("No ready Kinect found!\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+void KinectSkeletonSource::Close()
+{
+	if (m_pNuiSensor)
+	{
+		m_pNuiSensor->NuiShutdown();
+		SafeRelease(m_pNuiSensor);
+	}
+
+	if (m_hNextSkeletonEvent && (m_hNextSkeletonEvent != INVALID_HANDLE_VALUE))
+	{
+		CloseHandle(m_hNextSkeletonEvent);
+	}
+	m_hNextSkeletonEvent = INVALID_HANDLE_VALUE;
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*****************************************************
+*	KinectSkeletonSource.h
+*
+*	Skeleton frames from a Kinect v1 sensor using the
+*	Kinect SDK v1.8. Windows only.
+*****************************************************/
+
+#pragma once
+
+#ifdef _WIN32
+
+#include "SkeletonSource.h"
+
+#include <windows.h>
+#include <NuiApi.h>
+
+class KinectSkeletonSource : public SkeletonSource
+{
+public:
+	/* Public Functions */
+	KinectSkeletonSource();
+	~KinectSkeletonSource();
+
+	/// <summary>
+	/// Create the first connected Kinect found
+	/// </summary>
+	/// <returns>0 on success, -1 on failure</returns>
+	int Open();
+	int GetNextFrame(skeletonFrame* frame, int timeout_ms);
+	void Close();
+
+private:
+	/* Private Variables */
+	INuiSensor*             m_pNuiSensor;
+
+	HANDLE                  m_pSkeletonStreamHandle;
+	HANDLE                  m_hNextSkeletonEvent;
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*****************************************************
+*	LatencyTrace.cpp
+*
+*	Per-stage latency histograms for gesture commands.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "LatencyTrace.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+static const char* traceStageNames[TRACE_STAGE_COUNT] = {
+	"recognize", "dispatch", "send", "actuate", "total"
+};
+
+LatencyHistogram::LatencyHistogram()
+{
+	Clear();
+}
+
+void LatencyHistogram::Clear()
+{
+	memset(buckets, 0x00, sizeof(buckets));
+	count = 0;
+	sum = 0;
+	max = 0;
+}
+
+int LatencyHistogram::bucketIndex(int64_t us)
+{
+	int log2;
+
+	if (us < 0) us = 0;
+	if (us < LATENCY_HIST_SUB_COUNT) return (int)us;
+
+	log2 = 0;
+	while ((us >> (log2 + 1)) != 0) log2++;
+	if (log2 > LATENCY_HIST_MAX_LOG2) return LATENCY_HIST_BUCKETS - 1;
+
+	return (log2 - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_COUNT + (int)((us >> (log2 - LATENCY_HIST_SUB_BITS)) & (LATENCY_HIST_SUB_COUNT - 1));
+}
+
+int64_t LatencyHistogram::bucketUpperBound(int index)
+{
+	int log2, sub;
+
+	if (index < LATENCY_HIST_SUB_COUNT) return index;
+
+	log2 = index / LATENCY_HIST_SUB_COUNT + LATENCY_HIST_SUB_BITS - 1;
+	sub = index % LATENCY_HIST_SUB_COUNT;
+	return ((int64_t)(LATENCY_HIST_SUB_COUNT + sub + 1) << (log2 - LATENCY_HIST_SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::Record(int64_t us)
+{
+	buckets[bucketIndex(us)]++;
+	count++;
+	sum += us;
+	if (us > max) max = us;
+}
+
+uint64_t LatencyHistogram::getCount()
+{
+	return count;
+}
+
+int64_t LatencyHistogram::getMax()
+{
+	return max;
+}
+
+double LatencyHistogram::getMean()
+{
+	return (count > 0) ? (double)sum / (double)count : 0.0;
+}
+
+int64_t LatencyHistogram::getPercentile(double fraction)
+{
+	uint64_t target, seen;
+	int i;
+
+	if (count == 0) return 0;
+	target = (uint64_t)ceil(fraction * (double)count);
+	if (target < 1) target = 1;
+
+	seen = 0;
+	for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= target) {
+			return (bucketUpperBound(i) < max) ? bucketUpperBound(i) : max;
+		}
+	}
+	return max;
+}
+
+LatencyTrace::LatencyTrace()
+{
+	memset(pending, 0x00, sizeof(pending));
+	framesReceived = 0;
+	framesDropped = 0;
+	frameGaps = 0;
+}
+
+int64_t LatencyTrace::Now()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (int64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 + (int64_t)((counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void LatencyTrace::Record(int stage, int64_t us)
+{
+	if (stage < 0 || stage >= TRACE_STAGE_COUNT) return;
+	stages[stage].Record(us);
+}
+
+void LatencyTrace::commandSent(uint32_t traceID, int64_t frameTime, int64_t sendTime)
+{
+	latencyTracePending* p = &pending[traceID % TRACE_PENDING_COUNT];
+
+	p->frameTime = frameTime;
+	p->sendTime = sendTime;
+	p->traceID = traceID;
+}
+
+void LatencyTrace::commandAcknowledged(uint32_t traceID)
+{
+	latencyTracePending* p = &pending[traceID % TRACE_PENDING_COUNT];
+	int64_t now;
+
+	/* Untraced, already acknowledged, or pushed out of the pending table by newer commands */
+	if (traceID == 0 || p->traceID != traceID) return;
+
+	now = Now();
+	stages[TRACE_STAGE_ACTUATE].Record(now - p->sendTime);
+	stages[TRACE_STAGE_TOTAL].Record(now - p->frameTime);
+	p->traceID = 0;
+}
+
+void LatencyTrace::setFrameCounts(uint64_t received, uint64_t dropped, uint64_t gaps)
+{
+	framesReceived = received;
+	framesDropped = dropped;
+	frameGaps = gaps;
+}
+
+void LatencyTrace::Print(FILE* out)
+{
+	int i;
+
+	fprintf(out, "Latency (us)    count        p50        p99        max       mean\n");
+	for (i = 0; i < TRACE_STAGE_COUNT; i++) {
+		fprintf(out, "%-10s %10llu %10lld %10lld %10lld %10.1f\n", traceStageNames[i],
+			(unsigned long long)stages[i].getCount(), (long long)stages[i].getPercentile(0.50),
+			(long long)stages[i].getPercentile(0.99), (long long)stages[i].getMax(), stages[i].getMean());
+	}
+	fprintf(out, "Skeleton frames %llu received, %llu dropped in %llu gaps\n", (unsigned long long)framesReceived,
+		(unsigned long long)framesDropped, (unsigned long long)frameGaps);
+}
+
+void LatencyTrace::Clear()
+{
+	int i;
+
+	for (i = 0; i < TRACE_STAGE_COUNT; i++) stages[i].Clear();
+	memset(pending, 0x00, sizeof(pending));
+}
@@ -0,0 +1,98 @@
+/*****************************************************
+*	LatencyTrace.h
+*
+*	Gesture to actuation latency tracing. Each skeleton
+*	frame gets an ID and a monotonic receive time which
+*	travel with the resulting command through the FSM
+*	and the TCP command message. gazeboInterface echoes
+*	the ID back over UDP after publishing the velocity
+*	Pose, closing the trace.
+*
+*	Each stage keeps a histogram so p50/p99/max can be
+*	printed while the controller is running.
+*****************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Trace stages, all in microseconds */
+#define TRACE_STAGE_RECOGNIZE	0	// frame received -> command posted by gesture thread
+#define TRACE_STAGE_DISPATCH	1	// command posted -> FSM stepped
+#define TRACE_STAGE_SEND		2	// FSM stepped -> TCP command sent
+#define TRACE_STAGE_ACTUATE		3	// TCP command sent -> gazeboInterface publish acknowledged (round trip)
+#define TRACE_STAGE_TOTAL		4	// frame received -> gazeboInterface publish acknowledged
+#define TRACE_STAGE_COUNT		5
+
+/* Histogram buckets: exact below 16 us, then 16 buckets per power of two (worst case 6% error) */
+#define LATENCY_HIST_SUB_BITS	4
+#define LATENCY_HIST_SUB_COUNT	(1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_LOG2	40
+#define LATENCY_HIST_BUCKETS	((LATENCY_HIST_MAX_LOG2 - LATENCY_HIST_SUB_BITS + 2) * LATENCY_HIST_SUB_COUNT)
+
+/* Commands sent but not yet acknowledged. Older entries are overwritten. */
+#define TRACE_PENDING_COUNT		64
+
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+	void Clear();
+	void Record(int64_t us);
+
+	uint64_t getCount();
+	int64_t getMax();
+	double getMean();
+
+	/// <summary>
+	/// Upper bound of the bucket holding the given fraction (0..1) of samples
+	/// </summary>
+	int64_t getPercentile(double fraction);
+
+private:
+	static int bucketIndex(int64_t us);
+	static int64_t bucketUpperBound(int index);
+
+	uint32_t	buckets[LATENCY_HIST_BUCKETS];
+	uint64_t	count;
+	int64_t		sum;
+	int64_t		max;
+};
+
+typedef struct {
+	uint32_t	traceID;
+	int64_t		frameTime;
+	int64_t		sendTime;
+}latencyTracePending;
+
+/* Each stage is recorded by a single thread. Print() may run on any thread and can see a sample half recorded. */
+class LatencyTrace
+{
+public:
+	LatencyTrace();
+
+	/// <summary>
+	/// Monotonic clock in microseconds, shared by all trace stamps
+	/// </summary>
+	static int64_t Now();
+
+	void Record(int stage, int64_t us);
+
+	/* Remember a sent command until gazeboInterface acknowledges its trace ID */
+	void commandSent(uint32_t traceID, int64_t frameTime, int64_t sendTime);
+	void commandAcknowledged(uint32_t traceID);
+
+	/* Skeleton frame counters (see Gesture::getFrameStats), printed with the histograms. Dropped frames stretch the RECOGNIZE stage. */
+	void setFrameCounts(uint64_t received, uint64_t dropped, uint64_t gaps);
+
+	void Print(FILE* out);
+	void Clear();
+
+private:
+	LatencyHistogram		stages[TRACE_STAGE_COUNT];
+	latencyTracePending		pending[TRACE_PENDING_COUNT];
+	uint64_t				framesReceived;
+	uint64_t				framesDropped;
+	uint64_t				frameGaps;
+};
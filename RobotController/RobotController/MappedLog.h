@@ -0,0 +1,23 @@
+/*****************************************************
+*	MappedLog.h
+*
+*	Checks shared by the memory-mapped log readers
+*	(SkeletonLogReader, StateMachineLogReader). Their
+*	files are a header followed by fixed-size records,
+*	the count taken from the file size.
+*****************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+/// <summary>
+/// Number of whole records of recordSize bytes after a header of headerSize bytes in a mapped file of
+/// mapSize bytes. headerSize comes from the file itself, so it is checked against mapSize before use.
+/// </summary>
+/// <returns>The record count, or -1 if the header runs past the end of the file or recordSize is 0</returns>
+inline int64_t mappedLogRecordCount(uint64_t mapSize, uint64_t headerSize, uint64_t recordSize)
+{
+	if (headerSize > mapSize || recordSize == 0) return -1;
+	return (int64_t)((mapSize - headerSize) / recordSize);
+}
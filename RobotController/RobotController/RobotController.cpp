@@ -1,469 +1,778 @@
-/****************************************************************************
-*	RobotController.cpp
-*
-*	Main project file. 
-*	Provides control inputs for a simulated robot over TCP/UDP sockets.
-*	Intended for use with Gazebo simulator.
-*
-*	Author: Charles Hartsell
-*			Ben Yett
-*
-*	Date:	3-31-17
-****************************************************************************/
-
-#include "NetSocket.h"
-#include "Gesture.h"
-#include "StateMachine.h"
-#include "GazeboDefs.h"
-#include "StateMachineDefs.h"
-
-#include "stdafx.h"
-
-#define UDP_PORT "18423"
-#define TCP_PORT "18424"
-
-#define MUTEX_WAIT_TIMEOUT_MS		500
-#define THREAD_WAIT_TIMEOUT_MS		500
-
-typedef struct threadSharedItems{
-	bool	threadShutdown;
-	bool	new_msg;
-	int		msg_len;
-	char	*msg_p;
-	HANDLE	mutex;
-}threadSharedItems;
-
-typedef struct gestureData {
-	uint16_t		user_cmd;
-	double	arg;
-}gestureData;
-
-/* Gesture recognition thread function declaration */
-DWORD WINAPI gestureThreadFunction(LPVOID lpParam);
-
-/* Gazebo Listener thread function declaration */
-DWORD WINAPI listenThreadFunction(LPVOID lpParam);
-
-/* Helper functions */
-int shutdownThread(HANDLE thread, threadSharedItems *t_items);
-uint16_t DEBUG_GetUserInputCMDLine();
-void DEBUG_PrintUserCMD(uint16_t input);
-void DEBUG_PrintCMD(int cmd_id, double cmd_arg);
-
-
-int main(/*array<System::String ^> ^args*/)
-{
-	/* Thread Specific variables */
-	WSADATA				wsaData;
-	HANDLE				gestureThread, listenerThread;
-	DWORD				gestureThreadID, listenerThreadID;
-	threadSharedItems	*gestureShared, *listenerShared;
-	
-
-	char		buf[GAZEBO_CMD_MSG_SIZE];
-	int			cmd_id;
-	double		turn_angle;
-	uint16_t	machineInput;
-	StateMachine *FSM = new StateMachine();
-
-	/* Allocate and initilize memory */
-	gestureShared	= (threadSharedItems*)malloc(sizeof(threadSharedItems));
-	if (gestureShared == NULL) {
-		printf("ERROR: Failed to allocate memory for gestureShared.\n");
-		ExitProcess(1);
-	}
-
-	listenerShared	= (threadSharedItems*)malloc(sizeof(threadSharedItems));
-	if (listenerShared == NULL) {
-		free(gestureShared);
-		printf("ERROR: Failed to allocate memory for listenerShared.\n");
-		ExitProcess(1);
-	}
-
-	memset(gestureShared, 0x00, sizeof(threadSharedItems));
-	memset(listenerShared, 0x00, sizeof(threadSharedItems));
-	cmd_id = NULL_CMD;
-	machineInput = 0;
-	turn_angle = 0.0;
-
-	/* Create thread mutexes */
-	gestureShared->mutex = CreateMutex(
-		NULL,						// default security attributes
-		FALSE,						// initially not owned
-		NULL);						// unnamed mutex
-	listenerShared->mutex = CreateMutex(
-		NULL,						// default security attributes
-		FALSE,						// initially not owned
-		NULL);						// unnamed mutex
-
-	if (gestureShared->mutex == NULL)
-	{
-		printf("CreateMutex error: %d\n", GetLastError());
-		ExitProcess(2);
-	}
-	if (listenerShared->mutex == NULL)
-	{
-		printf("CreateMutex error: %d\n", GetLastError());
-		ExitProcess(2);
-	}
-
-	/* Spawn gesture recognition thread */
-	gestureThread = CreateThread(
-		NULL,								// default security attributes
-		0,									// use default stack size  
-		gestureThreadFunction,				// thread function name
-		(LPVOID)gestureShared,				// argument to thread function 
-		0,									// use default creation flags 
-		&gestureThreadID);					// returns the thread identifier 
-
-	if (gestureThread == NULL) {
-		printf("ERROR: Failed to spawn gesture recognition thread.\n");
-		ExitProcess(3);
-	}
-
-	/* Startup WSA */
-	if ((WSAStartup(MAKEWORD(2, 2), &wsaData)) != 0) {
-		printf("ERROR: WSAStartup failed.");
-		ExitProcess(1);
-	}
-	
-	/* Open TCP Socket for command communication with Gazebo Interface. Block until handshake received. */
-	NetSocket* TCP_Socket = new NetSocket(TCP_PORT, SOCK_STREAM);
-	TCP_Socket->openSocket();
-	TCP_Socket->waitForConnection();
-	
-	/* Spawn Gazebo Listener thread */
-	listenerThread = CreateThread(
-		NULL,								// default security attributes
-		0,									// use default stack size  
-		listenThreadFunction,				// thread function name
-		(LPVOID)listenerShared,				// argument to thread function 
-		0,									// use default creation flags 
-		&listenerThreadID);					// returns the thread identifier 
-
-	if (listenerThread == NULL) {
-		printf("ERROR: Failed to spawn Gazebo listener thread.\n");
-		ExitProcess(3);
-	}
-
-	/* Main task loop */
-	while (1) {
-		Sleep( STATE_MACHINE_TICK_TIME_MS );
-
-		/* Lock mutex on listener shared data and read latest data update */
-		WaitForSingleObject(listenerShared->mutex, INFINITE);
-		if (listenerShared->new_msg == TRUE) {
-			machineInput |= *((uint16_t*)(listenerShared->msg_p));
-		}
-		listenerShared->new_msg = FALSE;
-		ReleaseMutex(listenerShared->mutex);
-
-		/* Lock mutex on gesture shared data and read latest user input */
-		WaitForSingleObject(gestureShared->mutex, INFINITE);
-		if (gestureShared->new_msg == TRUE) {
-			machineInput |= ((gestureData*)(gestureShared->msg_p))->user_cmd;
-			turn_angle = ((gestureData*)(gestureShared->msg_p))->arg;
-			((gestureData*)(gestureShared->msg_p))->user_cmd = NULL_CMD;
-			((gestureData*)(gestureShared->msg_p))->arg = 0.0;
-		}
-		gestureShared->new_msg = FALSE;
-		ReleaseMutex(gestureShared->mutex);
-
-		/************ DEBUG *************
-		if (machineInput & (STOP_CMD_MASK | FORWARD_CMD_MASK | REVERSE_CMD_MASK | TURN_L_CMD_MASK | TURN_R_CMD_MASK | MANUAL_MODE_CMD_MASK | AUTO_MODE_CMD_MASK))
-			DEBUG_PrintUserCMD(machineInput);
-		*/
-
-		/* Send input to FSM, step, and get output */
-		FSM->setInput(machineInput, turn_angle);
-		FSM->stepMachine();
-		cmd_id = FSM->getOutputCmd();
-		machineInput = NULL_CMD_MASK;
-
-		/************ DEBUG *************
-		machineInput = FSM->getCurrentState();
-		printf("cmd: %d\tstate: %d\n", cmd_id, machineInput);
-		machineInput = NULL_CMD_MASK;*/
-
-		/************ DEBUG *************
-		if (cmd_id != NULL_CMD)
-			DEBUG_PrintCMD(cmd_id, turn_angle);
-		*/
-
-		/* Send command and argument (as applicable) to gazeboInterface */
-		if (cmd_id != NULL_CMD){
-			memcpy(&buf[0], &cmd_id, sizeof(cmd_id));
-			if ((FSM->getCurrentState()) == AUTO_TURN_L_STATE){
-				turn_angle = GESTURE_MAX_TURN_L;
-			}
-			else if ((FSM->getCurrentState()) == AUTO_TURN_R_STATE){
-				turn_angle = GESTURE_MAX_TURN_R;
-			}
-			memcpy(&buf[sizeof(cmd_id)], &turn_angle, sizeof(turn_angle));
-			if (TCP_Socket->Send(buf, sizeof(buf)) == -1) {
-				printf("TCP Send error.\n");
-			}
-		}
-	}
-
-	/* Shutdown */
-	shutdownThread(gestureThread, gestureShared);
-	shutdownThread(listenerThread, listenerShared);
-	free(gestureShared);
-	free(listenerShared);
-	WSACleanup();
-
-	return 0;
-}
-
-/* Gesture recognition thread function definition */
-DWORD WINAPI gestureThreadFunction(LPVOID lpParam) 
-{
-	threadSharedItems *gestureShared;
-	gestureData *inputData;
-	int threadShutdown;
-	uint16_t userInput;
-	double arg;
-
-	gestureShared = (threadSharedItems*)lpParam;
-	threadShutdown = FALSE;
-
-	inputData = (gestureData*)malloc(sizeof(gestureData));
-	if (inputData == NULL) {
-		printf("ERROR: Failed to allocate memory for inputData. Stopping gesture thread.\n");
-		return -1;
-	}
-	memset(inputData, 0x00, sizeof(gestureData));
-
-	/* Spawn Gesture class and initilize Kinect*/
-	Gesture* gesture = new Gesture();
-	if ((gesture->CreateFirstConnected()) != S_OK) {
-		printf("ERROR: Failed to link with Kinect. Stopping gesture recognition thread.\n");
-		return -1;
-	}
-	else printf("Linked with Kinect.\n");
-
-	/* Configure shared data structure */
-	WaitForSingleObject(gestureShared->mutex, INFINITE);
-	gestureShared->msg_len = sizeof(gestureData);
-	gestureShared->msg_p = (char*)inputData;
-	ReleaseMutex(gestureShared->mutex);
-
-	while ( !threadShutdown ) {
-		gesture->Update();
-		userInput = gesture->getUserInput();
-		arg = gesture->getUserArg();
-
-		/* Lock mutex on shared data. Update inputData if necessary and check if thread has been told to shutdown */
-		WaitForSingleObject(gestureShared->mutex, INFINITE);
-		if ((userInput & ~(STOP_TURN_CMD_MASK)) != NULL_CMD_MASK) {
-			gestureShared->new_msg = TRUE;
-			inputData->user_cmd = userInput;
-			inputData->arg = arg;
-		}
-		else if (userInput & STOP_TURN_CMD_MASK){
-			gestureShared->new_msg = TRUE;
-			inputData->user_cmd |= STOP_TURN_CMD_MASK;
-		}
-		threadShutdown = gestureShared->threadShutdown;
-		ReleaseMutex(gestureShared->mutex);
-	}
-
-	return 0;
-}
-
-/* Gazebo Listener thread function definition */
-DWORD WINAPI listenThreadFunction(LPVOID lpParam)
-{
-	threadSharedItems	*listenerShared;
-	gazeboSensorData	sensorData;
-
-	int			threadShutdown, data_id, buf_len, data_index;
-	uint16_t	sensorMask, sharedMask;
-	double		data_value;
-	char		buf[GAZEBO_DATA_MSG_SIZE];
-
-	listenerShared = (threadSharedItems*)lpParam;
-	threadShutdown = FALSE;
-	memset(&sensorData, 0x00, sizeof(sensorData));
-
-	/* Open UDP Socket for listening to Gazebo data messages */
-	NetSocket* UDP_Socket = new NetSocket(UDP_PORT, SOCK_DGRAM);
-	UDP_Socket->openSocket();
-	if ((UDP_Socket->waitForConnection()) == -1) {
-		printf("ERROR: Failed to open UDP socket with Gazebo. Stopping listener thread.\n");
-		return -1;
-	}
-
-	/* Configure shared data structure */
-	WaitForSingleObject(listenerShared->mutex, INFINITE);
-	listenerShared->msg_len = sizeof(uint16_t);
-	listenerShared->msg_p = (char*)&sharedMask;
-	ReleaseMutex(listenerShared->mutex);
-
-	while (!threadShutdown) {
-		buf_len = sizeof(buf);
-		UDP_Socket->Recv(buf, &buf_len);
-
-		/* Verify valid message length */
-		if (buf_len == GAZEBO_DATA_MSG_SIZE) {
-			memcpy(&data_id, &buf[0], sizeof(data_id));
-			memcpy(&data_value, &buf[sizeof(data_id)], sizeof(data_value));
-
-			/* Verify valid data_id */
-			if ((data_id >= GAZEBO_SENSOR_BASE) || (data_id < (GAZEBO_SENSOR_BASE + GAZEBO_SENSOR_COUNT))) {
-				data_index = data_id % GAZEBO_SENSOR_BASE;
-				sensorData.sensor_ranges[data_index] = data_value;
-			}
-			else {
-				printf("ERROR: Unknown data message ID (%d) received.\n", data_id);
-			}
-		}
-		else if (buf_len == SOCKET_ERROR) printf("ERROR: UDP_Socket->Recv() failed.\n");
-		else printf("ERROR: Received unknown message from Gazebo.\n");
-
-		/* Check if any sensor has tripped (detects danger condition) */
-		sensorMask = 0;
-		if (sensorData.sensor_ranges[WALL_ID % GAZEBO_SENSOR_BASE] < WALL_SENSOR_TRIP_RANGE) 
-		{
-			sensorMask |= WALL_SENSOR_MASK;
-		}
-		if (sensorData.sensor_ranges[LEFT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ||
-			sensorData.sensor_ranges[LEFTFRONT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ) 
-		{
-			sensorMask |= LEFT_SENSOR_MASK;
-		}
-		if (sensorData.sensor_ranges[RIGHT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ||
-			sensorData.sensor_ranges[RIGHTFRONT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE)
-		{
-			sensorMask |= RIGHT_SENSOR_MASK;
-		}
-
-		/* Update shared data and check if thread has been told to shutdown. */
-		WaitForSingleObject(listenerShared->mutex, INFINITE);
-		listenerShared->new_msg = TRUE;
-		sharedMask = sensorMask;
-		threadShutdown = listenerShared->threadShutdown;
-		ReleaseMutex(listenerShared->mutex);
-	}
-
-	return 0;
-}
-
-int shutdownThread(HANDLE thread, threadSharedItems *t_items)
-{
-	int rv;
-
-	rv = WaitForSingleObject(t_items->mutex, MUTEX_WAIT_TIMEOUT_MS);
-	switch (rv) {
-	case WAIT_OBJECT_0:
-		t_items->threadShutdown = TRUE;
-		ReleaseMutex(t_items->mutex);
-		/* Wait for thread to exit gracefully */
-		rv = WaitForSingleObject(thread, THREAD_WAIT_TIMEOUT_MS);
-		switch (rv) {
-		case WAIT_OBJECT_0:
-			rv = 0;
-			break;
-		default:
-			printf("ERROR: Thread did not shutdown in time after sending shutdown command.\n");
-			TerminateThread(thread, -1);
-			rv = -1;
-			break;
-		}
-		break;
-	case WAIT_TIMEOUT:
-		printf("ERROR: Timeout when locking shared thread data mutex for thread shutdown. Terminating thread.\n");
-		TerminateThread(thread, -1);
-		rv = -1;
-		break;
-	default:
-		printf("ERROR: Unknown error locking thread mutex. Terminating thread.\n");
-		TerminateThread(thread, -1);
-		rv = -1;
-		break;
-	}
-
-	CloseHandle(t_items->mutex);
-	CloseHandle(thread);
-
-	return rv;
-}
-
-uint16_t DEBUG_GetUserInputCMDLine()
-{
-	char buf[10];
-	uint16_t input;
-
-	printf("User Input: ");
-	std::cin.getline(buf, 10);
-	input = atoi(buf);
-
-	return input;
-}
-
-void DEBUG_PrintUserCMD(uint16_t input)
-{
-	printf("User Input:\n");
-	if (input & STOP_CMD_MASK)
-		printf("\tSTOP\n");
-	if (input & FORWARD_CMD_MASK)
-		printf("\tFORWARD\n");
-	if (input & REVERSE_CMD_MASK)
-		printf("\tREVERSE\n");
-	if (input & TURN_L_CMD_MASK)
-		printf("\tTURN_L\n");
-	if (input & TURN_R_CMD_MASK)
-		printf("\tTURN_R\n");
-	if (input & AUTO_MODE_CMD_MASK)
-		printf("\tAUTO MODE\n");
-	if (input & MANUAL_MODE_CMD_MASK)
-		printf("\tMANUAL MODE\n");
-
-	printf("\n");
-}
-
-void DEBUG_PrintCMD(int cmd_id, double cmd_arg)
-{
-	printf("Sending Command:\t");
-	switch (cmd_id){
-	case STOP_CMD:
-		printf("STOP\n");
-		break;
-	case FORWARD_CMD:
-		printf("FORWARD\n");
-		break;
-	case REVERSE_CMD:
-		printf("REVERSE\n");
-		break;
-	case TURN_L_CMD:
-		printf("TURN_L\t turn_angle: %f\n", cmd_arg);
-		break;
-	case TURN_R_CMD:
-		printf("TURN_R\t turn_angle: %f\n", cmd_arg);
-		break;
-	case FORWARD_L_CMD:
-		printf("FORWARD_L\t turn_angle: %f\n", cmd_arg);
-		break;
-	case FORWARD_R_CMD:
-		printf("FORWARD_R\t turn_angle: %f\n", cmd_arg);
-		break;
-	case REVERSE_L_CMD:
-		printf("REVERSE_L\t turn_angle: %f\n", cmd_arg);
-		break;
-	case REVERSE_R_CMD:
-		printf("REVERSE_R\t turn_angle: %f\n", cmd_arg);
-		break;
-	case AUTO_MODE_CMD:
-		printf("AUTO_MODE\n");
-		break;
-	case MANUAL_MODE_CMD:
-		printf("MANUAL_MODE\n");
-		break;
-	default:
-		printf("ERROR: RobotContoller DEBUG_PrintCMD Unknown command ID.\n");
-		break;
-	}
-
-	printf("\n");
+/****************************************************************************
+*	RobotController.cpp
+*
+*	Main project file. 
+*	Provides control inputs for a simulated robot over TCP/UDP sockets.
+*	Intended for use with Gazebo simulator.
+*
+*	Author: Charles Hartsell
+*			Ben Yett
+*
+*	Date:	3-31-17
+****************************************************************************/
+
+#include "NetSocket.h"
+#include "Gesture.h"
+#include "KinectSkeletonSource.h"
+#include "FileSkeletonSource.h"
+#include "UdpSkeletonSource.h"
+#include "StateMachine.h"
+#include "StateMachineChart.h"
+#include "StateMachineProfile.h"
+#include "StateMachineLog.h"
+#include "GazeboDefs.h"
+#include "StateMachineDefs.h"
+#include "LatencyTrace.h"
+#include "InputQueue.h"
+#include "TimerWheel.h"
+#include "WallFollower.h"
+
+#include "stdafx.h"
+
+#define UDP_PORT "18423"
+#define TCP_PORT "18424"
+
+#define MUTEX_WAIT_TIMEOUT_MS		500
+#define THREAD_WAIT_TIMEOUT_MS		500
+
+/* Main loop timers */
+#define TIMER_FSM_DEADLINE			0		// end of the AUTO mode delay the FSM waits for
+
+typedef struct threadSharedItems{
+	bool	threadShutdown;
+	HANDLE	mutex;
+	HANDLE	event;		// auto-reset, signaled when queued input should be handled before the next FSM tick
+}threadSharedItems;
+
+/* Gesture recognition thread function declaration */
+DWORD WINAPI gestureThreadFunction(LPVOID lpParam);
+
+/* Gazebo Listener thread function declaration */
+DWORD WINAPI listenThreadFunction(LPVOID lpParam);
+
+/* Helper functions */
+void stepFSM(StateMachine* FSM, NetSocket* TCP_Socket, TimerWheel* timers, uint16_t input, double* turn_angle, int64_t stepTime, uint32_t traceID, int64_t traceFrameTime, int64_t traceStepTime);
+void runTimers(StateMachine* FSM, NetSocket* TCP_Socket, TimerWheel* timers, int64_t now, uint16_t sensorMask, double* turn_angle);
+int shutdownThread(HANDLE thread, threadSharedItems *t_items);
+uint16_t DEBUG_GetUserInputCMDLine();
+void DEBUG_PrintUserCMD(uint16_t input);
+void DEBUG_PrintCMD(int cmd_id, double cmd_arg);
+BOOL WINAPI consoleCtrlHandler(DWORD ctrlType);
+
+/* Skeleton log file set with "-record <file>". NULL when not recording. */
+static const char* skeletonRecordPath = NULL;
+
+/* Trace of every FSM step, written to the file set with "-fsmlog <file>" for StateMachineReplay */
+static const char* fsmLogPath = NULL;
+static StateMachineLogWriter fsmLog;
+
+/* Skeleton frame source options. Kinect sensor is used unless "-replay <file>" or "-udp <port>" is given. */
+static const char* skeletonReplayPath = NULL;
+static const char* skeletonUdpPort = NULL;
+
+/* Operator arbitration policy set with "-operator <longest | closest | claim>" */
+static int gestureArbitration = GESTURE_ARBITRATE_LONGEST;
+
+/* Joint smoothing set with "-smooth off" or "-smooth <minCutoff Hz> <beta>". Defaults in SkeletonFilter.h. */
+static bool skeletonSmoothing = true;
+static float skeletonFilterMinCutoff = SKELETON_FILTER_MIN_CUTOFF;
+static float skeletonFilterBeta = SKELETON_FILTER_BETA;
+
+/* Gesture template file set with "-templates <file>". NULL for pose rules only. */
+static const char* gestureTemplatePath = NULL;
+
+/* Early commit confidence for repeated-motion gestures set with "-commit <confidence>". Default in Gesture.h. */
+static double gestureCommitConfidence = GESTURE_COMMIT_CONFIDENCE;
+
+/* Gesture to actuation latency histograms. Printed on Ctrl+Break. */
+static LatencyTrace latencyTrace;
+
+/* Gesture commands and sensor changes for the FSM, in the order they happened. Counters printed on Ctrl+Break. */
+static InputQueue inputQueue;
+
+/* State coverage and dwell times of the FSM, and the table it runs for listing changes of state never taken */
+static StateMachineProfile fsmProfile;
+static const fsmEntry (*fsmProfileTable)[FSM_SYMBOLS] = NULL;
+
+/* "-wallfollow [left | right]": AUTO mode follows walls and floor edges steered by the raw sensor ranges,
+ * the latest of which the listener thread keeps in sensorRanges */
+static bool fsmWallFollow = false;
+static WallFollower wallFollower;
+static gazeboSensorData sensorRanges;
+static HANDLE sensorRangesMutex = NULL;
+
+
+int main(int argc, char* argv[])
+{
+	/* Thread Specific variables */
+	WSADATA				wsaData;
+	HANDLE				gestureThread, listenerThread;
+	DWORD				gestureThreadID, listenerThreadID;
+	threadSharedItems	*gestureShared, *listenerShared;
+	
+
+	double		turn_angle;
+	double		gesture_confidence;
+	inputEvent	event;
+	uint16_t	sensorMask;
+	int64_t		now, deadline;
+	DWORD		wait;
+
+	/* Trace of the gesture input consumed by an FSM step */
+	uint32_t	traceID;
+	int64_t		traceFrameTime, traceStepTime;
+	StateMachine *FSM = NULL;
+	bool		fsmFromChart = false;
+	int			fsmLogTable;
+	static fsmEntry fsmChartTable[FSM_STATE_CODES][FSM_SYMBOLS];
+
+	/* Allocate and initilize memory */
+	gestureShared	= (threadSharedItems*)malloc(sizeof(threadSharedItems));
+	if (gestureShared == NULL) {
+		printf("ERROR: Failed to allocate memory for gestureShared.\n");
+		ExitProcess(1);
+	}
+
+	listenerShared	= (threadSharedItems*)malloc(sizeof(threadSharedItems));
+	if (listenerShared == NULL) {
+		free(gestureShared);
+		printf("ERROR: Failed to allocate memory for listenerShared.\n");
+		ExitProcess(1);
+	}
+
+	memset(gestureShared, 0x00, sizeof(threadSharedItems));
+	memset(listenerShared, 0x00, sizeof(threadSharedItems));
+	turn_angle = 0.0;
+	gesture_confidence = 0.0;
+	sensorMask = 0;
+
+	/* Parse command line options */
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-record") == 0 && (i + 1) < argc) {
+			skeletonRecordPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-replay") == 0 && (i + 1) < argc) {
+			skeletonReplayPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-udp") == 0 && (i + 1) < argc) {
+			skeletonUdpPort = argv[++i];
+		}
+		else if (strcmp(argv[i], "-operator") == 0 && (i + 1) < argc && Gesture::parseArbitration(argv[i + 1]) >= 0) {
+			gestureArbitration = Gesture::parseArbitration(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-smooth") == 0 && (i + 1) < argc && strcmp(argv[i + 1], "off") == 0) {
+			skeletonSmoothing = false;
+			i++;
+		}
+		else if (strcmp(argv[i], "-smooth") == 0 && (i + 2) < argc && atof(argv[i + 1]) > 0.0) {
+			skeletonFilterMinCutoff = (float)atof(argv[++i]);
+			skeletonFilterBeta = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-templates") == 0 && (i + 1) < argc) {
+			gestureTemplatePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-commit") == 0 && (i + 1) < argc && atof(argv[i + 1]) > 0.0 && atof(argv[i + 1]) <= 1.0) {
+			gestureCommitConfidence = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-fsmlog") == 0 && (i + 1) < argc) {
+			fsmLogPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-chart") == 0) {
+			fsmFromChart = true;
+		}
+		else if (strcmp(argv[i], "-wallfollow") == 0) {
+			fsmWallFollow = true;
+			if ((i + 1) < argc && strcmp(argv[i + 1], "left") == 0) {
+				wallFollower.setSide(WALL_FOLLOW_LEFT);
+				i++;
+			}
+			else if ((i + 1) < argc && strcmp(argv[i + 1], "right") == 0) {
+				wallFollower.setSide(WALL_FOLLOW_RIGHT);
+				i++;
+			}
+		}
+		else {
+			printf("Usage: RobotController [-record <skeleton log file>] [-replay <skeleton log file> | -udp <port>] [-operator <longest | closest | claim>] [-templates <gesture template file>] [-commit <confidence 0-1>] [-smooth <off | minCutoff beta>] [-chart | -wallfollow [left | right]] [-fsmlog <state machine log file>]\n");
+			ExitProcess(1);
+		}
+	}
+
+	/* -chart runs the state machine generated from cps.slx (StateMachineChart.h) instead of the hand written one */
+	if (fsmFromChart) {
+		if (StateMachine::compileTransitions(fsmChartSpec, FSM_CHART_SPEC_COUNT, fsmChartTable) != 0) {
+			printf("ERROR: Generated state machine chart is invalid.\n");
+			ExitProcess(1);
+		}
+		FSM = new StateMachine(fsmChartTable, FSM_CHART_INITIAL_STATE);
+		fsmProfileTable = fsmChartTable;
+		fsmLogTable = FSM_LOG_TABLE_CHART;
+	}
+	/* -wallfollow enters WALL_FOLLOW_STATE on AUTO mode instead of the bump and turn AUTO mode states */
+	else if (fsmWallFollow) {
+		FSM = new StateMachine(StateMachine::getWallFollowTable(), STOP_STATE);
+		fsmProfileTable = StateMachine::getWallFollowTable();
+		fsmLogTable = FSM_LOG_TABLE_WALL_FOLLOW;
+	}
+	else {
+		FSM = new StateMachine();
+		fsmProfileTable = StateMachine::getDefaultTable();
+		fsmLogTable = FSM_LOG_TABLE_BUILT_IN;
+	}
+	FSM->setProfile(&fsmProfile);
+	if (fsmLogPath != NULL && fsmLog.Open(fsmLogPath, fsmProfileTable, fsmLogTable, FSM->getCurrentState()) != 0) {
+		printf("ERROR: Failed to start state machine logging. Continuing without logging.\n");
+	}
+
+	/* Ctrl+Break prints latency histograms, input queue counters and the FSM profile without stopping the controller */
+	SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+	printf("Press Ctrl+Break to print gesture latency histograms, input queue counters and the state machine profile.\n");
+
+	/* Create thread mutexes */
+	gestureShared->mutex = CreateMutex(
+		NULL,						// default security attributes
+		FALSE,						// initially not owned
+		NULL);						// unnamed mutex
+	listenerShared->mutex = CreateMutex(
+		NULL,						// default security attributes
+		FALSE,						// initially not owned
+		NULL);						// unnamed mutex
+	sensorRangesMutex = CreateMutex(
+		NULL,						// default security attributes
+		FALSE,						// initially not owned
+		NULL);						// unnamed mutex
+
+	gestureShared->event = CreateEvent(
+		NULL,						// default security attributes
+		FALSE,						// auto-reset
+		FALSE,						// initially not signaled
+		NULL);						// unnamed event
+
+	if (gestureShared->mutex == NULL)
+	{
+		printf("CreateMutex error: %d\n", GetLastError());
+		ExitProcess(2);
+	}
+	if (gestureShared->event == NULL)
+	{
+		printf("CreateEvent error: %d\n", GetLastError());
+		ExitProcess(2);
+	}
+	if (listenerShared->mutex == NULL || sensorRangesMutex == NULL)
+	{
+		printf("CreateMutex error: %d\n", GetLastError());
+		ExitProcess(2);
+	}
+
+	/* Both threads wake the main loop through the same event */
+	listenerShared->event = gestureShared->event;
+
+	/* Spawn gesture recognition thread */
+	gestureThread = CreateThread(
+		NULL,								// default security attributes
+		0,									// use default stack size  
+		gestureThreadFunction,				// thread function name
+		(LPVOID)gestureShared,				// argument to thread function 
+		0,									// use default creation flags 
+		&gestureThreadID);					// returns the thread identifier 
+
+	if (gestureThread == NULL) {
+		printf("ERROR: Failed to spawn gesture recognition thread.\n");
+		ExitProcess(3);
+	}
+
+	/* Startup WSA */
+	if ((WSAStartup(MAKEWORD(2, 2), &wsaData)) != 0) {
+		printf("ERROR: WSAStartup failed.");
+		ExitProcess(1);
+	}
+	
+	/* Open TCP Socket for command communication with Gazebo Interface. Block until handshake received. */
+	NetSocket* TCP_Socket = new NetSocket(TCP_PORT, SOCK_STREAM);
+	TCP_Socket->openSocket();
+	TCP_Socket->waitForConnection();
+	
+	/* Spawn Gazebo Listener thread */
+	listenerThread = CreateThread(
+		NULL,								// default security attributes
+		0,									// use default stack size  
+		listenThreadFunction,				// thread function name
+		(LPVOID)listenerShared,				// argument to thread function 
+		0,									// use default creation flags 
+		&listenerThreadID);					// returns the thread identifier 
+
+	if (listenerThread == NULL) {
+		printf("ERROR: Failed to spawn Gazebo listener thread.\n");
+		ExitProcess(3);
+	}
+
+	/* Main task loop. The FSM runs on monotonic time (LatencyTrace::Now) and is stepped only when input
+	 * arrives or an AUTO mode delay it waits for ends, so an idle controller sleeps. Inputs are taken from
+	 * inputQueue in the order they were pushed, each gesture command and sensor change stepping the FSM once.
+	 * A delay is stepped at its deadline rather than at the time the loop woke up, so lateness does not add up
+	 * over the ticks of a maneuver. Its command is still only sent when the loop wakes: a late wakeup ends a
+	 * reverse late, and cuts the turn it starts short, by that wakeup's lateness. */
+	TimerWheel timers(LatencyTrace::Now());
+	stepFSM(FSM, TCP_Socket, &timers, sensorMask, &turn_angle, LatencyTrace::Now(), 0, 0, 0);
+	while (1) {
+		deadline = timers.nextDeadline();
+		now = LatencyTrace::Now();
+		if (deadline == TIMER_WHEEL_NEVER) wait = INFINITE;
+		else wait = (deadline > now) ? (DWORD)((deadline - now + 999) / 1000) : 0;
+		WaitForSingleObject(gestureShared->event, wait);
+
+		while (inputQueue.Pop(&event)) {
+			/* Deadlines that passed before the input was pushed come first */
+			runTimers(FSM, TCP_Socket, &timers, event.postTime, sensorMask, &turn_angle);
+
+			if (event.source == INPUT_SOURCE_SENSOR) {
+				sensorMask = event.input;
+				stepFSM(FSM, TCP_Socket, &timers, sensorMask, &turn_angle, event.postTime, 0, 0, 0);
+				continue;
+			}
+
+			turn_angle = event.arg;
+			gesture_confidence = event.confidence;
+			traceID = event.frameID;
+			traceFrameTime = event.frameTime;
+			traceStepTime = LatencyTrace::Now();
+			if (traceID != 0) {
+				latencyTrace.Record(TRACE_STAGE_RECOGNIZE, event.postTime - traceFrameTime);
+				latencyTrace.Record(TRACE_STAGE_DISPATCH, traceStepTime - event.postTime);
+			}
+
+			/************ DEBUG *************
+			DEBUG_PrintUserCMD(event.input);
+			printf("\t confidence: %f\n", gesture_confidence);
+			*/
+
+			stepFSM(FSM, TCP_Socket, &timers, event.input | sensorMask, &turn_angle, event.postTime, traceID, traceFrameTime, traceStepTime);
+		}
+
+		runTimers(FSM, TCP_Socket, &timers, LatencyTrace::Now(), sensorMask, &turn_angle);
+	}
+
+	/* Shutdown */
+	fsmProfile.Print(stdout, fsmProfileTable);
+	fsmLog.Close();
+	shutdownThread(gestureThread, gestureShared);
+	shutdownThread(listenerThread, listenerShared);
+	CloseHandle(gestureShared->event);
+	CloseHandle(sensorRangesMutex);
+	free(gestureShared);
+	free(listenerShared);
+	WSACleanup();
+
+	return 0;
+}
+
+/* Step the FSM with one input at stepTime, arm TIMER_FSM_DEADLINE for the delay it then waits for, and send
+ * its command and argument (as applicable) to gazeboInterface. In WALL_FOLLOW_STATE the command and turn are
+ * the WallFollower's on the latest sensor ranges, sent every tick; the turn is only sent, turn_angle keeps the
+ * operator's argument for the FSM and its log. traceID is the trace of the gesture command in input, 0 when
+ * none. */
+void stepFSM(StateMachine* FSM, NetSocket* TCP_Socket, TimerWheel* timers, uint16_t input, double* turn_angle, int64_t stepTime, uint32_t traceID, int64_t traceFrameTime, int64_t traceStepTime)
+{
+	char		buf[GAZEBO_CMD_MSG_SIZE];
+	int			cmd_id, stateBefore;
+	int64_t		traceSendTime, deadline;
+	gazeboSensorData ranges;
+	double		steering;
+
+	steering = 0.0;
+	stateBefore = FSM->getCurrentState();
+	FSM->setInput(input, *turn_angle);
+	FSM->stepMachineAt(stepTime);
+	cmd_id = FSM->getOutputCmd();
+	if (FSM->getOutputActions() & FSM_ACT_OBSTACLE_MSG) printf("Obstacle Detected.\n");
+	fsmLog.Log(stepTime, input, *turn_angle, FSM_LOG_STEP_AT, stateBefore, FSM->getCurrentState(), cmd_id);
+
+	deadline = FSM->getNextDeadline();
+	if (deadline == FSM_NO_DEADLINE) timers->Cancel(TIMER_FSM_DEADLINE);
+	else timers->Schedule(TIMER_FSM_DEADLINE, deadline);
+
+	/************ DEBUG *************
+	printf("cmd: %d\tstate: %d\n", cmd_id, FSM->getCurrentState());
+	if (cmd_id != NULL_CMD) DEBUG_PrintCMD(cmd_id, *turn_angle);
+	*/
+
+	if (cmd_id == NULL_CMD) return;
+
+	if (FSM->getCurrentState() == WALL_FOLLOW_STATE) {
+		if (stateBefore != WALL_FOLLOW_STATE) wallFollower.Reset();
+		WaitForSingleObject(sensorRangesMutex, INFINITE);
+		memcpy(&ranges, &sensorRanges, sizeof(ranges));
+		ReleaseMutex(sensorRangesMutex);
+		cmd_id = wallFollower.Update(ranges, (FSM->getOutputActions() & FSM_ACT_TOO_CLOSE) != 0, &steering);
+	}
+
+	memcpy(&buf[0], &cmd_id, sizeof(cmd_id));
+	if ((FSM->getCurrentState()) == AUTO_TURN_L_STATE){
+		*turn_angle = GESTURE_MAX_TURN_L;
+	}
+	else if ((FSM->getCurrentState()) == AUTO_TURN_R_STATE){
+		*turn_angle = GESTURE_MAX_TURN_R;
+	}
+	if ((FSM->getCurrentState()) == WALL_FOLLOW_STATE) {
+		memcpy(&buf[sizeof(cmd_id)], &steering, sizeof(steering));
+	}
+	else memcpy(&buf[sizeof(cmd_id)], turn_angle, sizeof(*turn_angle));
+	memcpy(&buf[sizeof(cmd_id) + sizeof(*turn_angle)], &traceID, sizeof(traceID));
+	if (TCP_Socket->Send(buf, sizeof(buf)) == -1) {
+		printf("TCP Send error.\n");
+	}
+	else if (traceID != 0) {
+		traceSendTime = LatencyTrace::Now();
+		latencyTrace.Record(TRACE_STAGE_SEND, traceSendTime - traceStepTime);
+		latencyTrace.commandSent(traceID, traceFrameTime, traceSendTime);
+	}
+}
+
+/* Handle the timers due at now, each at its own deadline */
+void runTimers(StateMachine* FSM, NetSocket* TCP_Socket, TimerWheel* timers, int64_t now, uint16_t sensorMask, double* turn_angle)
+{
+	int64_t deadline;
+	int timer;
+
+	while ((timer = timers->Expire(now, &deadline)) >= 0) {
+		switch (timer) {
+		case TIMER_FSM_DEADLINE:
+			stepFSM(FSM, TCP_Socket, timers, sensorMask, turn_angle, deadline, 0, 0, 0);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/* Gesture recognition thread function definition */
+DWORD WINAPI gestureThreadFunction(LPVOID lpParam) 
+{
+	threadSharedItems *gestureShared;
+	inputEvent event;
+	int threadShutdown, sourceResult;
+	uint16_t userInput;
+	double arg, confidence;
+	bool turning;
+
+	gestureShared = (threadSharedItems*)lpParam;
+	threadShutdown = FALSE;
+	sourceResult = SKELETON_SOURCE_TIMEOUT;
+	turning = false;
+	memset(&event, 0x00, sizeof(event));
+	event.source = INPUT_SOURCE_GESTURE;
+
+	/* Open skeleton source and spawn Gesture class */
+	SkeletonSource* source;
+	if (skeletonReplayPath != NULL) source = new FileSkeletonSource(skeletonReplayPath, true);
+	else if (skeletonUdpPort != NULL) source = new UdpSkeletonSource(skeletonUdpPort);
+	else source = new KinectSkeletonSource();
+
+	if ((source->Open()) != 0) {
+		printf("ERROR: Failed to open skeleton source. Stopping gesture recognition thread.\n");
+		delete source;
+		return -1;
+	}
+	else if (skeletonReplayPath != NULL) printf("Replaying skeleton frames from %s.\n", skeletonReplayPath);
+	else if (skeletonUdpPort == NULL) printf("Linked with Kinect.\n");
+	Gesture* gesture = new Gesture(source);
+	gesture->setArbitration(gestureArbitration);
+	gesture->setSmoothing(skeletonSmoothing);
+	gesture->getFilter()->setParameters(skeletonFilterMinCutoff, skeletonFilterBeta, SKELETON_FILTER_D_CUTOFF);
+	if (gestureCommitConfidence != GESTURE_COMMIT_CONFIDENCE) {
+		gestureParams params = gesture->getParams();
+		params.commitConfidence = gestureCommitConfidence;
+		if (gesture->setParams(params) != 0) printf("ERROR: Invalid gesture commit confidence. Waiting for complete gestures.\n");
+	}
+	if (gestureTemplatePath != NULL && gesture->loadTemplates(gestureTemplatePath) != 0) {
+		printf("ERROR: Failed to load gesture templates. Continuing with pose rules only.\n");
+	}
+
+	if (skeletonRecordPath != NULL) {
+		if (gesture->startRecording(skeletonRecordPath) == 0)
+			printf("Recording skeleton frames to %s.\n", skeletonRecordPath);
+		else
+			printf("ERROR: Failed to start skeleton recording. Continuing without recording.\n");
+	}
+
+	/* A replay that ran out or a failed source returns at once from every wait, so stop rather than spin */
+	while ( !threadShutdown ) {
+		sourceResult = gesture->Update();
+		if (sourceResult == SKELETON_SOURCE_END) {
+			printf("Skeleton replay ended. Stopping gesture recognition thread.\n");
+			break;
+		}
+		if (sourceResult == SKELETON_SOURCE_ERROR) {
+			printf("ERROR: Skeleton source failed. Stopping gesture recognition thread.\n");
+			break;
+		}
+		latencyTrace.setFrameCounts(gesture->getFrameStats().received, gesture->getFrameStats().dropped, gesture->getFrameStats().gaps);
+		userInput = gesture->getUserInput();
+		arg = gesture->getUserArg();
+		confidence = gesture->getUserConfidence();
+
+		/* Queue each command, and STOP_TURN_CMD_MASK once when a turn ends rather than on every idle frame */
+		if ((userInput & ~(STOP_TURN_CMD_MASK)) != NULL_CMD_MASK) {
+			event.input = userInput;
+			event.arg = arg;
+			event.confidence = confidence;
+			event.frameID = gesture->getFrameID();
+			event.frameTime = gesture->getFrameTime();
+			event.postTime = LatencyTrace::Now();
+			inputQueue.Push(event);
+			turning = (userInput & (TURN_L_CMD_MASK | TURN_R_CMD_MASK)) != 0;
+			SetEvent(gestureShared->event);
+		}
+		else if ((userInput & STOP_TURN_CMD_MASK) && turning) {
+			event.input = STOP_TURN_CMD_MASK;
+			event.arg = arg;
+			event.confidence = confidence;
+			event.frameID = 0;
+			event.frameTime = 0;
+			event.postTime = LatencyTrace::Now();
+			inputQueue.Push(event);
+			turning = false;
+			SetEvent(gestureShared->event);
+		}
+
+		/* Check if thread has been told to shutdown */
+		WaitForSingleObject(gestureShared->mutex, INFINITE);
+		threadShutdown = gestureShared->threadShutdown;
+		ReleaseMutex(gestureShared->mutex);
+	}
+
+	/* Gesture closes its recording, then the source is closed by its destructor */
+	delete gesture;
+	delete source;
+	return (sourceResult == SKELETON_SOURCE_ERROR) ? -1 : 0;
+}
+
+/* Gazebo Listener thread function definition */
+DWORD WINAPI listenThreadFunction(LPVOID lpParam)
+{
+	threadSharedItems	*listenerShared;
+	gazeboSensorData	sensorData;
+
+	int			threadShutdown, data_id, buf_len, data_index;
+	uint16_t	sensorMask, queuedMask;
+	inputEvent	event;
+	double		data_value;
+	char		buf[GAZEBO_DATA_MSG_SIZE];
+
+	listenerShared = (threadSharedItems*)lpParam;
+	threadShutdown = FALSE;
+	memset(&sensorData, 0x00, sizeof(sensorData));
+	memset(&event, 0x00, sizeof(event));
+	event.source = INPUT_SOURCE_SENSOR;
+	queuedMask = 0;
+
+	/* Open UDP Socket for listening to Gazebo data messages */
+	NetSocket* UDP_Socket = new NetSocket(UDP_PORT, SOCK_DGRAM);
+	UDP_Socket->openSocket();
+	if ((UDP_Socket->waitForConnection()) == -1) {
+		printf("ERROR: Failed to open UDP socket with Gazebo. Stopping listener thread.\n");
+		return -1;
+	}
+
+	while (!threadShutdown) {
+		buf_len = sizeof(buf);
+		UDP_Socket->Recv(buf, &buf_len);
+
+		/* Verify valid message length */
+		if (buf_len == GAZEBO_DATA_MSG_SIZE) {
+			memcpy(&data_id, &buf[0], sizeof(data_id));
+			memcpy(&data_value, &buf[sizeof(data_id)], sizeof(data_value));
+
+			/* Verify valid data_id */
+			if (data_id == GAZEBO_TRACE_ACK_ID) {
+				latencyTrace.commandAcknowledged((uint32_t)data_value);
+			}
+			else if ((data_id >= GAZEBO_SENSOR_BASE) && (data_id < (GAZEBO_SENSOR_BASE + GAZEBO_SENSOR_COUNT))) {
+				data_index = data_id % GAZEBO_SENSOR_BASE;
+				sensorData.sensor_ranges[data_index] = data_value;
+
+				/* Raw ranges for wall following */
+				if (fsmWallFollow) {
+					WaitForSingleObject(sensorRangesMutex, INFINITE);
+					sensorRanges.sensor_ranges[data_index] = data_value;
+					ReleaseMutex(sensorRangesMutex);
+				}
+			}
+			else {
+				printf("ERROR: Unknown data message ID (%d) received.\n", data_id);
+			}
+		}
+		else if (buf_len == SOCKET_ERROR) printf("ERROR: UDP_Socket->Recv() failed.\n");
+		else printf("ERROR: Received unknown message from Gazebo.\n");
+
+		/* Check if any sensor has tripped (detects danger condition) */
+		sensorMask = 0;
+		if (sensorData.sensor_ranges[WALL_ID % GAZEBO_SENSOR_BASE] < WALL_SENSOR_TRIP_RANGE) 
+		{
+			sensorMask |= WALL_SENSOR_MASK;
+		}
+		if (sensorData.sensor_ranges[LEFT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ||
+			sensorData.sensor_ranges[LEFTFRONT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ) 
+		{
+			sensorMask |= LEFT_SENSOR_MASK;
+		}
+		if (sensorData.sensor_ranges[RIGHT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ||
+			sensorData.sensor_ranges[RIGHTFRONT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE)
+		{
+			sensorMask |= RIGHT_SENSOR_MASK;
+		}
+
+		/* Queue sensor changes and wake the main loop. A change dropped by a full queue is queued again with the next message. */
+		if (sensorMask != queuedMask) {
+			event.input = sensorMask;
+			event.postTime = LatencyTrace::Now();
+			if (inputQueue.Push(event) == 0) {
+				SetEvent(listenerShared->event);
+				queuedMask = sensorMask;
+			}
+		}
+
+		/* Check if thread has been told to shutdown. */
+		WaitForSingleObject(listenerShared->mutex, INFINITE);
+		threadShutdown = listenerShared->threadShutdown;
+		ReleaseMutex(listenerShared->mutex);
+	}
+
+	return 0;
+}
+
+/* Ctrl+Break prints the latency histograms, input queue counters and FSM profile and keeps running. Ctrl+C and
+ * closing the console print the FSM profile and write the rest of the FSM log, then fall through to the default
+ * handler, which exits. */
+BOOL WINAPI consoleCtrlHandler(DWORD ctrlType)
+{
+	if (ctrlType == CTRL_BREAK_EVENT) {
+		latencyTrace.Print(stdout);
+		inputQueue.Print(stdout);
+		fsmProfile.Print(stdout, fsmProfileTable);
+		return TRUE;
+	}
+	if (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_CLOSE_EVENT) {
+		fsmProfile.Print(stdout, fsmProfileTable);
+		fsmLog.Close();
+		fflush(stdout);
+	}
+	return FALSE;
+}
+
+int shutdownThread(HANDLE thread, threadSharedItems *t_items)
+{
+	int rv;
+
+	rv = WaitForSingleObject(t_items->mutex, MUTEX_WAIT_TIMEOUT_MS);
+	switch (rv) {
+	case WAIT_OBJECT_0:
+		t_items->threadShutdown = TRUE;
+		ReleaseMutex(t_items->mutex);
+		/* Wait for thread to exit gracefully */
+		rv = WaitForSingleObject(thread, THREAD_WAIT_TIMEOUT_MS);
+		switch (rv) {
+		case WAIT_OBJECT_0:
+			rv = 0;
+			break;
+		default:
+			printf("ERROR: Thread did not shutdown in time after sending shutdown command.\n");
+			TerminateThread(thread, -1);
+			rv = -1;
+			break;
+		}
+		break;
+	case WAIT_TIMEOUT:
+		printf("ERROR: Timeout when locking shared thread data mutex for thread shutdown. Terminating thread.\n");
+		TerminateThread(thread, -1);
+		rv = -1;
+		break;
+	default:
+		printf("ERROR: Unknown error locking thread mutex. Terminating thread.\n");
+		TerminateThread(thread, -1);
+		rv = -1;
+		break;
+	}
+
+	CloseHandle(t_items->mutex);
+	CloseHandle(thread);
+
+	return rv;
+}
+
+uint16_t DEBUG_GetUserInputCMDLine()
+{
+	char buf[10];
+	uint16_t input;
+
+	printf("User Input: ");
+	std::cin.getline(buf, 10);
+	input = atoi(buf);
+
+	return input;
+}
+
+void DEBUG_PrintUserCMD(uint16_t input)
+{
+	printf("User Input:\n");
+	if (input & STOP_CMD_MASK)
+		printf("\tSTOP\n");
+	if (input & FORWARD_CMD_MASK)
+		printf("\tFORWARD\n");
+	if (input & REVERSE_CMD_MASK)
+		printf("\tREVERSE\n");
+	if (input & TURN_L_CMD_MASK)
+		printf("\tTURN_L\n");
+	if (input & TURN_R_CMD_MASK)
+		printf("\tTURN_R\n");
+	if (input & AUTO_MODE_CMD_MASK)
+		printf("\tAUTO MODE\n");
+	if (input & MANUAL_MODE_CMD_MASK)
+		printf("\tMANUAL MODE\n");
+
+	printf("\n");
+}
+
+void DEBUG_PrintCMD(int cmd_id, double cmd_arg)
+{
+	printf("Sending Command:\t");
+	switch (cmd_id){
+	case STOP_CMD:
+		printf("STOP\n");
+		break;
+	case FORWARD_CMD:
+		printf("FORWARD\n");
+		break;
+	case REVERSE_CMD:
+		printf("REVERSE\n");
+		break;
+	case TURN_L_CMD:
+		printf("TURN_L\t turn_angle: %f\n", cmd_arg);
+		break;
+	case TURN_R_CMD:
+		printf("TURN_R\t turn_angle: %f\n", cmd_arg);
+		break;
+	case FORWARD_L_CMD:
+		printf("FORWARD_L\t turn_angle: %f\n", cmd_arg);
+		break;
+	case FORWARD_R_CMD:
+		printf("FORWARD_R\t turn_angle: %f\n", cmd_arg);
+		break;
+	case REVERSE_L_CMD:
+		printf("REVERSE_L\t turn_angle: %f\n", cmd_arg);
+		break;
+	case REVERSE_R_CMD:
+		printf("REVERSE_R\t turn_angle: %f\n", cmd_arg);
+		break;
+	case AUTO_MODE_CMD:
+		printf("AUTO_MODE\n");
+		break;
+	case MANUAL_MODE_CMD:
+		printf("MANUAL_MODE\n");
+		break;
+	default:
+		printf("ERROR: RobotContoller DEBUG_PrintCMD Unknown command ID.\n");
+		break;
+	}
+
+	printf("\n");
 }
\ No newline at end of file
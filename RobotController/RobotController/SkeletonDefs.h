@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Skeleton frame dimensions. Match NUI_SKELETON_COUNT and NUI_SKELETON_POSITION_COUNT from Kinect SDK v1.8 */
+#define SKELETON_COUNT				6
+#define SKELETON_POSITION_COUNT		20
+
+/* Skeleton tracking states. Match NUI_SKELETON_TRACKING_STATE */
+#define SKELETON_NOT_TRACKED		0
+#define SKELETON_POSITION_ONLY		1
+#define SKELETON_TRACKED			2
+
+/* Skeleton joint indices. Match NUI_SKELETON_POSITION_INDEX */
+#define SKELETON_POSITION_HIP_CENTER		0
+#define SKELETON_POSITION_SPINE				1
+#define SKELETON_POSITION_SHOULDER_CENTER	2
+#define SKELETON_POSITION_HEAD				3
+#define SKELETON_POSITION_SHOULDER_LEFT		4
+#define SKELETON_POSITION_ELBOW_LEFT		5
+#define SKELETON_POSITION_WRIST_LEFT		6
+#define SKELETON_POSITION_HAND_LEFT			7
+#define SKELETON_POSITION_SHOULDER_RIGHT	8
+#define SKELETON_POSITION_ELBOW_RIGHT		9
+#define SKELETON_POSITION_WRIST_RIGHT		10
+#define SKELETON_POSITION_HAND_RIGHT		11
+#define SKELETON_POSITION_HIP_LEFT			12
+#define SKELETON_POSITION_KNEE_LEFT			13
+#define SKELETON_POSITION_ANKLE_LEFT		14
+#define SKELETON_POSITION_FOOT_LEFT			15
+#define SKELETON_POSITION_HIP_RIGHT			16
+#define SKELETON_POSITION_KNEE_RIGHT		17
+#define SKELETON_POSITION_ANKLE_RIGHT		18
+#define SKELETON_POSITION_FOOT_RIGHT		19
+
+/* Joint position in Kinect skeleton space (meters). The SDK's w component is always 1.0 and is not stored. */
+typedef struct {
+	float	x, y, z;
+}skeletonJoint;
+
+typedef struct {
+	uint32_t		trackingState;
+	uint32_t		trackingID;
+	skeletonJoint	position;
+	skeletonJoint	joints[SKELETON_POSITION_COUNT];
+}skeletonData;
+
+/* One sensor frame. Plain fixed-size struct so it can be written to and mapped from skeleton logs directly. */
+typedef struct {
+	int64_t			timestamp;		// sensor timestamp in ms
+	uint32_t		frameNumber;
+	uint32_t		flags;
+	skeletonData	skeletons[SKELETON_COUNT];
+}skeletonFrame;
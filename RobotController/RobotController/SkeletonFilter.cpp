@@ -0,0 +1,145 @@
+/*****************************************************
+*	SkeletonFilter.cpp
+*
+*	One Euro joint smoothing, all joints of a skeleton
+*	in one SIMD pass.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "SkeletonFilter.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SKELETON_FILTER_SSE2
+#endif
+
+#define SKELETON_FILTER_TWO_PI	6.2831853f
+
+/* Joints are stored as packed x y z floats, so a skeleton's joints form one contiguous array */
+typedef char skeletonFilterPackedCheck[(sizeof(skeletonJoint) == 3 * sizeof(float)) ? 1 : -1];
+
+/* SIMD kernel must be compiled as native code when building with /clr */
+#ifdef _MANAGED
+#pragma managed(push, off)
+#endif
+
+/*****************************************************
+*	One step of the filter over n values. aSpeed is the
+*	smoothing factor of the speed estimate, k = 2 pi dt
+*	so the value's smoothing factor for cutoff fc is
+*	k fc / (k fc + 1).
+*****************************************************/
+static void oneEuroStep(float* x, float* value, float* speed, int n, float invDt, float aSpeed, float k, float minCutoff, float beta)
+{
+	int i = 0;
+
+#if defined(SKELETON_FILTER_SSE2)
+	const __m128 vInvDt = _mm_set1_ps(invDt);
+	const __m128 vASpeed = _mm_set1_ps(aSpeed);
+	const __m128 vK = _mm_set1_ps(k);
+	const __m128 vMin = _mm_set1_ps(minCutoff);
+	const __m128 vBeta = _mm_set1_ps(beta);
+	const __m128 vOne = _mm_set1_ps(1.0f);
+	const __m128 vAbs = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	for (; i + 4 <= n; i += 4) {
+		__m128 prev = _mm_loadu_ps(&value[i]);
+		__m128 delta = _mm_sub_ps(_mm_loadu_ps(&x[i]), prev);
+		__m128 s = _mm_loadu_ps(&speed[i]);
+		s = _mm_add_ps(s, _mm_mul_ps(vASpeed, _mm_sub_ps(_mm_mul_ps(delta, vInvDt), s)));
+		__m128 kc = _mm_mul_ps(vK, _mm_add_ps(vMin, _mm_mul_ps(vBeta, _mm_and_ps(s, vAbs))));
+		__m128 out = _mm_add_ps(prev, _mm_mul_ps(_mm_div_ps(kc, _mm_add_ps(kc, vOne)), delta));
+		_mm_storeu_ps(&speed[i], s);
+		_mm_storeu_ps(&value[i], out);
+		_mm_storeu_ps(&x[i], out);
+	}
+#endif
+
+	for (; i < n; i++) {
+		float delta = x[i] - value[i];
+		float kc;
+
+		speed[i] += aSpeed * (delta * invDt - speed[i]);
+		kc = k * (minCutoff + beta * fabsf(speed[i]));
+		value[i] += kc / (kc + 1.0f) * delta;
+		x[i] = value[i];
+	}
+}
+
+#ifdef _MANAGED
+#pragma managed(pop)
+#endif
+
+SkeletonFilter::SkeletonFilter() :
+	minCutoff(SKELETON_FILTER_MIN_CUTOFF),
+	beta(SKELETON_FILTER_BETA),
+	dCutoff(SKELETON_FILTER_D_CUTOFF)
+{
+	Reset();
+}
+
+void SkeletonFilter::setParameters(float minCutoff, float beta, float dCutoff)
+{
+	this->minCutoff = minCutoff;
+	this->beta = beta;
+	this->dCutoff = dCutoff;
+}
+
+float SkeletonFilter::getMinCutoff()
+{
+	return minCutoff;
+}
+
+float SkeletonFilter::getBeta()
+{
+	return beta;
+}
+
+float SkeletonFilter::getDCutoff()
+{
+	return dCutoff;
+}
+
+void SkeletonFilter::Reset()
+{
+	memset(state, 0x00, sizeof(state));
+}
+
+void SkeletonFilter::Apply(const skeletonFrame & in, skeletonFrame* out)
+{
+	skeletonFilterState* s;
+	int64_t dtMs;
+	float dt, k;
+	int i;
+
+	if (out != &in) memcpy(out, &in, sizeof(skeletonFrame));
+
+	for (i = 0; i < SKELETON_COUNT; i++) {
+		skeletonData& skeleton = out->skeletons[i];
+		float* joints = &skeleton.joints[0].x;
+		s = &state[i];
+
+		if (skeleton.trackingState != SKELETON_TRACKED) {
+			s->trackingID = 0;
+			continue;
+		}
+
+		/* New person in this slot, a gap, or time running backwards (log replayed again): start from the raw joints */
+		dtMs = in.timestamp - s->timestamp;
+		if (s->trackingID != skeleton.trackingID || dtMs < 0 || dtMs > SKELETON_FILTER_MAX_DT_MS) {
+			s->trackingID = skeleton.trackingID;
+			s->timestamp = in.timestamp;
+			memcpy(s->value, joints, sizeof(s->value));
+			memset(s->speed, 0x00, sizeof(s->speed));
+			continue;
+		}
+
+		if (dtMs == 0) dtMs = SKELETON_FILTER_DEFAULT_DT_MS;
+		s->timestamp = in.timestamp;
+		dt = (float)dtMs * 0.001f;
+		k = SKELETON_FILTER_TWO_PI * dt;
+
+		oneEuroStep(joints, s->value, s->speed, SKELETON_FILTER_VALUES, 1.0f / dt, k * dCutoff / (k * dCutoff + 1.0f), k, minCutoff, beta);
+	}
+}
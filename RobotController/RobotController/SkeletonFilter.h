@@ -0,0 +1,63 @@
+/*****************************************************
+*	SkeletonFilter.h
+*
+*	Joint smoothing for portable skeleton frames. Each
+*	joint coordinate runs through a One Euro filter: a
+*	first order low-pass whose cutoff rises with the
+*	joint's speed, so a hand held still is steadied
+*	while a moving hand follows with little lag.
+*
+*		cutoff = minCutoff + beta * |filtered speed|
+*
+*	Lower minCutoff removes more jitter at rest, higher
+*	beta removes more lag in motion. Replaces the Kinect
+*	SDK's NuiTransformSmooth so the same smoothing (and
+*	its lag) applies to every SkeletonSource.
+*****************************************************/
+
+#pragma once
+
+#include "SkeletonDefs.h"
+
+/* Defaults, tuned with SkeletonFilterBench (Tools) for 30 fps Kinect v1 skeletons */
+#define SKELETON_FILTER_MIN_CUTOFF		0.5f	// Hz
+#define SKELETON_FILTER_BETA			8.0f	// Hz per m/s
+#define SKELETON_FILTER_D_CUTOFF		1.0f	// Hz, smoothing of the speed estimate
+
+#define SKELETON_FILTER_DEFAULT_DT_MS	33		// used when frame timestamps do not advance
+#define SKELETON_FILTER_MAX_DT_MS		500		// longer gaps restart the filter
+
+/* Joint coordinates filtered per skeleton, x y z of every joint */
+#define SKELETON_FILTER_VALUES			(SKELETON_POSITION_COUNT * 3)
+
+typedef struct {
+	uint32_t	trackingID;		// 0 when the slot holds no filter state
+	int64_t		timestamp;		// ms, of the last filtered frame
+	float		value[SKELETON_FILTER_VALUES];
+	float		speed[SKELETON_FILTER_VALUES];
+}skeletonFilterState;
+
+class SkeletonFilter
+{
+public:
+	/* Public Functions */
+	SkeletonFilter();
+
+	void setParameters(float minCutoff, float beta, float dCutoff);
+	float getMinCutoff();
+	float getBeta();
+	float getDCutoff();
+
+	/// <summary>
+	/// Smooth the joints of every tracked skeleton in frame into out. in and out may be the
+	/// same frame. Filter state follows each skeleton's tracking ID.
+	/// </summary>
+	void Apply(const skeletonFrame & in, skeletonFrame* out);
+	void Reset();
+
+private:
+	float					minCutoff;
+	float					beta;
+	float					dCutoff;
+	skeletonFilterState		state[SKELETON_COUNT];
+};
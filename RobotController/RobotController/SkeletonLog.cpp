@@ -0,0 +1,209 @@
+/*****************************************************
+*	SkeletonLog.cpp
+*
+*	Binary recording and memory-mapped playback of
+*	skeleton frames.
+*****************************************************/
+
+#include "SkeletonLog.h"
+#include "MappedLog.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+SkeletonLogWriter::SkeletonLogWriter() :
+	fp(NULL)
+{
+}
+
+SkeletonLogWriter::~SkeletonLogWriter()
+{
+	Close();
+}
+
+int SkeletonLogWriter::Open(const char* path)
+{
+	skeletonLogHeader header;
+
+	Close();
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) {
+		printf("ERROR: SkeletonLogWriter::Open could not create %s.\n", path);
+		return -1;
+	}
+
+	memset(&header, 0x00, sizeof(header));
+	header.magic = SKELETON_LOG_MAGIC;
+	header.version = SKELETON_LOG_VERSION;
+	header.headerSize = sizeof(skeletonLogHeader);
+	header.frameSize = sizeof(skeletonFrame);
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+		printf("ERROR: SkeletonLogWriter::Open failed to write header.\n");
+		Close();
+		return -1;
+	}
+
+	return 0;
+}
+
+int SkeletonLogWriter::WriteFrame(const skeletonFrame& frame)
+{
+	if (fp == NULL) return -1;
+
+	if (fwrite(&frame, sizeof(frame), 1, fp) != 1) {
+		printf("ERROR: SkeletonLogWriter::WriteFrame write failed. Recording stopped.\n");
+		Close();
+		return -1;
+	}
+
+	return 0;
+}
+
+void SkeletonLogWriter::Close()
+{
+	if (fp != NULL) {
+		fclose(fp);
+		fp = NULL;
+	}
+}
+
+bool SkeletonLogWriter::isOpen()
+{
+	return (fp != NULL);
+}
+
+SkeletonLogReader::SkeletonLogReader() :
+	base(NULL),
+	mapSize(0),
+	frameCount(0)
+#ifdef _WIN32
+	, hFile(INVALID_HANDLE_VALUE)
+	, hMapping(NULL)
+#else
+	, fd(-1)
+#endif
+{
+}
+
+SkeletonLogReader::~SkeletonLogReader()
+{
+	Close();
+}
+
+int SkeletonLogReader::Open(const char* path)
+{
+	const skeletonLogHeader* header;
+	int64_t count;
+
+	Close();
+
+#ifdef _WIN32
+	LARGE_INTEGER size;
+
+	hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		printf("ERROR: SkeletonLogReader::Open could not open %s.\n", path);
+		return -1;
+	}
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart < (LONGLONG)sizeof(skeletonLogHeader)) {
+		printf("ERROR: SkeletonLogReader::Open %s is not a skeleton log.\n", path);
+		Close();
+		return -1;
+	}
+	mapSize = (uint64_t)size.QuadPart;
+
+	hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (hMapping == NULL) {
+		printf("ERROR: SkeletonLogReader::Open CreateFileMapping error: %d\n", GetLastError());
+		Close();
+		return -1;
+	}
+	base = (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (base == NULL) {
+		printf("ERROR: SkeletonLogReader::Open MapViewOfFile error: %d\n", GetLastError());
+		Close();
+		return -1;
+	}
+#else
+	struct stat st;
+	void* map;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		printf("ERROR: SkeletonLogReader::Open could not open %s.\n", path);
+		return -1;
+	}
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(skeletonLogHeader)) {
+		printf("ERROR: SkeletonLogReader::Open %s is not a skeleton log.\n", path);
+		Close();
+		return -1;
+	}
+	mapSize = (uint64_t)st.st_size;
+
+	map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		printf("ERROR: SkeletonLogReader::Open mmap failed.\n");
+		mapSize = 0;
+		Close();
+		return -1;
+	}
+	/* Replay reads front to back. Let the kernel read ahead aggressively. */
+	madvise(map, mapSize, MADV_SEQUENTIAL);
+	base = (const char*)map;
+#endif
+
+	header = (const skeletonLogHeader*)base;
+	if (header->magic != SKELETON_LOG_MAGIC || header->version != SKELETON_LOG_VERSION ||
+		header->frameSize != sizeof(skeletonFrame) || header->headerSize < sizeof(skeletonLogHeader)) {
+		printf("ERROR: SkeletonLogReader::Open %s has an unsupported format.\n", path);
+		Close();
+		return -1;
+	}
+
+	count = mappedLogRecordCount(mapSize, header->headerSize, sizeof(skeletonFrame));
+	if (count < 0) {
+		printf("ERROR: SkeletonLogReader::Open %s is truncated or corrupt.\n", path);
+		Close();
+		return -1;
+	}
+	frameCount = (uint64_t)count;
+	return 0;
+}
+
+void SkeletonLogReader::Close()
+{
+#ifdef _WIN32
+	if (base != NULL) UnmapViewOfFile(base);
+	if (hMapping != NULL) CloseHandle(hMapping);
+	if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+	hMapping = NULL;
+	hFile = INVALID_HANDLE_VALUE;
+#else
+	if (base != NULL) munmap((void*)base, mapSize);
+	if (fd != -1) close(fd);
+	fd = -1;
+#endif
+	base = NULL;
+	mapSize = 0;
+	frameCount = 0;
+}
+
+uint64_t SkeletonLogReader::getFrameCount()
+{
+	return frameCount;
+}
+
+const skeletonFrame* SkeletonLogReader::getFrame(uint64_t index)
+{
+	if (index >= frameCount) return NULL;
+
+	return (const skeletonFrame*)(base + ((const skeletonLogHeader*)base)->headerSize + index * sizeof(skeletonFrame));
+}
@@ -0,0 +1,77 @@
+/*****************************************************
+*	SkeletonLog.h
+*
+*	Binary recording and memory-mapped playback of
+*	skeleton frames.
+*
+*	File layout: one skeletonLogHeader followed by
+*	fixed-size skeletonFrame records. Frame count is
+*	derived from file size so a log cut short by a
+*	crash is still readable up to the last full frame.
+*****************************************************/
+
+#pragma once
+
+#include "SkeletonDefs.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define SKELETON_LOG_MAGIC		0x474C4B53		// "SKLG"
+#define SKELETON_LOG_VERSION	1
+
+typedef struct {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	headerSize;
+	uint32_t	frameSize;
+	uint32_t	reserved;
+}skeletonLogHeader;
+
+class SkeletonLogWriter
+{
+public:
+	/* Public Functions */
+	SkeletonLogWriter();
+	~SkeletonLogWriter();
+
+	int Open(const char* path);
+	int WriteFrame(const skeletonFrame& frame);
+	void Close();
+	bool isOpen();
+
+private:
+	/* Private Variables */
+	FILE*		fp;
+};
+
+class SkeletonLogReader
+{
+public:
+	/* Public Functions */
+	SkeletonLogReader();
+	~SkeletonLogReader();
+
+	int Open(const char* path);
+	void Close();
+	uint64_t getFrameCount();
+
+	/* Returns pointer into the mapped file. Valid until Close(). */
+	const skeletonFrame* getFrame(uint64_t index);
+
+private:
+	/* Private Variables */
+	const char*		base;
+	uint64_t		mapSize;
+	uint64_t		frameCount;
+
+#ifdef _WIN32
+	HANDLE			hFile;
+	HANDLE			hMapping;
+#else
+	int				fd;
+#endif
+};
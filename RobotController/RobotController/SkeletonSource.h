@@ -0,0 +1,37 @@
+/*****************************************************
+*	SkeletonSource.h
+*
+*	Interface for anything that produces skeleton
+*	frames for the Gesture recognizer (Kinect sensor,
+*	recorded skeleton log, UDP stream).
+*****************************************************/
+
+#pragma once
+
+#include "SkeletonDefs.h"
+
+/* GetNextFrame() return values */
+#define SKELETON_SOURCE_FRAME		1
+#define SKELETON_SOURCE_TIMEOUT		0
+#define SKELETON_SOURCE_ERROR		-1
+#define SKELETON_SOURCE_END			-2
+
+class SkeletonSource
+{
+public:
+	virtual ~SkeletonSource() {}
+
+	/// <summary>
+	/// Open the source
+	/// </summary>
+	/// <returns>0 on success, -1 on failure</returns>
+	virtual int Open() = 0;
+
+	/// <summary>
+	/// Wait up to timeout_ms for the next frame and copy it into frame
+	/// </summary>
+	/// <returns>One of the SKELETON_SOURCE_* values</returns>
+	virtual int GetNextFrame(skeletonFrame* frame, int timeout_ms) = 0;
+
+	virtual void Close() = 0;
+};
@@ -1,317 +1,518 @@
-/*********************************************************************************
-*	StateMachine.cpp
-*
-*	Basic Finite State Machine class for implementing Robot Controller logic.
-*
-*	Author: Charles Hartsell
-*
-*	Date:	4-7-17
-*********************************************************************************/
-
-#include "StateMachine.h"
-
-StateMachine::StateMachine()
-{
-	/* Initial FSM State */
-	currentState = STOP_STATE;
-	machineMode = MANUAL_MODE;
-	outputCmd = NULL_CMD;
-	outputArg = 0.0;
-	tickCount = 0;
-}
-
-int StateMachine::getCurrentState()
-{
-	return currentState;
-}
-
-void StateMachine::setInput(uint16_t input, double arg)
-{
-	externalInput = input;
-	inputArg = arg;
-}
-
-int StateMachine::getOutputCmd()
-{
-	int temp;
-
-	temp = outputCmd;
-	outputCmd = NULL_CMD;
-
-	return temp;
-}
-
-double StateMachine::getOutputArg()
-{
-	double temp;
-
-	temp = outputArg;
-	outputArg = 0.0;
-
-	return temp;
-}
-
-int StateMachine::stepMachine()
-{
-	/*	State machine behavior defined in MATLAB Simulink file.
-	 *	Currently located at $ROBOT_PROJECT_HOME/cps.slx
-	 *	For Manual mode of operation, the mid-level hierarchy is evaluated before the bottom-level.
-	 *	This is a very tedious and ugly way to implement an FSM.
-	 */
-
-	tickCount++;
-	outputCmd = NULL_CMD;
-	outputArg = inputArg;
-
-	switch (machineMode) {
-	/* Manual Mode */
-	case MANUAL_MODE:
-		if (externalInput & AUTO_MODE_CMD_MASK) {
-			machineMode = AUTO_MODE;
-			currentState = AUTO_FORWARD_STATE;
-			outputCmd = FORWARD_CMD;
-			break;
-		}
-		else {
-			/* Mid-level of Hierarchy */
-			if (externalInput & (WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)) {
-				printf("Obstacle Detected.\n");
-				currentState = AVOID_OBSTACLE_STATE;
-				outputCmd = REVERSE_CMD;
-				break;
-			}
-			switch (currentState) {
-			case STOP_STATE:
-			case STOP_L_STATE:
-			case STOP_R_STATE:
-				if (externalInput & FORWARD_CMD_MASK) {
-					currentState = FORWARD_STATE;
-					outputCmd = FORWARD_CMD;
-				}
-				else if (externalInput & REVERSE_CMD_MASK) {
-					currentState = REVERSE_STATE;
-					outputCmd = REVERSE_CMD;
-				}
-				break;
-			case FORWARD_STATE:
-			case FORWARD_L_STATE:
-			case FORWARD_R_STATE:
-				if (externalInput & STOP_CMD_MASK) {
-					currentState = STOP_STATE;
-					outputCmd = STOP_CMD;
-				}
-				else if (externalInput & REVERSE_CMD_MASK) {
-					currentState = REVERSE_STATE;
-					outputCmd = REVERSE_CMD;
-				}
-				break;
-			case REVERSE_STATE:
-			case REVERSE_L_STATE:
-			case REVERSE_R_STATE:
-				if (externalInput & STOP_CMD_MASK) {
-					currentState = STOP_STATE;
-					outputCmd = STOP_CMD;
-				}
-				else if (externalInput & FORWARD_CMD_MASK) {
-					currentState = FORWARD_STATE;
-					outputCmd = FORWARD_CMD;
-				}
-				break;
-			case AVOID_OBSTACLE_STATE:
-				if ( !(externalInput & (WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)) ) {
-					currentState = STOP_STATE;
-					outputCmd = STOP_CMD;
-				}
-				else outputCmd = REVERSE_CMD;
-				break;
-			default:
-				printf("ERROR: Unknown FSM State %d. Manual Mid-Level.\n", currentState);
-				return -1;
-			}
-
-			/* If Mid-level hierarchy caused state transition, do not evaluate bottom level */
-			if (outputCmd != NULL_CMD) break;
-
-			/* Bottom level of Hierarchy */
-			switch (currentState) {
-			case STOP_STATE:
-				if (externalInput & TURN_L_CMD_MASK) {
-					currentState = STOP_L_STATE;
-					outputCmd = TURN_L_CMD;
-				}
-				else if (externalInput & TURN_R_CMD_MASK) {
-					currentState = STOP_R_STATE;
-					outputCmd = TURN_R_CMD;
-				}
-				else outputCmd = STOP_CMD;
-				break;
-			case STOP_L_STATE:
-				if (externalInput & (STOP_CMD_MASK | STOP_TURN_CMD_MASK)) {
-					currentState = STOP_STATE;
-					outputCmd = STOP_CMD;
-				}
-				else if (externalInput & TURN_R_CMD_MASK) {
-					currentState = STOP_R_STATE;
-					outputCmd = TURN_R_CMD;
-				}
-				else outputCmd = TURN_L_CMD;
-				break;
-			case STOP_R_STATE:
-				if (externalInput & (STOP_CMD_MASK | STOP_TURN_CMD_MASK)) {
-					currentState = STOP_STATE;
-					outputCmd = STOP_CMD;
-				}
-				else if (externalInput & TURN_L_CMD_MASK) {
-					currentState = STOP_L_STATE;
-					outputCmd = TURN_L_CMD;
-				}
-				else outputCmd = TURN_R_CMD;
-				break;
-			case FORWARD_STATE:
-				if (externalInput & TURN_L_CMD_MASK) {
-					currentState = FORWARD_L_STATE;
-					outputCmd = FORWARD_L_CMD;
-				}
-				else if (externalInput & TURN_R_CMD_MASK) {
-					currentState = FORWARD_R_STATE;
-					outputCmd = FORWARD_R_CMD;
-				}
-				else outputCmd = FORWARD_CMD;
-				break;
-			case FORWARD_L_STATE:
-				if (externalInput & (FORWARD_CMD_MASK | STOP_TURN_CMD_MASK)) {
-					currentState = FORWARD_STATE;
-					outputCmd = FORWARD_CMD;
-				}
-				else if (externalInput & TURN_R_CMD_MASK) {
-					currentState = FORWARD_R_STATE;
-					outputCmd = FORWARD_R_CMD;
-				}
-				else outputCmd = FORWARD_L_CMD;
-				break;
-			case FORWARD_R_STATE:
-				if (externalInput & (FORWARD_CMD_MASK | STOP_TURN_CMD_MASK)) {
-					currentState = FORWARD_STATE;
-					outputCmd = FORWARD_CMD;
-				}
-				else if (externalInput & TURN_L_CMD_MASK) {
-					currentState = FORWARD_L_STATE;
-					outputCmd = FORWARD_L_CMD;
-				}
-				else outputCmd = FORWARD_R_CMD;
-				break;
-			case REVERSE_STATE:
-				if (externalInput & TURN_L_CMD_MASK) {
-					currentState = REVERSE_L_STATE;
-					outputCmd = REVERSE_L_CMD;
-				}
-				else if (externalInput & TURN_R_CMD_MASK) {
-					currentState = REVERSE_R_STATE;
-					outputCmd = REVERSE_R_CMD;
-				}
-				else outputCmd = REVERSE_CMD;
-				break;
-			case REVERSE_L_STATE:
-				if (externalInput & (REVERSE_CMD_MASK | STOP_TURN_CMD_MASK)) {
-					currentState = REVERSE_STATE;
-					outputCmd = REVERSE_CMD;
-				}
-				else if (externalInput & TURN_R_CMD_MASK) {
-					currentState = REVERSE_R_STATE;
-					outputCmd = REVERSE_R_CMD;
-				}
-				else outputCmd = REVERSE_L_CMD;
-				break;
-			case REVERSE_R_STATE:
-				if (externalInput & (REVERSE_CMD_MASK | STOP_TURN_CMD_MASK)) {
-					currentState = REVERSE_STATE;
-					outputCmd = REVERSE_CMD;
-				}
-				else if (externalInput & TURN_L_CMD_MASK) {
-					currentState = REVERSE_L_STATE;
-					outputCmd = REVERSE_L_CMD;
-				}
-				else outputCmd = REVERSE_R_CMD;
-				break;
-			default:
-				printf("ERROR: Unknown FSM State %d. Manual Bottom-Level.\n", currentState);
-				return -1;
-			}
-		}
-		break;
-
-	/* Autonomous Mode */
-	case AUTO_MODE:
-		if (externalInput & MANUAL_MODE_CMD_MASK) {
-			machineMode = MANUAL_MODE;
-			currentState = STOP_STATE;
-			outputCmd = STOP_CMD;
-			break;
-		}
-		else {
-			switch (currentState) {
-			case AUTO_FORWARD_STATE:
-				if (externalInput & (WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)) {
-					if (externalInput & LEFT_SENSOR_MASK) left_sensor_tripped = true;
-					currentState = AUTO_REVERSE_STATE;
-					outputCmd = REVERSE_CMD;
-					tickCount = 0;
-				}
-				else outputCmd = FORWARD_CMD;
-				break;
-			case AUTO_REVERSE_STATE:
-				if (tickCount >= AUTO_AVOIDANCE_REVERSE_DELAY_TICKS ) {
-					if (left_sensor_tripped) {
-						currentState = AUTO_TURN_R_STATE;
-						outputCmd = TURN_R_CMD;
-						left_sensor_tripped = false;
-					}
-					else
-					{
-						currentState = AUTO_TURN_L_STATE;
-						outputCmd = TURN_L_CMD;
-					}
-					tickCount = 0;
-				}
-				else outputCmd = REVERSE_CMD;
-				break;
-			case AUTO_TURN_L_STATE:
-				if (tickCount >= AUTO_AVOIDANCE_TURN_DELAY_TICKS) {
-					if (externalInput & (WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)) {
-						currentState = AUTO_REVERSE_STATE;
-						outputCmd = REVERSE_CMD;
-					}
-					else {
-						currentState = AUTO_FORWARD_STATE;
-						outputCmd = FORWARD_CMD;
-					}
-				}
-				else outputCmd = TURN_L_CMD;
-				break;
-			case AUTO_TURN_R_STATE:
-				if (tickCount >= AUTO_AVOIDANCE_TURN_DELAY_TICKS) {
-					if (externalInput & (WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)) {
-						currentState = AUTO_REVERSE_STATE;
-						outputCmd = REVERSE_CMD;
-					}
-					else {
-						currentState = AUTO_FORWARD_STATE;
-						outputCmd = FORWARD_CMD;
-					}
-				}
-				else outputCmd = TURN_R_CMD;
-				break;
-			default:
-				printf("ERROR: Unknown FSM State %d. Auto mode.\n", currentState);
-				return -1;
-			}
-		}
-		break;
-	default:
-		printf("ERROR: Unknown FSM machineMode (AUTO or MANUAL supported).\n");
-		return -1;
-	}
-
-	externalInput = 0;
-	return 0;
-}
\ No newline at end of file
+/*********************************************************************************
+*	StateMachine.cpp
+*
+*	Basic Finite State Machine class for implementing Robot Controller logic.
+*
+*	State machine behavior defined in MATLAB Simulink file.
+*	Currently located at $ROBOT_PROJECT_HOME/cps.slx
+*
+*	Author: Charles Hartsell
+*
+*	Date:	4-7-17
+*********************************************************************************/
+
+#include "StateMachine.h"
+#include "StateMachineProfile.h"
+
+#define FSM_MANUAL_STATES	(FSM_STATE_BIT(STOP_STATE) | FSM_STATE_BIT(STOP_L_STATE) | FSM_STATE_BIT(STOP_R_STATE) | \
+							 FSM_STATE_BIT(FORWARD_STATE) | FSM_STATE_BIT(FORWARD_L_STATE) | FSM_STATE_BIT(FORWARD_R_STATE) | \
+							 FSM_STATE_BIT(REVERSE_STATE) | FSM_STATE_BIT(REVERSE_L_STATE) | FSM_STATE_BIT(REVERSE_R_STATE) | \
+							 FSM_STATE_BIT(AVOID_OBSTACLE_STATE))
+#define FSM_STOP_STATES		(FSM_STATE_BIT(STOP_STATE) | FSM_STATE_BIT(STOP_L_STATE) | FSM_STATE_BIT(STOP_R_STATE))
+#define FSM_FORWARD_STATES	(FSM_STATE_BIT(FORWARD_STATE) | FSM_STATE_BIT(FORWARD_L_STATE) | FSM_STATE_BIT(FORWARD_R_STATE))
+#define FSM_REVERSE_STATES	(FSM_STATE_BIT(REVERSE_STATE) | FSM_STATE_BIT(REVERSE_L_STATE) | FSM_STATE_BIT(REVERSE_R_STATE))
+#define FSM_AUTO_STATES		(FSM_STATE_BIT(AUTO_FORWARD_STATE) | FSM_STATE_BIT(AUTO_REVERSE_STATE) | \
+							 FSM_STATE_BIT(AUTO_TURN_L_STATE) | FSM_STATE_BIT(AUTO_TURN_R_STATE))
+#define FSM_AUTONOMOUS_STATES	(FSM_AUTO_STATES | FSM_STATE_BIT(WALL_FOLLOW_STATE))	// states running in AUTO_MODE
+#define FSM_AUTO_TURN_STATES	(FSM_STATE_BIT(AUTO_TURN_L_STATE) | FSM_STATE_BIT(AUTO_TURN_R_STATE))
+#define FSM_AUTO_MOVING_STATES	(FSM_STATE_BIT(AUTO_FORWARD_STATE) | FSM_AUTO_TURN_STATES)
+
+#define FSM_SENSOR_MASK		(WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)
+
+/*****************************************************
+*	Transition specification, one list of rows per
+*	composite state of the hierarchy (fsmHierarchy
+*	below). For each state the first row whose
+*	conditions hold fires, trying the rows of the
+*	enclosing composites first, so a mode level
+*	transition takes priority over the mid-level and a
+*	mid-level one over the bottom level.
+*	Columns: states (0 for all states of the
+*	composite), all, any, none, next, output, actions.
+*****************************************************/
+
+/* Manual mode */
+static const fsmTransition fsmManualSpec[] = {
+	{ 0, 0, AUTO_MODE_CMD_MASK, 0, AUTO_FORWARD_STATE, FORWARD_CMD, 0 },
+	{ 0, 0, FSM_COND_OBSTACLE, 0, AVOID_OBSTACLE_STATE, REVERSE_CMD, FSM_ACT_OBSTACLE_MSG },
+};
+
+static const fsmTransition fsmStopSpec[] = {
+	{ 0, 0, FORWARD_CMD_MASK, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	{ 0, 0, REVERSE_CMD_MASK, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_STATE), 0, TURN_L_CMD_MASK, 0, STOP_L_STATE, TURN_L_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_STATE), 0, TURN_R_CMD_MASK, 0, STOP_R_STATE, TURN_R_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_STATE), 0, 0, 0, FSM_SAME_STATE, STOP_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_L_STATE), 0, STOP_CMD_MASK | STOP_TURN_CMD_MASK, 0, STOP_STATE, STOP_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_L_STATE), 0, TURN_R_CMD_MASK, 0, STOP_R_STATE, TURN_R_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_L_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_L_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_R_STATE), 0, STOP_CMD_MASK | STOP_TURN_CMD_MASK, 0, STOP_STATE, STOP_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_R_STATE), 0, TURN_L_CMD_MASK, 0, STOP_L_STATE, TURN_L_CMD, 0 },
+	{ FSM_STATE_BIT(STOP_R_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_R_CMD, 0 },
+};
+
+static const fsmTransition fsmForwardSpec[] = {
+	{ 0, 0, STOP_CMD_MASK, 0, STOP_STATE, STOP_CMD, 0 },
+	{ 0, 0, REVERSE_CMD_MASK, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_STATE), 0, TURN_L_CMD_MASK, 0, FORWARD_L_STATE, FORWARD_L_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_STATE), 0, TURN_R_CMD_MASK, 0, FORWARD_R_STATE, FORWARD_R_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_STATE), 0, 0, 0, FSM_SAME_STATE, FORWARD_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_L_STATE), 0, FORWARD_CMD_MASK | STOP_TURN_CMD_MASK, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_L_STATE), 0, TURN_R_CMD_MASK, 0, FORWARD_R_STATE, FORWARD_R_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_L_STATE), 0, 0, 0, FSM_SAME_STATE, FORWARD_L_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_R_STATE), 0, FORWARD_CMD_MASK | STOP_TURN_CMD_MASK, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_R_STATE), 0, TURN_L_CMD_MASK, 0, FORWARD_L_STATE, FORWARD_L_CMD, 0 },
+	{ FSM_STATE_BIT(FORWARD_R_STATE), 0, 0, 0, FSM_SAME_STATE, FORWARD_R_CMD, 0 },
+};
+
+static const fsmTransition fsmReverseSpec[] = {
+	{ 0, 0, STOP_CMD_MASK, 0, STOP_STATE, STOP_CMD, 0 },
+	{ 0, 0, FORWARD_CMD_MASK, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_STATE), 0, TURN_L_CMD_MASK, 0, REVERSE_L_STATE, REVERSE_L_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_STATE), 0, TURN_R_CMD_MASK, 0, REVERSE_R_STATE, REVERSE_R_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_L_STATE), 0, REVERSE_CMD_MASK | STOP_TURN_CMD_MASK, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_L_STATE), 0, TURN_R_CMD_MASK, 0, REVERSE_R_STATE, REVERSE_R_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_L_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_L_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_R_STATE), 0, REVERSE_CMD_MASK | STOP_TURN_CMD_MASK, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_R_STATE), 0, TURN_L_CMD_MASK, 0, REVERSE_L_STATE, REVERSE_L_CMD, 0 },
+	{ FSM_STATE_BIT(REVERSE_R_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_R_CMD, 0 },
+};
+
+static const fsmTransition fsmAvoidObstacleSpec[] = {
+	{ 0, 0, 0, FSM_COND_OBSTACLE, STOP_STATE, STOP_CMD, 0 },
+	{ 0, 0, 0, 0, FSM_SAME_STATE, REVERSE_CMD, 0 },
+};
+
+/* Autonomous mode */
+/* An obstacle seen while driving forward or turning starts a new reverse */
+static const fsmTransition fsmAutoSpec[] = {
+	{ 0, 0, MANUAL_MODE_CMD_MASK, 0, STOP_STATE, STOP_CMD, 0 },
+	{ FSM_AUTO_MOVING_STATES, FSM_COND_OBSTACLE | FSM_COND_LEFT_SENSOR, 0, 0, AUTO_REVERSE_STATE, REVERSE_CMD, FSM_ACT_RESET_TICKS | FSM_ACT_SET_LEFT_TRIPPED },
+	{ FSM_AUTO_MOVING_STATES, FSM_COND_OBSTACLE, 0, 0, AUTO_REVERSE_STATE, REVERSE_CMD, FSM_ACT_RESET_TICKS },
+};
+
+static const fsmTransition fsmAutoForwardSpec[] = {
+	{ 0, 0, 0, 0, FSM_SAME_STATE, FORWARD_CMD, 0 },
+};
+
+/* Entering AutoTurn starts the turn delay and clears the left sensor latch (fsmHierarchy). The turn waits
+ * until the obstacle is no longer seen. */
+static const fsmTransition fsmAutoReverseSpec[] = {
+	{ 0, FSM_COND_OBSTACLE, 0, 0, FSM_SAME_STATE, REVERSE_CMD, 0 },
+	{ 0, FSM_COND_REVERSE_DONE | FSM_COND_LEFT_TRIPPED, 0, 0, AUTO_TURN_R_STATE, TURN_R_CMD, 0 },
+	{ 0, FSM_COND_REVERSE_DONE, 0, 0, AUTO_TURN_L_STATE, TURN_L_CMD, 0 },
+	{ 0, 0, 0, 0, FSM_SAME_STATE, REVERSE_CMD, 0 },
+};
+
+static const fsmTransition fsmAutoTurnSpec[] = {
+	{ 0, FSM_COND_TURN_DONE, 0, 0, AUTO_FORWARD_STATE, FORWARD_CMD, 0 },
+	{ FSM_STATE_BIT(AUTO_TURN_L_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_L_CMD, 0 },
+	{ FSM_STATE_BIT(AUTO_TURN_R_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_R_CMD, 0 },
+};
+
+/* Wall following mode (getWallFollowTable). Obstacles are left to WallFollower, which steers away from them
+ * in proportion to the sensor ranges instead of stopping. A tripped sensor means it was too close: the row
+ * keeps going forward and FSM_ACT_TOO_CLOSE has the caller turn hard away for a while. */
+static const fsmTransition fsmWallFollowManualSpec[] = {
+	{ 0, 0, AUTO_MODE_CMD_MASK, 0, WALL_FOLLOW_STATE, FORWARD_CMD, 0 },
+	{ 0, 0, FSM_COND_OBSTACLE, 0, AVOID_OBSTACLE_STATE, REVERSE_CMD, FSM_ACT_OBSTACLE_MSG },
+};
+
+static const fsmTransition fsmWallFollowSpec[] = {
+	{ 0, 0, MANUAL_MODE_CMD_MASK, 0, STOP_STATE, STOP_CMD, 0 },
+	{ 0, FSM_COND_OBSTACLE, 0, 0, FSM_SAME_STATE, FORWARD_CMD, FSM_ACT_TOO_CLOSE },
+	{ 0, 0, 0, 0, FSM_SAME_STATE, FORWARD_CMD, 0 },
+};
+
+#define FSM_ROWS(spec)	spec, (int)(sizeof(spec) / sizeof(spec[0]))
+
+/* Composite states, each after the one enclosing it. Columns: name, parent, states, rows, entry and exit actions. */
+static const fsmComposite fsmHierarchy[] = {
+	{ "Manual", -1, FSM_MANUAL_STATES, FSM_ROWS(fsmManualSpec), 0, 0 },
+	{ "Stop", 0, FSM_STOP_STATES, FSM_ROWS(fsmStopSpec), 0, 0 },
+	{ "Forward", 0, FSM_FORWARD_STATES, FSM_ROWS(fsmForwardSpec), 0, 0 },
+	{ "Reverse", 0, FSM_REVERSE_STATES, FSM_ROWS(fsmReverseSpec), 0, 0 },
+	{ "AvoidObstacle", 0, FSM_STATE_BIT(AVOID_OBSTACLE_STATE), FSM_ROWS(fsmAvoidObstacleSpec), 0, 0 },
+	{ "Auto", -1, FSM_AUTO_STATES, FSM_ROWS(fsmAutoSpec), 0, 0 },
+	{ "AutoForward", 5, FSM_STATE_BIT(AUTO_FORWARD_STATE), FSM_ROWS(fsmAutoForwardSpec), 0, 0 },
+	{ "AutoReverse", 5, FSM_STATE_BIT(AUTO_REVERSE_STATE), FSM_ROWS(fsmAutoReverseSpec), 0, 0 },
+	{ "AutoTurn", 5, FSM_AUTO_TURN_STATES, FSM_ROWS(fsmAutoTurnSpec), FSM_ACT_RESET_TICKS | FSM_ACT_CLEAR_LEFT_TRIPPED, 0 },
+};
+#define FSM_HIERARCHY_COUNT	(sizeof(fsmHierarchy) / sizeof(fsmHierarchy[0]))
+
+/* The manual mode of fsmHierarchy with a wall following mode in place of the AUTO mode */
+static const fsmComposite fsmWallFollowHierarchy[] = {
+	{ "Manual", -1, FSM_MANUAL_STATES, FSM_ROWS(fsmWallFollowManualSpec), 0, 0 },
+	{ "Stop", 0, FSM_STOP_STATES, FSM_ROWS(fsmStopSpec), 0, 0 },
+	{ "Forward", 0, FSM_FORWARD_STATES, FSM_ROWS(fsmForwardSpec), 0, 0 },
+	{ "Reverse", 0, FSM_REVERSE_STATES, FSM_ROWS(fsmReverseSpec), 0, 0 },
+	{ "AvoidObstacle", 0, FSM_STATE_BIT(AVOID_OBSTACLE_STATE), FSM_ROWS(fsmAvoidObstacleSpec), 0, 0 },
+	{ "WallFollow", -1, FSM_STATE_BIT(WALL_FOLLOW_STATE), FSM_ROWS(fsmWallFollowSpec), 0, 0 },
+};
+#define FSM_WALL_FOLLOW_HIERARCHY_COUNT	(sizeof(fsmWallFollowHierarchy) / sizeof(fsmWallFollowHierarchy[0]))
+
+/* States whose command is refined from the sensor ranges on every step, so are stepped every tick */
+#define FSM_STEERED_STATES	FSM_STATE_BIT(WALL_FOLLOW_STATE)
+
+/* Tables built from fsmHierarchy and fsmWallFollowHierarchy before main() runs */
+static fsmEntry fsmTable[FSM_STATE_CODES][FSM_SYMBOLS];
+static fsmEntry fsmWallFollowTable[FSM_STATE_CODES][FSM_SYMBOLS];
+
+static int compileSpec()
+{
+	if (StateMachine::compileHierarchy(fsmHierarchy, FSM_HIERARCHY_COUNT, fsmTable) != 0 ||
+		StateMachine::compileHierarchy(fsmWallFollowHierarchy, FSM_WALL_FOLLOW_HIERARCHY_COUNT, fsmWallFollowTable) != 0) {
+		printf("ERROR: State machine specification is invalid.\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int fsmSpecCompiled = compileSpec();
+
+/* AUTO mode symbols pack the mode switch and FSM_COND_OBSTACLE..FSM_COND_LEFT_TRIPPED into 6 bits */
+static inline int autoSymbol(int conditions)
+{
+	return ((conditions & MANUAL_MODE_CMD_MASK) >> 6) | ((conditions >> 7) & 0x3E);
+}
+
+static inline int autoConditions(int symbol)
+{
+	return ((symbol & 0x01) << 6) | ((symbol & 0x3E) << 7);
+}
+
+StateMachine::StateMachine()
+{
+	/* Initial FSM State */
+	table = fsmTable;
+	currentState = STOP_STATE;
+	machineMode = MANUAL_MODE;
+	outputCmd = NULL_CMD;
+	outputActions = 0;
+	inputArg = 0.0;
+	outputArg = 0.0;
+	tickCount = 0;
+	left_sensor_tripped = false;
+	externalInput = 0;
+	delayStart = 0;
+	lastStepTime = 0;
+	profile = NULL;
+	stateEntered = false;
+}
+
+StateMachine::StateMachine(const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS], int initialState)
+{
+	this->table = table;
+	currentState = initialState;
+	machineMode = stateMode(initialState);
+	outputCmd = NULL_CMD;
+	outputActions = 0;
+	inputArg = 0.0;
+	outputArg = 0.0;
+	tickCount = 0;
+	left_sensor_tripped = false;
+	externalInput = 0;
+	delayStart = 0;
+	lastStepTime = 0;
+	profile = NULL;
+	stateEntered = false;
+}
+
+int StateMachine::getCurrentState()
+{
+	return currentState;
+}
+
+void StateMachine::setInput(uint16_t input, double arg)
+{
+	externalInput = input;
+	inputArg = arg;
+}
+
+int StateMachine::getOutputCmd()
+{
+	int temp;
+
+	temp = outputCmd;
+	outputCmd = NULL_CMD;
+
+	return temp;
+}
+
+int StateMachine::getOutputActions()
+{
+	return outputActions;
+}
+
+double StateMachine::getOutputArg()
+{
+	double temp;
+
+	temp = outputArg;
+	outputArg = 0.0;
+
+	return temp;
+}
+
+const fsmEntry (*StateMachine::getDefaultTable())[FSM_SYMBOLS]
+{
+	return fsmTable;
+}
+
+const fsmEntry (*StateMachine::getWallFollowTable())[FSM_SYMBOLS]
+{
+	return fsmWallFollowTable;
+}
+
+void StateMachine::getConfiguration(fsmConfiguration* config)
+{
+	config->state = currentState;
+	config->tickCount = tickCount;
+	config->leftSensorTripped = left_sensor_tripped;
+}
+
+void StateMachine::setConfiguration(const fsmConfiguration & config)
+{
+	currentState = config.state;
+	machineMode = stateMode(config.state);
+	tickCount = config.tickCount;
+	left_sensor_tripped = config.leftSensorTripped;
+	outputCmd = NULL_CMD;
+	outputActions = 0;
+	inputArg = 0.0;
+	outputArg = 0.0;
+	externalInput = 0;
+}
+
+void StateMachine::setProfile(StateMachineProfile* profile)
+{
+	this->profile = profile;
+}
+
+int StateMachine::stateMode(int state)
+{
+	return (FSM_STATE_BIT(state) & FSM_AUTONOMOUS_STATES) ? AUTO_MODE : MANUAL_MODE;
+}
+
+inline int StateMachine::inputSymbol()
+{
+	int conditions;
+
+	conditions = externalInput & FSM_COND_INPUT;
+	if (externalInput & FSM_SENSOR_MASK) conditions |= FSM_COND_OBSTACLE;
+	if (externalInput & LEFT_SENSOR_MASK) conditions |= FSM_COND_LEFT_SENSOR;
+	if (tickCount >= AUTO_AVOIDANCE_REVERSE_DELAY_TICKS) conditions |= FSM_COND_REVERSE_DONE;
+	if (tickCount >= AUTO_AVOIDANCE_TURN_DELAY_TICKS) conditions |= FSM_COND_TURN_DONE;
+	if (left_sensor_tripped) conditions |= FSM_COND_LEFT_TRIPPED;
+
+	if (machineMode == AUTO_MODE) return autoSymbol(conditions);
+	return conditions & (FSM_MANUAL_SYMBOLS - 1);
+}
+
+int StateMachine::stepMachine(bool timerTick)
+{
+	if (timerTick) {
+		tickCount++;
+		lastStepTime += STATE_MACHINE_TICK_TIME_US;
+	}
+	return (transition() != NULL) ? 0 : -1;
+}
+
+int StateMachine::stepMachineAt(int64_t now)
+{
+	const fsmEntry* entry;
+	int64_t ticks;
+
+	if (now < lastStepTime) now = lastStepTime;
+	lastStepTime = now;
+
+	/* Whole ticks since the delay started. Counts past the longest delay behave the same. */
+	ticks = (now - delayStart) / STATE_MACHINE_TICK_TIME_US;
+	tickCount = (ticks < AUTO_AVOIDANCE_TURN_DELAY_TICKS) ? (int)ticks : AUTO_AVOIDANCE_TURN_DELAY_TICKS;
+
+	entry = transition();
+	if (entry == NULL) return -1;
+	if (entry->actions & FSM_ACT_RESET_TICKS) delayStart = now;
+	return 0;
+}
+
+int64_t StateMachine::getNextDeadline()
+{
+	static const int conditions[] = { FSM_COND_REVERSE_DONE, FSM_COND_TURN_DONE };
+	static const int delays[] = { AUTO_AVOIDANCE_REVERSE_DELAY_TICKS, AUTO_AVOIDANCE_TURN_DELAY_TICKS };
+	int64_t deadline, end;
+	int i;
+
+	if (currentState < 0 || currentState >= FSM_STATE_CODES || !table[currentState][0].valid) return FSM_NO_DEADLINE;
+
+	deadline = (stateEntered || (FSM_STATE_BIT(currentState) & FSM_STEERED_STATES)) ? lastStepTime + STATE_MACHINE_TICK_TIME_US : FSM_NO_DEADLINE;
+	for (i = 0; i < 2; i++) {
+		if (tickCount >= delays[i] || !waitsFor(conditions[i])) continue;
+		end = delayStart + (int64_t)delays[i] * STATE_MACHINE_TICK_TIME_US;
+		if (end < deadline) deadline = end;
+	}
+	return deadline;
+}
+
+/* Take the transition for the current input and clear it. NULL if the current state is not defined. */
+const fsmEntry* StateMachine::transition()
+{
+	const fsmEntry* entry;
+	int from, actions;
+
+	outputArg = inputArg;
+
+	if (currentState < 0 || currentState >= FSM_STATE_CODES || !table[currentState][0].valid) {
+		printf("ERROR: Unknown FSM State %d.\n", currentState);
+		outputCmd = NULL_CMD;
+		outputActions = 0;
+		return NULL;
+	}
+
+	/* Actions are applied without branching on them, as they vary from step to step */
+	entry = &table[currentState][inputSymbol()];
+	actions = entry->actions;
+	tickCount &= (actions & FSM_ACT_RESET_TICKS) ? 0 : ~0;
+	left_sensor_tripped = (left_sensor_tripped || (actions & FSM_ACT_SET_LEFT_TRIPPED)) && !(actions & FSM_ACT_CLEAR_LEFT_TRIPPED);
+	stateEntered = (entry->next != currentState);
+	from = currentState;
+	currentState = entry->next;
+	machineMode = stateMode(currentState);
+	outputCmd = entry->output;
+	outputActions = actions;
+	if (profile != NULL) profile->Record(from, currentState, lastStepTime);
+
+	externalInput = 0;
+	return entry;
+}
+
+/* Whether some transition of the current state depends on a delay condition */
+bool StateMachine::waitsFor(int condition)
+{
+	int bit, symbol;
+
+	if (machineMode != AUTO_MODE) return false;
+	bit = autoSymbol(condition);
+	for (symbol = 0; symbol < FSM_AUTO_SYMBOLS; symbol++) {
+		if (symbol & bit) continue;
+		if (memcmp(&table[currentState][symbol], &table[currentState][symbol | bit], sizeof(fsmEntry)) != 0) return true;
+	}
+	return false;
+}
+
+int StateMachine::compileTransitions(const fsmTransition* spec, int count, fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS])
+{
+	uint32_t used;
+	int state, symbol, symbols, conditions, next, r;
+
+	used = 0;
+	for (r = 0; r < count; r++) {
+		if (spec[r].states >> FSM_STATE_CODES) {
+			printf("ERROR: FSM transition %d applies to an unknown state.\n", r);
+			return -1;
+		}
+		if ((spec[r].next != FSM_SAME_STATE && (spec[r].next < 0 || spec[r].next >= FSM_STATE_CODES)) ||
+			spec[r].output < 0 || spec[r].output > 0xFF) {
+			printf("ERROR: FSM transition %d has an invalid next state or output.\n", r);
+			return -1;
+		}
+		used |= spec[r].states;
+	}
+
+	memset(table, 0x00, sizeof(fsmEntry) * FSM_STATE_CODES * FSM_SYMBOLS);
+	for (state = 0; state < FSM_STATE_CODES; state++) {
+		if (!(used & FSM_STATE_BIT(state))) continue;
+
+		symbols = (stateMode(state) == AUTO_MODE) ? FSM_AUTO_SYMBOLS : FSM_MANUAL_SYMBOLS;
+		for (symbol = 0; symbol < symbols; symbol++) {
+			conditions = (stateMode(state) == AUTO_MODE) ? autoConditions(symbol) : symbol;
+			for (r = 0; r < count; r++) {
+				if (!(spec[r].states & FSM_STATE_BIT(state))) continue;
+				if ((conditions & spec[r].all) != spec[r].all) continue;
+				if (spec[r].any && !(conditions & spec[r].any)) continue;
+				if (conditions & spec[r].none) continue;
+				break;
+			}
+			if (r == count) {
+				printf("ERROR: FSM State %d has no transition for conditions 0x%04X.\n", state, conditions);
+				return -1;
+			}
+
+			next = (spec[r].next == FSM_SAME_STATE) ? state : spec[r].next;
+			if (!(used & FSM_STATE_BIT(next))) {
+				printf("ERROR: FSM transition %d leads to State %d, which has no transitions.\n", r, next);
+				return -1;
+			}
+			table[state][symbol].next = (uint8_t)next;
+			table[state][symbol].output = (uint8_t)spec[r].output;
+			table[state][symbol].actions = (uint8_t)spec[r].actions;
+			table[state][symbol].valid = 1;
+		}
+	}
+	return 0;
+}
+
+int StateMachine::compileHierarchy(const fsmComposite* composites, int count, fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS])
+{
+	fsmTransition* spec;
+	uint32_t from, to;
+	int c, r, rows, state, symbol, ret;
+
+	rows = 0;
+	for (c = 0; c < count; c++) rows += composites[c].count;
+	spec = (fsmTransition*)malloc(sizeof(fsmTransition) * (rows > 0 ? rows : 1));
+	if (spec == NULL) {
+		printf("ERROR: Could not allocate the FSM specification.\n");
+		return -1;
+	}
+
+	/* Rows of each composite in hierarchy order, which puts every enclosing composite's rows first */
+	rows = 0;
+	for (c = 0; c < count; c++) {
+		if (composites[c].parent >= c ||
+			(composites[c].parent >= 0 && (composites[c].states & ~composites[composites[c].parent].states))) {
+			printf("ERROR: FSM composite %s is not inside its parent, or listed before it.\n", composites[c].name);
+			free(spec);
+			return -1;
+		}
+		for (r = 0; r < composites[c].count; r++) {
+			spec[rows] = composites[c].transitions[r];
+			if (spec[rows].states & ~composites[c].states) {
+				printf("ERROR: FSM composite %s transition %d applies to a state outside it.\n", composites[c].name, r);
+				free(spec);
+				return -1;
+			}
+			if (spec[rows].states == 0) spec[rows].states = composites[c].states;
+			rows++;
+		}
+	}
+	ret = compileTransitions(spec, rows, table);
+	free(spec);
+	if (ret != 0) return -1;
+
+	/* Transitions that cross a composite's boundary take its exit or entry actions */
+	for (state = 0; state < FSM_STATE_CODES; state++) {
+		for (symbol = 0; symbol < FSM_SYMBOLS; symbol++) {
+			fsmEntry & entry = table[state][symbol];
+			if (!entry.valid || entry.next == state) continue;
+			from = FSM_STATE_BIT(state);
+			to = FSM_STATE_BIT(entry.next);
+			for (c = 0; c < count; c++) {
+				if ((composites[c].states & from) && !(composites[c].states & to)) entry.actions |= (uint8_t)composites[c].exitActions;
+				if (!(composites[c].states & from) && (composites[c].states & to)) entry.actions |= (uint8_t)composites[c].entryActions;
+			}
+		}
+	}
+	return 0;
+}
@@ -1,67 +1,210 @@
-/*********************************************************************************
-*	StateMachine.h
-*
-*	Basic Finite State Machine class for implementing Robot Controller logic.
-*
-*	Author: Charles Hartsell
-*
-*	Date:	4-7-17
-*********************************************************************************/
-
-#pragma once
-
-#include "GazeboDefs.h"
-#include "StateMachineDefs.h"
-
-#include "stdafx.h"
-
-/* States of machine */
-#define NULL_STATE				0x00
-#define FORWARD_STATE			0x01
-#define FORWARD_L_STATE			0x02
-#define FORWARD_R_STATE			0x03
-#define STOP_STATE				0x04
-#define STOP_L_STATE			0x05
-#define STOP_R_STATE			0x06
-#define REVERSE_STATE			0x07
-#define REVERSE_L_STATE			0x08
-#define REVERSE_R_STATE			0x09
-#define AVOID_OBSTACLE_STATE	0x10
-#define AUTO_FORWARD_STATE		0x11
-#define AUTO_REVERSE_STATE		0x12
-#define AUTO_TURN_L_STATE		0x13
-#define AUTO_TURN_R_STATE		0x14
-
-#define AUTO_MODE				0x30
-#define MANUAL_MODE				0x31
-
-#define STATE_MACHINE_TICK_TIME_MS				20	
-#define AUTO_AVOIDANCE_REVERSE_DELAY_TICKS		25
-#define AUTO_AVOIDANCE_TURN_DELAY_TICKS			50
-
-public class StateMachine 
-{
-public:
-	/* Public Functions */
-	StateMachine();
-	int getCurrentState();
-	void setInput(uint16_t input, double arg);
-	int getOutputCmd();
-	double getOutputArg();
-	int stepMachine();
-
-	/* Public Variables */
-
-private:
-	/* Private Functions */
-
-	/* Private Variables */
-	int currentState;
-	int machineMode;
-	int outputCmd;
-	double inputArg;
-	double outputArg;
-	int tickCount;
-	bool left_sensor_tripped;
-	uint16_t externalInput;
+/*********************************************************************************
+*	StateMachine.h
+*
+*	Basic Finite State Machine class for implementing Robot Controller logic.
+*
+*	The behavior is a hierarchy of composite states, each with its own transition
+*	rows (fsmHierarchy in StateMachine.cpp), compiled before main() runs into a
+*	table indexed by state and input symbol, so stepMachine is one table lookup
+*	whatever the number of modes and transitions.
+*
+*	Author: Charles Hartsell
+*
+*	Date:	4-7-17
+*********************************************************************************/
+
+#pragma once
+
+#include "GazeboDefs.h"
+#include "StateMachineDefs.h"
+
+#include "stdafx.h"
+
+/* States of machine */
+#define NULL_STATE				0x00
+#define FORWARD_STATE			0x01
+#define FORWARD_L_STATE			0x02
+#define FORWARD_R_STATE			0x03
+#define STOP_STATE				0x04
+#define STOP_L_STATE			0x05
+#define STOP_R_STATE			0x06
+#define REVERSE_STATE			0x07
+#define REVERSE_L_STATE			0x08
+#define REVERSE_R_STATE			0x09
+#define AVOID_OBSTACLE_STATE	0x10
+#define AUTO_FORWARD_STATE		0x11
+#define AUTO_REVERSE_STATE		0x12
+#define AUTO_TURN_L_STATE		0x13
+#define AUTO_TURN_R_STATE		0x14
+#define WALL_FOLLOW_STATE		0x15	// RobotController -wallfollow, steered by WallFollower
+
+#define AUTO_MODE				0x30
+#define MANUAL_MODE				0x31
+
+#define STATE_MACHINE_TICK_TIME_MS				20	
+#define AUTO_AVOIDANCE_REVERSE_DELAY_TICKS		25
+#define AUTO_AVOIDANCE_TURN_DELAY_TICKS			50
+#define STATE_MACHINE_TICK_TIME_US				(STATE_MACHINE_TICK_TIME_MS * 1000)
+#define FSM_NO_DEADLINE							INT64_MAX
+
+/* Conditions a transition can test. The low byte is the machine input (StateMachineDefs.h). */
+#define FSM_COND_INPUT			0x00FF
+#define FSM_COND_OBSTACLE		0x0100	// any obstacle sensor
+#define FSM_COND_LEFT_SENSOR	0x0200
+#define FSM_COND_REVERSE_DONE	0x0400	// tickCount >= AUTO_AVOIDANCE_REVERSE_DELAY_TICKS
+#define FSM_COND_TURN_DONE		0x0800	// tickCount >= AUTO_AVOIDANCE_TURN_DELAY_TICKS
+#define FSM_COND_LEFT_TRIPPED	0x1000	// left sensor caused the current avoidance
+
+/* Actions of a transition besides setting the state and output command */
+#define FSM_ACT_RESET_TICKS			0x01
+#define FSM_ACT_SET_LEFT_TRIPPED	0x02
+#define FSM_ACT_CLEAR_LEFT_TRIPPED	0x04
+#define FSM_ACT_OBSTACLE_MSG		0x08	// for the caller to report, see getOutputActions
+#define FSM_ACT_TOO_CLOSE			0x10	// for the caller to steer clear, see WallFollower::Update
+
+#define FSM_STATE_CODES			0x16	// state codes are below this
+#define FSM_STATE_BIT(state)	(1u << (state))
+#define FSM_SAME_STATE			-1
+
+/* Input symbols. MANUAL mode states read the machine input and FSM_COND_OBSTACLE,
+ * AUTO mode states the mode switch, sensors, delays and left sensor latch. */
+#define FSM_MANUAL_SYMBOLS		0x200
+#define FSM_AUTO_SYMBOLS		0x40
+#define FSM_SYMBOLS				FSM_MANUAL_SYMBOLS
+
+/* One row of a transition specification. Rows are tried in order; the first whose
+ * conditions hold for the current state fires. */
+typedef struct {
+	uint32_t	states;		// FSM_STATE_BIT of each state the row applies to
+	uint16_t	all;		// FSM_COND_* that must all hold
+	uint16_t	any;		// at least one must hold, 0 for no requirement
+	uint16_t	none;		// none may hold
+	int			next;		// state, or FSM_SAME_STATE
+	int			output;		// command ID (GazeboDefs.h)
+	int			actions;	// FSM_ACT_*
+}fsmTransition;
+
+/* A state or group of states in the hierarchy, such as a mode or a mid-level group within one. Its rows are
+ * tried after those of the composites enclosing it. A transition from a state inside it to one outside takes
+ * its exit actions, one from outside to inside its entry actions; staying inside takes neither. */
+typedef struct {
+	const char*				name;
+	int						parent;			// index of the enclosing composite, which must come first; -1 for none
+	uint32_t				states;			// FSM_STATE_BIT of every state inside it, within those of the parent
+	const fsmTransition*	transitions;	// rows with states 0 apply to every state inside it
+	int						count;
+	int						entryActions;	// FSM_ACT_*
+	int						exitActions;
+}fsmComposite;
+
+/* Compiled transition */
+typedef struct {
+	uint8_t		next;
+	uint8_t		output;
+	uint8_t		actions;
+	uint8_t		valid;
+}fsmEntry;
+
+/* Everything that determines the future behavior of a machine. The mode follows from the state. */
+typedef struct {
+	int			state;
+	int			tickCount;
+	bool		leftSensorTripped;
+}fsmConfiguration;
+
+class StateMachineProfile;
+
+#ifdef __cplusplus_cli
+public class StateMachine 
+#else
+class StateMachine
+#endif
+{
+public:
+	/* Public Functions */
+	StateMachine();
+	/* Machine running a table built by compileTransitions, which must outlive it */
+	StateMachine(const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS], int initialState);
+	int getCurrentState();
+	void setInput(uint16_t input, double arg);
+	int getOutputCmd();
+	double getOutputArg();
+	/* FSM_ACT_* of the transition the last step took. The machine prints nothing; the caller reports FSM_ACT_OBSTACLE_MSG
+	 * and steers clear on FSM_ACT_TOO_CLOSE. */
+	int getOutputActions();
+	/* timerTick is false for extra steps taken between ticks to react to new input. Only timer ticks advance the AUTO mode delays. */
+	int stepMachine(bool timerTick = true);
+
+	/// <summary>
+	/// Step at a monotonic time in microseconds (LatencyTrace::Now) instead of on timer ticks. The AUTO mode
+	/// delays are measured from the time of the transition that started them, so a delay of n ticks lasts
+	/// exactly n * STATE_MACHINE_TICK_TIME_US however often the machine is stepped. Times earlier than the
+	/// last step are taken as the last step.
+	/// </summary>
+	/// <returns>0 on success, -1 if the current state is not defined</returns>
+	int stepMachineAt(int64_t now);
+
+	/// <summary>
+	/// When stepped with stepMachineAt, the time at which the machine next needs stepping if no input
+	/// arrives: the end of a delay the current state waits for, or one tick after a state change so the new
+	/// state sees the sensors that are still tripped, as it would on the next timer tick. WALL_FOLLOW_STATE
+	/// is steered from the sensor ranges on every step, so it always needs stepping one tick later.
+	/// </summary>
+	/// <returns>deadline in microseconds, or FSM_NO_DEADLINE</returns>
+	int64_t getNextDeadline();
+
+	/// <summary>
+	/// Build the lookup table of a transition specification. Every state used by the specification
+	/// must have a row for every input symbol, usually a final row with no conditions.
+	/// </summary>
+	/// <returns>0 on success, -1 if a state has no transition for some input</returns>
+	static int compileTransitions(const fsmTransition* spec, int count, fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS]);
+
+	/// <summary>
+	/// Build the lookup table of a hierarchy of composite states: their rows are flattened into one
+	/// specification, outer composites first, and their entry and exit actions added to the transitions
+	/// crossing their boundary. A new behavior is a new composite; states outside it pay nothing for it.
+	/// </summary>
+	/// <returns>0 on success, -1 if the hierarchy or its specification is invalid</returns>
+	static int compileHierarchy(const fsmComposite* composites, int count, fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS]);
+
+	/* Mode of a state, AUTO_MODE or MANUAL_MODE */
+	static int stateMode(int state);
+
+	/* Table compiled from the built in specification */
+	static const fsmEntry (*getDefaultTable())[FSM_SYMBOLS];
+
+	/* Built in specification with AUTO_MODE_CMD_MASK entering WALL_FOLLOW_STATE instead of the AUTO mode states */
+	static const fsmEntry (*getWallFollowTable())[FSM_SYMBOLS];
+
+	/* Save or restore the configuration, for example to explore every configuration a machine can reach. Restoring clears input and output. */
+	void getConfiguration(fsmConfiguration* config);
+	void setConfiguration(const fsmConfiguration & config);
+
+	/* Record every step in profile (StateMachineProfile.h), NULL to stop. Timer ticks count STATE_MACHINE_TICK_TIME_US each. */
+	void setProfile(StateMachineProfile* profile);
+
+	/* Public Variables */
+
+private:
+	/* Private Functions */
+	int inputSymbol();
+	const fsmEntry* transition();
+	bool waitsFor(int condition);
+
+	/* Private Variables */
+	const fsmEntry (*table)[FSM_SYMBOLS];
+	int currentState;
+	int machineMode;
+	int outputCmd;
+	int outputActions;
+	double inputArg;
+	double outputArg;
+	int tickCount;
+	bool left_sensor_tripped;
+	uint16_t externalInput;
+	int64_t delayStart;		// stepMachineAt time of the last FSM_ACT_RESET_TICKS
+	int64_t lastStepTime;	// stepMachineAt time, or timer ticks times STATE_MACHINE_TICK_TIME_US
+	bool stateEntered;		// the last step changed the state
+	StateMachineProfile* profile;
 };
\ No newline at end of file
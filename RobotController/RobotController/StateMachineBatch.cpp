@@ -0,0 +1,296 @@
+/*****************************************************
+*	StateMachineBatch.cpp
+*
+*	SIMD stepping of many StateMachines. Each lane
+*	builds its input symbol the way
+*	StateMachine::inputSymbol does and gathers its
+*	transition from the table; actions become lane
+*	masks.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachineBatch.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FSM_BATCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FSM_BATCH_SSE2
+#endif
+
+#define FSM_SENSOR_MASK		(WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)
+#define FSM_SYMBOL_BITS		9		// log2(FSM_SYMBOLS)
+
+/* SIMD kernels must be compiled as native code when building with /clr */
+#ifdef _MANAGED
+#pragma managed(push, off)
+#endif
+
+/*****************************************************
+*	Lane helpers. vi holds int32 values or comparison
+*	masks (all ones = true). A table entry is read as
+*	one int32: next | output << 8 | actions << 16 |
+*	valid << 24.
+*****************************************************/
+#if defined(FSM_BATCH_AVX2)
+
+#define LANES 8
+typedef __m256i	vi;
+
+static inline vi vi_load(const int32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void vi_store(int32_t* p, vi a) { _mm256_storeu_si256((__m256i*)p, a); }
+static inline vi vi_set(int32_t a) { return _mm256_set1_epi32(a); }
+static inline vi vi_zero() { return _mm256_setzero_si256(); }
+static inline vi vi_and(vi a, vi b) { return _mm256_and_si256(a, b); }
+static inline vi vi_or(vi a, vi b) { return _mm256_or_si256(a, b); }
+static inline vi vi_andnot(vi m, vi a) { return _mm256_andnot_si256(m, a); }	// a where m is false, else 0
+static inline vi vi_add(vi a, vi b) { return _mm256_add_epi32(a, b); }
+static inline vi vi_eq(vi a, vi b) { return _mm256_cmpeq_epi32(a, b); }
+static inline vi vi_gt(vi a, vi b) { return _mm256_cmpgt_epi32(a, b); }
+static inline vi vi_sel(vi m, vi a, vi b) { return _mm256_blendv_epi8(b, a, m); }
+static inline vi vi_shl(vi a, int n) { return _mm256_slli_epi32(a, n); }
+static inline vi vi_shr(vi a, int n) { return _mm256_srli_epi32(a, n); }
+static inline vi vi_gather(const int32_t* base, vi index) { return _mm256_i32gather_epi32((const int*)base, index, 4); }
+static inline void vf_copy(float* dst, const float* src) { _mm256_storeu_ps(dst, _mm256_loadu_ps(src)); }
+
+#elif defined(FSM_BATCH_SSE2)
+
+#define LANES 4
+typedef __m128i	vi;
+
+static inline vi vi_load(const int32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void vi_store(int32_t* p, vi a) { _mm_storeu_si128((__m128i*)p, a); }
+static inline vi vi_set(int32_t a) { return _mm_set1_epi32(a); }
+static inline vi vi_zero() { return _mm_setzero_si128(); }
+static inline vi vi_and(vi a, vi b) { return _mm_and_si128(a, b); }
+static inline vi vi_or(vi a, vi b) { return _mm_or_si128(a, b); }
+static inline vi vi_andnot(vi m, vi a) { return _mm_andnot_si128(m, a); }	// a where m is false, else 0
+static inline vi vi_add(vi a, vi b) { return _mm_add_epi32(a, b); }
+static inline vi vi_eq(vi a, vi b) { return _mm_cmpeq_epi32(a, b); }
+static inline vi vi_gt(vi a, vi b) { return _mm_cmpgt_epi32(a, b); }
+static inline vi vi_sel(vi m, vi a, vi b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+static inline vi vi_shl(vi a, int n) { return _mm_slli_epi32(a, n); }
+static inline vi vi_shr(vi a, int n) { return _mm_srli_epi32(a, n); }
+static inline vi vi_gather(const int32_t* base, vi index)
+{
+	int32_t lane[4];
+
+	_mm_storeu_si128((__m128i*)lane, index);
+	return _mm_setr_epi32(base[lane[0]], base[lane[1]], base[lane[2]], base[lane[3]]);
+}
+static inline void vf_copy(float* dst, const float* src) { _mm_storeu_ps(dst, _mm_loadu_ps(src)); }
+
+#else
+
+/* Scalar fallback. One lane, masks are 0 or -1. */
+#define LANES 1
+typedef int32_t	vi;
+
+static inline vi vi_load(const int32_t* p) { return *p; }
+static inline void vi_store(int32_t* p, vi a) { *p = a; }
+static inline vi vi_set(int32_t a) { return a; }
+static inline vi vi_zero() { return 0; }
+static inline vi vi_and(vi a, vi b) { return a & b; }
+static inline vi vi_or(vi a, vi b) { return a | b; }
+static inline vi vi_andnot(vi m, vi a) { return ~m & a; }
+static inline vi vi_add(vi a, vi b) { return a + b; }
+static inline vi vi_eq(vi a, vi b) { return (a == b) ? -1 : 0; }
+static inline vi vi_gt(vi a, vi b) { return (a > b) ? -1 : 0; }
+static inline vi vi_sel(vi m, vi a, vi b) { return m ? a : b; }
+static inline vi vi_shl(vi a, int n) { return (vi)((uint32_t)a << n); }
+static inline vi vi_shr(vi a, int n) { return (vi)((uint32_t)a >> n); }
+static inline vi vi_gather(const int32_t* base, vi index) { return base[index]; }
+static inline void vf_copy(float* dst, const float* src) { *dst = *src; }
+
+#endif
+
+/* Lanes where any bit of mask is set in a */
+static inline vi vi_any(vi a, int32_t mask)
+{
+	return vi_andnot(vi_eq(vi_and(a, vi_set(mask)), vi_zero()), vi_set(-1));
+}
+
+/* bit in lanes where m is true */
+static inline vi vi_bit(vi m, int32_t bit)
+{
+	return vi_and(m, vi_set(bit));
+}
+
+int StateMachineBatch::stepAll(bool timerTick)
+{
+	const int32_t* entries = (const int32_t*)table;
+	const vi zero = vi_zero(), one = vi_set(1);
+	const vi tick = vi_set(timerTick ? 1 : 0);
+	vi errors = zero;
+	int32_t lanes[LANES];
+	int i, invalid;
+
+	for (i = 0; i < count; i += LANES) {
+		vi s = vi_load(&state[i]);
+		vi t = vi_add(vi_load(&tickCount[i]), tick);
+		vi in = vi_load(&input[i]);
+		vi latch = vi_load(&leftTripped[i]);
+
+		/* Conditions and input symbol (StateMachine::inputSymbol). AUTO states are the codes above AVOID_OBSTACLE_STATE. */
+		vi cond = vi_and(in, vi_set(FSM_COND_INPUT));
+		cond = vi_or(cond, vi_bit(vi_any(in, FSM_SENSOR_MASK), FSM_COND_OBSTACLE));
+		cond = vi_or(cond, vi_bit(vi_any(in, LEFT_SENSOR_MASK), FSM_COND_LEFT_SENSOR));
+		cond = vi_or(cond, vi_bit(vi_gt(t, vi_set(AUTO_AVOIDANCE_REVERSE_DELAY_TICKS - 1)), FSM_COND_REVERSE_DONE));
+		cond = vi_or(cond, vi_bit(vi_gt(t, vi_set(AUTO_AVOIDANCE_TURN_DELAY_TICKS - 1)), FSM_COND_TURN_DONE));
+		cond = vi_or(cond, vi_bit(latch, FSM_COND_LEFT_TRIPPED));
+		vi autoSymbol = vi_or(vi_shr(vi_and(cond, vi_set(MANUAL_MODE_CMD_MASK)), 6), vi_and(vi_shr(cond, 7), vi_set(0x3E)));
+		vi symbol = vi_sel(vi_gt(s, vi_set(AVOID_OBSTACLE_STATE)), autoSymbol, vi_and(cond, vi_set(FSM_MANUAL_SYMBOLS - 1)));
+
+		/* Transition */
+		vi e = vi_gather(entries, vi_add(vi_shl(s, FSM_SYMBOL_BITS), symbol));
+		vi valid = vi_gt(vi_shr(e, 24), zero);
+		vi actions = vi_and(vi_shr(e, 16), valid);
+		t = vi_andnot(vi_any(actions, FSM_ACT_RESET_TICKS), t);
+		latch = vi_or(latch, vi_any(actions, FSM_ACT_SET_LEFT_TRIPPED));
+		latch = vi_andnot(vi_any(actions, FSM_ACT_CLEAR_LEFT_TRIPPED), latch);
+		s = vi_sel(valid, vi_and(e, vi_set(0xFF)), s);
+		errors = vi_add(errors, vi_andnot(valid, one));
+
+		vi_store(&state[i], s);
+		vi_store(&tickCount[i], t);
+		vi_store(&leftTripped[i], latch);
+		vi_store(&outputCmd[i], vi_and(vi_and(vi_shr(e, 8), vi_set(0xFF)), valid));
+		vi_store(&input[i], zero);
+		vf_copy(&outputArg[i], &inputArg[i]);
+	}
+
+	/* Padding lanes past count always hold a valid state */
+	vi_store(lanes, errors);
+	for (i = 0, invalid = 0; i < LANES; i++) invalid += lanes[i];
+	return invalid;
+}
+
+#ifdef _MANAGED
+#pragma managed(pop)
+#endif
+
+StateMachineBatch::StateMachineBatch(int capacity) :
+	table(StateMachine::getDefaultTable()),
+	initialState(STOP_STATE),
+	count(0)
+{
+	allocate(capacity);
+}
+
+StateMachineBatch::StateMachineBatch(int capacity, const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS], int initialState) :
+	table(table),
+	initialState(initialState),
+	count(0)
+{
+	allocate(capacity);
+}
+
+void StateMachineBatch::allocate(int capacity)
+{
+	char* p;
+
+	/* Round up so stepAll() never has a partial SIMD step. Padding lanes are stepped and ignored. */
+	this->capacity = ((capacity + LANES - 1) / LANES) * LANES;
+
+	storage = calloc((size_t)7 * this->capacity, sizeof(int32_t));
+	if (storage == NULL) {
+		printf("ERROR: StateMachineBatch failed to allocate memory for %d machines.\n", capacity);
+		this->capacity = 0;
+	}
+
+	p = (char*)storage;
+#define NEXT_ARRAY(type) (type*)p; p += this->capacity * sizeof(int32_t)
+	state = NEXT_ARRAY(int32_t);
+	tickCount = NEXT_ARRAY(int32_t);
+	leftTripped = NEXT_ARRAY(int32_t);
+	input = NEXT_ARRAY(int32_t);
+	inputArg = NEXT_ARRAY(float);
+	outputCmd = NEXT_ARRAY(int32_t);
+	outputArg = NEXT_ARRAY(float);
+#undef NEXT_ARRAY
+
+	resetAll();
+}
+
+StateMachineBatch::~StateMachineBatch()
+{
+	free(storage);
+}
+
+int StateMachineBatch::getCapacity()
+{
+	return capacity;
+}
+
+int StateMachineBatch::getCount()
+{
+	return count;
+}
+
+void StateMachineBatch::setCount(int count)
+{
+	if (count < 0) count = 0;
+	if (count > capacity) count = capacity;
+	this->count = count;
+}
+
+void StateMachineBatch::resetMachine(int index)
+{
+	state[index] = initialState;
+	tickCount[index] = 0;
+	leftTripped[index] = 0;
+	input[index] = 0;
+	inputArg[index] = 0.0f;
+	outputCmd[index] = NULL_CMD;
+	outputArg[index] = 0.0f;
+}
+
+void StateMachineBatch::resetAll()
+{
+	int i;
+
+	for (i = 0; i < capacity; i++) resetMachine(i);
+}
+
+void StateMachineBatch::setInput(int index, uint16_t input, double arg)
+{
+	this->input[index] = input;
+	inputArg[index] = (float)arg;
+}
+
+int32_t* StateMachineBatch::getInputs()
+{
+	return input;
+}
+
+float* StateMachineBatch::getInputArgs()
+{
+	return inputArg;
+}
+
+int StateMachineBatch::getCurrentState(int index)
+{
+	return state[index];
+}
+
+int StateMachineBatch::getMode(int index)
+{
+	return StateMachine::stateMode(state[index]);
+}
+
+int StateMachineBatch::getOutputCmd(int index)
+{
+	return outputCmd[index];
+}
+
+double StateMachineBatch::getOutputArg(int index)
+{
+	return outputArg[index];
+}
+
+const int32_t* StateMachineBatch::getOutputCmds()
+{
+	return outputCmd;
+}
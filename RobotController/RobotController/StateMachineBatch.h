@@ -0,0 +1,79 @@
+/*****************************************************
+*	StateMachineBatch.h
+*
+*	Steps the controller state machine for many robots
+*	at once. State, tick count, left sensor latch and
+*	input of each machine are structure-of-arrays and
+*	the transition table (StateMachine::compileTransitions)
+*	is read with SIMD gathers (AVX2 when compiled with
+*	it, otherwise SSE2), so one call advances every
+*	machine by one step.
+*
+*	Each machine behaves as a StateMachine running the
+*	same table, except that the actions of the last step
+*	(StateMachine::getOutputActions) are not kept. The
+*	mode is not stored; it follows from the state
+*	(StateMachine::stateMode).
+*****************************************************/
+
+#pragma once
+
+#include "StateMachine.h"
+
+class StateMachineBatch
+{
+public:
+	/* Public Functions */
+	StateMachineBatch(int capacity);
+	/* Machines running a table built by compileTransitions, which must outlive the batch */
+	StateMachineBatch(int capacity, const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS], int initialState);
+	~StateMachineBatch();
+
+	int getCapacity();
+	int getCount();
+	void setCount(int count);
+
+	/* Back to the initial state with no input */
+	void resetMachine(int index);
+	void resetAll();
+
+	/* Input for the next step of one machine (StateMachine::setInput). Writers that already hold
+	 * the inputs as arrays can fill getInputs/getInputArgs directly. */
+	void setInput(int index, uint16_t input, double arg);
+	int32_t* getInputs();
+	float* getInputArgs();
+
+	/// <summary>
+	/// Step machines [0, count). timerTick applies to all of them (StateMachine::stepMachine).
+	/// Inputs are cleared afterwards.
+	/// </summary>
+	/// <returns>number of machines in a state the table does not define; they keep their state and output NULL_CMD</returns>
+	int stepAll(bool timerTick = true);
+
+	/* Results of the last stepAll() */
+	int getCurrentState(int index);
+	int getMode(int index);
+	int getOutputCmd(int index);
+	double getOutputArg(int index);
+	const int32_t* getOutputCmds();
+
+private:
+	/* Private Functions */
+	void allocate(int capacity);
+
+	/* Private Variables */
+	const fsmEntry (*table)[FSM_SYMBOLS];
+	int			initialState;
+	int			capacity;		// rounded up to a whole number of SIMD lanes
+	int			count;
+
+	int32_t*	state;
+	int32_t*	tickCount;
+	int32_t*	leftTripped;	// 0 or -1
+	int32_t*	input;
+	float*		inputArg;
+	int32_t*	outputCmd;
+	float*		outputArg;
+
+	void*		storage;
+};
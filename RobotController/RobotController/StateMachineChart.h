@@ -0,0 +1,127 @@
+/*****************************************************
+*	StateMachineChart.h
+*
+*	Generated by SlxImport from cps.slx, chart "Robot Model".
+*	Do not edit: change the model and run
+*	SlxImport again.
+*****************************************************/
+
+#pragma once
+
+#include "StateMachine.h"
+
+#define FSM_CHART_INITIAL_STATE	STOP_STATE
+
+#define FSM_CHART_MANUAL	(FSM_STATE_BIT(FORWARD_STATE) | FSM_STATE_BIT(FORWARD_L_STATE) | FSM_STATE_BIT(FORWARD_R_STATE) | FSM_STATE_BIT(STOP_STATE) | FSM_STATE_BIT(STOP_L_STATE) | FSM_STATE_BIT(STOP_R_STATE) | FSM_STATE_BIT(REVERSE_STATE) | FSM_STATE_BIT(REVERSE_L_STATE) | FSM_STATE_BIT(REVERSE_R_STATE) | FSM_STATE_BIT(AVOID_OBSTACLE_STATE))
+#define FSM_CHART_AUTO	(FSM_STATE_BIT(AUTO_FORWARD_STATE) | FSM_STATE_BIT(AUTO_REVERSE_STATE) | FSM_STATE_BIT(AUTO_TURN_L_STATE) | FSM_STATE_BIT(AUTO_TURN_R_STATE))
+#define FSM_CHART_MANUAL_STOP	(FSM_STATE_BIT(STOP_STATE) | FSM_STATE_BIT(STOP_L_STATE) | FSM_STATE_BIT(STOP_R_STATE))
+#define FSM_CHART_MANUAL_BACKWARD	(FSM_STATE_BIT(REVERSE_STATE) | FSM_STATE_BIT(REVERSE_L_STATE) | FSM_STATE_BIT(REVERSE_R_STATE))
+#define FSM_CHART_MANUAL_FORWARD	(FSM_STATE_BIT(FORWARD_STATE) | FSM_STATE_BIT(FORWARD_L_STATE) | FSM_STATE_BIT(FORWARD_R_STATE))
+
+static const fsmTransition fsmChartSpec[] = {
+	/* Manual -> Auto/Backward [auto==1 && (wall==1 || left_sensor==1 || right_sensor==1)] */
+	{ FSM_CHART_MANUAL, AUTO_MODE_CMD_MASK | FSM_COND_OBSTACLE, 0, 0, AUTO_REVERSE_STATE, REVERSE_CMD, FSM_ACT_RESET_TICKS },
+	/* Manual -> Auto (default Auto/Forward) [auto==1 && (wall==0 && left_sensor==0 && right_sensor==0)] */
+	{ FSM_CHART_MANUAL, AUTO_MODE_CMD_MASK, 0, FSM_COND_OBSTACLE, AUTO_FORWARD_STATE, FORWARD_CMD, 0 },
+	/* Auto -> Manual (default Manual/Stop) (default Manual/Stop/Stop) [manual==1] */
+	{ FSM_CHART_AUTO, MANUAL_MODE_CMD_MASK, 0, 0, STOP_STATE, STOP_CMD, 0 },
+	/* Manual/Avoid_Obstacle -> Manual/Stop (default Manual/Stop/Stop) [wall==0 && left_sensor==0 && right_sensor==0] */
+	{ FSM_STATE_BIT(AVOID_OBSTACLE_STATE), 0, 0, FSM_COND_OBSTACLE, STOP_STATE, STOP_CMD, 0 },
+	/* Manual/Stop -> Manual/Avoid_Obstacle [wall==1 || left_sensor==1 || right_sensor==1] */
+	{ FSM_CHART_MANUAL_STOP, FSM_COND_OBSTACLE, 0, 0, AVOID_OBSTACLE_STATE, REVERSE_CMD, 0 },
+	/* Manual/Stop -> Manual/Backward (default Manual/Backward/Backward) [backward==1] */
+	{ FSM_CHART_MANUAL_STOP, REVERSE_CMD_MASK, 0, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	/* Manual/Stop -> Manual/Forward (default Manual/Forward/Forward) [goforward==1] */
+	{ FSM_CHART_MANUAL_STOP, FORWARD_CMD_MASK, 0, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	/* Manual/Backward -> Manual/Avoid_Obstacle [wall==1 || left_sensor==1 || right_sensor==1] */
+	{ FSM_CHART_MANUAL_BACKWARD, FSM_COND_OBSTACLE, 0, 0, AVOID_OBSTACLE_STATE, REVERSE_CMD, 0 },
+	/* Manual/Backward -> Manual/Stop (default Manual/Stop/Stop) [stop==1] */
+	{ FSM_CHART_MANUAL_BACKWARD, STOP_CMD_MASK, 0, 0, STOP_STATE, STOP_CMD, 0 },
+	/* Manual/Backward -> Manual/Forward (default Manual/Forward/Forward) [goforward==1] */
+	{ FSM_CHART_MANUAL_BACKWARD, FORWARD_CMD_MASK, 0, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	/* Manual/Forward -> Manual/Stop (default Manual/Stop/Stop) [stop==1] */
+	{ FSM_CHART_MANUAL_FORWARD, STOP_CMD_MASK, 0, 0, STOP_STATE, STOP_CMD, 0 },
+	/* Manual/Forward -> Manual/Avoid_Obstacle [wall==1 || left_sensor==1 || right_sensor==1] */
+	{ FSM_CHART_MANUAL_FORWARD, FSM_COND_OBSTACLE, 0, 0, AVOID_OBSTACLE_STATE, REVERSE_CMD, 0 },
+	/* Manual/Forward -> Manual/Backward (default Manual/Backward/Backward) [backward==1] */
+	{ FSM_CHART_MANUAL_FORWARD, REVERSE_CMD_MASK, 0, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	/* Auto/Forward -> Auto/Backward [right_sensor==1 || wall==1 || left_sensor==1] */
+	{ FSM_STATE_BIT(AUTO_FORWARD_STATE), FSM_COND_OBSTACLE, 0, 0, AUTO_REVERSE_STATE, REVERSE_CMD, FSM_ACT_RESET_TICKS },
+	/* Auto/Backward -> Auto/TurnL [after(50,tick) && (left_sensor==0)] */
+	{ FSM_STATE_BIT(AUTO_REVERSE_STATE), FSM_COND_TURN_DONE, 0, FSM_COND_LEFT_SENSOR, AUTO_TURN_L_STATE, TURN_L_CMD, FSM_ACT_RESET_TICKS },
+	/* Auto/Backward -> Auto/TurnR [after(50,tick) && (left_sensor==1)] */
+	{ FSM_STATE_BIT(AUTO_REVERSE_STATE), FSM_COND_OBSTACLE | FSM_COND_LEFT_SENSOR | FSM_COND_TURN_DONE, 0, 0, AUTO_TURN_R_STATE, TURN_R_CMD, FSM_ACT_RESET_TICKS },
+	/* Auto/TurnL -> Auto/Forward [right_sensor==0 && wall==0 && left_sensor==0 && after(50,tick)] */
+	{ FSM_STATE_BIT(AUTO_TURN_L_STATE), FSM_COND_TURN_DONE, 0, FSM_COND_OBSTACLE | FSM_COND_LEFT_SENSOR, AUTO_FORWARD_STATE, FORWARD_CMD, 0 },
+	/* Auto/TurnL -> Auto/Backward [after(50,tick) && (right_sensor==1 || wall==1 || left_sensor==1)] */
+	{ FSM_STATE_BIT(AUTO_TURN_L_STATE), FSM_COND_OBSTACLE | FSM_COND_TURN_DONE, 0, 0, AUTO_REVERSE_STATE, REVERSE_CMD, FSM_ACT_RESET_TICKS },
+	/* Auto/TurnR -> Auto/Forward [right_sensor==0 && wall==0 && left_sensor==0 && after(50,tick)] */
+	{ FSM_STATE_BIT(AUTO_TURN_R_STATE), FSM_COND_TURN_DONE, 0, FSM_COND_OBSTACLE | FSM_COND_LEFT_SENSOR, AUTO_FORWARD_STATE, FORWARD_CMD, 0 },
+	/* Auto/TurnR -> Auto/Backward [after(50,tick) && (right_sensor==1 || wall==1 || left_sensor==1)] */
+	{ FSM_STATE_BIT(AUTO_TURN_R_STATE), FSM_COND_OBSTACLE | FSM_COND_TURN_DONE, 0, 0, AUTO_REVERSE_STATE, REVERSE_CMD, FSM_ACT_RESET_TICKS },
+	/* Manual/Stop/Stop -> Manual/Stop/TurnL [result>0] */
+	{ FSM_STATE_BIT(STOP_STATE), TURN_L_CMD_MASK, 0, 0, STOP_L_STATE, TURN_L_CMD, 0 },
+	/* Manual/Stop/Stop -> Manual/Stop/TurnR [result<0] */
+	{ FSM_STATE_BIT(STOP_STATE), TURN_R_CMD_MASK, 0, 0, STOP_R_STATE, TURN_R_CMD, 0 },
+	/* Manual/Stop/TurnL -> Manual/Stop/Stop [stopturn==1] */
+	{ FSM_STATE_BIT(STOP_L_STATE), STOP_TURN_CMD_MASK, 0, 0, STOP_STATE, STOP_CMD, 0 },
+	/* Manual/Stop/TurnL -> Manual/Stop/TurnR [result<0] */
+	{ FSM_STATE_BIT(STOP_L_STATE), TURN_R_CMD_MASK, 0, 0, STOP_R_STATE, TURN_R_CMD, 0 },
+	/* Manual/Stop/TurnR -> Manual/Stop/Stop [stopturn==1] */
+	{ FSM_STATE_BIT(STOP_R_STATE), STOP_TURN_CMD_MASK, 0, 0, STOP_STATE, STOP_CMD, 0 },
+	/* Manual/Stop/TurnR -> Manual/Stop/TurnL [result>0] */
+	{ FSM_STATE_BIT(STOP_R_STATE), TURN_L_CMD_MASK, 0, 0, STOP_L_STATE, TURN_L_CMD, 0 },
+	/* Manual/Backward/Backward -> Manual/Backward/TurnL [result>0] */
+	{ FSM_STATE_BIT(REVERSE_STATE), TURN_L_CMD_MASK, 0, 0, REVERSE_L_STATE, REVERSE_L_CMD, 0 },
+	/* Manual/Backward/Backward -> Manual/Backward/TurnR [result<0] */
+	{ FSM_STATE_BIT(REVERSE_STATE), TURN_R_CMD_MASK, 0, 0, REVERSE_R_STATE, REVERSE_R_CMD, 0 },
+	/* Manual/Backward/TurnL -> Manual/Backward/Backward [stopturn==1] */
+	{ FSM_STATE_BIT(REVERSE_L_STATE), STOP_TURN_CMD_MASK, 0, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	/* Manual/Backward/TurnL -> Manual/Backward/TurnR [result<0] */
+	{ FSM_STATE_BIT(REVERSE_L_STATE), TURN_R_CMD_MASK, 0, 0, REVERSE_R_STATE, REVERSE_R_CMD, 0 },
+	/* Manual/Backward/TurnR -> Manual/Backward/Backward [stopturn==1] */
+	{ FSM_STATE_BIT(REVERSE_R_STATE), STOP_TURN_CMD_MASK, 0, 0, REVERSE_STATE, REVERSE_CMD, 0 },
+	/* Manual/Backward/TurnR -> Manual/Backward/TurnL [result>0] */
+	{ FSM_STATE_BIT(REVERSE_R_STATE), TURN_L_CMD_MASK, 0, 0, REVERSE_L_STATE, REVERSE_L_CMD, 0 },
+	/* Manual/Forward/Forward -> Manual/Forward/TurnL [result>0] */
+	{ FSM_STATE_BIT(FORWARD_STATE), TURN_L_CMD_MASK, 0, 0, FORWARD_L_STATE, FORWARD_L_CMD, 0 },
+	/* Manual/Forward/Forward -> Manual/Forward/TurnR [result<0] */
+	{ FSM_STATE_BIT(FORWARD_STATE), TURN_R_CMD_MASK, 0, 0, FORWARD_R_STATE, FORWARD_R_CMD, 0 },
+	/* Manual/Forward/TurnL -> Manual/Forward/Forward [stopturn==1] */
+	{ FSM_STATE_BIT(FORWARD_L_STATE), STOP_TURN_CMD_MASK, 0, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	/* Manual/Forward/TurnL -> Manual/Forward/TurnR [result<0] */
+	{ FSM_STATE_BIT(FORWARD_L_STATE), TURN_R_CMD_MASK, 0, 0, FORWARD_R_STATE, FORWARD_R_CMD, 0 },
+	/* Manual/Forward/TurnR -> Manual/Forward/Forward [stopturn==1] */
+	{ FSM_STATE_BIT(FORWARD_R_STATE), STOP_TURN_CMD_MASK, 0, 0, FORWARD_STATE, FORWARD_CMD, 0 },
+	/* Manual/Forward/TurnR -> Manual/Forward/TurnL [result>0] */
+	{ FSM_STATE_BIT(FORWARD_R_STATE), TURN_L_CMD_MASK, 0, 0, FORWARD_L_STATE, FORWARD_L_CMD, 0 },
+	/* Manual/Avoid_Obstacle */
+	{ FSM_STATE_BIT(AVOID_OBSTACLE_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_CMD, 0 },
+	/* Manual/Stop/Stop */
+	{ FSM_STATE_BIT(STOP_STATE), 0, 0, 0, FSM_SAME_STATE, STOP_CMD, 0 },
+	/* Manual/Stop/TurnL */
+	{ FSM_STATE_BIT(STOP_L_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_L_CMD, 0 },
+	/* Manual/Stop/TurnR */
+	{ FSM_STATE_BIT(STOP_R_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_R_CMD, 0 },
+	/* Manual/Backward/Backward */
+	{ FSM_STATE_BIT(REVERSE_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_CMD, 0 },
+	/* Manual/Backward/TurnL */
+	{ FSM_STATE_BIT(REVERSE_L_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_L_CMD, 0 },
+	/* Manual/Backward/TurnR */
+	{ FSM_STATE_BIT(REVERSE_R_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_R_CMD, 0 },
+	/* Manual/Forward/Forward */
+	{ FSM_STATE_BIT(FORWARD_STATE), 0, 0, 0, FSM_SAME_STATE, FORWARD_CMD, 0 },
+	/* Manual/Forward/TurnL */
+	{ FSM_STATE_BIT(FORWARD_L_STATE), 0, 0, 0, FSM_SAME_STATE, FORWARD_L_CMD, 0 },
+	/* Manual/Forward/TurnR */
+	{ FSM_STATE_BIT(FORWARD_R_STATE), 0, 0, 0, FSM_SAME_STATE, FORWARD_R_CMD, 0 },
+	/* Auto/Forward */
+	{ FSM_STATE_BIT(AUTO_FORWARD_STATE), 0, 0, 0, FSM_SAME_STATE, FORWARD_CMD, 0 },
+	/* Auto/Backward */
+	{ FSM_STATE_BIT(AUTO_REVERSE_STATE), 0, 0, 0, FSM_SAME_STATE, REVERSE_CMD, 0 },
+	/* Auto/TurnL */
+	{ FSM_STATE_BIT(AUTO_TURN_L_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_L_CMD, 0 },
+	/* Auto/TurnR */
+	{ FSM_STATE_BIT(AUTO_TURN_R_STATE), 0, 0, 0, FSM_SAME_STATE, TURN_R_CMD, 0 },
+};
+#define FSM_CHART_SPEC_COUNT	(sizeof(fsmChartSpec) / sizeof(fsmChartSpec[0]))
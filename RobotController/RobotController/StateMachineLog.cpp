@@ -0,0 +1,389 @@
+/*****************************************************
+*	StateMachineLog.cpp
+*
+*	Binary trace of every state machine step, written
+*	asynchronously, and memory-mapped playback of it.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachineLog.h"
+#include "MappedLog.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define FSM_LOG_RING_MASK	(FSM_LOG_RING_RECORDS - 1)
+#define FSM_LOG_RING_WAKE	(FSM_LOG_RING_RECORDS / 2)	// queued records that wake the writer thread early
+
+/* Ordered load/store of the ring positions, and increment of the counters */
+#ifdef _WIN32
+static inline int32_t counterLoad(fsmLogCounter* c) { int32_t v = *c; MemoryBarrier(); return v; }
+static inline void counterStore(fsmLogCounter* c, int32_t v) { MemoryBarrier(); *c = v; }
+static inline void counterIncrement(fsmLogCounter* c) { InterlockedIncrement(c); }
+#else
+static inline int32_t counterLoad(fsmLogCounter* c) { return __atomic_load_n(c, __ATOMIC_ACQUIRE); }
+static inline void counterStore(fsmLogCounter* c, int32_t v) { __atomic_store_n(c, v, __ATOMIC_RELEASE); }
+static inline void counterIncrement(fsmLogCounter* c) { __sync_fetch_and_add(c, 1); }
+#endif
+
+StateMachineLogWriter::StateMachineLogWriter() :
+	fp(NULL),
+	head(0),
+	tail(0),
+	running(0),
+	dropped(0),
+	sequence(0),
+	failed(0)
+#ifdef _WIN32
+	, thread(NULL)
+	, wakeEvent(NULL)
+#else
+	, threadStarted(false)
+#endif
+{
+}
+
+StateMachineLogWriter::~StateMachineLogWriter()
+{
+	Close();
+}
+
+int StateMachineLogWriter::Open(const char* path, const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS], int tableID, int initialState)
+{
+	fsmLogHeader header;
+
+	Close();
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) {
+		printf("ERROR: StateMachineLogWriter::Open could not create %s.\n", path);
+		return -1;
+	}
+
+	memset(&header, 0x00, sizeof(header));
+	header.magic = FSM_LOG_MAGIC;
+	header.version = FSM_LOG_VERSION;
+	header.headerSize = sizeof(fsmLogHeader);
+	header.recordSize = sizeof(fsmLogRecord);
+	header.tableHash = tableHash(table);
+	header.table = (uint8_t)tableID;
+	header.initialState = (uint8_t)initialState;
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+		printf("ERROR: StateMachineLogWriter::Open failed to write header.\n");
+		fclose(fp);
+		fp = NULL;
+		return -1;
+	}
+
+	head = 0;
+	tail = 0;
+	dropped = 0;
+	sequence = 0;
+	failed = 0;
+	running = 1;
+
+#ifdef _WIN32
+	wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (wakeEvent != NULL) thread = CreateThread(NULL, 0, writerThread, (LPVOID)this, 0, NULL);
+	if (thread == NULL) {
+#else
+	threadStarted = (pthread_create(&thread, NULL, writerThread, (void*)this) == 0);
+	if (!threadStarted) {
+#endif
+		printf("ERROR: StateMachineLogWriter::Open could not start the writer thread.\n");
+		running = 0;
+		Close();
+		return -1;
+	}
+
+	return 0;
+}
+
+int StateMachineLogWriter::Log(int64_t time, uint16_t input, double arg, int flags, int stateBefore, int state, int output)
+{
+	fsmLogRecord* r;
+	int32_t position, queued;
+
+	if (!counterLoad(&running)) return -1;
+
+	position = head;
+	sequence++;
+	queued = (int32_t)((uint32_t)position - (uint32_t)counterLoad(&tail));
+	if (queued >= FSM_LOG_RING_RECORDS || counterLoad(&failed)) {
+		counterIncrement(&dropped);
+		return -1;
+	}
+
+	r = &ring[position & FSM_LOG_RING_MASK];
+	r->time = time;
+	r->arg = arg;
+	r->sequence = sequence;
+	r->input = input;
+	r->stateBefore = (uint8_t)stateBefore;
+	r->state = (uint8_t)state;
+	r->output = (uint8_t)output;
+	r->flags = (uint8_t)flags;
+	memset(r->reserved, 0x00, sizeof(r->reserved));
+
+	/* Publish the record to the writer thread */
+	counterStore(&head, (int32_t)((uint32_t)position + 1));
+#ifdef _WIN32
+	if (queued + 1 == FSM_LOG_RING_WAKE) SetEvent(wakeEvent);
+#endif
+	return 0;
+}
+
+/* Write the records queued so far. Returns -1 when a write fails. */
+int StateMachineLogWriter::writeQueued()
+{
+	int32_t first, last;
+	uint32_t count, chunk, index;
+
+	first = tail;
+	last = counterLoad(&head);
+	count = (uint32_t)last - (uint32_t)first;
+	while (count > 0) {
+		/* Up to the end of the ring, then from its start */
+		index = (uint32_t)first & FSM_LOG_RING_MASK;
+		chunk = (count < FSM_LOG_RING_RECORDS - index) ? count : FSM_LOG_RING_RECORDS - index;
+		if (!failed && fwrite(&ring[index], sizeof(fsmLogRecord), chunk, fp) != chunk) {
+			printf("ERROR: StateMachineLogWriter write failed. State machine logging stopped.\n");
+			counterStore(&failed, 1);
+		}
+		first = (int32_t)((uint32_t)first + chunk);
+		count -= chunk;
+		counterStore(&tail, first);
+	}
+	if (!failed) fflush(fp);
+	return failed ? -1 : 0;
+}
+
+#ifdef _WIN32
+DWORD WINAPI StateMachineLogWriter::writerThread(LPVOID param)
+{
+	StateMachineLogWriter* log = (StateMachineLogWriter*)param;
+
+	while (counterLoad(&log->running)) {
+		WaitForSingleObject(log->wakeEvent, FSM_LOG_FLUSH_MS);
+		log->writeQueued();
+	}
+	log->writeQueued();
+	return 0;
+}
+#else
+void* StateMachineLogWriter::writerThread(void* param)
+{
+	StateMachineLogWriter* log = (StateMachineLogWriter*)param;
+	int waited;
+
+	while (counterLoad(&log->running)) {
+		/* Check for Close and a half full ring every millisecond */
+		for (waited = 0; waited < FSM_LOG_FLUSH_MS && counterLoad(&log->running) && log->getQueued() < FSM_LOG_RING_WAKE; waited++) {
+			usleep(1000);
+		}
+		log->writeQueued();
+	}
+	log->writeQueued();
+	return NULL;
+}
+#endif
+
+void StateMachineLogWriter::Close()
+{
+	counterStore(&running, 0);
+
+#ifdef _WIN32
+	if (thread != NULL) {
+		SetEvent(wakeEvent);
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+		thread = NULL;
+	}
+	if (wakeEvent != NULL) {
+		CloseHandle(wakeEvent);
+		wakeEvent = NULL;
+	}
+#else
+	if (threadStarted) {
+		pthread_join(thread, NULL);
+		threadStarted = false;
+	}
+#endif
+
+	if (fp != NULL) {
+		fclose(fp);
+		fp = NULL;
+	}
+}
+
+bool StateMachineLogWriter::isOpen()
+{
+	return (fp != NULL);
+}
+
+uint32_t StateMachineLogWriter::getLogged()
+{
+	return (uint32_t)counterLoad(&tail);
+}
+
+uint32_t StateMachineLogWriter::getDropped()
+{
+	return (uint32_t)counterLoad(&dropped);
+}
+
+int StateMachineLogWriter::getQueued()
+{
+	return (int)((uint32_t)counterLoad(&head) - (uint32_t)counterLoad(&tail));
+}
+
+uint32_t StateMachineLogWriter::tableHash(const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS])
+{
+	const uint8_t* bytes = (const uint8_t*)table;
+	uint32_t hash;
+	size_t i;
+
+	hash = 2166136261u;
+	for (i = 0; i < sizeof(fsmEntry) * FSM_STATE_CODES * FSM_SYMBOLS; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+StateMachineLogReader::StateMachineLogReader() :
+	base(NULL),
+	mapSize(0),
+	recordCount(0)
+#ifdef _WIN32
+	, hFile(INVALID_HANDLE_VALUE)
+	, hMapping(NULL)
+#else
+	, fd(-1)
+#endif
+{
+}
+
+StateMachineLogReader::~StateMachineLogReader()
+{
+	Close();
+}
+
+int StateMachineLogReader::Open(const char* path)
+{
+	const fsmLogHeader* header;
+	int64_t count;
+
+	Close();
+
+#ifdef _WIN32
+	LARGE_INTEGER size;
+
+	hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		printf("ERROR: StateMachineLogReader::Open could not open %s.\n", path);
+		return -1;
+	}
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart < (LONGLONG)sizeof(fsmLogHeader)) {
+		printf("ERROR: StateMachineLogReader::Open %s is not a state machine log.\n", path);
+		Close();
+		return -1;
+	}
+	mapSize = (uint64_t)size.QuadPart;
+
+	hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (hMapping == NULL) {
+		printf("ERROR: StateMachineLogReader::Open CreateFileMapping error: %d\n", GetLastError());
+		Close();
+		return -1;
+	}
+	base = (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (base == NULL) {
+		printf("ERROR: StateMachineLogReader::Open MapViewOfFile error: %d\n", GetLastError());
+		Close();
+		return -1;
+	}
+#else
+	struct stat st;
+	void* map;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		printf("ERROR: StateMachineLogReader::Open could not open %s.\n", path);
+		return -1;
+	}
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(fsmLogHeader)) {
+		printf("ERROR: StateMachineLogReader::Open %s is not a state machine log.\n", path);
+		Close();
+		return -1;
+	}
+	mapSize = (uint64_t)st.st_size;
+
+	map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		printf("ERROR: StateMachineLogReader::Open mmap failed.\n");
+		mapSize = 0;
+		Close();
+		return -1;
+	}
+	madvise(map, mapSize, MADV_SEQUENTIAL);
+	base = (const char*)map;
+#endif
+
+	header = (const fsmLogHeader*)base;
+	if (header->magic != FSM_LOG_MAGIC || header->version != FSM_LOG_VERSION ||
+		header->recordSize != sizeof(fsmLogRecord) || header->headerSize < sizeof(fsmLogHeader)) {
+		printf("ERROR: StateMachineLogReader::Open %s has an unsupported format.\n", path);
+		Close();
+		return -1;
+	}
+
+	count = mappedLogRecordCount(mapSize, header->headerSize, sizeof(fsmLogRecord));
+	if (count < 0) {
+		printf("ERROR: StateMachineLogReader::Open %s is truncated or corrupt.\n", path);
+		Close();
+		return -1;
+	}
+	recordCount = (uint64_t)count;
+	return 0;
+}
+
+void StateMachineLogReader::Close()
+{
+#ifdef _WIN32
+	if (base != NULL) UnmapViewOfFile(base);
+	if (hMapping != NULL) CloseHandle(hMapping);
+	if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+	hMapping = NULL;
+	hFile = INVALID_HANDLE_VALUE;
+#else
+	if (base != NULL) munmap((void*)base, mapSize);
+	if (fd != -1) close(fd);
+	fd = -1;
+#endif
+	base = NULL;
+	mapSize = 0;
+	recordCount = 0;
+}
+
+const fsmLogHeader* StateMachineLogReader::getHeader()
+{
+	return (const fsmLogHeader*)base;
+}
+
+uint64_t StateMachineLogReader::getRecordCount()
+{
+	return recordCount;
+}
+
+const fsmLogRecord* StateMachineLogReader::getRecord(uint64_t index)
+{
+	if (index >= recordCount) return NULL;
+
+	return (const fsmLogRecord*)(base + ((const fsmLogHeader*)base)->headerSize + index * sizeof(fsmLogRecord));
+}
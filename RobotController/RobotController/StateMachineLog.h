@@ -0,0 +1,163 @@
+/*****************************************************
+*	StateMachineLog.h
+*
+*	Binary trace of every state machine step: input,
+*	argument and step time going in, state and command
+*	coming out. StateMachineReplay (RobotController/
+*	Tools) steps a StateMachine through a trace and
+*	lists every step where it now does something else.
+*
+*	The stepping thread only copies each record into a
+*	lock-free single producer, single consumer ring; a
+*	writer thread moves the ring to disk every
+*	FSM_LOG_FLUSH_MS, or as soon as it is half full.
+*	When the ring is full the record is dropped and
+*	counted, never waited for.
+*
+*	File layout: one fsmLogHeader followed by fixed-size
+*	fsmLogRecord records, as in SkeletonLog. The record
+*	count is derived from file size so a log cut short
+*	by a crash is still readable up to the last full
+*	record.
+*****************************************************/
+
+#pragma once
+
+#include "StateMachine.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define FSM_LOG_MAGIC			0x4C4D5346		// "FSML"
+#define FSM_LOG_VERSION			1
+#define FSM_LOG_RING_RECORDS	4096			// power of two
+#define FSM_LOG_FLUSH_MS		100
+
+/* Record flags: how the step was taken */
+#define FSM_LOG_STEP_AT			0x01	// stepMachineAt(time), else stepMachine
+#define FSM_LOG_TIMER_TICK		0x02	// stepMachine(true)
+
+/* Machines a log can be replayed against */
+#define FSM_LOG_TABLE_BUILT_IN	0
+#define FSM_LOG_TABLE_CHART		1		// StateMachineChart.h, RobotController -chart
+#define FSM_LOG_TABLE_WALL_FOLLOW	2		// StateMachine::getWallFollowTable, RobotController -wallfollow
+
+typedef struct {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	headerSize;
+	uint32_t	recordSize;
+	uint32_t	tableHash;		// StateMachineLogWriter::tableHash of the table that was running
+	uint8_t		table;			// FSM_LOG_TABLE_*
+	uint8_t		initialState;
+	uint16_t	reserved;
+}fsmLogHeader;
+
+typedef struct {
+	int64_t		time;			// step time: stepMachineAt time, else LatencyTrace::Now()
+	double		arg;			// setInput argument
+	uint32_t	sequence;		// counts every step, so dropped records show as a gap
+	uint16_t	input;			// setInput input
+	uint8_t		stateBefore;
+	uint8_t		state;			// after the step
+	uint8_t		output;			// getOutputCmd
+	uint8_t		flags;			// FSM_LOG_*
+	uint8_t		reserved[6];
+}fsmLogRecord;
+
+#ifdef _WIN32
+typedef volatile LONG	fsmLogCounter;
+#else
+typedef volatile int32_t	fsmLogCounter;
+#endif
+
+class StateMachineLogWriter
+{
+public:
+	/* Public Functions */
+	StateMachineLogWriter();
+	~StateMachineLogWriter();
+
+	/* Create the log for a machine running table from initialState and start the writer thread */
+	int Open(const char* path, const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS], int tableID, int initialState);
+
+	/// <summary>
+	/// Queue one step for writing. Only one thread may log. Never blocks.
+	/// </summary>
+	/// <returns>0 on success, -1 if the log is closed or the ring is full and the record was dropped</returns>
+	int Log(int64_t time, uint16_t input, double arg, int flags, int stateBefore, int state, int output);
+
+	/* Stop the writer thread after it has written everything queued */
+	void Close();
+	bool isOpen();
+
+	/* Records written to disk, dropped, and waiting in the ring */
+	uint32_t getLogged();
+	uint32_t getDropped();
+	int getQueued();
+
+	/* FNV-1a hash of a compiled table, to tell whether a log was recorded with the machine it is replayed against */
+	static uint32_t tableHash(const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS]);
+
+private:
+	/* Private Functions */
+#ifdef _WIN32
+	static DWORD WINAPI writerThread(LPVOID param);
+#else
+	static void* writerThread(void* param);
+#endif
+	int writeQueued();
+
+	/* Private Variables */
+	FILE*			fp;
+	fsmLogRecord	ring[FSM_LOG_RING_RECORDS];
+	fsmLogCounter	head;			// next record to fill, written by Log only
+	fsmLogCounter	tail;			// next record to write, written by the writer thread only
+	fsmLogCounter	running;
+	fsmLogCounter	dropped;
+	uint32_t		sequence;
+	fsmLogCounter	failed;			// a write failed, later records are dropped
+
+#ifdef _WIN32
+	HANDLE			thread;
+	HANDLE			wakeEvent;		// half full, or closing
+#else
+	pthread_t		thread;
+	bool			threadStarted;
+#endif
+};
+
+class StateMachineLogReader
+{
+public:
+	/* Public Functions */
+	StateMachineLogReader();
+	~StateMachineLogReader();
+
+	int Open(const char* path);
+	void Close();
+	const fsmLogHeader* getHeader();
+	uint64_t getRecordCount();
+
+	/* Returns pointer into the mapped file. Valid until Close(). */
+	const fsmLogRecord* getRecord(uint64_t index);
+
+private:
+	/* Private Variables */
+	const char*		base;
+	uint64_t		mapSize;
+	uint64_t		recordCount;
+
+#ifdef _WIN32
+	HANDLE			hFile;
+	HANDLE			hMapping;
+#else
+	int				fd;
+#endif
+};
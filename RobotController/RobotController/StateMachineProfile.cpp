@@ -0,0 +1,159 @@
+/*****************************************************
+*	StateMachineProfile.cpp
+*
+*	State coverage and dwell time profile of a running
+*	StateMachine.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachineProfile.h"
+
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+static const char* profileStateNames[FSM_STATE_CODES] = {
+	"NULL_STATE", "FORWARD_STATE", "FORWARD_L_STATE", "FORWARD_R_STATE", "STOP_STATE", "STOP_L_STATE", "STOP_R_STATE",
+	"REVERSE_STATE", "REVERSE_L_STATE", "REVERSE_R_STATE", "", "", "", "", "", "", "AVOID_OBSTACLE_STATE",
+	"AUTO_FORWARD_STATE", "AUTO_REVERSE_STATE", "AUTO_TURN_L_STATE", "AUTO_TURN_R_STATE",
+	"WALL_FOLLOW_STATE"
+};
+
+/* Ordered load/store of the sequence number. The writer is a single thread, so a plain increment will do. */
+#ifdef _WIN32
+static inline int32_t sequenceLoad(fsmProfileSequence* s) { int32_t v = *s; MemoryBarrier(); return v; }
+static inline void sequenceStore(fsmProfileSequence* s, int32_t v) { MemoryBarrier(); *s = v; MemoryBarrier(); }
+static inline void fenceLoads() { MemoryBarrier(); }
+static inline void yieldThread() { SwitchToThread(); }
+#else
+static inline int32_t sequenceLoad(fsmProfileSequence* s) { return __atomic_load_n(s, __ATOMIC_ACQUIRE); }
+static inline void sequenceStore(fsmProfileSequence* s, int32_t v) { __atomic_store_n(s, v, __ATOMIC_RELEASE); __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void fenceLoads() { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+static inline void yieldThread() { sched_yield(); }
+#endif
+
+StateMachineProfile::StateMachineProfile()
+{
+	sequence = 0;
+	Clear();
+}
+
+void StateMachineProfile::Record(int from, int to, int64_t time)
+{
+	int32_t s;
+
+	if (from < 0 || from >= FSM_STATE_CODES || to < 0 || to >= FSM_STATE_CODES) return;
+
+	s = (int32_t)sequence;
+	sequenceStore(&sequence, s + 1);
+
+	if (counters.steps == 0) {
+		start = time;
+		since = time;
+		counters.state = from;
+		counters.entries[from]++;
+	}
+	if (time < since) time = since;
+	counters.steps++;
+	counters.elapsed = time - start;
+	if (to != counters.state) {
+		counters.dwell[counters.state].Record(time - since);
+		counters.timeIn[counters.state] += time - since;
+		counters.changes[counters.state][to]++;
+		counters.entries[to]++;
+		counters.state = to;
+		since = time;
+	}
+
+	sequenceStore(&sequence, s + 2);
+}
+
+void StateMachineProfile::getSnapshot(fsmProfileSnapshot* snapshot)
+{
+	int32_t before;
+
+	while (1) {
+		before = sequenceLoad(&sequence);
+		if (before & 1) {
+			yieldThread();
+			continue;
+		}
+		*snapshot = counters;
+		fenceLoads();
+		if (sequenceLoad(&sequence) == before) break;
+	}
+
+	/* The current visit up to the last step */
+	if (snapshot->steps > 0) snapshot->timeIn[snapshot->state] += start + snapshot->elapsed - since;
+}
+
+void StateMachineProfile::Print(FILE* out, const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS])
+{
+	fsmProfileSnapshot* p;
+	double minutes;
+	int from, to, symbol, symbols, never;
+	bool allowed;
+
+	/* Too large for the console handler's stack */
+	p = (fsmProfileSnapshot*)malloc(sizeof(fsmProfileSnapshot));
+	if (p == NULL) {
+		printf("ERROR: Could not allocate the state machine profile snapshot.\n");
+		return;
+	}
+	getSnapshot(p);
+	minutes = p->elapsed / 60e6;
+
+	fprintf(out, "State machine profile: %llu steps over %.1f s, now in %s\n", (unsigned long long)p->steps,
+		p->elapsed / 1e6, profileStateNames[p->state]);
+	fprintf(out, "State                    entries   time %%  dwell (ms) p50        p99        max\n");
+	for (from = 0; from < FSM_STATE_CODES; from++) {
+		if (p->entries[from] == 0) continue;
+		fprintf(out, "%-22s %9lu %8.1f %14.1f %10.1f %10.1f\n", profileStateNames[from], (unsigned long)p->entries[from],
+			(p->elapsed > 0) ? 100.0 * p->timeIn[from] / p->elapsed : 0.0, p->dwell[from].getPercentile(0.50) / 1000.0,
+			p->dwell[from].getPercentile(0.99) / 1000.0, p->dwell[from].getMax() / 1000.0);
+	}
+
+	fprintf(out, "Changes of state                              count   per minute\n");
+	for (from = 0; from < FSM_STATE_CODES; from++) {
+		for (to = 0; to < FSM_STATE_CODES; to++) {
+			if (p->changes[from][to] == 0) continue;
+			fprintf(out, "%-20s -> %-20s %9lu %12.2f\n", profileStateNames[from], profileStateNames[to],
+				(unsigned long)p->changes[from][to], (minutes > 0.0) ? p->changes[from][to] / minutes : 0.0);
+		}
+	}
+
+	if (table != NULL) {
+		never = 0;
+		fprintf(out, "Changes of state never taken:\n");
+		for (from = 0; from < FSM_STATE_CODES; from++) {
+			if (!table[from][0].valid) continue;
+			symbols = (StateMachine::stateMode(from) == AUTO_MODE) ? FSM_AUTO_SYMBOLS : FSM_MANUAL_SYMBOLS;
+			for (to = 0; to < FSM_STATE_CODES; to++) {
+				if (to == from || p->changes[from][to] != 0) continue;
+				allowed = false;
+				for (symbol = 0; symbol < symbols && !allowed; symbol++) allowed = (table[from][symbol].next == to);
+				if (!allowed) continue;
+				fprintf(out, "%-20s -> %s\n", profileStateNames[from], profileStateNames[to]);
+				never++;
+			}
+		}
+		if (never == 0) fprintf(out, "(none)\n");
+	}
+	free(p);
+}
+
+void StateMachineProfile::Clear()
+{
+	int i;
+
+	counters.steps = 0;
+	counters.elapsed = 0;
+	counters.state = 0;
+	memset(counters.changes, 0x00, sizeof(counters.changes));
+	memset(counters.entries, 0x00, sizeof(counters.entries));
+	memset(counters.timeIn, 0x00, sizeof(counters.timeIn));
+	for (i = 0; i < FSM_STATE_CODES; i++) counters.dwell[i].Clear();
+	start = 0;
+	since = 0;
+}
@@ -0,0 +1,69 @@
+/*****************************************************
+*	StateMachineProfile.h
+*
+*	State coverage and dwell time profile of a running
+*	StateMachine: how often each change of state
+*	happens, how long each visit to a state lasts, and
+*	which changes of state the table allows but never
+*	took. Attached with StateMachine::setProfile, it is
+*	updated by every step.
+*
+*	The stepping thread is the only writer; the counters
+*	sit behind a sequence number (a seqlock), so
+*	getSnapshot on any other thread retries until it
+*	copies them between two steps instead of making the
+*	step wait on a lock.
+*****************************************************/
+
+#pragma once
+
+#include "StateMachine.h"
+#include "LatencyTrace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Consistent copy of the profile. Times are microseconds of state machine time (stepMachineAt times, or
+ * STATE_MACHINE_TICK_TIME_US per timer tick). */
+typedef struct {
+	uint64_t			steps;
+	int64_t				elapsed;										// first step to last step
+	int					state;											// current state
+	uint32_t			changes[FSM_STATE_CODES][FSM_STATE_CODES];		// [from][to] changes of state
+	uint32_t			entries[FSM_STATE_CODES];						// visits, including the first state
+	int64_t				timeIn[FSM_STATE_CODES];						// including the current visit so far
+	LatencyHistogram	dwell[FSM_STATE_CODES];							// length of each completed visit
+}fsmProfileSnapshot;
+
+#ifdef _WIN32
+typedef volatile LONG	fsmProfileSequence;
+#else
+typedef volatile int32_t	fsmProfileSequence;
+#endif
+
+class StateMachineProfile
+{
+public:
+	StateMachineProfile();
+
+	/* Called by StateMachine after each step from state from to state to, at time */
+	void Record(int from, int to, int64_t time);
+
+	/* Copy the profile as it was between two steps. Any thread may call it. */
+	void getSnapshot(fsmProfileSnapshot* snapshot);
+
+	/// <summary>
+	/// Print time and dwell per state, the changes of state taken with their rate, and the changes of
+	/// state table allows that were never taken (table may be NULL to skip them)
+	/// </summary>
+	void Print(FILE* out, const fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS]);
+
+	/* Not safe while the machine is stepped */
+	void Clear();
+
+private:
+	fsmProfileSequence	sequence;		// odd while Record is writing
+	fsmProfileSnapshot	counters;
+	int64_t				start;
+	int64_t				since;			// time the current state was entered
+};
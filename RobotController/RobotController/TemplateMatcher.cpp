@@ -0,0 +1,488 @@
+/*****************************************************
+*	TemplateMatcher.cpp
+*
+*	DTW template matching with LB_Keogh pruning.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "TemplateMatcher.h"
+#include "StateMachineDefs.h"
+
+#include <cfloat>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TEMPLATE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEMPLATE_SSE2
+#endif
+
+#define TEMPLATE_LINE_LENGTH		512
+
+typedef struct {
+	const char*	name;
+	uint16_t	command;
+}templateCommandName;
+
+static const templateCommandName templateCommandNames[] = {
+	{ "stop", STOP_CMD_MASK },
+	{ "forward", FORWARD_CMD_MASK },
+	{ "reverse", REVERSE_CMD_MASK },
+	{ "turn_l", TURN_L_CMD_MASK },
+	{ "turn_r", TURN_R_CMD_MASK },
+	{ "stop_turn", STOP_TURN_CMD_MASK },
+	{ "manual", MANUAL_MODE_CMD_MASK },
+	{ "auto", AUTO_MODE_CMD_MASK },
+};
+#define TEMPLATE_COMMAND_NAMES	(sizeof(templateCommandNames) / sizeof(templateCommandNames[0]))
+
+/* SIMD kernels must be compiled as native code when building with /clr */
+#ifdef _MANAGED
+#pragma managed(push, off)
+#endif
+
+/*****************************************************
+*	Per-frame kernels over TEMPLATE_FEATURES (8) floats
+*****************************************************/
+#if defined(TEMPLATE_AVX2)
+
+static inline float hsum8(__m256 v)
+{
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+/* Squared Euclidean distance between two feature vectors */
+static inline float dist8(const float* a, const float* b)
+{
+	__m256 d = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+	return hsum8(_mm256_mul_ps(d, d));
+}
+
+/* Squared distance from a feature vector to the [lower, upper] envelope */
+static inline float envelope8(const float* q, const float* upper, const float* lower)
+{
+	__m256 v = _mm256_loadu_ps(q);
+	__m256 zero = _mm256_setzero_ps();
+	__m256 d = _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(v, _mm256_loadu_ps(upper)), zero),
+		_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(lower), v), zero));
+	return hsum8(_mm256_mul_ps(d, d));
+}
+
+#elif defined(TEMPLATE_SSE2)
+
+static inline float hsum4(__m128 s)
+{
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+static inline float dist8(const float* a, const float* b)
+{
+	__m128 d0 = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+	__m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + 4), _mm_loadu_ps(b + 4));
+	return hsum4(_mm_add_ps(_mm_mul_ps(d0, d0), _mm_mul_ps(d1, d1)));
+}
+
+static inline float envelope8(const float* q, const float* upper, const float* lower)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 v0 = _mm_loadu_ps(q), v1 = _mm_loadu_ps(q + 4);
+	__m128 d0 = _mm_add_ps(_mm_max_ps(_mm_sub_ps(v0, _mm_loadu_ps(upper)), zero), _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lower), v0), zero));
+	__m128 d1 = _mm_add_ps(_mm_max_ps(_mm_sub_ps(v1, _mm_loadu_ps(upper + 4)), zero), _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lower + 4), v1), zero));
+	return hsum4(_mm_add_ps(_mm_mul_ps(d0, d0), _mm_mul_ps(d1, d1)));
+}
+
+#else
+
+static inline float dist8(const float* a, const float* b)
+{
+	float sum = 0.0f, d;
+	int k;
+
+	for (k = 0; k < TEMPLATE_FEATURES; k++) {
+		d = a[k] - b[k];
+		sum += d * d;
+	}
+	return sum;
+}
+
+static inline float envelope8(const float* q, const float* upper, const float* lower)
+{
+	float sum = 0.0f, d;
+	int k;
+
+	for (k = 0; k < TEMPLATE_FEATURES; k++) {
+		d = (q[k] > upper[k]) ? q[k] - upper[k] : ((q[k] < lower[k]) ? lower[k] - q[k] : 0.0f);
+		sum += d * d;
+	}
+	return sum;
+}
+
+#endif
+
+float TemplateMatcher::lbKeogh(const float* query, const gestureTemplate & t, float limit)
+{
+	float sum = 0.0f;
+	int i;
+
+	for (i = 0; i < t.length; i++) {
+		sum += envelope8(&query[i * TEMPLATE_FEATURES], &t.upper[i * TEMPLATE_FEATURES], &t.lower[i * TEMPLATE_FEATURES]);
+		if (sum > limit) break;
+	}
+	return sum;
+}
+
+float TemplateMatcher::dtwDistance(const float* query, const gestureTemplate & t, float limit)
+{
+	/* Two rows of the cost matrix, query frame i against template frames j - band .. j + band */
+	float rows[2][TEMPLATE_MAX_LENGTH];
+	float* prev = rows[0];
+	float* cur = rows[1];
+	float* swap;
+	float best, rowMin, c;
+	int i, j, lo, hi, prevLo, prevHi;
+	const int n = t.length;
+	const int r = t.band;
+
+	prevLo = 0;
+	prevHi = -1;
+	for (i = 0; i < n; i++) {
+		lo = (i - r > 0) ? i - r : 0;
+		hi = (i + r < n - 1) ? i + r : n - 1;
+		rowMin = FLT_MAX;
+		for (j = lo; j <= hi; j++) {
+			if (i == 0 && j == 0) {
+				best = 0.0f;
+			}
+			else {
+				best = FLT_MAX;
+				if (j > lo && cur[j - 1] < best) best = cur[j - 1];
+				if (j >= prevLo && j <= prevHi && prev[j] < best) best = prev[j];
+				if (j - 1 >= prevLo && j - 1 <= prevHi && prev[j - 1] < best) best = prev[j - 1];
+			}
+			c = (best == FLT_MAX) ? FLT_MAX : best + dist8(&query[i * TEMPLATE_FEATURES], &t.frames[j * TEMPLATE_FEATURES]);
+			cur[j] = c;
+			if (c < rowMin) rowMin = c;
+		}
+
+		/* Every warping path crosses this row, so none can finish under limit */
+		if (rowMin > limit) return rowMin;
+
+		swap = prev;
+		prev = cur;
+		cur = swap;
+		prevLo = lo;
+		prevHi = hi;
+	}
+	return prev[n - 1];
+}
+
+#ifdef _MANAGED
+#pragma managed(pop)
+#endif
+
+TemplateLibrary::TemplateLibrary() :
+	count(0),
+	maxLength(0)
+{
+	memset(templates, 0x00, sizeof(templates));
+}
+
+TemplateLibrary::~TemplateLibrary()
+{
+	Clear();
+}
+
+int TemplateLibrary::addTemplate(uint16_t command, const float* frames, int length, float threshold)
+{
+	gestureTemplate* t;
+	int i, j, k, lo, hi;
+
+	if (count >= TEMPLATE_MAX_COUNT) {
+		printf("ERROR: TemplateLibrary::addTemplate library is full (%d templates).\n", TEMPLATE_MAX_COUNT);
+		return -1;
+	}
+	if (length < TEMPLATE_MIN_LENGTH || length > TEMPLATE_MAX_LENGTH || threshold <= 0.0f) {
+		printf("ERROR: TemplateLibrary::addTemplate invalid template (length %d, threshold %f).\n", length, threshold);
+		return -1;
+	}
+
+	t = &templates[count];
+	t->command = command;
+	t->length = length;
+	t->threshold = threshold;
+	t->band = length * TEMPLATE_WARP_PERCENT / 100;
+	if (t->band < TEMPLATE_MIN_WARP) t->band = TEMPLATE_MIN_WARP;
+	t->frames = new float[length * TEMPLATE_FEATURES];
+	t->upper = new float[length * TEMPLATE_FEATURES];
+	t->lower = new float[length * TEMPLATE_FEATURES];
+	memcpy(t->frames, frames, length * TEMPLATE_FEATURES * sizeof(float));
+
+	/* Envelope of every frame the warping band lets query frame i align with */
+	for (i = 0; i < length; i++) {
+		lo = (i - t->band > 0) ? i - t->band : 0;
+		hi = (i + t->band < length - 1) ? i + t->band : length - 1;
+		for (k = 0; k < TEMPLATE_FEATURES; k++) {
+			t->upper[i * TEMPLATE_FEATURES + k] = frames[lo * TEMPLATE_FEATURES + k];
+			t->lower[i * TEMPLATE_FEATURES + k] = frames[lo * TEMPLATE_FEATURES + k];
+			for (j = lo + 1; j <= hi; j++) {
+				if (frames[j * TEMPLATE_FEATURES + k] > t->upper[i * TEMPLATE_FEATURES + k]) t->upper[i * TEMPLATE_FEATURES + k] = frames[j * TEMPLATE_FEATURES + k];
+				if (frames[j * TEMPLATE_FEATURES + k] < t->lower[i * TEMPLATE_FEATURES + k]) t->lower[i * TEMPLATE_FEATURES + k] = frames[j * TEMPLATE_FEATURES + k];
+			}
+		}
+	}
+
+	if (length > maxLength) maxLength = length;
+	count++;
+	return 0;
+}
+
+int TemplateLibrary::Load(const char* path)
+{
+	FILE* fp;
+	char line[TEMPLATE_LINE_LENGTH];
+	char name[32];
+	float frames[TEMPLATE_MAX_LENGTH * TEMPLATE_FEATURES];
+	float threshold;
+	float* f;
+	int length, row, lineNumber, loaded;
+	uint16_t command;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		printf("ERROR: TemplateLibrary::Load could not open %s.\n", path);
+		return -1;
+	}
+
+	lineNumber = 0;
+	loaded = 0;
+	length = 0;
+	row = 0;
+	command = NULL_CMD_MASK;
+	threshold = 0.0f;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineNumber++;
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == '\0') continue;
+
+		if (row < length) {
+			f = &frames[row * TEMPLATE_FEATURES];
+			if (sscanf(line, "%f %f %f %f %f %f %f %f", &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &f[6], &f[7]) != TEMPLATE_FEATURES) {
+				printf("ERROR: TemplateLibrary::Load %s line %d: expected %d features.\n", path, lineNumber, TEMPLATE_FEATURES);
+				fclose(fp);
+				return -1;
+			}
+			if (++row == length) {
+				if (addTemplate(command, frames, length, threshold) != 0) {
+					fclose(fp);
+					return -1;
+				}
+				loaded++;
+			}
+			continue;
+		}
+
+		if (sscanf(line, "template %31s %d %f", name, &length, &threshold) != 3) {
+			printf("ERROR: TemplateLibrary::Load %s line %d: expected \"template <command> <length> <threshold>\".\n", path, lineNumber);
+			fclose(fp);
+			return -1;
+		}
+		command = parseCommand(name);
+		if (command == NULL_CMD_MASK || length < TEMPLATE_MIN_LENGTH || length > TEMPLATE_MAX_LENGTH) {
+			printf("ERROR: TemplateLibrary::Load %s line %d: bad command or length.\n", path, lineNumber);
+			fclose(fp);
+			return -1;
+		}
+		row = 0;
+	}
+	fclose(fp);
+
+	if (row < length) {
+		printf("ERROR: TemplateLibrary::Load %s: last template is truncated.\n", path);
+		return -1;
+	}
+
+	printf("Loaded %d gesture templates from %s.\n", loaded, path);
+	return 0;
+}
+
+int TemplateLibrary::Save(const char* path)
+{
+	FILE* fp;
+	int i, j, k;
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		printf("ERROR: TemplateLibrary::Save could not create %s.\n", path);
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		fprintf(fp, "template %s %d %f\n", commandName(templates[i].command), templates[i].length, templates[i].threshold);
+		for (j = 0; j < templates[i].length; j++) {
+			for (k = 0; k < TEMPLATE_FEATURES; k++) {
+				fprintf(fp, (k == 0) ? "%.4f" : " %.4f", templates[i].frames[j * TEMPLATE_FEATURES + k]);
+			}
+			fprintf(fp, "\n");
+		}
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+void TemplateLibrary::Clear()
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		delete[] templates[i].frames;
+		delete[] templates[i].upper;
+		delete[] templates[i].lower;
+	}
+	memset(templates, 0x00, sizeof(templates));
+	count = 0;
+	maxLength = 0;
+}
+
+int TemplateLibrary::getCount() const
+{
+	return count;
+}
+
+int TemplateLibrary::getMaxLength() const
+{
+	return maxLength;
+}
+
+const gestureTemplate* TemplateLibrary::getTemplate(int index) const
+{
+	return (index >= 0 && index < count) ? &templates[index] : NULL;
+}
+
+void TemplateLibrary::extractFeatures(const skeletonData & skeleton, float* features)
+{
+	gestureFeatures f;
+
+	computeFeatures(skeleton, &f);
+	extractFeatures(f, features);
+}
+
+void TemplateLibrary::extractFeatures(const gestureFeatures & joints, float* features)
+{
+	static const int featureJoints[TEMPLATE_FEATURES / 2] = {
+		SKELETON_POSITION_HAND_RIGHT, SKELETON_POSITION_HAND_LEFT, SKELETON_POSITION_ELBOW_RIGHT, SKELETON_POSITION_ELBOW_LEFT
+	};
+	int i;
+
+	for (i = 0; i < TEMPLATE_FEATURES / 2; i++) {
+		features[2 * i] = joints.x[featureJoints[i]];
+		features[2 * i + 1] = joints.y[featureJoints[i]];
+	}
+}
+
+uint16_t TemplateLibrary::parseCommand(const char* name)
+{
+	size_t i;
+
+	for (i = 0; i < TEMPLATE_COMMAND_NAMES; i++) {
+		if (strcmp(name, templateCommandNames[i].name) == 0) return templateCommandNames[i].command;
+	}
+	return NULL_CMD_MASK;
+}
+
+const char* TemplateLibrary::commandName(uint16_t command)
+{
+	size_t i;
+
+	for (i = 0; i < TEMPLATE_COMMAND_NAMES; i++) {
+		if (command == templateCommandNames[i].command) return templateCommandNames[i].name;
+	}
+	return "none";
+}
+
+TemplateMatcher::TemplateMatcher()
+{
+	memset(window, 0x00, sizeof(window));
+	Reset();
+}
+
+void TemplateMatcher::Push(const float* features)
+{
+	memcpy(&window[head * TEMPLATE_FEATURES], features, TEMPLATE_FEATURES * sizeof(float));
+	memcpy(&window[(head + TEMPLATE_MAX_LENGTH) * TEMPLATE_FEATURES], features, TEMPLATE_FEATURES * sizeof(float));
+	head = (head + 1) % TEMPLATE_MAX_LENGTH;
+	if (filled < TEMPLATE_MAX_LENGTH) filled++;
+}
+
+void TemplateMatcher::Reset()
+{
+	head = 0;
+	filled = 0;
+	lastDistance = 0.0f;
+	lastPruned = 0;
+	lastComputed = 0;
+}
+
+uint16_t TemplateMatcher::Match(const TemplateLibrary & library)
+{
+	const gestureTemplate* t;
+	const float* query;
+	float best, limit, d;
+	uint16_t command;
+	int i;
+
+	lastPruned = 0;
+	lastComputed = 0;
+	lastDistance = FLT_MAX;
+	best = FLT_MAX;
+	command = NULL_CMD_MASK;
+
+	for (i = 0; i < library.getCount(); i++) {
+		t = library.getTemplate(i);
+		if (t->length > filled) continue;
+
+		/* Newest t->length frames. Distances are compared per template frame so templates of different lengths rank fairly. */
+		query = &window[(head + TEMPLATE_MAX_LENGTH - t->length) * TEMPLATE_FEATURES];
+		limit = ((best < t->threshold) ? best : t->threshold) * (float)t->length;
+
+		if (lbKeogh(query, *t, limit) > limit) {
+			lastPruned++;
+			continue;
+		}
+
+		lastComputed++;
+		d = dtwDistance(query, *t, limit);
+		if (d <= limit) {
+			best = d / (float)t->length;
+			command = t->command;
+		}
+	}
+
+	if (command != NULL_CMD_MASK) {
+		lastDistance = best;
+		head = 0;
+		filled = 0;
+	}
+	return command;
+}
+
+float TemplateMatcher::getLastDistance()
+{
+	return lastDistance;
+}
+
+int TemplateMatcher::getLastPruned()
+{
+	return lastPruned;
+}
+
+int TemplateMatcher::getLastComputed()
+{
+	return lastComputed;
+}
@@ -0,0 +1,125 @@
+/*****************************************************
+*	TemplateMatcher.h
+*
+*	Template gesture recognition. Recorded exemplars of
+*	a gesture (joint trajectories) are compared against
+*	the most recent frames of a skeleton using dynamic
+*	time warping, so the same motion performed faster,
+*	slower or by a different operator still matches.
+*
+*	LB_Keogh lower bounds discard most templates before
+*	the full DTW is computed, and the per-frame distance
+*	kernels run in SIMD lanes (AVX2 when compiled with
+*	it, otherwise SSE2).
+*
+*	Template file (text):
+*		template <command> <length> <threshold>
+*		<TEMPLATE_FEATURES floats>		x length lines
+*	command is stop, forward, reverse, turn_l, turn_r,
+*	stop_turn, manual or auto. Lines starting with #
+*	are comments.
+*****************************************************/
+
+#pragma once
+
+#include "GestureFeatures.h"
+#include "SkeletonDefs.h"
+
+/* Per-frame feature vector: right hand, left hand, right elbow, left elbow (x, y)
+ * relative to the shoulder center, in shoulder widths (see GestureFeatures.h) */
+#define TEMPLATE_FEATURES		8
+
+#define TEMPLATE_MAX_LENGTH		64		// frames, about 2 s at 30 fps
+#define TEMPLATE_MIN_LENGTH		4
+#define TEMPLATE_MAX_COUNT		128
+#define TEMPLATE_WARP_PERCENT	10		// Sakoe-Chiba band as a percent of template length
+#define TEMPLATE_MIN_WARP		2		// frames
+
+typedef struct {
+	uint16_t	command;
+	int			length;
+	int			band;			// frames of warping allowed
+	float		threshold;		// largest mean per-frame distance that counts as a match
+	float*		frames;			// length x TEMPLATE_FEATURES
+	float*		upper;			// LB_Keogh envelope over the warping band
+	float*		lower;
+}gestureTemplate;
+
+class TemplateLibrary
+{
+public:
+	/* Public Functions */
+	TemplateLibrary();
+	~TemplateLibrary();
+
+	/// <summary>
+	/// Add one exemplar
+	/// </summary>
+	/// <returns>0 on success, -1 on failure</returns>
+	int addTemplate(uint16_t command, const float* frames, int length, float threshold);
+
+	/* Template file I/O, see file header for format. Load appends to the library. */
+	int Load(const char* path);
+	int Save(const char* path);
+	void Clear();
+
+	int getCount() const;
+	int getMaxLength() const;
+	const gestureTemplate* getTemplate(int index) const;
+
+	/// <summary>
+	/// Feature vector of one skeleton, TEMPLATE_FEATURES floats
+	/// </summary>
+	static void extractFeatures(const skeletonData & skeleton, float* features);
+	static void extractFeatures(const gestureFeatures & joints, float* features);
+
+	/* Command names used in template files. Returns 0 for an unknown name. */
+	static uint16_t parseCommand(const char* name);
+	static const char* commandName(uint16_t command);
+
+private:
+	gestureTemplate		templates[TEMPLATE_MAX_COUNT];
+	int					count;
+	int					maxLength;
+};
+
+/* Sliding window of one skeleton's recent features, matched against a TemplateLibrary */
+class TemplateMatcher
+{
+public:
+	/* Public Functions */
+	TemplateMatcher();
+
+	void Push(const float* features);
+	void Reset();
+
+	/// <summary>
+	/// Compare the window against every template. The window is cleared after a match so
+	/// one motion is reported once.
+	/// </summary>
+	/// <returns>command of the closest template under its threshold, NULL_CMD_MASK if none</returns>
+	uint16_t Match(const TemplateLibrary & library);
+
+	/* Statistics of the last Match() */
+	float getLastDistance();
+	int getLastPruned();
+	int getLastComputed();
+
+	/// <summary>
+	/// DTW distance (sum of squared feature distances along the warping path) between the
+	/// last template->length frames and the template, or a value above limit once it is
+	/// certain to exceed limit
+	/// </summary>
+	static float dtwDistance(const float* query, const gestureTemplate & t, float limit);
+	static float lbKeogh(const float* query, const gestureTemplate & t, float limit);
+
+private:
+	/* Each frame is stored twice, TEMPLATE_MAX_LENGTH apart, so the newest frames are always contiguous */
+	float		window[2 * TEMPLATE_MAX_LENGTH * TEMPLATE_FEATURES];
+	int			head;			// slot the next frame goes to
+	int			filled;			// frames in window
+
+	float		lastDistance;
+	int			lastPruned;
+	int			lastComputed;
+};
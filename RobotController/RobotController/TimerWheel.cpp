@@ -0,0 +1,142 @@
+/*****************************************************
+*	TimerWheel.cpp
+*
+*	Hashed timing wheel for the controller's deadlines.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "TimerWheel.h"
+
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SLOTS - 1)
+
+static inline int64_t slotTime(int64_t t)
+{
+	/* Floor, also for negative times */
+	return (t >= 0) ? t / TIMER_WHEEL_RESOLUTION : -((-t + TIMER_WHEEL_RESOLUTION - 1) / TIMER_WHEEL_RESOLUTION);
+}
+
+TimerWheel::TimerWheel(int64_t now)
+{
+	int i;
+
+	cursor = slotTime(now);
+	for (i = 0; i < TIMER_WHEEL_SLOTS; i++) slots[i] = -1;
+	for (i = 0; i < TIMER_WHEEL_TIMERS; i++) {
+		deadlines[i] = TIMER_WHEEL_NEVER;
+		slotOf[i] = -1;
+		next[i] = -1;
+		prev[i] = -1;
+		scheduled[i] = false;
+	}
+}
+
+int TimerWheel::Schedule(int timer, int64_t deadline)
+{
+	int64_t t;
+	int slot;
+
+	if (timer < 0 || timer >= TIMER_WHEEL_TIMERS) {
+		printf("ERROR: Unknown timer %d.\n", timer);
+		return -1;
+	}
+	if (scheduled[timer]) unlink(timer);
+
+	/* Past deadlines go in the cursor slot so the next Expire finds them */
+	t = slotTime(deadline);
+	if (t < cursor) t = cursor;
+	slot = (int)(t & TIMER_WHEEL_MASK);
+
+	deadlines[timer] = deadline;
+	slotOf[timer] = (int16_t)slot;
+	prev[timer] = -1;
+	next[timer] = slots[slot];
+	if (slots[slot] >= 0) prev[slots[slot]] = (int8_t)timer;
+	slots[slot] = (int8_t)timer;
+	scheduled[timer] = true;
+	return 0;
+}
+
+void TimerWheel::Cancel(int timer)
+{
+	if (timer < 0 || timer >= TIMER_WHEEL_TIMERS || !scheduled[timer]) return;
+	unlink(timer);
+}
+
+bool TimerWheel::isScheduled(int timer)
+{
+	return timer >= 0 && timer < TIMER_WHEEL_TIMERS && scheduled[timer];
+}
+
+void TimerWheel::unlink(int timer)
+{
+	if (prev[timer] >= 0) next[prev[timer]] = next[timer];
+	else slots[slotOf[timer]] = next[timer];
+	if (next[timer] >= 0) prev[next[timer]] = prev[timer];
+	slotOf[timer] = -1;
+	next[timer] = -1;
+	prev[timer] = -1;
+	scheduled[timer] = false;
+	deadlines[timer] = TIMER_WHEEL_NEVER;
+}
+
+int64_t TimerWheel::nextDeadline()
+{
+	int64_t best;
+	int i, s, timer;
+
+	/* The first slot holding a deadline within one turn of the cursor has the earliest one */
+	for (s = 0; s < TIMER_WHEEL_SLOTS; s++) {
+		best = TIMER_WHEEL_NEVER;
+		for (timer = slots[(cursor + s) & TIMER_WHEEL_MASK]; timer >= 0; timer = next[timer]) {
+			if (slotTime(deadlines[timer]) <= cursor + s && deadlines[timer] < best) best = deadlines[timer];
+		}
+		if (best != TIMER_WHEEL_NEVER) return best;
+	}
+
+	/* Only deadlines more than a turn ahead */
+	best = TIMER_WHEEL_NEVER;
+	for (i = 0; i < TIMER_WHEEL_TIMERS; i++) {
+		if (scheduled[i] && deadlines[i] < best) best = deadlines[i];
+	}
+	return best;
+}
+
+int TimerWheel::Expire(int64_t now, int64_t* deadline)
+{
+	int64_t end;
+	int timer, due;
+
+	end = slotTime(now);
+	if (end < cursor) return -1;
+	if (end - cursor >= TIMER_WHEEL_SLOTS) {
+		/* More than a turn since the last call, so any slot may hold due timers */
+		due = -1;
+		for (timer = 0; timer < TIMER_WHEEL_TIMERS; timer++) {
+			if (scheduled[timer] && deadlines[timer] <= now && (due < 0 || deadlines[timer] < deadlines[due])) due = timer;
+		}
+		if (due >= 0) {
+			*deadline = deadlines[due];
+			unlink(due);
+			return due;
+		}
+		cursor = end;
+		return -1;
+	}
+
+	/* Visit each slot from the cursor to now */
+	for (; cursor <= end; cursor++) {
+		due = -1;
+		for (timer = slots[cursor & TIMER_WHEEL_MASK]; timer >= 0; timer = next[timer]) {
+			if (deadlines[timer] <= now && (due < 0 || deadlines[timer] < deadlines[due])) due = timer;
+		}
+		if (due >= 0) {
+			*deadline = deadlines[due];
+			unlink(due);
+			return due;
+		}
+	}
+	/* Stay on the current slot, it may still get deadlines before its end */
+	cursor = end;
+	return -1;
+}
@@ -0,0 +1,62 @@
+/*****************************************************
+*	TimerWheel.h
+*
+*	Hashed timing wheel for the controller's deadlines.
+*	A timer is kept in the slot of its deadline modulo
+*	the wheel size, so arming and cancelling are O(1)
+*	and expiring only visits the slots the clock has
+*	passed since the last call. Deadlines more than one
+*	turn of the wheel ahead wait in their slot until
+*	the clock reaches them.
+*
+*	Times are microseconds on the LatencyTrace::Now()
+*	clock. Timers are identified by a small integer
+*	chosen by the caller (TIMER_WHEEL_TIMERS of them).
+*****************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define TIMER_WHEEL_SLOTS		256		// power of two
+#define TIMER_WHEEL_TIMERS		8
+#define TIMER_WHEEL_RESOLUTION	1000	// us per slot
+#define TIMER_WHEEL_NEVER		INT64_MAX
+
+class TimerWheel
+{
+public:
+	/* Wheel whose clock starts at now */
+	TimerWheel(int64_t now);
+
+	/* Arm a timer, moving it if it is already armed. Deadlines in the past expire on the next Expire call. */
+	int Schedule(int timer, int64_t deadline);
+	void Cancel(int timer);
+	bool isScheduled(int timer);
+
+	/// <summary>
+	/// Earliest deadline of all armed timers, to sleep until
+	/// </summary>
+	/// <returns>deadline, or TIMER_WHEEL_NEVER when no timer is armed</returns>
+	int64_t nextDeadline();
+
+	/// <summary>
+	/// Disarm and return the armed timer with the earliest deadline at or before now. Call repeatedly
+	/// until it returns -1; timers come out in deadline order.
+	/// </summary>
+	/// <returns>timer, or -1 when no timer is due</returns>
+	int Expire(int64_t now, int64_t* deadline);
+
+private:
+	/* Private Functions */
+	void unlink(int timer);
+
+	/* Private Variables */
+	int64_t		cursor;							// slot time (deadline / TIMER_WHEEL_RESOLUTION) of the first slot not yet expired
+	int8_t		slots[TIMER_WHEEL_SLOTS];		// first timer in each slot, -1 for none
+	int64_t		deadlines[TIMER_WHEEL_TIMERS];
+	int16_t		slotOf[TIMER_WHEEL_TIMERS];
+	int8_t		next[TIMER_WHEEL_TIMERS];
+	int8_t		prev[TIMER_WHEEL_TIMERS];
+	bool		scheduled[TIMER_WHEEL_TIMERS];
+};
@@ -0,0 +1,122 @@
+/*****************************************************
+*	UdpSkeletonSource.cpp
+*
+*	Skeleton frames received as UDP datagrams.
+*****************************************************/
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "WS2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netdb.h>
+#include <unistd.h>
+#define INVALID_SOCKET	-1
+#define closesocket		close
+#endif
+
+#include "UdpSkeletonSource.h"
+
+#include <cstdio>
+#include <cstring>
+
+UdpSkeletonSource::UdpSkeletonSource(const char* port) :
+	port(port),
+	socket_fd((uintptr_t)INVALID_SOCKET),
+	opened(false)
+{
+}
+
+UdpSkeletonSource::~UdpSkeletonSource()
+{
+	Close();
+}
+
+int UdpSkeletonSource::Open()
+{
+	struct addrinfo hints, *servinfo, *p;
+	int rv;
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		printf("ERROR: UdpSkeletonSource WSAStartup failed.\n");
+		return -1;
+	}
+#endif
+	opened = true;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_PASSIVE;
+
+	if ((rv = getaddrinfo(NULL, port, &hints, &servinfo)) != 0) {
+		printf("ERROR: UdpSkeletonSource getaddrinfo: %s\n", gai_strerror(rv));
+		return -1;
+	}
+
+	// loop through all the results and bind to the first we can
+	for (p = servinfo; p != NULL; p = p->ai_next) {
+		socket_fd = (uintptr_t)socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+		if (socket_fd == (uintptr_t)INVALID_SOCKET) {
+			continue;
+		}
+		if (bind(socket_fd, p->ai_addr, (int)p->ai_addrlen) != 0) {
+			closesocket(socket_fd);
+			socket_fd = (uintptr_t)INVALID_SOCKET;
+			continue;
+		}
+		break;
+	}
+	freeaddrinfo(servinfo);
+
+	if (p == NULL) {
+		printf("ERROR: UdpSkeletonSource failed to bind UDP port %s.\n", port);
+		return -1;
+	}
+
+	printf("Listening for skeleton frames on UDP port %s.\n", port);
+	return 0;
+}
+
+int UdpSkeletonSource::GetNextFrame(skeletonFrame* frame, int timeout_ms)
+{
+	fd_set readfds;
+	struct timeval tv;
+	int rv;
+
+	if (socket_fd == (uintptr_t)INVALID_SOCKET) return SKELETON_SOURCE_ERROR;
+
+	FD_ZERO(&readfds);
+	FD_SET(socket_fd, &readfds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	rv = select((int)socket_fd + 1, &readfds, NULL, NULL, &tv);
+	if (rv == 0) return SKELETON_SOURCE_TIMEOUT;
+	if (rv < 0) return SKELETON_SOURCE_ERROR;
+
+	rv = recv(socket_fd, (char*)frame, sizeof(skeletonFrame), 0);
+	if (rv != (int)sizeof(skeletonFrame)) {
+		printf("ERROR: UdpSkeletonSource received datagram of unexpected size (%d).\n", rv);
+		return SKELETON_SOURCE_TIMEOUT;
+	}
+
+	return SKELETON_SOURCE_FRAME;
+}
+
+void UdpSkeletonSource::Close()
+{
+	if (socket_fd != (uintptr_t)INVALID_SOCKET) {
+		closesocket(socket_fd);
+		socket_fd = (uintptr_t)INVALID_SOCKET;
+	}
+#ifdef _WIN32
+	if (opened) WSACleanup();
+#endif
+	opened = false;
+}
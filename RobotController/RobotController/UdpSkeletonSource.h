@@ -0,0 +1,30 @@
+/*****************************************************
+*	UdpSkeletonSource.h
+*
+*	Skeleton frames received as UDP datagrams, one raw
+*	skeletonFrame per datagram. Stand-in for a remote
+*	or simulated sensor, and a way to load test the
+*	recognizer from another machine.
+*****************************************************/
+
+#pragma once
+
+#include "SkeletonSource.h"
+
+class UdpSkeletonSource : public SkeletonSource
+{
+public:
+	/* Public Functions */
+	UdpSkeletonSource(const char* port);
+	~UdpSkeletonSource();
+
+	int Open();
+	int GetNextFrame(skeletonFrame* frame, int timeout_ms);
+	void Close();
+
+private:
+	/* Private Variables */
+	const char*		port;
+	uintptr_t		socket_fd;		// SOCKET on Windows, file descriptor elsewhere
+	bool			opened;
+};
@@ -0,0 +1,106 @@
+/*****************************************************
+*	WallFollower.cpp
+*
+*	Proportional wall and edge following on the raw
+*	sensor ranges.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "WallFollower.h"
+
+#define WALL_FOLLOW_SEEK_CYCLE	(WALL_FOLLOW_SEEK_STEPS + WALL_FOLLOW_PEEL_STEPS)
+
+/* How far into its range the wall sensor sees a wall, 0 (none) to 1 (at the minimum range) */
+static double wallProximity(double range)
+{
+	if (!(range >= WALL_FOLLOW_WALL_MIN_RANGE) || !(range < WALL_FOLLOW_WALL_RANGE)) return 0.0;
+	return (WALL_FOLLOW_WALL_RANGE - range) / (WALL_FOLLOW_WALL_RANGE - WALL_FOLLOW_WALL_MIN_RANGE);
+}
+
+/* How far a cliff sensor reads past the floor, 0 (floor) to 1 (at or past the trip range, or nothing in range) */
+static double edgeDepth(double range)
+{
+	if (range == 0.0) return 0.0;
+	if (!(range < TILT_SENSOR_TRIP_RANGE)) return 1.0;
+	if (range <= WALL_FOLLOW_FLOOR_RANGE) return 0.0;
+	return (range - WALL_FOLLOW_FLOOR_RANGE) / (TILT_SENSOR_TRIP_RANGE - WALL_FOLLOW_FLOOR_RANGE);
+}
+
+WallFollower::WallFollower()
+{
+	side = WALL_FOLLOW_RIGHT;
+	turn = 0.0;
+	unseenSteps = WALL_FOLLOW_SEEK_CYCLES * WALL_FOLLOW_SEEK_CYCLE;
+	avoidSteps = 0;
+	avoidTurn = 0.0;
+}
+
+void WallFollower::setSide(int side)
+{
+	this->side = (side == WALL_FOLLOW_LEFT) ? WALL_FOLLOW_LEFT : WALL_FOLLOW_RIGHT;
+}
+
+int WallFollower::getSide()
+{
+	return side;
+}
+
+void WallFollower::Reset()
+{
+	turn = 0.0;
+	unseenSteps = WALL_FOLLOW_SEEK_CYCLES * WALL_FOLLOW_SEEK_CYCLE;
+	avoidSteps = 0;
+	avoidTurn = 0.0;
+}
+
+double WallFollower::getTurn()
+{
+	return turn;
+}
+
+int WallFollower::Update(const gazeboSensorData & ranges, bool tooClose, double* turnAngle)
+{
+	double wall, edgeL, edgeR, followed, seek, avoid, target;
+
+	wall = wallProximity(ranges.sensor_ranges[WALL_ID % GAZEBO_SENSOR_BASE]);
+	edgeL = WALL_FOLLOW_FRONT_WEIGHT * edgeDepth(ranges.sensor_ranges[LEFTFRONT_ID % GAZEBO_SENSOR_BASE]) +
+		(1.0 - WALL_FOLLOW_FRONT_WEIGHT) * edgeDepth(ranges.sensor_ranges[LEFT_ID % GAZEBO_SENSOR_BASE]);
+	edgeR = WALL_FOLLOW_FRONT_WEIGHT * edgeDepth(ranges.sensor_ranges[RIGHTFRONT_ID % GAZEBO_SENSOR_BASE]) +
+		(1.0 - WALL_FOLLOW_FRONT_WEIGHT) * edgeDepth(ranges.sensor_ranges[RIGHT_ID % GAZEBO_SENSOR_BASE]);
+	followed = (side == WALL_FOLLOW_RIGHT) ? edgeR : edgeL;
+	if (wall > followed) followed = wall;
+
+	/* Seek only for a while after losing the boundary, a steady turn in open floor just circles */
+	if (followed > 0.0) unseenSteps = 0;
+	else if (unseenSteps < WALL_FOLLOW_SEEK_CYCLES * WALL_FOLLOW_SEEK_CYCLE) unseenSteps++;
+	if (unseenSteps >= WALL_FOLLOW_SEEK_CYCLES * WALL_FOLLOW_SEEK_CYCLE) seek = 0.0;
+	else if (unseenSteps % WALL_FOLLOW_SEEK_CYCLE < WALL_FOLLOW_SEEK_STEPS) seek = WALL_FOLLOW_SEEK_TURN;
+	else seek = -WALL_FOLLOW_PEEL_TURN;
+
+	/* Positive turns left. A right side follower turns left, away from the wall, and seeks right.
+	 * An edge seen on both sides (straight ahead) turns it away from the followed side as a wall does. */
+	avoid = WALL_FOLLOW_EDGE_GAIN * (edgeR - edgeL + side * fmin(edgeL, edgeR)) + side * WALL_FOLLOW_WALL_GAIN * wall;
+	target = avoid - side * seek * (1.0 - followed);
+	if (target > WALL_FOLLOW_MAX_TURN) target = WALL_FOLLOW_MAX_TURN;
+	else if (target < -WALL_FOLLOW_MAX_TURN) target = -WALL_FOLLOW_MAX_TURN;
+
+	/* Too close: hold a full turn away from what the ranges show, or from the followed side when they show
+	 * nothing, without the seek term that may be what balanced the turn into the dead band */
+	if (tooClose) {
+		if (avoidSteps == 0) avoidTurn = (avoid > 0.0 || (avoid == 0.0 && side == WALL_FOLLOW_RIGHT)) ? WALL_FOLLOW_MAX_TURN : -WALL_FOLLOW_MAX_TURN;
+		avoidSteps = WALL_FOLLOW_AVOID_STEPS + 1;
+	}
+	if (avoidSteps > 0) {
+		avoidSteps--;
+		turn = avoidTurn;
+	}
+	else turn += WALL_FOLLOW_SMOOTHING * (target - turn);
+
+	if (fabs(turn) < WALL_FOLLOW_DEADBAND) {
+		*turnAngle = 0.0;
+		return FORWARD_CMD;
+	}
+	*turnAngle = turn;
+	return (turn > 0.0) ? FORWARD_L_CMD : FORWARD_R_CMD;
+}
@@ -0,0 +1,103 @@
+/*****************************************************
+*	WallFollower.h
+*
+*	Proportional steering for the wall following mode
+*	(WALL_FOLLOW_STATE, RobotController -wallfollow).
+*	Works on the raw gazeboSensorData ranges rather than
+*	the WALL/LEFT/RIGHT bits the listener thread makes
+*	of them, so the robot keeps moving forward and turns
+*	harder the closer it gets to a wall or floor edge.
+*
+*	Every step the turn is the sum of
+*	  - the wall term: turning away from the followed
+*		side in proportion to how far into its range
+*		the wall sensor sees a wall,
+*	  - the edge term: turning away from the side whose
+*		cliff sensors read further than the floor, the
+*		front ones weighted more as they see an edge
+*		first, and away from the followed side for an
+*		edge both sides see,
+*	  - the seek term: a weave toward the followed side,
+*		fading out as the wall or edge comes into view,
+*		so the robot closes back in on the boundary it
+*		follows rather than leaving it. Each cycle turns
+*		in for WALL_FOLLOW_SEEK_STEPS and back out for
+*		WALL_FOLLOW_PEEL_STEPS, so a wall too shallow
+*		for the wall sensor is left again rather than
+*		scraped along. It stops WALL_FOLLOW_SEEK_CYCLES
+*		after the boundary was last seen and the robot
+*		drives straight across open floor to the next
+*		one,
+*	low-pass filtered and sent as FORWARD_L_CMD or
+*	FORWARD_R_CMD with the turn as the argument.
+*
+*	A tripped obstacle sensor (FSM_ACT_TOO_CLOSE from
+*	the wall following table) means the robot got too
+*	close: it turns away at WALL_FOLLOW_MAX_TURN for
+*	WALL_FOLLOW_AVOID_STEPS, as the proportional terms
+*	alone can balance against the seek term and leave
+*	it pinned in a corner.
+*
+*	Gains tuned with WallFollowSim (Tools) on the
+*	figure8 and test_world courses, for the least wall
+*	contact over runs of 2 to 60 minutes on either side.
+*****************************************************/
+
+#pragma once
+
+#include "GazeboDefs.h"
+
+#include "stdafx.h"
+
+/* Side kept against the wall or edge */
+#define WALL_FOLLOW_RIGHT			1
+#define WALL_FOLLOW_LEFT			-1
+
+/* Sensor ranges, meters */
+#define WALL_FOLLOW_WALL_MIN_RANGE	0.010		// wall sensor minimum, a wall at or closer than this reads fully near
+#define WALL_FOLLOW_WALL_RANGE		0.040		// wall sensor maximum, steering starts here
+#define WALL_FOLLOW_FLOOR_RANGE		0.027		// cliff sensor over level floor, an edge reads from here to TILT_SENSOR_TRIP_RANGE
+
+/* Steering, radians of turn argument (positive left, as GESTURE_MAX_TURN_L) */
+#define WALL_FOLLOW_MAX_TURN		(PI/2)		// GESTURE_MAX_TURN_L
+#define WALL_FOLLOW_WALL_GAIN		(PI/2)		// at a wall at WALL_FOLLOW_WALL_MIN_RANGE
+#define WALL_FOLLOW_EDGE_GAIN		(PI/2)		// with both cliff sensors of one side over an edge
+#define WALL_FOLLOW_FRONT_WEIGHT	0.7			// share of the front cliff sensor in its side's edge term
+#define WALL_FOLLOW_SEEK_TURN		0.3			// toward the followed side, with nothing in view
+#define WALL_FOLLOW_SEEK_STEPS		15			// steps (0.3 s) of each seek cycle turning in
+#define WALL_FOLLOW_PEEL_TURN		0.3			// away from the followed side
+#define WALL_FOLLOW_PEEL_STEPS		25			// steps (0.5 s) of each seek cycle turning out
+#define WALL_FOLLOW_SEEK_CYCLES		10			// seek cycles (8 s) after the boundary was last seen
+#define WALL_FOLLOW_AVOID_STEPS		10			// steps (0.2 s) of full turn after an obstacle sensor tripped
+#define WALL_FOLLOW_SMOOTHING		0.5			// weight of the newest step in the turn
+#define WALL_FOLLOW_DEADBAND		0.02		// smaller turns drive straight with FORWARD_CMD
+
+class WallFollower
+{
+public:
+	/* Public Functions */
+	WallFollower();
+
+	void setSide(int side);
+	int getSide();
+
+	/// <summary>
+	/// Steering for one step from the latest sensor ranges. Ranges not yet received (0) or out of
+	/// a sensor's range (infinite) are handled as no wall and, for the cliff sensors, as an edge.
+	/// tooClose is set when the step took a transition with FSM_ACT_TOO_CLOSE.
+	/// </summary>
+	/// <returns>FORWARD_CMD, or FORWARD_L_CMD / FORWARD_R_CMD with the turn argument in turnAngle</returns>
+	int Update(const gazeboSensorData & ranges, bool tooClose, double* turnAngle);
+
+	/* Forget the filtered turn, when the mode is entered */
+	void Reset();
+	double getTurn();
+
+private:
+	/* Private Variables */
+	int		side;
+	double	turn;
+	int		unseenSteps;	// since the followed side last saw a wall or edge
+	int		avoidSteps;		// left of the full turn after an obstacle sensor tripped
+	double	avoidTurn;
+};
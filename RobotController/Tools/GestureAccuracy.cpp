@@ -0,0 +1,246 @@
+/*****************************************************
+*	GestureAccuracy.cpp
+*
+*	Replays a labeled corpus (see GestureCorpus.h)
+*	through the Gesture recognizer and reports precision,
+*	recall and recognition latency per command, and
+*	frames/sec throughput.
+*
+*	With -baseline the results are compared against a
+*	baseline file and the exit code is 1 if precision or
+*	recall of any command dropped by more than the
+*	accuracy tolerance. Write a baseline with
+*	-write-baseline.
+*
+*	Throughput depends on the machine, so the baseline
+*	holds it relative to a fixed reference workload
+*	(referenceFrame) timed over the same frames in the
+*	same run: the exit code is 1 if that ratio dropped
+*	by more than the throughput tolerance (a fraction).
+*
+*	-drop skips that fraction of frames at random (the
+*	same ones every run), as a loaded machine or a busy
+*	sensor would, to check recognition timing holds up.
+*	A skipped frame repeats the previous frame's output.
+*
+*	Usage: GestureAccuracy <corpus list> [-baseline <file>] [-write-baseline <file>]
+*			[-tolerance <0.02>] [-fps-tolerance <0.3>] [-repeat <n>] [-drop <fraction>]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "Gesture.h"
+#include "GestureCorpus.h"
+#include "SkeletonLog.h"
+
+#include <chrono>
+#include <vector>
+
+#define ACCURACY_TOLERANCE		0.02
+#define ACCURACY_FPS_TOLERANCE	0.3
+#define ACCURACY_DROP_SEED		12345
+
+typedef struct {
+	double	precision[CORPUS_CLASS_COUNT];
+	double	recall[CORPUS_CLASS_COUNT];
+	double	fps;
+	double	throughput;		// fps over the reference workload's frames/sec
+}accuracyBaseline;
+
+static int readBaseline(const char* path, accuracyBaseline* b)
+{
+	FILE* fp;
+	char line[256], name[32];
+	double p, r;
+	int c, found = 0;
+	bool hasThroughput = false;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		printf("ERROR: could not open baseline %s.\n", path);
+		return -1;
+	}
+	memset(b, 0x00, sizeof(accuracyBaseline));
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (line[0] == '#') continue;
+		if (sscanf(line, "throughput %lf", &p) == 1) {
+			b->throughput = p;
+			hasThroughput = true;
+			continue;
+		}
+		if (sscanf(line, "%31s %lf %lf", name, &p, &r) != 3) continue;
+		for (c = 0; c < CORPUS_CLASS_COUNT; c++) {
+			if (strcmp(name, corpusClassName(c)) == 0) {
+				b->precision[c] = p;
+				b->recall[c] = r;
+				found++;
+			}
+		}
+	}
+	fclose(fp);
+
+	if (found != CORPUS_CLASS_COUNT) {
+		printf("ERROR: baseline %s does not list every command.\n", path);
+		return -1;
+	}
+	if (!hasThroughput || b->throughput <= 0.0) {
+		printf("ERROR: baseline %s has no throughput line.\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+static int writeBaseline(const char* path, const accuracyBaseline & b)
+{
+	FILE* fp;
+	int c;
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		printf("ERROR: could not create baseline %s.\n", path);
+		return -1;
+	}
+	fprintf(fp, "# GestureAccuracy baseline: <command> <precision> <recall>, then throughput <recognizer fps / reference fps>\n");
+	for (c = 0; c < CORPUS_CLASS_COUNT; c++) fprintf(fp, "%s %.4f %.4f\n", corpusClassName(c), b.precision[c], b.recall[c]);
+	fprintf(fp, "throughput %.4f\n", b.throughput);
+	fclose(fp);
+	return 0;
+}
+
+/* Reference workload for the throughput ratio: float work of about the recognizer's size on every joint of
+ * the frame, independent of the recognizer code so a slower recognizer shows as a lower ratio. */
+static float referenceFrame(const skeletonFrame & frame)
+{
+	float sum = 0.0f;
+	int i, j;
+
+	for (i = 0; i < SKELETON_COUNT; i++) {
+		const skeletonData & d = frame.skeletons[i];
+		if (d.trackingState != SKELETON_TRACKED) continue;
+		for (j = 0; j < SKELETON_POSITION_COUNT; j++) {
+			sum += sqrtf(d.joints[j].x * d.joints[j].x + d.joints[j].y * d.joints[j].y) + atan2f(d.joints[j].y, d.joints[j].z);
+		}
+	}
+	return sum;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<corpusSession> sessions;
+	std::vector<uint16_t> outputs;
+	SkeletonLogReader reader;
+	accuracyBaseline result, baseline;
+	corpusScore score;
+	const char* baselinePath = NULL;
+	const char* writePath = NULL;
+	double tolerance = ACCURACY_TOLERANCE, fpsTolerance = ACCURACY_FPS_TOLERANCE, drop = 0.0, elapsed, referenceElapsed;
+	volatile float referenceSink = 0.0f;
+	uint32_t dropRandom, dropThreshold;
+	uint64_t frames, f, dropped = 0, gaps = 0;
+	size_t s;
+	int i, c, repeat = 1, r, failures;
+
+	if (argc < 2) {
+		printf("Usage: %s <corpus list> [-baseline <file>] [-write-baseline <file>] [-tolerance <%.2f>] [-fps-tolerance <%.2f>] [-repeat <n>] [-drop <fraction>]\n",
+			argv[0], ACCURACY_TOLERANCE, ACCURACY_FPS_TOLERANCE);
+		return 1;
+	}
+	for (i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+		else if (strcmp(argv[i], "-write-baseline") == 0 && i + 1 < argc) writePath = argv[++i];
+		else if (strcmp(argv[i], "-tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+		else if (strcmp(argv[i], "-fps-tolerance") == 0 && i + 1 < argc) fpsTolerance = atof(argv[++i]);
+		else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-drop") == 0 && i + 1 < argc) drop = atof(argv[++i]);
+		else {
+			printf("Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (repeat < 1) repeat = 1;
+	if (drop < 0.0 || drop >= 1.0) {
+		printf("Drop fraction must be in [0, 1)\n");
+		return 1;
+	}
+	dropThreshold = (uint32_t)(drop * 4294967296.0);
+	if (loadCorpus(argv[1], &sessions) != 0) return 1;
+
+	/* Accuracy: one fresh recognizer per session */
+	clearScore(&score);
+	elapsed = 0.0;
+	referenceElapsed = 0.0;
+	frames = 0;
+	for (s = 0; s < sessions.size(); s++) {
+		if (reader.Open(sessions[s].logPath.c_str()) != 0) return 1;
+		outputs.resize(reader.getFrameCount());
+
+		for (r = 0; r < repeat; r++) {
+			Gesture gesture;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			dropRandom = ACCURACY_DROP_SEED + (uint32_t)s;
+			for (f = 0; f < reader.getFrameCount(); f++) {
+				dropRandom = dropRandom * 1664525u + 1013904223u;
+				if (f > 0 && dropRandom < dropThreshold) {
+					outputs[f] = outputs[f - 1];
+					continue;
+				}
+				gesture.ProcessFrame(*reader.getFrame(f));
+				outputs[f] = (uint16_t)gesture.getUserInput();
+			}
+			elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			frames += reader.getFrameCount();
+
+			/* The reference workload on the same frames, right after, so both see the same machine load */
+			start = std::chrono::steady_clock::now();
+			for (f = 0; f < reader.getFrameCount(); f++) referenceSink = referenceSink + referenceFrame(*reader.getFrame(f));
+			referenceElapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (drop > 0.0 && r == 0) {
+				dropped += gesture.getFrameStats().dropped;
+				gaps += gesture.getFrameStats().gaps;
+			}
+		}
+		scoreSession(sessions[s].labels, outputs, &score);
+		reader.Close();
+	}
+
+	result.fps = (elapsed > 0.0) ? (double)frames / elapsed : 0.0;
+	result.throughput = (elapsed > 0.0) ? referenceElapsed / elapsed : 0.0;
+	printf("%d sessions, %llu frames\n", (int)sessions.size(), (unsigned long long)score.frames);
+	if (drop > 0.0) printf("Dropped %llu frames in %llu gaps\n", (unsigned long long)dropped, (unsigned long long)gaps);
+	printf("Command     labels   TP   FP   FN  precision  recall  latency mean/max (frames)\n");
+	for (c = 0; c < CORPUS_CLASS_COUNT; c++) {
+		const corpusClassScore& cs = score.classes[c];
+		result.precision[c] = scorePrecision(cs);
+		result.recall[c] = scoreRecall(cs);
+		printf("%-10s %7llu %4llu %4llu %4llu %10.3f %7.3f %12.1f / %u\n", corpusClassName(c),
+			(unsigned long long)(cs.truePositives + cs.falseNegatives), (unsigned long long)cs.truePositives,
+			(unsigned long long)cs.falsePositives, (unsigned long long)cs.falseNegatives,
+			result.precision[c], result.recall[c], scoreMeanLatency(cs), cs.latencyMax);
+	}
+	printf("Overall F1 %.3f, mean latency %.1f frames, throughput %.0f frames/s (%.3f of the reference workload)\n", scoreF1(score),
+		scoreMeanLatency(score), result.fps, result.throughput);
+
+	if (writePath != NULL && writeBaseline(writePath, result) == 0) printf("Wrote baseline %s\n", writePath);
+
+	if (baselinePath == NULL) return 0;
+	if (readBaseline(baselinePath, &baseline) != 0) return 1;
+
+	failures = 0;
+	if (result.throughput < baseline.throughput * (1.0 - fpsTolerance)) {
+		printf("REGRESSION: throughput %.3f of the reference workload, baseline %.3f\n", result.throughput, baseline.throughput);
+		failures++;
+	}
+
+	for (c = 0; c < CORPUS_CLASS_COUNT; c++) {
+		if (result.precision[c] < baseline.precision[c] - tolerance) {
+			printf("REGRESSION: %s precision %.3f, baseline %.3f\n", corpusClassName(c), result.precision[c], baseline.precision[c]);
+			failures++;
+		}
+		if (result.recall[c] < baseline.recall[c] - tolerance) {
+			printf("REGRESSION: %s recall %.3f, baseline %.3f\n", corpusClassName(c), result.recall[c], baseline.recall[c]);
+			failures++;
+		}
+	}
+	printf("%s against baseline %s\n", (failures == 0) ? "PASS" : "FAIL", baselinePath);
+	return (failures == 0) ? 0 : 1;
+}
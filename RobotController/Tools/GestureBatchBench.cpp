@@ -0,0 +1,215 @@
+/*****************************************************
+*	GestureBatchBench.cpp
+*
+*	Compares the batched SIMD gesture evaluator against
+*	calling the scalar Gesture rules in a loop over the
+*	same skeletons, and checks both produce the same
+*	predicates, commands, arguments and automaton
+*	states under several gestureParams, including
+*	early commit.
+*
+*	Both read the same SoA joint rows: the scalar loop
+*	gathers each skeleton's seven joints from them, the
+*	batch reads them in place. Copy in also times moving
+*	every row into the batch each frame. Each figure is
+*	the fastest of the passes. Fails if any result
+*	differs or the in place batch is not
+*	BENCH_TARGET_SPEEDUP times the scalar loop.
+*
+*	Usage: GestureBatchBench [skeletons] [frames] [passes]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "Gesture.h"
+#include "GestureBatch.h"
+#include "StateMachineDefs.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#define BENCH_TARGET_SPEEDUP	10.0	// in place batch over the scalar rules
+
+static const int batchJoints[GESTURE_BATCH_JOINTS] = {
+	SKELETON_POSITION_HAND_RIGHT, SKELETON_POSITION_HAND_LEFT, SKELETON_POSITION_SHOULDER_RIGHT,
+	SKELETON_POSITION_ELBOW_RIGHT, SKELETON_POSITION_ELBOW_LEFT, SKELETON_POSITION_HIP_RIGHT, SKELETON_POSITION_HIP_LEFT
+};
+
+/* Parameter sets checked: defaults, then other margins, counts, dead bands and early commit.
+ * Columns: stop margin, stop hold frames, sequence count, wave count, turn dead band, commit confidence. */
+static const gestureParams benchParams[] = {
+	{ GESTURE_STOP_MARGIN, GESTURE_STOP_HOLD_FRAMES, GESTURE_SEQUENCE_COUNT, GESTURE_WAVE_COUNT, GESTURE_TURN_DEADBAND, GESTURE_COMMIT_CONFIDENCE },
+	{ 0.25, 3, 3, 1, 0.05, 1.0 },
+	{ GESTURE_STOP_MARGIN, GESTURE_STOP_HOLD_FRAMES, GESTURE_SEQUENCE_COUNT, GESTURE_WAVE_COUNT, GESTURE_TURN_DEADBAND, 0.75 },
+	{ 0.6, 10, 4, 3, 0.2, 0.5 },
+};
+#define BENCH_PARAM_SETS	(int)(sizeof(benchParams) / sizeof(benchParams[0]))
+
+/* Joint rows of frame f, joint j */
+static inline const float* row(const std::vector<float> & soa, int f, int j, int stride)
+{
+	return &soa[((size_t)f * GESTURE_BATCH_JOINTS + j) * stride];
+}
+
+/* The scalar rules on skeleton s of frame f, reading its joints from the SoA rows */
+static inline uint16_t scalarStep(const std::vector<float> & soaX, const std::vector<float> & soaY, int f, int s, int stride,
+	const gestureParams & params, const gestureMachine* machines, gestureState* state, uint32_t* predicates, double* arg)
+{
+	gestureFeatures features;
+	double angle;
+	int j;
+
+	for (j = 0; j < GESTURE_BATCH_JOINTS; j++) {
+		features.x[batchJoints[j]] = row(soaX, f, j, stride)[s];
+		features.y[batchJoints[j]] = row(soaY, f, j, stride)[s];
+	}
+	*predicates = Gesture::evaluatePredicates(features, params, &angle);
+	*arg = 0.0;
+	return Gesture::stepGesture(machines, state, *predicates, angle, arg);
+}
+
+int main(int argc, char* argv[])
+{
+	int skeletons, frames, passes, stride, f, s, j, r, set;
+	uint64_t mismatches, commands;
+
+	skeletons = (argc > 1) ? atoi(argv[1]) : 1024;
+	frames = (argc > 2) ? atoi(argv[2]) : 128;
+	passes = (argc > 3) ? atoi(argv[3]) : 20;
+	if (skeletons < 1 || frames < 1 || passes < 1) {
+		printf("Usage: %s [skeletons] [frames] [passes]\n", argv[0]);
+		return 1;
+	}
+
+	GestureBatch batch(skeletons);
+	batch.setCount(skeletons);
+	stride = batch.getCapacity();
+
+	/* Synthetic operators: each skeleton's arms swing at its own rate around a fixed body. The normalized
+	 * joints are stored as SoA rows, padded to the batch capacity so Evaluate can read them in place. */
+	skeletonData d;
+	gestureFeatures features;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	std::vector<float> soaX((size_t)frames * GESTURE_BATCH_JOINTS * stride), soaY(soaX.size());
+	for (s = 0; s < skeletons; s++) {
+		float rate = 0.05f + 0.3f * uni(rng), phase = 6.28f * uni(rng);
+		for (f = 0; f < frames; f++) {
+			float t = phase + rate * f;
+			memset(&d, 0x00, sizeof(d));
+			d.trackingState = SKELETON_TRACKED;
+			d.joints[SKELETON_POSITION_SHOULDER_CENTER].y = 0.45f;
+			d.joints[SKELETON_POSITION_SHOULDER_RIGHT].x = 0.2f;
+			d.joints[SKELETON_POSITION_SHOULDER_RIGHT].y = 0.45f;
+			d.joints[SKELETON_POSITION_SHOULDER_LEFT].x = -0.2f;
+			d.joints[SKELETON_POSITION_SHOULDER_LEFT].y = 0.45f;
+			d.joints[SKELETON_POSITION_HIP_RIGHT].x = 0.1f;
+			d.joints[SKELETON_POSITION_HIP_LEFT].x = -0.1f;
+			d.joints[SKELETON_POSITION_ELBOW_RIGHT].x = 0.3f;
+			d.joints[SKELETON_POSITION_ELBOW_RIGHT].y = 0.2f;
+			d.joints[SKELETON_POSITION_ELBOW_LEFT].x = -0.3f;
+			d.joints[SKELETON_POSITION_ELBOW_LEFT].y = 0.2f;
+			d.joints[SKELETON_POSITION_HAND_RIGHT].x = 0.3f + 0.15f * sinf(t * 1.7f);
+			d.joints[SKELETON_POSITION_HAND_RIGHT].y = 0.2f + 0.5f * sinf(t) + 0.05f * uni(rng);
+			d.joints[SKELETON_POSITION_HAND_LEFT].x = -0.3f + 0.15f * cosf(t * 1.3f);
+			d.joints[SKELETON_POSITION_HAND_LEFT].y = 0.1f + 0.45f * sinf(t * 0.7f) + 0.05f * uni(rng);
+			computeFeatures(d, &features);
+			for (j = 0; j < GESTURE_BATCH_JOINTS; j++) {
+				soaX[((size_t)f * GESTURE_BATCH_JOINTS + j) * stride + s] = features.x[batchJoints[j]];
+				soaY[((size_t)f * GESTURE_BATCH_JOINTS + j) * stride + s] = features.y[batchJoints[j]];
+			}
+		}
+	}
+
+	/* Verification, copying the joints in, under every parameter set */
+	std::vector<gestureState> states(skeletons);
+	gestureMachine machines[GESTURE_COUNT];
+	gestureState batchState;
+	mismatches = 0;
+	for (set = 0; set < BENCH_PARAM_SETS; set++) {
+		const gestureParams & params = benchParams[set];
+		if (Gesture::compileGestures(params, machines) != 0 || batch.setParams(params) != 0) {
+			printf("ERROR: Parameter set %d is invalid.\n", set);
+			return 1;
+		}
+		commands = 0;
+		for (s = 0; s < skeletons; s++) Gesture::clearGestureState(&states[s]);
+		for (f = 0; f < frames; f++) {
+			for (j = 0; j < GESTURE_BATCH_JOINTS; j++) {
+				memcpy(batch.getJointX(j), row(soaX, f, j, stride), skeletons * sizeof(float));
+				memcpy(batch.getJointY(j), row(soaY, f, j, stride), skeletons * sizeof(float));
+			}
+			batch.Evaluate();
+			for (s = 0; s < skeletons; s++) {
+				uint32_t p;
+				double arg;
+				uint16_t input = scalarStep(soaX, soaY, f, s, stride, params, machines, &states[s], &p, &arg);
+				batch.getState(s, &batchState);
+				if (input != batch.getUserInput(s) || p != batch.getPredicates(s) || fabs(arg - batch.getUserArg(s)) > 1e-6 ||
+					batchState.states != states[s].states) mismatches++;
+				if (input & ~STOP_TURN_CMD_MASK) commands++;
+			}
+		}
+		printf("Verified parameter set %d, %d skeletons x %d frames: %llu commands\n", set, skeletons, frames, (unsigned long long)commands);
+	}
+	printf("Mismatches: %llu\n", (unsigned long long)mismatches);
+
+	/* Timing with the default parameters */
+	gestureParams params;
+	Gesture::getDefaultParams(&params);
+	Gesture::compileGestures(params, machines);
+	batch.setParams(params);
+	volatile uint32_t sink = 0;
+	double scalarTime = 0.0, copyTime = 0.0, batchTime = 0.0, t;
+	for (r = 0; r < passes; r++) {
+		/* Scalar rules in a loop */
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (f = 0; f < frames; f++) {
+			for (s = 0; s < skeletons; s++) {
+				uint32_t p;
+				double arg;
+				sink += scalarStep(soaX, soaY, f, s, stride, params, machines, &states[s], &p, &arg);
+			}
+		}
+		t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || t < scalarTime) scalarTime = t;
+
+		/* Batch, copying each frame's joints into the batch */
+		start = std::chrono::steady_clock::now();
+		for (f = 0; f < frames; f++) {
+			for (j = 0; j < GESTURE_BATCH_JOINTS; j++) {
+				memcpy(batch.getJointX(j), row(soaX, f, j, stride), skeletons * sizeof(float));
+				memcpy(batch.getJointY(j), row(soaY, f, j, stride), skeletons * sizeof(float));
+			}
+			batch.Evaluate();
+			sink += batch.getUserInput(0);
+		}
+		t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || t < copyTime) copyTime = t;
+
+		/* Batch, reading the SoA rows in place */
+		start = std::chrono::steady_clock::now();
+		for (f = 0; f < frames; f++) {
+			const float* x[GESTURE_BATCH_JOINTS];
+			const float* y[GESTURE_BATCH_JOINTS];
+			for (j = 0; j < GESTURE_BATCH_JOINTS; j++) {
+				x[j] = row(soaX, f, j, stride);
+				y[j] = row(soaY, f, j, stride);
+			}
+			batch.Evaluate(x, y);
+			sink += batch.getUserInput(0);
+		}
+		t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || t < batchTime) batchTime = t;
+	}
+
+	double total = (double)skeletons * frames;
+	double speedup = scalarTime / batchTime;
+	printf("Scalar:           %.1f M skeleton-frames/s\n", total / scalarTime / 1e6);
+	printf("Batch (copy in):  %.1f M skeleton-frames/s (%.1fx)\n", total / copyTime / 1e6, scalarTime / copyTime);
+	printf("Batch (in place): %.1f M skeleton-frames/s (%.1fx)\n", total / batchTime / 1e6, speedup);
+	printf("Target: in place %.0fx the scalar rules, %s\n", BENCH_TARGET_SPEEDUP, (speedup >= BENCH_TARGET_SPEEDUP) ? "met" : "MISSED");
+
+	return (mismatches == 0 && speedup >= BENCH_TARGET_SPEEDUP) ? 0 : 1;
+}
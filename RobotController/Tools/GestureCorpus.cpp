@@ -0,0 +1,264 @@
+/*****************************************************
+*	GestureCorpus.cpp
+*
+*	Label files and precision/recall scoring.
+*****************************************************/
+
+#include "GestureCorpus.h"
+#include "StateMachineDefs.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define CORPUS_LINE_LENGTH	1024
+
+typedef struct {
+	const char*	name;
+	uint16_t	command;
+	int			scoreClass;
+}corpusCommand;
+
+static const corpusCommand corpusCommands[] = {
+	{ "stop", STOP_CMD_MASK, CORPUS_CLASS_STOP },
+	{ "forward", FORWARD_CMD_MASK, CORPUS_CLASS_FORWARD },
+	{ "reverse", REVERSE_CMD_MASK, CORPUS_CLASS_REVERSE },
+	{ "turn_l", TURN_L_CMD_MASK, CORPUS_CLASS_TURN },
+	{ "turn_r", TURN_R_CMD_MASK, CORPUS_CLASS_TURN },
+	{ "auto", AUTO_MODE_CMD_MASK, CORPUS_CLASS_AUTO },
+	{ "manual", MANUAL_MODE_CMD_MASK, CORPUS_CLASS_MANUAL },
+};
+#define CORPUS_COMMAND_COUNT	(sizeof(corpusCommands) / sizeof(corpusCommands[0]))
+
+static const char* corpusClassNames[CORPUS_CLASS_COUNT] = {
+	"STOP", "FORWARD", "REVERSE", "TURN", "AUTO", "MANUAL"
+};
+
+uint16_t parseCorpusCommand(const char* name)
+{
+	size_t i;
+
+	for (i = 0; i < CORPUS_COMMAND_COUNT; i++) {
+		if (strcmp(name, corpusCommands[i].name) == 0) return corpusCommands[i].command;
+	}
+	return 0;
+}
+
+const char* corpusCommandName(uint16_t command)
+{
+	size_t i;
+
+	for (i = 0; i < CORPUS_COMMAND_COUNT; i++) {
+		if (command == corpusCommands[i].command) return corpusCommands[i].name;
+	}
+	return "none";
+}
+
+const char* corpusClassName(int c)
+{
+	return (c >= 0 && c < CORPUS_CLASS_COUNT) ? corpusClassNames[c] : "none";
+}
+
+static int commandClass(uint16_t command)
+{
+	size_t i;
+
+	for (i = 0; i < CORPUS_COMMAND_COUNT; i++) {
+		if (command == corpusCommands[i].command) return corpusCommands[i].scoreClass;
+	}
+	return -1;
+}
+
+static bool skipLine(const char* line)
+{
+	while (*line == ' ' || *line == '\t') line++;
+	return (*line == '#' || *line == '\n' || *line == '\r' || *line == '\0');
+}
+
+int loadLabels(const char* path, std::vector<corpusLabel>* labels)
+{
+	FILE* fp;
+	char line[CORPUS_LINE_LENGTH];
+	char name[32];
+	corpusLabel label;
+	unsigned int first, last;
+	int lineNumber = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		printf("ERROR: loadLabels could not open %s.\n", path);
+		return -1;
+	}
+
+	labels->clear();
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineNumber++;
+		if (skipLine(line)) continue;
+		if (sscanf(line, "%31s %u %u", name, &first, &last) != 3 || parseCorpusCommand(name) == 0 || last < first) {
+			printf("ERROR: loadLabels %s line %d: expected \"<command> <first frame> <last frame>\".\n", path, lineNumber);
+			fclose(fp);
+			return -1;
+		}
+		label.command = parseCorpusCommand(name);
+		label.first = first;
+		label.last = last;
+		labels->push_back(label);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+int writeLabels(const char* path, const std::vector<corpusLabel> & labels)
+{
+	FILE* fp;
+	size_t i;
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		printf("ERROR: writeLabels could not create %s.\n", path);
+		return -1;
+	}
+
+	fprintf(fp, "# command first_frame last_frame\n");
+	for (i = 0; i < labels.size(); i++) {
+		fprintf(fp, "%s %u %u\n", corpusCommandName(labels[i].command), labels[i].first, labels[i].last);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+int loadCorpus(const char* listPath, std::vector<corpusSession>* sessions)
+{
+	FILE* fp;
+	char line[CORPUS_LINE_LENGTH];
+	char logName[CORPUS_LINE_LENGTH], labelName[CORPUS_LINE_LENGTH];
+	std::string dir;
+	const char* slash;
+	corpusSession session;
+	int lineNumber = 0;
+
+	fp = fopen(listPath, "r");
+	if (fp == NULL) {
+		printf("ERROR: loadCorpus could not open %s.\n", listPath);
+		return -1;
+	}
+
+	slash = strrchr(listPath, '/');
+	if (slash != NULL) dir.assign(listPath, slash - listPath + 1);
+
+	sessions->clear();
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineNumber++;
+		if (skipLine(line)) continue;
+		if (sscanf(line, "%1023s %1023s", logName, labelName) != 2) {
+			printf("ERROR: loadCorpus %s line %d: expected \"<skeleton log> <label file>\".\n", listPath, lineNumber);
+			fclose(fp);
+			return -1;
+		}
+		session.logPath = (logName[0] == '/') ? std::string(logName) : dir + logName;
+		session.labelPath = (labelName[0] == '/') ? std::string(labelName) : dir + labelName;
+		if (loadLabels(session.labelPath.c_str(), &session.labels) != 0) {
+			fclose(fp);
+			return -1;
+		}
+		sessions->push_back(session);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+void clearScore(corpusScore* score)
+{
+	memset(score, 0x00, sizeof(corpusScore));
+}
+
+void scoreSession(const std::vector<corpusLabel> & labels, const std::vector<uint16_t> & outputs, corpusScore* score)
+{
+	const uint32_t frames = (uint32_t)outputs.size();
+	size_t i, c;
+	uint32_t f, end;
+	int cls;
+
+	score->frames += frames;
+
+	/* Recall: each label needs its command reported inside its window */
+	for (i = 0; i < labels.size(); i++) {
+		corpusClassScore* s;
+
+		cls = commandClass(labels[i].command);
+		if (cls < 0) continue;
+		s = &score->classes[cls];
+		end = labels[i].last + CORPUS_DETECT_FRAMES;
+		for (f = labels[i].first; f <= end && f < frames; f++) {
+			if (outputs[f] & labels[i].command) break;
+		}
+		if (f <= end && f < frames) {
+			s->truePositives++;
+			s->latencySum += f - labels[i].first;
+			if (f - labels[i].first > s->latencyMax) s->latencyMax = f - labels[i].first;
+		}
+		else {
+			s->falseNegatives++;
+		}
+	}
+
+	/* Precision: each run of a reported command outside every window of a label with that command */
+	for (c = 0; c < CORPUS_COMMAND_COUNT; c++) {
+		const uint16_t command = corpusCommands[c].command;
+		for (f = 0; f < frames; f++) {
+			if (!(outputs[f] & command) || (f > 0 && (outputs[f - 1] & command))) continue;
+			for (i = 0; i < labels.size(); i++) {
+				if (labels[i].command == command && f >= labels[i].first && f <= labels[i].last + CORPUS_DETECT_FRAMES) break;
+			}
+			if (i == labels.size()) score->classes[corpusCommands[c].scoreClass].falsePositives++;
+		}
+	}
+}
+
+double scorePrecision(const corpusClassScore & c)
+{
+	uint64_t reported = c.truePositives + c.falsePositives;
+	return (reported > 0) ? (double)c.truePositives / (double)reported : 1.0;
+}
+
+double scoreRecall(const corpusClassScore & c)
+{
+	uint64_t labeled = c.truePositives + c.falseNegatives;
+	return (labeled > 0) ? (double)c.truePositives / (double)labeled : 1.0;
+}
+
+double scoreMeanLatency(const corpusClassScore & c)
+{
+	return (c.truePositives > 0) ? (double)c.latencySum / (double)c.truePositives : 0.0;
+}
+
+double scoreF1(const corpusScore & score)
+{
+	corpusClassScore total;
+	double p, r;
+	int i;
+
+	memset(&total, 0x00, sizeof(total));
+	for (i = 0; i < CORPUS_CLASS_COUNT; i++) {
+		total.truePositives += score.classes[i].truePositives;
+		total.falsePositives += score.classes[i].falsePositives;
+		total.falseNegatives += score.classes[i].falseNegatives;
+	}
+	p = scorePrecision(total);
+	r = scoreRecall(total);
+	return (p + r > 0.0) ? 2.0 * p * r / (p + r) : 0.0;
+}
+
+double scoreMeanLatency(const corpusScore & score)
+{
+	uint64_t sum = 0, n = 0;
+	int i;
+
+	for (i = 0; i < CORPUS_CLASS_COUNT; i++) {
+		sum += score.classes[i].latencySum;
+		n += score.classes[i].truePositives;
+	}
+	return (n > 0) ? (double)sum / (double)n : 0.0;
+}
@@ -0,0 +1,87 @@
+/*****************************************************
+*	GestureCorpus.h
+*
+*	Labeled skeleton recordings and accuracy scoring,
+*	shared by the benchmark tools.
+*
+*	Corpus list (text), one session per line, paths
+*	relative to the list file:
+*		<skeleton log> <label file>
+*
+*	Label file (text), one performed gesture per line:
+*		<command> <first frame> <last frame>
+*	command is stop, forward, reverse, turn_l, turn_r,
+*	auto or manual. Frames index the skeleton log. Lines
+*	starting with # are comments.
+*
+*	A label is recognized if its command is reported
+*	between its first frame and CORPUS_DETECT_FRAMES
+*	after its last. Every run of frames reporting a
+*	command outside such a window is a false positive.
+*****************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Scored command classes. TURN covers turn_l and turn_r, a turn reported the wrong way is a miss. */
+#define CORPUS_CLASS_STOP		0
+#define CORPUS_CLASS_FORWARD	1
+#define CORPUS_CLASS_REVERSE	2
+#define CORPUS_CLASS_TURN		3
+#define CORPUS_CLASS_AUTO		4
+#define CORPUS_CLASS_MANUAL		5
+#define CORPUS_CLASS_COUNT		6
+
+#define CORPUS_DETECT_FRAMES	15		// frames after a label's last frame its command may still arrive
+
+typedef struct {
+	uint16_t	command;		// *_CMD_MASK
+	uint32_t	first;
+	uint32_t	last;
+}corpusLabel;
+
+typedef struct {
+	std::string					logPath;
+	std::string					labelPath;
+	std::vector<corpusLabel>	labels;
+}corpusSession;
+
+typedef struct {
+	uint64_t	truePositives;
+	uint64_t	falsePositives;
+	uint64_t	falseNegatives;
+	uint64_t	latencySum;		// frames from label start to first report, over true positives
+	uint32_t	latencyMax;
+}corpusClassScore;
+
+typedef struct {
+	corpusClassScore	classes[CORPUS_CLASS_COUNT];
+	uint64_t			frames;
+}corpusScore;
+
+/* Returns 0 on success, -1 on failure */
+int loadCorpus(const char* listPath, std::vector<corpusSession>* sessions);
+int loadLabels(const char* path, std::vector<corpusLabel>* labels);
+int writeLabels(const char* path, const std::vector<corpusLabel> & labels);
+
+/* Command names used in label files. parseCorpusCommand returns 0 for an unknown name. */
+uint16_t parseCorpusCommand(const char* name);
+const char* corpusCommandName(uint16_t command);
+const char* corpusClassName(int c);
+
+/// <summary>
+/// Score one session: outputs holds Gesture::getUserInput() for every frame of its log
+/// </summary>
+void scoreSession(const std::vector<corpusLabel> & labels, const std::vector<uint16_t> & outputs, corpusScore* score);
+void clearScore(corpusScore* score);
+
+double scorePrecision(const corpusClassScore & c);
+double scoreRecall(const corpusClassScore & c);
+double scoreMeanLatency(const corpusClassScore & c);
+
+/* Totals over every class */
+double scoreF1(const corpusScore & score);
+double scoreMeanLatency(const corpusScore & score);
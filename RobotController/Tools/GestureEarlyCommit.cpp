@@ -0,0 +1,149 @@
+/*****************************************************
+*	GestureEarlyCommit.cpp
+*
+*	Replays a labeled corpus (see GestureCorpus.h) at
+*	several early commit confidences and reports, for
+*	the repeated-motion gestures, the recognition latency
+*	saved against waiting for the whole motion and what
+*	it costs in false positives.
+*
+*	Usage: GestureEarlyCommit <corpus list> [-commit <c,...>]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "Gesture.h"
+#include "GestureCorpus.h"
+#include "SkeletonLog.h"
+
+#include <vector>
+
+#define EARLY_FRAME_MS		33.3	// Kinect skeleton frame period
+#define EARLY_COMMITS		"1,0.875,0.75,0.625,0.5"
+
+/* Gestures early commit applies to */
+static const int earlyClasses[] = { CORPUS_CLASS_FORWARD, CORPUS_CLASS_REVERSE, CORPUS_CLASS_AUTO, CORPUS_CLASS_MANUAL };
+#define EARLY_CLASS_COUNT	(sizeof(earlyClasses) / sizeof(earlyClasses[0]))
+
+static bool parseList(const char* text, std::vector<double>* values)
+{
+	char* end;
+
+	values->clear();
+	for (;;) {
+		values->push_back(strtod(text, &end));
+		if (end == text) return false;
+		if (*end == '\0') return true;
+		if (*end != ',') return false;
+		text = end + 1;
+	}
+}
+
+/* Score every session with a fresh recognizer at one commit confidence */
+static int runCorpus(const std::vector<corpusSession> & sessions, std::vector<SkeletonLogReader*> & readers, double commit, corpusScore* score)
+{
+	std::vector<uint16_t> outputs;
+	gestureParams params;
+	uint64_t f;
+	size_t s;
+
+	Gesture::getDefaultParams(&params);
+	params.commitConfidence = commit;
+	clearScore(score);
+	for (s = 0; s < sessions.size(); s++) {
+		Gesture gesture;
+		if (gesture.setParams(params) != 0) {
+			printf("ERROR: commit confidence %g is not in (0, 1].\n", commit);
+			return -1;
+		}
+		outputs.resize(readers[s]->getFrameCount());
+		for (f = 0; f < readers[s]->getFrameCount(); f++) {
+			gesture.ProcessFrame(*readers[s]->getFrame(f));
+			outputs[f] = (uint16_t)gesture.getUserInput();
+		}
+		scoreSession(sessions[s].labels, outputs, score);
+	}
+	return 0;
+}
+
+/* Totals over the early commit classes */
+static corpusClassScore sumClasses(const corpusScore & score)
+{
+	corpusClassScore total;
+	size_t i;
+
+	memset(&total, 0x00, sizeof(total));
+	for (i = 0; i < EARLY_CLASS_COUNT; i++) {
+		const corpusClassScore& c = score.classes[earlyClasses[i]];
+		total.truePositives += c.truePositives;
+		total.falsePositives += c.falsePositives;
+		total.falseNegatives += c.falseNegatives;
+		total.latencySum += c.latencySum;
+		if (c.latencyMax > total.latencyMax) total.latencyMax = c.latencyMax;
+	}
+	return total;
+}
+
+static void printRow(double commit, const char* name, const corpusClassScore & c, double referenceLatency, double minutes)
+{
+	double saved = referenceLatency - scoreMeanLatency(c);
+
+	printf("%6.3f  %-8s %4llu %4llu %4llu %10.3f %7.3f %8.2f %9.1f %7.1f %7.0f\n", commit, name,
+		(unsigned long long)c.truePositives, (unsigned long long)c.falsePositives, (unsigned long long)c.falseNegatives,
+		scorePrecision(c), scoreRecall(c), (minutes > 0.0) ? (double)c.falsePositives / minutes : 0.0,
+		scoreMeanLatency(c), saved, saved * EARLY_FRAME_MS);
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<corpusSession> sessions;
+	std::vector<SkeletonLogReader*> readers;
+	std::vector<double> commits;
+	corpusScore reference, score;
+	corpusClassScore total, referenceTotal;
+	double minutes;
+	size_t i, s;
+	int a;
+
+	parseList(EARLY_COMMITS, &commits);
+	if (argc < 2) {
+		printf("Usage: %s <corpus list> [-commit <c,...>]\n", argv[0]);
+		return 1;
+	}
+	for (a = 2; a < argc; a++) {
+		if (strcmp(argv[a], "-commit") == 0 && a + 1 < argc && parseList(argv[a + 1], &commits)) a++;
+		else {
+			printf("Bad option %s\n", argv[a]);
+			return 1;
+		}
+	}
+
+	if (loadCorpus(argv[1], &sessions) != 0 || sessions.empty()) return 1;
+	for (s = 0; s < sessions.size(); s++) {
+		readers.push_back(new SkeletonLogReader());
+		if (readers[s]->Open(sessions[s].logPath.c_str()) != 0) return 1;
+	}
+
+	/* Latency saved is measured against waiting for the whole motion */
+	if (runCorpus(sessions, readers, 1.0, &reference) != 0) return 1;
+	referenceTotal = sumClasses(reference);
+	minutes = (double)reference.frames * EARLY_FRAME_MS / 60000.0;
+
+	printf("%d sessions, %llu frames (%.1f min)\n", (int)sessions.size(), (unsigned long long)reference.frames, minutes);
+	printf("commit  command    TP   FP   FN  precision  recall   FP/min   latency   saved (frames / ms)\n");
+	for (i = 0; i < commits.size(); i++) {
+		if (runCorpus(sessions, readers, commits[i], &score) != 0) return 1;
+		for (s = 0; s < EARLY_CLASS_COUNT; s++) {
+			printRow(commits[i], corpusClassName(earlyClasses[s]), score.classes[earlyClasses[s]],
+				scoreMeanLatency(reference.classes[earlyClasses[s]]), minutes);
+		}
+		total = sumClasses(score);
+		printRow(commits[i], "all", total, scoreMeanLatency(referenceTotal), minutes);
+	}
+
+	for (s = 0; s < readers.size(); s++) {
+		readers[s]->Close();
+		delete readers[s];
+	}
+	return 0;
+}
@@ -0,0 +1,79 @@
+/*****************************************************
+*	GestureReplay.cpp
+*
+*	Replays a recorded skeleton log through the Gesture
+*	recognizer as fast as possible, without a Kinect.
+*	Reports recognized commands, operator changes and
+*	throughput.
+*
+*	Usage: GestureReplay <skeleton log> [repeat count] [longest | closest | claim]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "Gesture.h"
+#include "SkeletonLog.h"
+#include "StateMachineDefs.h"
+
+#include <chrono>
+
+#define REPLAY_CMD_COUNT	7
+
+static const uint16_t replayCmdMasks[REPLAY_CMD_COUNT] = {
+	STOP_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK, AUTO_MODE_CMD_MASK, MANUAL_MODE_CMD_MASK
+};
+static const char* replayCmdNames[REPLAY_CMD_COUNT] = {
+	"STOP", "FORWARD", "REVERSE", "TURN_L", "TURN_R", "AUTO_MODE", "MANUAL_MODE"
+};
+
+int main(int argc, char* argv[])
+{
+	SkeletonLogReader	reader;
+	Gesture				gesture;
+	uint64_t			frameCount, i, cmdCounts[REPLAY_CMD_COUNT], operatorChanges;
+	int					repeat, r, c, userInput, policy, maxTracked;
+	uint32_t			operatorID;
+
+	policy = (argc > 3) ? Gesture::parseArbitration(argv[3]) : GESTURE_ARBITRATE_LONGEST;
+	if (argc < 2 || policy < 0) {
+		printf("Usage: %s <skeleton log> [repeat count] [longest | closest | claim]\n", argv[0]);
+		return 1;
+	}
+	repeat = (argc > 2) ? atoi(argv[2]) : 1;
+	if (repeat < 1) repeat = 1;
+	gesture.setArbitration(policy);
+
+	if (reader.Open(argv[1]) != 0) return 1;
+	frameCount = reader.getFrameCount();
+	memset(cmdCounts, 0x00, sizeof(cmdCounts));
+	operatorChanges = 0;
+	operatorID = 0;
+	maxTracked = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (r = 0; r < repeat; r++) {
+		for (i = 0; i < frameCount; i++) {
+			gesture.ProcessFrame(*reader.getFrame(i));
+			userInput = gesture.getUserInput();
+			if (gesture.getOperatorID() != operatorID) {
+				operatorID = gesture.getOperatorID();
+				operatorChanges++;
+			}
+			if (gesture.getTrackedCount() > maxTracked) maxTracked = gesture.getTrackedCount();
+			for (c = 0; c < REPLAY_CMD_COUNT; c++) {
+				if (userInput & replayCmdMasks[c]) cmdCounts[c]++;
+			}
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	printf("Replayed %llu frames x %d from %s\n", (unsigned long long)frameCount, repeat, argv[1]);
+	for (c = 0; c < REPLAY_CMD_COUNT; c++) {
+		printf("\t%-12s %llu\n", replayCmdNames[c], (unsigned long long)cmdCounts[c]);
+	}
+	printf("Operator changes: %llu\tMost people tracked: %d\n", (unsigned long long)operatorChanges, maxTracked);
+	printf("Elapsed: %.3f s\tThroughput: %.0f frames/s\n", elapsed.count(),
+		(elapsed.count() > 0.0) ? (double)(frameCount * repeat) / elapsed.count() : 0.0);
+
+	return 0;
+}
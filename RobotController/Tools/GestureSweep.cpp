@@ -0,0 +1,327 @@
+/*****************************************************
+*	GestureSweep.cpp
+*
+*	Replays a labeled corpus (see GestureCorpus.h)
+*	through the recognizer for every combination of a
+*	grid of gestureParams, and prints the parameter sets
+*	on the accuracy/latency Pareto front: no other set
+*	has both a higher F1 and a lower mean recognition
+*	latency.
+*
+*	Each (parameter set, session) replay is one task.
+*	Tasks are dealt out to one deque per thread; a thread
+*	works from the back of its own deque and steals from
+*	the front of another's when it runs dry, so slow
+*	sessions do not leave cores idle.
+*
+*	Stop margins and dead bands are in shoulder widths.
+*
+*	Usage: GestureSweep <corpus list> [-threads <n>] [-csv <file>]
+*			[-stop-margin <w,...>] [-stop-hold <frames,...>] [-sequence <n,...>]
+*			[-waves <n,...>] [-deadband <w,...>]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "Gesture.h"
+#include "GestureCorpus.h"
+#include "SkeletonLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct {
+	gestureParams	params;
+	corpusScore		score;
+	double			f1;
+	double			latency;
+	double			precision;
+	double			recall;
+}sweepResult;
+
+/* Task deque owned by one worker */
+class SweepQueue
+{
+public:
+	void Push(uint32_t task)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		tasks.push_back(task);
+	}
+
+	/* Owner end */
+	bool Pop(uint32_t* task)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (tasks.empty()) return false;
+		*task = tasks.back();
+		tasks.pop_back();
+		return true;
+	}
+
+	/* Thief end */
+	bool Steal(uint32_t* task)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (tasks.empty()) return false;
+		*task = tasks.front();
+		tasks.pop_front();
+		return true;
+	}
+
+private:
+	std::mutex				lock;
+	std::deque<uint32_t>	tasks;
+};
+
+typedef struct {
+	std::vector<corpusSession>*			sessions;
+	std::vector<SkeletonLogReader*>*	readers;
+	std::vector<sweepResult>*			results;
+	std::vector<corpusScore>*			taskScores;		// one per task, merged per parameter set afterwards
+	std::vector<SweepQueue>*			queues;
+	std::atomic<uint64_t>*				steals;
+	std::atomic<uint64_t>*				frames;
+}sweepShared;
+
+static void runTask(sweepShared* shared, uint32_t task)
+{
+	const size_t sessionCount = shared->sessions->size();
+	const size_t set = task / sessionCount, s = task % sessionCount;
+	SkeletonLogReader* reader = (*shared->readers)[s];
+	std::vector<uint16_t> outputs(reader->getFrameCount());
+	Gesture gesture;
+	corpusScore* score = &(*shared->taskScores)[task];
+	uint64_t f;
+
+	gesture.setParams((*shared->results)[set].params);
+	for (f = 0; f < reader->getFrameCount(); f++) {
+		gesture.ProcessFrame(*reader->getFrame(f));
+		outputs[f] = (uint16_t)gesture.getUserInput();
+	}
+	clearScore(score);
+	scoreSession((*shared->sessions)[s].labels, outputs, score);
+	*shared->frames += reader->getFrameCount();
+}
+
+static void worker(sweepShared* shared, size_t self)
+{
+	std::vector<SweepQueue>& queues = *shared->queues;
+	uint32_t task = 0;
+	size_t i;
+
+	for (;;) {
+		if (queues[self].Pop(&task)) {
+			runTask(shared, task);
+			continue;
+		}
+
+		/* Own deque is empty: take the oldest task of the next worker that has any */
+		for (i = 1; i < queues.size(); i++) {
+			if (queues[(self + i) % queues.size()].Steal(&task)) break;
+		}
+		if (i == queues.size()) return;
+		(*shared->steals)++;
+		runTask(shared, task);
+	}
+}
+
+/* Comma separated list of numbers */
+static bool parseList(const char* text, std::vector<double>* values)
+{
+	char* end;
+
+	values->clear();
+	for (;;) {
+		values->push_back(strtod(text, &end));
+		if (end == text) return false;
+		if (*end == '\0') return true;
+		if (*end != ',') return false;
+		text = end + 1;
+	}
+}
+
+static bool sameParams(const gestureParams & a, const gestureParams & b)
+{
+	return a.stopMargin == b.stopMargin && a.stopHoldFrames == b.stopHoldFrames && a.sequenceCount == b.sequenceCount
+		&& a.waveCount == b.waveCount && a.turnDeadband == b.turnDeadband && a.commitConfidence == b.commitConfidence;
+}
+
+static void printResult(const sweepResult & r, const char* note)
+{
+	printf("%8.3f %6d %6d %6d %9.3f %10.3f %7.3f %6.3f %9.1f  %s\n", r.params.stopMargin, r.params.stopHoldFrames, r.params.sequenceCount,
+		r.params.waveCount, r.params.turnDeadband, r.precision, r.recall, r.f1, r.latency, note);
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<corpusSession> sessions;
+	std::vector<SkeletonLogReader*> readers;
+	std::vector<sweepResult> results;
+	std::vector<corpusScore> taskScores;
+	std::vector<std::thread> threads;
+	std::vector<double> stopMargins, stopHolds, sequences, waves, deadbands;
+	std::atomic<uint64_t> steals(0), frames(0);
+	gestureParams defaults, p;
+	sweepShared shared;
+	sweepResult r;
+	const char* csvPath = NULL;
+	size_t a, b, c, d, e, i, s, threadCount, tasks;
+	int c2;
+
+	Gesture::getDefaultParams(&defaults);
+	parseList("0.15,0.25,0.4,0.5,0.65", &stopMargins);
+	parseList("3,5,8", &stopHolds);
+	parseList("1,2,3", &sequences);
+	parseList("1,2,3", &waves);
+	parseList("0,0.08,0.15,0.25", &deadbands);
+	threadCount = std::thread::hardware_concurrency();
+	if (threadCount < 1) threadCount = 1;
+
+	if (argc < 2) {
+		printf("Usage: %s <corpus list> [-threads <n>] [-csv <file>] [-stop-margin <w,...>] [-stop-hold <frames,...>]\n"
+			"\t[-sequence <n,...>] [-waves <n,...>] [-deadband <w,...>]\n", argv[0]);
+		return 1;
+	}
+	for (c2 = 2; c2 < argc; c2++) {
+		bool ok = (c2 + 1 < argc);
+		if (ok && strcmp(argv[c2], "-threads") == 0) threadCount = (size_t)atoi(argv[++c2]);
+		else if (ok && strcmp(argv[c2], "-csv") == 0) csvPath = argv[++c2];
+		else if (ok && strcmp(argv[c2], "-stop-margin") == 0) ok = parseList(argv[++c2], &stopMargins);
+		else if (ok && strcmp(argv[c2], "-stop-hold") == 0) ok = parseList(argv[++c2], &stopHolds);
+		else if (ok && strcmp(argv[c2], "-sequence") == 0) ok = parseList(argv[++c2], &sequences);
+		else if (ok && strcmp(argv[c2], "-waves") == 0) ok = parseList(argv[++c2], &waves);
+		else if (ok && strcmp(argv[c2], "-deadband") == 0) ok = parseList(argv[++c2], &deadbands);
+		else ok = false;
+		if (!ok || threadCount < 1) {
+			printf("Bad option %s\n", argv[c2]);
+			return 1;
+		}
+	}
+
+	if (loadCorpus(argv[1], &sessions) != 0 || sessions.empty()) return 1;
+	for (s = 0; s < sessions.size(); s++) {
+		readers.push_back(new SkeletonLogReader());
+		if (readers[s]->Open(sessions[s].logPath.c_str()) != 0) return 1;
+	}
+
+	/* Every grid point the automatons can hold */
+	for (a = 0; a < stopMargins.size(); a++) for (b = 0; b < stopHolds.size(); b++) for (c = 0; c < sequences.size(); c++)
+	for (d = 0; d < waves.size(); d++) for (e = 0; e < deadbands.size(); e++) {
+		gestureMachine machines[GESTURE_COUNT];
+		p.stopMargin = stopMargins[a];
+		p.stopHoldFrames = (int)stopHolds[b];
+		p.sequenceCount = (int)sequences[c];
+		p.waveCount = (int)waves[d];
+		p.turnDeadband = deadbands[e];
+		p.commitConfidence = defaults.commitConfidence;
+		if (Gesture::compileGestures(p, machines) != 0) continue;
+		memset(&r, 0x00, sizeof(r));
+		r.params = p;
+		results.push_back(r);
+	}
+	if (results.empty()) {
+		printf("No valid parameter sets in the grid.\n");
+		return 1;
+	}
+
+	/* Deal tasks round robin so every deque starts with a similar mix of sessions */
+	tasks = results.size() * sessions.size();
+	taskScores.resize(tasks);
+	std::vector<SweepQueue> queues(threadCount);
+	for (i = 0; i < tasks; i++) queues[i % threadCount].Push((uint32_t)i);
+
+	shared.sessions = &sessions;
+	shared.readers = &readers;
+	shared.results = &results;
+	shared.taskScores = &taskScores;
+	shared.queues = &queues;
+	shared.steals = &steals;
+	shared.frames = &frames;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (i = 0; i < threadCount; i++) threads.push_back(std::thread(worker, &shared, i));
+	for (i = 0; i < threadCount; i++) threads[i].join();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	/* Merge session scores into each parameter set */
+	for (i = 0; i < results.size(); i++) {
+		corpusClassScore total;
+		clearScore(&results[i].score);
+		for (s = 0; s < sessions.size(); s++) {
+			const corpusScore& t = taskScores[i * sessions.size() + s];
+			for (c = 0; c < CORPUS_CLASS_COUNT; c++) {
+				results[i].score.classes[c].truePositives += t.classes[c].truePositives;
+				results[i].score.classes[c].falsePositives += t.classes[c].falsePositives;
+				results[i].score.classes[c].falseNegatives += t.classes[c].falseNegatives;
+				results[i].score.classes[c].latencySum += t.classes[c].latencySum;
+				results[i].score.classes[c].latencyMax = std::max(results[i].score.classes[c].latencyMax, t.classes[c].latencyMax);
+			}
+			results[i].score.frames += t.frames;
+		}
+		memset(&total, 0x00, sizeof(total));
+		for (c = 0; c < CORPUS_CLASS_COUNT; c++) {
+			total.truePositives += results[i].score.classes[c].truePositives;
+			total.falsePositives += results[i].score.classes[c].falsePositives;
+			total.falseNegatives += results[i].score.classes[c].falseNegatives;
+		}
+		results[i].precision = scorePrecision(total);
+		results[i].recall = scoreRecall(total);
+		results[i].f1 = scoreF1(results[i].score);
+		results[i].latency = scoreMeanLatency(results[i].score);
+	}
+
+	printf("%d parameter sets x %d sessions on %d threads: %.2f s, %.1f M frames/s, %llu tasks stolen\n",
+		(int)results.size(), (int)sessions.size(), (int)threadCount, elapsed.count(),
+		(double)frames / elapsed.count() / 1e6, (unsigned long long)steals);
+
+	if (csvPath != NULL) {
+		FILE* csv = fopen(csvPath, "w");
+		if (csv == NULL) {
+			printf("ERROR: could not create %s.\n", csvPath);
+			return 1;
+		}
+		fprintf(csv, "stop_margin,stop_hold,sequence,waves,deadband,precision,recall,f1,latency");
+		for (c = 0; c < CORPUS_CLASS_COUNT; c++) fprintf(csv, ",%s_precision,%s_recall", corpusClassName((int)c), corpusClassName((int)c));
+		fprintf(csv, "\n");
+		for (i = 0; i < results.size(); i++) {
+			const sweepResult& t = results[i];
+			fprintf(csv, "%g,%d,%d,%d,%g,%.4f,%.4f,%.4f,%.2f", t.params.stopMargin, t.params.stopHoldFrames, t.params.sequenceCount,
+				t.params.waveCount, t.params.turnDeadband, t.precision, t.recall, t.f1, t.latency);
+			for (c = 0; c < CORPUS_CLASS_COUNT; c++) fprintf(csv, ",%.4f,%.4f", scorePrecision(t.score.classes[c]), scoreRecall(t.score.classes[c]));
+			fprintf(csv, "\n");
+		}
+		fclose(csv);
+	}
+
+	/* Pareto front: by increasing latency, keep each set that beats the best F1 so far */
+	std::vector<size_t> order(results.size());
+	for (i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [&results](size_t x, size_t y) {
+		return (results[x].latency != results[y].latency) ? results[x].latency < results[y].latency : results[x].f1 > results[y].f1;
+	});
+
+	printf("\nPareto front (F1 against mean latency in frames)\n");
+	printf(" margin   hold    seq  waves  deadband  precision  recall     F1   latency\n");
+	double bestF1 = -1.0;
+	for (i = 0; i < order.size(); i++) {
+		const sweepResult& t = results[order[i]];
+		if (t.f1 <= bestF1) continue;
+		bestF1 = t.f1;
+		printResult(t, sameParams(t.params, defaults) ? "(default)" : "");
+	}
+	for (i = 0; i < results.size(); i++) {
+		if (sameParams(results[i].params, defaults)) {
+			printf("\nDefault parameters\n");
+			printResult(results[i], "");
+		}
+	}
+
+	for (s = 0; s < readers.size(); s++) delete readers[s];
+	return 0;
+}
@@ -0,0 +1,283 @@
+/*****************************************************
+*	GestureSynth.cpp
+*
+*	Writes a labeled corpus of synthetic sessions: an
+*	operator performs scripted gestures between rests,
+*	with per-session speed, per-gesture variation and
+*	sensor noise. Some motions are distractors that look
+*	partly like gestures (one wave, hand raised to the
+*	head, hands on hips) and are not labeled, so a
+*	recognizer reporting them loses precision.
+*
+*	The corpus stands in for recorded sessions until
+*	real labeled recordings are added to a corpus list.
+*
+*	Usage: GestureSynth <output dir> [sessions] [seed]
+*	Writes session<N>.skl, session<N>.lbl and corpus.txt.
+*****************************************************/
+
+#include "GestureCorpus.h"
+#include "SkeletonLog.h"
+#include "StateMachineDefs.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#define SYNTH_FRAME_MS			33
+#define SYNTH_EVENTS			40		// gestures and distractors per session
+#define SYNTH_NOISE_M			0.008f
+#define SYNTH_DISTRACTOR_ODDS	0.15f
+
+/* Motions the operator performs */
+#define SYNTH_STOP			0
+#define SYNTH_FORWARD		1
+#define SYNTH_REVERSE		2
+#define SYNTH_TURN_L		3
+#define SYNTH_TURN_R		4
+#define SYNTH_AUTO			5
+#define SYNTH_MANUAL		6
+#define SYNTH_GESTURES		7
+#define SYNTH_ONE_WAVE		7		// distractors from here on
+#define SYNTH_SCRATCH_HEAD	8
+#define SYNTH_HANDS_ON_HIPS	9
+#define SYNTH_MOTIONS		10
+
+static const uint16_t synthCommands[SYNTH_GESTURES] = {
+	STOP_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK, AUTO_MODE_CMD_MASK, MANUAL_MODE_CMD_MASK
+};
+
+typedef struct {
+	float	x, y;
+}synthPoint;
+
+/* Hand targets the motion passes through, each held for hold frames */
+typedef struct {
+	synthPoint	rh, lh;
+	int			hold;
+}synthKey;
+
+static const synthPoint restRH = { 0.30f, -0.35f };
+static const synthPoint restLH = { -0.30f, -0.35f };
+
+class SynthSession
+{
+public:
+	SynthSession(std::mt19937* rng, float speed) :
+		rng(rng),
+		speed(speed),
+		noise(0.0f, SYNTH_NOISE_M),
+		uni(0.0f, 1.0f),
+		rh(restRH),
+		lh(restLH),
+		frames(0)
+	{
+		memset(&frame, 0x00, sizeof(frame));
+	}
+
+	int Open(const char* path) { return writer.Open(path); }
+	void Close() { writer.Close(); }
+	uint32_t getFrame() { return (uint32_t)frames; }
+
+	/* Hold the current pose */
+	void Hold(int n)
+	{
+		for (int i = 0; i < n; i++) Emit();
+	}
+
+	/* Move both hands to a key pose with a smooth start and stop, then hold it */
+	void Move(const synthKey & key)
+	{
+		synthPoint rh0 = rh, lh0 = lh;
+		int n = (int)((4.0f + 4.0f * uni(*rng)) / speed), i;
+
+		for (i = 1; i <= n; i++) {
+			float u = (float)i / (float)n;
+			u = u * u * (3.0f - 2.0f * u);
+			rh.x = rh0.x + (key.rh.x - rh0.x) * u;
+			rh.y = rh0.y + (key.rh.y - rh0.y) * u;
+			lh.x = lh0.x + (key.lh.x - lh0.x) * u;
+			lh.y = lh0.y + (key.lh.y - lh0.y) * u;
+			Emit();
+		}
+		Hold((int)((float)key.hold / speed));
+	}
+
+	float Vary(float v, float amount) { return v + amount * (2.0f * uni(*rng) - 1.0f); }
+
+private:
+	void Emit()
+	{
+		skeletonData& d = frame.skeletons[2];
+		const float z = 2.2f;
+		int j;
+
+		frame.timestamp = frames * SYNTH_FRAME_MS;
+		frame.frameNumber = (uint32_t)frames;
+		d.trackingState = SKELETON_TRACKED;
+		d.trackingID = 1;
+		d.position.x = 0.0f;
+		d.position.y = 0.0f;
+		d.position.z = z;
+
+		setJoint(d, SKELETON_POSITION_HIP_CENTER, 0.0f, -0.15f);
+		setJoint(d, SKELETON_POSITION_SPINE, 0.0f, 0.10f);
+		setJoint(d, SKELETON_POSITION_SHOULDER_CENTER, 0.0f, 0.45f);
+		setJoint(d, SKELETON_POSITION_HEAD, 0.0f, 0.65f);
+		setJoint(d, SKELETON_POSITION_SHOULDER_LEFT, -0.20f, 0.40f);
+		setJoint(d, SKELETON_POSITION_SHOULDER_RIGHT, 0.20f, 0.40f);
+		setJoint(d, SKELETON_POSITION_ELBOW_LEFT, -0.28f, 0.12f);
+		setJoint(d, SKELETON_POSITION_ELBOW_RIGHT, 0.28f, 0.12f);
+		setJoint(d, SKELETON_POSITION_HAND_LEFT, lh.x, lh.y);
+		setJoint(d, SKELETON_POSITION_HAND_RIGHT, rh.x, rh.y);
+		setJoint(d, SKELETON_POSITION_WRIST_LEFT, (lh.x - 0.28f) * 0.5f, (lh.y + 0.12f) * 0.5f);
+		setJoint(d, SKELETON_POSITION_WRIST_RIGHT, (rh.x + 0.28f) * 0.5f, (rh.y + 0.12f) * 0.5f);
+		setJoint(d, SKELETON_POSITION_HIP_LEFT, -0.10f, -0.20f);
+		setJoint(d, SKELETON_POSITION_HIP_RIGHT, 0.10f, -0.20f);
+		setJoint(d, SKELETON_POSITION_KNEE_LEFT, -0.12f, -0.60f);
+		setJoint(d, SKELETON_POSITION_KNEE_RIGHT, 0.12f, -0.60f);
+		setJoint(d, SKELETON_POSITION_ANKLE_LEFT, -0.12f, -0.95f);
+		setJoint(d, SKELETON_POSITION_ANKLE_RIGHT, 0.12f, -0.95f);
+		setJoint(d, SKELETON_POSITION_FOOT_LEFT, -0.12f, -1.00f);
+		setJoint(d, SKELETON_POSITION_FOOT_RIGHT, 0.12f, -1.00f);
+		for (j = 0; j < SKELETON_POSITION_COUNT; j++) {
+			d.joints[j].x += noise(*rng);
+			d.joints[j].y += noise(*rng);
+			d.joints[j].z = z + noise(*rng);
+		}
+
+		writer.WriteFrame(frame);
+		frames++;
+	}
+
+	static void setJoint(skeletonData & d, int joint, float x, float y)
+	{
+		d.joints[joint].x = x;
+		d.joints[joint].y = y;
+	}
+
+	std::mt19937*							rng;
+	float									speed;
+	std::normal_distribution<float>			noise;
+	std::uniform_real_distribution<float>	uni;
+	synthPoint								rh, lh;
+	skeletonFrame							frame;
+	int64_t									frames;
+	SkeletonLogWriter						writer;
+};
+
+/* Perform one motion from rest and return to rest */
+static void perform(SynthSession & s, int motion)
+{
+	synthKey keys[6];
+	int n = 0, i, hold = 2;
+	float h;
+
+	switch (motion) {
+	case SYNTH_STOP:
+		keys[n++] = { { s.Vary(0.25f, 0.05f), s.Vary(0.80f, 0.08f) }, restLH, 10 + (int)s.Vary(6.0f, 4.0f) };
+		break;
+	case SYNTH_FORWARD:
+		for (i = 0; i < 2; i++) {
+			keys[n++] = { { s.Vary(0.33f, 0.02f), s.Vary(0.00f, 0.05f) }, restLH, hold };
+			keys[n++] = { { s.Vary(0.33f, 0.02f), s.Vary(0.32f, 0.06f) }, restLH, hold };
+		}
+		break;
+	case SYNTH_REVERSE:
+		for (i = 0; i < 2; i++) {
+			keys[n++] = { restRH, { s.Vary(-0.34f, 0.02f), s.Vary(0.30f, 0.06f) }, hold };
+			keys[n++] = { restRH, { s.Vary(-0.34f, 0.02f), s.Vary(0.00f, 0.05f) }, hold };
+		}
+		break;
+	case SYNTH_TURN_L:
+	case SYNTH_TURN_R:
+		h = s.Vary(0.15f, 0.06f) * ((motion == SYNTH_TURN_L) ? 1.0f : -1.0f);
+		keys[n++] = { { s.Vary(0.35f, 0.05f), 0.10f + h }, { s.Vary(-0.35f, 0.05f), 0.10f - h }, 20 + (int)s.Vary(10.0f, 10.0f) };
+		break;
+	case SYNTH_AUTO:
+		for (i = 0; i < 2; i++) {
+			keys[n++] = { restRH, { s.Vary(-0.42f, 0.04f), s.Vary(0.35f, 0.06f) }, hold };
+			keys[n++] = { restRH, { s.Vary(-0.14f, 0.04f), s.Vary(0.35f, 0.06f) }, hold };
+		}
+		break;
+	case SYNTH_MANUAL:
+		for (i = 0; i < 2; i++) {
+			keys[n++] = { { s.Vary(0.44f, 0.04f), s.Vary(0.35f, 0.06f) }, restLH, hold };
+			keys[n++] = { { s.Vary(0.12f, 0.04f), s.Vary(0.35f, 0.06f) }, restLH, hold };
+		}
+		break;
+	case SYNTH_ONE_WAVE:
+		keys[n++] = { { s.Vary(0.44f, 0.04f), s.Vary(0.35f, 0.06f) }, restLH, hold };
+		keys[n++] = { { s.Vary(0.12f, 0.04f), s.Vary(0.35f, 0.06f) }, restLH, hold };
+		break;
+	case SYNTH_SCRATCH_HEAD:
+		keys[n++] = { { s.Vary(0.10f, 0.03f), s.Vary(0.62f, 0.04f) }, restLH, 2 };
+		break;
+	default:
+		keys[n++] = { { s.Vary(0.20f, 0.02f), s.Vary(-0.12f, 0.03f) }, { s.Vary(-0.20f, 0.02f), s.Vary(-0.12f, 0.03f) }, 20 };
+		break;
+	}
+
+	for (i = 0; i < n; i++) s.Move(keys[i]);
+	s.Move({ restRH, restLH, 0 });
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<corpusLabel> labels;
+	std::string dir, name;
+	corpusLabel label;
+	FILE* list;
+	int sessions, seed, n, e, motion;
+
+	if (argc < 2) {
+		printf("Usage: %s <output dir> [sessions] [seed]\n", argv[0]);
+		return 1;
+	}
+	dir = argv[1];
+	if (dir[dir.size() - 1] != '/') dir += "/";
+	sessions = (argc > 2) ? atoi(argv[2]) : 8;
+	seed = (argc > 3) ? atoi(argv[3]) : 1;
+
+	list = fopen((dir + "corpus.txt").c_str(), "w");
+	if (list == NULL) {
+		printf("ERROR: could not create %scorpus.txt.\n", dir.c_str());
+		return 1;
+	}
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	for (n = 0; n < sessions; n++) {
+		SynthSession s(&rng, 0.8f + 0.5f * uni(rng));
+		name = "session" + std::to_string(n);
+		if (s.Open((dir + name + ".skl").c_str()) != 0) return 1;
+
+		labels.clear();
+		s.Hold(30);
+		for (e = 0; e < SYNTH_EVENTS; e++) {
+			if (uni(rng) < SYNTH_DISTRACTOR_ODDS) motion = SYNTH_GESTURES + (int)(uni(rng) * (SYNTH_MOTIONS - SYNTH_GESTURES)) % (SYNTH_MOTIONS - SYNTH_GESTURES);
+			else motion = (int)(uni(rng) * SYNTH_GESTURES) % SYNTH_GESTURES;
+
+			label.first = s.getFrame();
+			perform(s, motion);
+			label.last = s.getFrame() - 1;
+			if (motion < SYNTH_GESTURES) {
+				label.command = synthCommands[motion];
+				labels.push_back(label);
+			}
+			s.Hold(20 + (int)(uni(rng) * 30.0f));
+		}
+		s.Close();
+
+		if (writeLabels((dir + name + ".lbl").c_str(), labels) != 0) return 1;
+		fprintf(list, "%s.skl %s.lbl\n", name.c_str(), name.c_str());
+	}
+
+	fclose(list);
+	printf("Wrote %d sessions to %s\n", sessions, dir.c_str());
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*****************************************************
+*	InputQueueStress.cpp
+*
+*	Stress test of the InputQueue. Producer threads
+*	push numbered inputs as fast as they can, retrying
+*	when the queue is full, while one consumer pops;
+*	every input must arrive exactly once and in order
+*	per producer. Then a burst larger than the queue is
+*	pushed with no consumer, which must drop exactly
+*	the excess and count it.
+*
+*	Usage: InputQueueStress [producers] [inputs per producer]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "InputQueue.h"
+#include "LatencyTrace.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static InputQueue queue;
+static std::atomic<bool> go(false);
+
+static void producer(int id, uint32_t count, uint64_t* retries)
+{
+	inputEvent e;
+	uint32_t i;
+
+	memset(&e, 0x00, sizeof(e));
+	e.source = id;
+	while (!go.load()) std::this_thread::yield();
+	for (i = 1; i <= count; i++) {
+		e.frameID = i;
+		e.postTime = LatencyTrace::Now();
+		while (queue.Push(e) != 0) {
+			(*retries)++;
+			std::this_thread::yield();
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int producers, p;
+	uint32_t count, i;
+	uint64_t popped, errors, retries, overflowsBefore;
+	int64_t delay, maxDelay;
+	inputEvent e;
+
+	producers = (argc > 1) ? atoi(argv[1]) : 3;
+	count = (argc > 2) ? (uint32_t)atoi(argv[2]) : 1000000;
+	if (producers < 1 || count < 1) {
+		printf("Usage: %s [producers] [inputs per producer]\n", argv[0]);
+		return 1;
+	}
+
+	/* Concurrent producers */
+	std::vector<std::thread> threads;
+	std::vector<uint64_t> producerRetries(producers, 0);
+	std::vector<uint32_t> expected(producers, 1);
+	for (p = 0; p < producers; p++) threads.push_back(std::thread(producer, p, count, &producerRetries[p]));
+	go = true;
+
+	auto start = std::chrono::steady_clock::now();
+	popped = 0;
+	errors = 0;
+	maxDelay = 0;
+	while (popped < (uint64_t)producers * count) {
+		if (!queue.Pop(&e)) {
+			std::this_thread::yield();
+			continue;
+		}
+		popped++;
+		if (e.source < 0 || e.source >= producers || e.frameID != expected[e.source]) {
+			if (errors++ < 10) printf("ERROR: producer %d input %lu arrived, expected %lu\n", e.source,
+				(unsigned long)e.frameID, (e.source >= 0 && e.source < producers) ? (unsigned long)expected[e.source] : 0ul);
+			if (e.source < 0 || e.source >= producers) continue;
+		}
+		expected[e.source] = e.frameID + 1;
+		delay = LatencyTrace::Now() - e.postTime;
+		if (delay > maxDelay) maxDelay = delay;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	for (p = 0; p < producers; p++) threads[p].join();
+	for (retries = 0, p = 0; p < producers; p++) retries += producerRetries[p];
+	if (queue.Pop(&e)) errors++;
+
+	printf("%d producers x %lu inputs: %llu popped, %llu out of order or lost, %.1f M inputs/s\n", producers, (unsigned long)count,
+		(unsigned long long)popped, (unsigned long long)errors, popped / elapsed.count() / 1e6);
+	printf("Queue full %llu times, most waiting %d of %d, longest wait %lld us\n", (unsigned long long)retries,
+		queue.getMaxDepth(), INPUT_QUEUE_CAPACITY, (long long)maxDelay);
+
+	/* Burst with no consumer */
+	overflowsBefore = queue.getOverflows();
+	memset(&e, 0x00, sizeof(e));
+	for (i = 0; i < 2 * INPUT_QUEUE_CAPACITY; i++) {
+		e.frameID = i;
+		queue.Push(e);
+	}
+	if (queue.getOverflows() - overflowsBefore != INPUT_QUEUE_CAPACITY || queue.getDepth() != INPUT_QUEUE_CAPACITY) errors++;
+	for (i = 0; queue.Pop(&e); i++) {
+		if (e.frameID != i) errors++;
+	}
+	if (i != INPUT_QUEUE_CAPACITY) errors++;
+	printf("Burst of %d: %lu dropped, %lu kept in order\n", 2 * INPUT_QUEUE_CAPACITY,
+		(unsigned long)(queue.getOverflows() - overflowsBefore), (unsigned long)i);
+	queue.Print(stdout);
+
+	return (errors == 0) ? 0 : 1;
+}
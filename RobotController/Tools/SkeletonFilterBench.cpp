@@ -0,0 +1,209 @@
+/*****************************************************
+*	SkeletonFilterBench.cpp
+*
+*	Measures the jitter SkeletonFilter removes and the
+*	lag it adds.
+*
+*	Without a log, a synthetic operator raises and lowers
+*	the right hand between rests, with sensor noise added.
+*	Rest jitter is the RMS error against the true hand
+*	position while it is still. Lag is how much later the
+*	filtered hand crosses the middle of each swing.
+*
+*	With a skeleton log there is no true position: jitter
+*	is the RMS second difference of the right hand (frame
+*	to frame shake) and lag is the shift that best aligns
+*	the filtered hand with the raw hand.
+*
+*	Usage: SkeletonFilterBench [minCutoff beta dCutoff] [skeleton log]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "SkeletonFilter.h"
+#include "SkeletonLog.h"
+
+#include <random>
+#include <vector>
+
+#define BENCH_FRAME_MS			33
+#define BENCH_NOISE_M			0.01f	// Kinect v1 joint noise is around 1 cm at 2 m
+#define BENCH_SWING_M			0.5f
+#define BENCH_MAX_SHIFT			15		// frames searched when aligning a log
+
+typedef struct {
+	float	jitter;		// m
+	float	lagMs;
+	float	maxLagMs;
+}filterResult;
+
+/* Right hand height of the synthetic operator: rest, swing up over swingFrames, rest, swing down */
+static float syntheticHand(int f, int restFrames, int swingFrames)
+{
+	int period = 2 * (restFrames + swingFrames);
+	int t = f % period;
+	float u;
+
+	if (t < restFrames) return 0.0f;
+	t -= restFrames;
+	if (t < swingFrames) {
+		u = (float)t / (float)swingFrames;
+		return BENCH_SWING_M * u * u * (3.0f - 2.0f * u);
+	}
+	t -= swingFrames;
+	if (t < restFrames) return BENCH_SWING_M;
+	t -= restFrames;
+	u = (float)t / (float)swingFrames;
+	return BENCH_SWING_M * (1.0f - u * u * (3.0f - 2.0f * u));
+}
+
+static filterResult runSynthetic(SkeletonFilter* filter, bool smooth, int swingFrames)
+{
+	const int restFrames = 30, swings = 200;
+	const int frames = swings * (restFrames + swingFrames);
+	std::mt19937 rng(42);
+	std::normal_distribution<float> noise(0.0f, BENCH_NOISE_M);
+	std::vector<float> truth(frames), out(frames);
+	skeletonFrame frame;
+	filterResult result;
+	double restError = 0.0, lagSum = 0.0;
+	int restCount = 0, lagCount = 0, f, j, period;
+
+	filter->Reset();
+	memset(&frame, 0x00, sizeof(frame));
+	frame.skeletons[0].trackingState = SKELETON_TRACKED;
+	frame.skeletons[0].trackingID = 1;
+	for (f = 0; f < frames; f++) {
+		truth[f] = syntheticHand(f, restFrames, swingFrames);
+		frame.timestamp = (int64_t)f * BENCH_FRAME_MS;
+		for (j = 0; j < SKELETON_POSITION_COUNT; j++) {
+			frame.skeletons[0].joints[j].x = noise(rng);
+			frame.skeletons[0].joints[j].y = noise(rng);
+			frame.skeletons[0].joints[j].z = 2.0f + noise(rng);
+		}
+		frame.skeletons[0].joints[SKELETON_POSITION_HAND_RIGHT].y += truth[f];
+		if (smooth) filter->Apply(frame, &frame);
+		out[f] = frame.skeletons[0].joints[SKELETON_POSITION_HAND_RIGHT].y;
+	}
+
+	/* Rest error, skipping the first frames of each rest while the filter settles */
+	period = restFrames + swingFrames;
+	for (f = period; f < frames; f++) {
+		int t = f % period;
+		if (t >= restFrames / 2 && t < restFrames) {
+			restError += (double)(out[f] - truth[f]) * (out[f] - truth[f]);
+			restCount++;
+		}
+	}
+
+	/* Lag at the middle of each swing, interpolated between frames */
+	result.maxLagMs = 0.0f;
+	for (f = period; f + period < frames; f += period) {
+		int mid = f + restFrames + swingFrames / 2;
+		bool up = truth[mid] < truth[mid + 1];
+		float level = BENCH_SWING_M * 0.5f;
+		int g;
+		for (g = f + restFrames; g < f + period + restFrames / 2; g++) {
+			if (up ? (out[g] < level && out[g + 1] >= level) : (out[g] > level && out[g + 1] <= level)) break;
+		}
+		float cross = (float)g + (level - out[g]) / (out[g + 1] - out[g]);
+		float truthCross = (float)(f + restFrames) + (float)swingFrames * 0.5f;
+		float lag = (cross - truthCross) * BENCH_FRAME_MS;
+		lagSum += lag;
+		lagCount++;
+		if (lag > result.maxLagMs) result.maxLagMs = lag;
+	}
+
+	result.jitter = (float)sqrt(restError / (restCount > 0 ? restCount : 1));
+	result.lagMs = (float)(lagSum / (lagCount > 0 ? lagCount : 1));
+	return result;
+}
+
+static filterResult runLog(SkeletonFilter* filter, SkeletonLogReader* reader)
+{
+	std::vector<float> raw, out;
+	skeletonFrame frame;
+	filterResult result;
+	uint32_t trackingID = 0;
+	double shake, bestError, error;
+	uint64_t i;
+	int s, bestShift, n;
+
+	/* Right hand height of the first tracked person, while they stay tracked */
+	filter->Reset();
+	for (i = 0; i < reader->getFrameCount(); i++) {
+		const skeletonFrame* in = reader->getFrame(i);
+		filter->Apply(*in, &frame);
+		for (s = 0; s < SKELETON_COUNT; s++) {
+			if (in->skeletons[s].trackingState != SKELETON_TRACKED) continue;
+			if (trackingID == 0) trackingID = in->skeletons[s].trackingID;
+			if (in->skeletons[s].trackingID != trackingID) continue;
+			raw.push_back(in->skeletons[s].joints[SKELETON_POSITION_HAND_RIGHT].y);
+			out.push_back(frame.skeletons[s].joints[SKELETON_POSITION_HAND_RIGHT].y);
+			break;
+		}
+		if (s == SKELETON_COUNT && trackingID != 0) break;
+	}
+
+	n = (int)raw.size();
+	shake = 0.0;
+	for (s = 2; s < n; s++) shake += (double)(out[s] - 2.0f * out[s - 1] + out[s - 2]) * (out[s] - 2.0f * out[s - 1] + out[s - 2]);
+	result.jitter = (float)sqrt(shake / (n > 2 ? n - 2 : 1));
+
+	/* Filtered hand compared with the raw hand delayed by each shift */
+	bestShift = 0;
+	bestError = -1.0;
+	for (s = 0; s <= BENCH_MAX_SHIFT && s < n; s++) {
+		error = 0.0;
+		for (i = (uint64_t)s; i < (uint64_t)n; i++) error += (double)(out[i] - raw[i - s]) * (out[i] - raw[i - s]);
+		error /= (double)(n - s);
+		if (bestError < 0.0 || error < bestError) {
+			bestError = error;
+			bestShift = s;
+		}
+	}
+	result.lagMs = (float)(bestShift * BENCH_FRAME_MS);
+	result.maxLagMs = result.lagMs;
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	SkeletonFilter filter;
+	SkeletonLogReader reader;
+	const char* logPath = NULL;
+	filterResult raw, smooth;
+	int swing;
+
+	if (argc >= 4) {
+		filter.setParameters((float)atof(argv[1]), (float)atof(argv[2]), (float)atof(argv[3]));
+		if (argc > 4) logPath = argv[4];
+	}
+	else if (argc == 2) {
+		logPath = argv[1];
+	}
+	else if (argc != 1) {
+		printf("Usage: %s [minCutoff beta dCutoff] [skeleton log]\n", argv[0]);
+		return 1;
+	}
+	printf("One Euro filter: minCutoff %.2f Hz, beta %.2f, dCutoff %.2f Hz\n", filter.getMinCutoff(), filter.getBeta(), filter.getDCutoff());
+
+	if (logPath != NULL) {
+		if (reader.Open(logPath) != 0) return 1;
+		SkeletonFilter passThrough;
+		passThrough.setParameters(1e6f, 0.0f, 1.0f);
+		raw = runLog(&passThrough, &reader);
+		smooth = runLog(&filter, &reader);
+		printf("Right hand shake %.2f mm/frame^2 raw, %.2f filtered (%.1fx less), lag %.0f ms\n",
+			raw.jitter * 1000.0f, smooth.jitter * 1000.0f, raw.jitter / smooth.jitter, smooth.lagMs);
+		return 0;
+	}
+
+	printf("Swing (ms)  rest jitter raw (mm)  filtered (mm)  mean lag (ms)  max lag (ms)\n");
+	for (swing = 6; swing <= 24; swing *= 2) {
+		raw = runSynthetic(&filter, false, swing);
+		smooth = runSynthetic(&filter, true, swing);
+		printf("%10d %21.2f %14.2f %14.1f %13.1f\n", swing * BENCH_FRAME_MS, raw.jitter * 1000.0f, smooth.jitter * 1000.0f, smooth.lagMs, smooth.maxLagMs);
+	}
+	return 0;
+}
@@ -0,0 +1,69 @@
+/*****************************************************
+*	SkeletonStream.cpp
+*
+*	Sends a recorded skeleton log as UDP datagrams to a
+*	UdpSkeletonSource (RobotController -udp <port>).
+*	Frames are paced by their recorded timestamps unless
+*	-fast is given, which sends them back to back for
+*	load testing.
+*
+*	Usage: SkeletonStream <skeleton log> <host> <port> [-fast]
+*****************************************************/
+
+#include "SkeletonLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+int main(int argc, char* argv[])
+{
+	SkeletonLogReader	reader;
+	struct addrinfo		hints, *servinfo;
+	const skeletonFrame	*frame, *prev;
+	uint64_t			i, frameCount;
+	int					sockfd, rv;
+	bool				fast;
+
+	if (argc < 4) {
+		printf("Usage: %s <skeleton log> <host> <port> [-fast]\n", argv[0]);
+		return 1;
+	}
+	fast = (argc > 4 && strcmp(argv[4], "-fast") == 0);
+
+	if (reader.Open(argv[1]) != 0) return 1;
+	frameCount = reader.getFrameCount();
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if ((rv = getaddrinfo(argv[2], argv[3], &hints, &servinfo)) != 0) {
+		printf("ERROR: getaddrinfo: %s\n", gai_strerror(rv));
+		return 1;
+	}
+	if ((sockfd = socket(servinfo->ai_family, servinfo->ai_socktype, servinfo->ai_protocol)) == -1) {
+		printf("ERROR: Socket creation error.\n");
+		return 1;
+	}
+
+	printf("Streaming %llu frames to %s:%s\n", (unsigned long long)frameCount, argv[2], argv[3]);
+	prev = NULL;
+	for (i = 0; i < frameCount; i++) {
+		frame = reader.getFrame(i);
+		if (!fast && prev != NULL && frame->timestamp > prev->timestamp) {
+			usleep((useconds_t)((frame->timestamp - prev->timestamp) * 1000));
+		}
+		if (sendto(sockfd, (const char*)frame, sizeof(skeletonFrame), 0, servinfo->ai_addr, servinfo->ai_addrlen) == -1) {
+			printf("ERROR: sendto failed on frame %llu.\n", (unsigned long long)i);
+		}
+		prev = frame;
+	}
+
+	freeaddrinfo(servinfo);
+	close(sockfd);
+	return 0;
+}
@@ -0,0 +1,1111 @@
+/*****************************************************
+*	SlxImport.cpp
+*
+*	Generates the StateMachine transition specification
+*	from the Stateflow chart inside a Simulink model
+*	(.slx), so changes to the model reach the controller
+*	without transcribing them by hand.
+*
+*	The chart's leaf states are mapped by path to the
+*	StateMachine states (see chartLeaves) and its guards
+*	to FSM_COND_* conditions. Transitions are ordered as
+*	Stateflow evaluates them: the outermost active state
+*	first, each state's transitions in execution order.
+*	A transition into a superstate follows its default
+*	transitions. Entering a state whose transitions use
+*	after(n,tick) restarts the tick count. Every guard is
+*	checked against the generated rows over all input
+*	values, and a chart the StateMachine cannot express
+*	(junctions, events, unknown data, a guard reading
+*	inputs its mode does not see) is rejected.
+*	State actions (the safe/backup outputs) are ignored,
+*	and a state that takes no transition repeats its
+*	command.
+*
+*	The .slx archive is read with unzip.
+*
+*	Usage: SlxImport <model.slx> [-chart <name>] [-o <header>]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+
+#include <map>
+#include <vector>
+
+#define SLX_DEFAULT_CHART	"Robot Model"
+#define SLX_MAX_ENV_TICKS	3
+
+/*****************************************************
+*	Minimal XML reader, enough for stateflow.xml
+*****************************************************/
+typedef struct xmlNode {
+	std::string							name;
+	std::map<std::string, std::string>	attrs;
+	std::string							text;
+	std::vector<xmlNode>				children;
+}xmlNode;
+
+static std::string xmlUnescape(const std::string & s)
+{
+	static const char* names[] = { "&lt;", "&gt;", "&amp;", "&quot;", "&apos;" };
+	static const char chars[] = { '<', '>', '&', '"', '\'' };
+	std::string out;
+	size_t i, n;
+
+	for (i = 0; i < s.size(); i++) {
+		if (s[i] != '&') {
+			out += s[i];
+			continue;
+		}
+		for (n = 0; n < 5; n++) {
+			if (s.compare(i, strlen(names[n]), names[n]) == 0) {
+				out += chars[n];
+				i += strlen(names[n]) - 1;
+				break;
+			}
+		}
+		if (n == 5) {
+			if (s.compare(i, 2, "&#") == 0 && s.find(';', i) != std::string::npos) {
+				size_t end = s.find(';', i);
+				out += (char)strtol(s.c_str() + i + 2 + (s[i + 2] == 'x' ? 1 : 0), NULL, s[i + 2] == 'x' ? 16 : 10);
+				i = end;
+			}
+			else out += '&';
+		}
+	}
+	return out;
+}
+
+/* Parses the element starting at pos. Returns false on malformed input. */
+static bool xmlParseElement(const std::string & doc, size_t* pos, xmlNode* node)
+{
+	size_t p = *pos, end;
+
+	if (doc[p] != '<') return false;
+	p++;
+	end = doc.find_first_of(" \t\r\n/>", p);
+	if (end == std::string::npos) return false;
+	node->name = doc.substr(p, end - p);
+	p = end;
+
+	/* Attributes */
+	for (;;) {
+		while (p < doc.size() && isspace((unsigned char)doc[p])) p++;
+		if (p >= doc.size()) return false;
+		if (doc.compare(p, 2, "/>") == 0) {
+			*pos = p + 2;
+			return true;
+		}
+		if (doc[p] == '>') {
+			p++;
+			break;
+		}
+		end = doc.find('=', p);
+		if (end == std::string::npos || end + 1 >= doc.size()) return false;
+		std::string key = doc.substr(p, end - p);
+		char quote = doc[end + 1];
+		size_t close = doc.find(quote, end + 2);
+		if (close == std::string::npos) return false;
+		node->attrs[key] = xmlUnescape(doc.substr(end + 2, close - end - 2));
+		p = close + 1;
+	}
+
+	/* Content */
+	for (;;) {
+		end = doc.find('<', p);
+		if (end == std::string::npos) return false;
+		node->text += xmlUnescape(doc.substr(p, end - p));
+		p = end;
+		if (doc.compare(p, 4, "<!--") == 0) {
+			end = doc.find("-->", p);
+			if (end == std::string::npos) return false;
+			p = end + 3;
+		}
+		else if (doc.compare(p, 9, "<![CDATA[") == 0) {
+			end = doc.find("]]>", p);
+			if (end == std::string::npos) return false;
+			node->text += doc.substr(p + 9, end - p - 9);
+			p = end + 3;
+		}
+		else if (doc.compare(p, 2, "</") == 0) {
+			end = doc.find('>', p);
+			if (end == std::string::npos) return false;
+			*pos = end + 1;
+			return true;
+		}
+		else {
+			node->children.push_back(xmlNode());
+			if (!xmlParseElement(doc, &p, &node->children.back())) return false;
+		}
+	}
+}
+
+static bool xmlParse(const std::string & doc, xmlNode* root)
+{
+	size_t p = 0;
+
+	for (;;) {
+		p = doc.find('<', p);
+		if (p == std::string::npos) return false;
+		if (doc.compare(p, 2, "<?") == 0) p = doc.find("?>", p);
+		else if (doc.compare(p, 4, "<!--") == 0) p = doc.find("-->", p);
+		else return xmlParseElement(doc, &p, root);
+		if (p == std::string::npos) return false;
+	}
+}
+
+/* Stateflow keeps most properties in <P Name="...">value</P> children */
+static std::string sfProperty(const xmlNode & node, const char* name)
+{
+	for (size_t i = 0; i < node.children.size(); i++) {
+		const xmlNode & c = node.children[i];
+		if (c.name == "P") {
+			std::map<std::string, std::string>::const_iterator it = c.attrs.find("Name");
+			if (it != c.attrs.end() && it->second == name) return c.text;
+		}
+	}
+	return "";
+}
+
+static const xmlNode* sfChild(const xmlNode & node, const char* name)
+{
+	for (size_t i = 0; i < node.children.size(); i++) {
+		if (node.children[i].name == name) return &node.children[i];
+	}
+	return NULL;
+}
+
+static const xmlNode* findChart(const xmlNode & node, const std::string & name)
+{
+	const xmlNode* found;
+
+	if (node.name == "chart" && sfProperty(node, "name") == name) return &node;
+	for (size_t i = 0; i < node.children.size(); i++) {
+		if ((found = findChart(node.children[i], name)) != NULL) return found;
+	}
+	return NULL;
+}
+
+/*****************************************************
+*	Guard expressions
+*****************************************************/
+
+/* Chart inputs and the conditions they set */
+typedef struct {
+	const char*	name;
+	uint16_t	condition;
+}chartInput;
+
+static const chartInput chartInputs[] = {
+	{ "goforward", FORWARD_CMD_MASK },
+	{ "backward", REVERSE_CMD_MASK },
+	{ "stop", STOP_CMD_MASK },
+	{ "manual", MANUAL_MODE_CMD_MASK },
+	{ "auto", AUTO_MODE_CMD_MASK },
+	{ "stopturn", STOP_TURN_CMD_MASK },
+	{ "wall", FSM_COND_OBSTACLE },
+	{ "left_sensor", FSM_COND_OBSTACLE | FSM_COND_LEFT_SENSOR },
+	{ "right_sensor", FSM_COND_OBSTACLE },
+};
+#define CHART_INPUT_COUNT	(int)(sizeof(chartInputs) / sizeof(chartInputs[0]))
+#define CHART_RESULT		CHART_INPUT_COUNT		// turn direction: > 0 left, < 0 right
+
+/* Conditions each mode's input symbol carries (see StateMachine::inputSymbol) */
+#define CHART_MANUAL_READABLE	(FSM_MANUAL_SYMBOLS - 1)
+#define CHART_AUTO_READABLE		(MANUAL_MODE_CMD_MASK | FSM_COND_OBSTACLE | FSM_COND_LEFT_SENSOR | \
+								 FSM_COND_REVERSE_DONE | FSM_COND_TURN_DONE | FSM_COND_LEFT_TRIPPED)
+
+#define EXPR_OR			0
+#define EXPR_AND		1
+#define EXPR_NOT		2
+#define EXPR_COMPARE	3
+#define EXPR_AFTER		4
+#define EXPR_TRUE		5
+
+typedef struct exprNode {
+	int						type;
+	int						input;		// EXPR_COMPARE: chartInputs index or CHART_RESULT
+	std::string				op;			// EXPR_COMPARE
+	int						value;		// EXPR_COMPARE constant, EXPR_AFTER ticks
+	std::vector<exprNode>	args;
+}exprNode;
+
+/* Input values a guard is checked against */
+typedef struct {
+	int		inputs[CHART_INPUT_COUNT + 1];
+	int		ticks;
+}chartEnv;
+
+typedef struct {
+	const std::string*	text;
+	size_t				pos;
+	std::string			error;
+}exprParser;
+
+static void skipSpace(exprParser* p)
+{
+	while (p->pos < p->text->size() && isspace((unsigned char)(*p->text)[p->pos])) p->pos++;
+}
+
+static bool accept(exprParser* p, const char* token)
+{
+	skipSpace(p);
+	if (p->text->compare(p->pos, strlen(token), token) != 0) return false;
+	p->pos += strlen(token);
+	return true;
+}
+
+static std::string identifier(exprParser* p)
+{
+	size_t start;
+
+	skipSpace(p);
+	start = p->pos;
+	while (p->pos < p->text->size() && (isalnum((unsigned char)(*p->text)[p->pos]) || (*p->text)[p->pos] == '_')) p->pos++;
+	return p->text->substr(start, p->pos - start);
+}
+
+static bool number(exprParser* p, int* value)
+{
+	char* end;
+
+	skipSpace(p);
+	*value = (int)strtol(p->text->c_str() + p->pos, &end, 10);
+	if (end == p->text->c_str() + p->pos) return false;
+	p->pos = end - p->text->c_str();
+	return true;
+}
+
+static bool parseOr(exprParser* p, exprNode* node);
+
+static bool parseUnary(exprParser* p, exprNode* node)
+{
+	std::string name;
+	int i;
+
+	if (accept(p, "!") || accept(p, "~")) {
+		node->type = EXPR_NOT;
+		node->args.resize(1);
+		return parseUnary(p, &node->args[0]);
+	}
+	if (accept(p, "(")) {
+		if (!parseOr(p, node)) return false;
+		if (!accept(p, ")")) {
+			p->error = "missing )";
+			return false;
+		}
+		return true;
+	}
+
+	name = identifier(p);
+	if (name == "after") {
+		node->type = EXPR_AFTER;
+		if (!accept(p, "(") || !number(p, &node->value) || !accept(p, ",") || identifier(p) != "tick" || !accept(p, ")")) {
+			p->error = "after() other than after(n,tick)";
+			return false;
+		}
+		return true;
+	}
+	if (name == "true") {
+		node->type = EXPR_TRUE;
+		return true;
+	}
+
+	node->type = EXPR_COMPARE;
+	node->input = -1;
+	if (name == "result") node->input = CHART_RESULT;
+	for (i = 0; i < CHART_INPUT_COUNT; i++) {
+		if (name == chartInputs[i].name) node->input = i;
+	}
+	if (node->input < 0) {
+		p->error = "unknown data '" + name + "'";
+		return false;
+	}
+	skipSpace(p);
+	static const char* ops[] = { "==", "~=", "!=", ">=", "<=", ">", "<" };
+	for (i = 0; i < 7; i++) {
+		if (accept(p, ops[i])) {
+			node->op = ops[i];
+			break;
+		}
+	}
+	if (i == 7 || !number(p, &node->value)) {
+		p->error = "expected <data> <op> <number> after '" + name + "'";
+		return false;
+	}
+	if (node->op == "~=") node->op = "!=";
+	return true;
+}
+
+static bool parseAnd(exprParser* p, exprNode* node)
+{
+	exprNode first;
+
+	if (!parseUnary(p, &first)) return false;
+	if (!accept(p, "&&")) {
+		*node = first;
+		return true;
+	}
+	node->type = EXPR_AND;
+	node->args.push_back(first);
+	do {
+		node->args.push_back(exprNode());
+		if (!parseUnary(p, &node->args.back())) return false;
+	} while (accept(p, "&&"));
+	return true;
+}
+
+static bool parseOr(exprParser* p, exprNode* node)
+{
+	exprNode first;
+
+	if (!parseAnd(p, &first)) return false;
+	if (!accept(p, "||")) {
+		*node = first;
+		return true;
+	}
+	node->type = EXPR_OR;
+	node->args.push_back(first);
+	do {
+		node->args.push_back(exprNode());
+		if (!parseAnd(p, &node->args.back())) return false;
+	} while (accept(p, "||"));
+	return true;
+}
+
+/* Transition label "[guard]". An empty label is always true. */
+static bool parseLabel(const std::string & label, exprNode* guard, std::string* error)
+{
+	exprParser p;
+	size_t close;
+
+	guard->type = EXPR_TRUE;
+	p.text = &label;
+	p.pos = 0;
+	skipSpace(&p);
+	if (p.pos == label.size()) return true;
+	close = label.rfind(']');
+	if (label[p.pos] != '[' || close == std::string::npos || label.find_first_not_of(" \t\r\n", close + 1) != std::string::npos) {
+		*error = "only [condition] labels are supported (no events or actions)";
+		return false;
+	}
+	std::string inner = label.substr(p.pos + 1, close - p.pos - 1);
+	p.text = &inner;
+	p.pos = 0;
+	if (!parseOr(&p, guard)) {
+		*error = p.error;
+		return false;
+	}
+	skipSpace(&p);
+	if (p.pos != inner.size()) {
+		*error = "unexpected text '" + inner.substr(p.pos) + "'";
+		return false;
+	}
+	return true;
+}
+
+static bool compare(int a, const std::string & op, int b)
+{
+	if (op == "==") return a == b;
+	if (op == "!=") return a != b;
+	if (op == ">=") return a >= b;
+	if (op == "<=") return a <= b;
+	if (op == ">") return a > b;
+	return a < b;
+}
+
+static bool evaluate(const exprNode & e, const chartEnv & env)
+{
+	size_t i;
+
+	switch (e.type) {
+	case EXPR_OR:
+		for (i = 0; i < e.args.size(); i++) if (evaluate(e.args[i], env)) return true;
+		return false;
+	case EXPR_AND:
+		for (i = 0; i < e.args.size(); i++) if (!evaluate(e.args[i], env)) return false;
+		return true;
+	case EXPR_NOT:
+		return !evaluate(e.args[0], env);
+	case EXPR_COMPARE:
+		return compare(env.inputs[e.input], e.op, e.value);
+	case EXPR_AFTER:
+		return env.ticks >= e.value;
+	default:
+		return true;
+	}
+}
+
+/* Guards as a disjunction of condition terms */
+typedef struct {
+	uint16_t	all;
+	uint16_t	none;
+}condTerm;
+
+typedef std::vector<condTerm> condDnf;
+
+static condDnf dnfTrue()
+{
+	condDnf d(1);
+	d[0].all = 0;
+	d[0].none = 0;
+	return d;
+}
+
+static condDnf dnfTerm(uint16_t all, uint16_t none)
+{
+	condDnf d(1);
+	d[0].all = all;
+	d[0].none = none;
+	return d;
+}
+
+static condDnf dnfAnd(const condDnf & a, const condDnf & b)
+{
+	condDnf d;
+	condTerm t;
+
+	for (size_t i = 0; i < a.size(); i++) {
+		for (size_t j = 0; j < b.size(); j++) {
+			t.all = a[i].all | b[j].all;
+			t.none = a[i].none | b[j].none;
+			if (!(t.all & t.none)) d.push_back(t);
+		}
+	}
+	return d;
+}
+
+static void dnfOr(condDnf* a, const condDnf & b)
+{
+	a->insert(a->end(), b.begin(), b.end());
+}
+
+static bool toDnf(const exprNode & e, bool negate, condDnf* out, std::string* error)
+{
+	condDnf part;
+	size_t i;
+	int v;
+
+	out->clear();
+	switch (e.type) {
+	case EXPR_TRUE:
+		if (!negate) *out = dnfTrue();
+		return true;
+	case EXPR_NOT:
+		return toDnf(e.args[0], !negate, out, error);
+	case EXPR_OR:
+	case EXPR_AND:
+		/* AND, or OR under negation, is a product */
+		if ((e.type == EXPR_AND) != negate) *out = dnfTrue();
+		for (i = 0; i < e.args.size(); i++) {
+			if (!toDnf(e.args[i], negate, &part, error)) return false;
+			if ((e.type == EXPR_AND) != negate) *out = dnfAnd(*out, part);
+			else dnfOr(out, part);
+		}
+		return true;
+	case EXPR_AFTER:
+		if (e.value == AUTO_AVOIDANCE_REVERSE_DELAY_TICKS) v = FSM_COND_REVERSE_DONE;
+		else if (e.value == AUTO_AVOIDANCE_TURN_DELAY_TICKS) v = FSM_COND_TURN_DONE;
+		else {
+			char buf[128];
+			sprintf(buf, "after(%d,tick): only %d and %d ticks are supported", e.value, AUTO_AVOIDANCE_REVERSE_DELAY_TICKS, AUTO_AVOIDANCE_TURN_DELAY_TICKS);
+			*error = buf;
+			return false;
+		}
+		*out = negate ? dnfTerm(0, (uint16_t)v) : dnfTerm((uint16_t)v, 0);
+		return true;
+	default:
+		break;
+	}
+
+	/* Comparison: the terms of each input value that satisfies it */
+	if (e.input == CHART_RESULT) {
+		if (compare(1, e.op, e.value) != negate) dnfOr(out, dnfTerm(TURN_L_CMD_MASK, 0));
+		if (compare(-1, e.op, e.value) != negate) dnfOr(out, dnfTerm(TURN_R_CMD_MASK, 0));
+		if (compare(0, e.op, e.value) != negate) dnfOr(out, dnfTerm(0, TURN_L_CMD_MASK | TURN_R_CMD_MASK));
+		if (out->size() == 3) *out = dnfTrue();
+		return true;
+	}
+	bool one = compare(1, e.op, e.value) != negate;
+	bool zero = compare(0, e.op, e.value) != negate;
+	if (one && zero) *out = dnfTrue();
+	else if (one) *out = dnfTerm(chartInputs[e.input].condition, 0);
+	else if (zero) {
+		/* left_sensor == 0 says nothing about the other sensors */
+		uint16_t c = chartInputs[e.input].condition;
+		*out = dnfTerm(0, (c == FSM_COND_OBSTACLE) ? c : (uint16_t)(c & ~FSM_COND_OBSTACLE));
+	}
+	return true;
+}
+
+/* Drop what a mode cannot read: a term needing an unreadable condition never holds, an
+ * unreadable condition that must not hold never does. Then drop repeated terms. */
+static condDnf dnfProject(const condDnf & d, uint16_t readable)
+{
+	condDnf out;
+	condTerm t;
+	size_t i, j;
+
+	for (i = 0; i < d.size(); i++) {
+		if (d[i].all & ~readable) continue;
+		t.all = d[i].all;
+		t.none = d[i].none & readable;
+		for (j = 0; j < out.size(); j++) {
+			if ((out[j].all & t.all) == out[j].all && (out[j].none & t.none) == out[j].none) break;
+		}
+		if (j == out.size()) out.push_back(t);
+	}
+	return out;
+}
+
+static bool dnfMatch(const condDnf & d, uint16_t conditions)
+{
+	for (size_t i = 0; i < d.size(); i++) {
+		if ((conditions & d[i].all) == d[i].all && !(conditions & d[i].none)) return true;
+	}
+	return false;
+}
+
+static uint16_t envConditions(const chartEnv & env, uint16_t readable)
+{
+	uint16_t c = 0;
+	int i;
+
+	for (i = 0; i < CHART_INPUT_COUNT; i++) {
+		if (env.inputs[i]) c |= chartInputs[i].condition;
+	}
+	if (env.inputs[CHART_RESULT] > 0) c |= TURN_L_CMD_MASK;
+	if (env.inputs[CHART_RESULT] < 0) c |= TURN_R_CMD_MASK;
+	if (env.ticks >= AUTO_AVOIDANCE_REVERSE_DELAY_TICKS) c |= FSM_COND_REVERSE_DONE;
+	if (env.ticks >= AUTO_AVOIDANCE_TURN_DELAY_TICKS) c |= FSM_COND_TURN_DONE;
+	return c & readable;
+}
+
+/* The rows must hold for exactly the input values the guard holds for */
+static bool checkGuard(const exprNode & guard, const condDnf & d, uint16_t readable, std::string* error)
+{
+	static const int ticks[SLX_MAX_ENV_TICKS] = { 0, AUTO_AVOIDANCE_REVERSE_DELAY_TICKS, AUTO_AVOIDANCE_TURN_DELAY_TICKS };
+	chartEnv env;
+	int bits, r, t, i;
+
+	for (bits = 0; bits < (1 << CHART_INPUT_COUNT); bits++) {
+		for (r = -1; r <= 1; r++) {
+			for (t = 0; t < SLX_MAX_ENV_TICKS; t++) {
+				for (i = 0; i < CHART_INPUT_COUNT; i++) env.inputs[i] = (bits >> i) & 1;
+				env.inputs[CHART_RESULT] = r;
+				env.ticks = ticks[t];
+				if (evaluate(guard, env) != dnfMatch(d, envConditions(env, readable))) {
+					std::string values;
+					for (i = 0; i < CHART_INPUT_COUNT; i++) values += std::string(" ") + chartInputs[i].name + "=" + (env.inputs[i] ? "1" : "0");
+					char buf[64];
+					sprintf(buf, " result=%d ticks=%d", r, env.ticks);
+					*error = "cannot be expressed in this mode's conditions (differs at" + values + buf + ")";
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/*****************************************************
+*	Chart
+*****************************************************/
+
+/* StateMachine state and command of each leaf state of the chart */
+typedef struct {
+	const char*	path;
+	int			state;
+	int			command;
+}chartLeaf;
+
+static const chartLeaf chartLeaves[] = {
+	{ "Manual/Stop/Stop", STOP_STATE, STOP_CMD },
+	{ "Manual/Stop/TurnL", STOP_L_STATE, TURN_L_CMD },
+	{ "Manual/Stop/TurnR", STOP_R_STATE, TURN_R_CMD },
+	{ "Manual/Forward/Forward", FORWARD_STATE, FORWARD_CMD },
+	{ "Manual/Forward/TurnL", FORWARD_L_STATE, FORWARD_L_CMD },
+	{ "Manual/Forward/TurnR", FORWARD_R_STATE, FORWARD_R_CMD },
+	{ "Manual/Backward/Backward", REVERSE_STATE, REVERSE_CMD },
+	{ "Manual/Backward/TurnL", REVERSE_L_STATE, REVERSE_L_CMD },
+	{ "Manual/Backward/TurnR", REVERSE_R_STATE, REVERSE_R_CMD },
+	{ "Manual/Avoid_Obstacle", AVOID_OBSTACLE_STATE, REVERSE_CMD },
+	{ "Auto/Forward", AUTO_FORWARD_STATE, FORWARD_CMD },
+	{ "Auto/Backward", AUTO_REVERSE_STATE, REVERSE_CMD },
+	{ "Auto/TurnL", AUTO_TURN_L_STATE, TURN_L_CMD },
+	{ "Auto/TurnR", AUTO_TURN_R_STATE, TURN_R_CMD },
+};
+#define CHART_LEAF_COUNT	(int)(sizeof(chartLeaves) / sizeof(chartLeaves[0]))
+
+typedef struct {
+	int					ssid;
+	std::string			name;
+	std::string			path;
+	int					parent;		// index, -1 at the top of the chart
+	int					depth;
+	std::vector<int>	children;
+	std::vector<int>	defaults;	// default transitions into children, in execution order
+	std::vector<int>	outgoing;	// in execution order
+	bool				usesAfter;
+	int					leaf;		// chartLeaves index, -1 for a superstate
+}chartState;
+
+typedef struct {
+	int				ssid;
+	int				src;		// state index, -1 for a default transition
+	int				dst;
+	int				container;	// state holding a default transition, -1 for the chart
+	int				order;
+	std::string		label;
+	exprNode		guard;
+	condDnf			terms;
+}chartTransition;
+
+typedef struct {
+	std::vector<chartState>			states;
+	std::vector<chartTransition>	transitions;
+	std::vector<int>				topDefaults;
+}chartModel;
+
+/* Generated specification row with the text that explains it */
+typedef struct {
+	fsmTransition	row;
+	std::string		comment;
+}specRow;
+
+static const char* stateNames[FSM_STATE_CODES] = {
+	"NULL_STATE", "FORWARD_STATE", "FORWARD_L_STATE", "FORWARD_R_STATE", "STOP_STATE", "STOP_L_STATE", "STOP_R_STATE",
+	"REVERSE_STATE", "REVERSE_L_STATE", "REVERSE_R_STATE", "", "", "", "", "", "", "AVOID_OBSTACLE_STATE",
+	"AUTO_FORWARD_STATE", "AUTO_REVERSE_STATE", "AUTO_TURN_L_STATE", "AUTO_TURN_R_STATE",
+	"WALL_FOLLOW_STATE"
+};
+
+static std::string commandName(int command)
+{
+	static const char* names[] = { "STOP_CMD", "FORWARD_CMD", "REVERSE_CMD", "TURN_L_CMD", "TURN_R_CMD",
+		"FORWARD_L_CMD", "FORWARD_R_CMD", "REVERSE_L_CMD", "REVERSE_R_CMD" };
+
+	if (command >= STOP_CMD && command <= REVERSE_R_CMD) return names[command - STOP_CMD];
+	return "NULL_CMD";
+}
+
+static std::string conditionNames(uint16_t conditions)
+{
+	static const char* names[] = { "STOP_CMD_MASK", "FORWARD_CMD_MASK", "REVERSE_CMD_MASK", "TURN_L_CMD_MASK", "TURN_R_CMD_MASK",
+		"STOP_TURN_CMD_MASK", "MANUAL_MODE_CMD_MASK", "AUTO_MODE_CMD_MASK", "FSM_COND_OBSTACLE", "FSM_COND_LEFT_SENSOR",
+		"FSM_COND_REVERSE_DONE", "FSM_COND_TURN_DONE", "FSM_COND_LEFT_TRIPPED" };
+	std::string s;
+
+	for (int b = 0; b < 13; b++) {
+		if (conditions & (1 << b)) s += (s.empty() ? "" : " | ") + std::string(names[b]);
+	}
+	return s.empty() ? "0" : s;
+}
+
+static int findState(const chartModel & m, int ssid)
+{
+	for (size_t i = 0; i < m.states.size(); i++) {
+		if (m.states[i].ssid == ssid) return (int)i;
+	}
+	return -1;
+}
+
+static bool readStates(const xmlNode & container, int parent, chartModel* m)
+{
+	const xmlNode* children = sfChild(container, "Children");
+	size_t i;
+
+	if (children == NULL) return true;
+	for (i = 0; i < children->children.size(); i++) {
+		const xmlNode & c = children->children[i];
+		if (c.name == "junction") {
+			printf("ERROR: Junction %s is not supported.\n", c.attrs.count("SSID") ? c.attrs.at("SSID").c_str() : "?");
+			return false;
+		}
+		if (c.name != "state" || sfProperty(c, "type") == "FUNC_STATE") continue;
+		if (sfProperty(c, "type") != "OR_STATE") {
+			printf("ERROR: State '%s' is not an exclusive (OR) state.\n", sfProperty(c, "labelString").c_str());
+			return false;
+		}
+
+		chartState s;
+		std::string label = sfProperty(c, "labelString");
+		s.ssid = atoi(c.attrs.count("SSID") ? c.attrs.at("SSID").c_str() : "0");
+		s.name = label.substr(0, label.find_first_of("\r\n/"));
+		while (!s.name.empty() && isspace((unsigned char)s.name[s.name.size() - 1])) s.name.erase(s.name.size() - 1);
+		s.parent = parent;
+		s.depth = (parent < 0) ? 0 : m->states[parent].depth + 1;
+		s.path = (parent < 0) ? s.name : m->states[parent].path + "/" + s.name;
+		s.usesAfter = false;
+		s.leaf = -1;
+		m->states.push_back(s);
+		int index = (int)m->states.size() - 1;
+		if (parent >= 0) m->states[parent].children.push_back(index);
+		if (!readStates(c, index, m)) return false;
+	}
+	return true;
+}
+
+static bool readTransitions(const xmlNode & container, int containerIndex, chartModel* m)
+{
+	const xmlNode* children = sfChild(container, "Children");
+	size_t i;
+
+	if (children == NULL) return true;
+	for (i = 0; i < children->children.size(); i++) {
+		const xmlNode & c = children->children[i];
+		if (c.name == "state") {
+			if (sfProperty(c, "type") == "FUNC_STATE") continue;
+			if (!readTransitions(c, findState(*m, atoi(c.attrs.at("SSID").c_str())), m)) return false;
+			continue;
+		}
+		if (c.name != "transition") continue;
+
+		chartTransition t;
+		const xmlNode* src = sfChild(c, "src");
+		const xmlNode* dst = sfChild(c, "dst");
+		std::string error;
+		t.ssid = atoi(c.attrs.count("SSID") ? c.attrs.at("SSID").c_str() : "0");
+		t.src = (src != NULL && !sfProperty(*src, "SSID").empty()) ? findState(*m, atoi(sfProperty(*src, "SSID").c_str())) : -1;
+		t.dst = (dst != NULL) ? findState(*m, atoi(sfProperty(*dst, "SSID").c_str())) : -1;
+		t.container = containerIndex;
+		t.order = atoi(sfProperty(c, "executionOrder").c_str());
+		t.label = sfProperty(c, "labelString");
+		if (t.dst < 0 || (src != NULL && !sfProperty(*src, "SSID").empty() && t.src < 0)) {
+			printf("ERROR: Transition %d does not connect two states.\n", t.ssid);
+			return false;
+		}
+		if (!parseLabel(t.label, &t.guard, &error) || !toDnf(t.guard, false, &t.terms, &error)) {
+			printf("ERROR: Transition %d '%s': %s.\n", t.ssid, t.label.c_str(), error.c_str());
+			return false;
+		}
+		m->transitions.push_back(t);
+	}
+	return true;
+}
+
+static void byOrder(const chartModel* m, std::vector<int>* list)
+{
+	for (size_t i = 1; i < list->size(); i++) {
+		for (size_t j = i; j > 0 && m->transitions[(*list)[j]].order < m->transitions[(*list)[j - 1]].order; j--) {
+			std::swap((*list)[j], (*list)[j - 1]);
+		}
+	}
+}
+
+static bool isAncestor(const chartModel & m, int ancestor, int state)
+{
+	for (; state >= 0; state = m.states[state].parent) {
+		if (state == ancestor) return true;
+	}
+	return false;
+}
+
+/* Leaves below a state, as FSM_STATE_BITs, and the mode they run in (-1 if mixed) */
+static uint32_t leafStates(const chartModel & m, int state, int* mode)
+{
+	uint32_t bits = 0;
+
+	if (m.states[state].leaf >= 0) {
+		int s = chartLeaves[m.states[state].leaf].state;
+		if (*mode == 0) *mode = StateMachine::stateMode(s);
+		else if (*mode != StateMachine::stateMode(s)) *mode = -1;
+		return FSM_STATE_BIT(s);
+	}
+	for (size_t i = 0; i < m.states[state].children.size(); i++) bits |= leafStates(m, m.states[state].children[i], mode);
+	return bits;
+}
+
+/* One way into a state: the extra terms the default transitions add and the leaf reached */
+typedef struct {
+	condDnf			terms;
+	int				leaf;
+	std::string		via;
+}chartEntry;
+
+static bool enterState(const chartModel & m, int state, const condDnf & terms, uint16_t readable, std::vector<chartEntry>* out)
+{
+	std::string error;
+	size_t i;
+
+	if (m.states[state].children.empty()) {
+		chartEntry e;
+		e.terms = terms;
+		e.leaf = state;
+		out->push_back(e);
+		return true;
+	}
+	for (i = 0; i < m.states[state].defaults.size(); i++) {
+		const chartTransition & t = m.transitions[m.states[state].defaults[i]];
+		condDnf d = dnfProject(t.terms, readable);
+		if (!checkGuard(t.guard, d, readable, &error)) {
+			printf("ERROR: Default transition %d '%s' into '%s' %s.\n", t.ssid, t.label.c_str(), m.states[t.dst].path.c_str(), error.c_str());
+			return false;
+		}
+		size_t before = out->size();
+		if (!enterState(m, t.dst, dnfAnd(terms, d), readable, out)) return false;
+		for (size_t j = before; j < out->size(); j++) (*out)[j].via = " (default " + m.states[t.dst].path + ")" + (*out)[j].via;
+		if (t.guard.type == EXPR_TRUE) return true;
+	}
+	printf("ERROR: State '%s' has no unconditional default transition.\n", m.states[state].path.c_str());
+	return false;
+}
+
+static bool buildSpec(chartModel* m, std::vector<specRow>* rows, int* initialState)
+{
+	std::vector<int> sources;
+	std::vector<chartEntry> entries;
+	std::string error;
+	size_t i, j, k;
+	int mode, l;
+
+	/* Leaves */
+	for (i = 0; i < m->states.size(); i++) {
+		if (!m->states[i].children.empty()) continue;
+		for (l = 0; l < CHART_LEAF_COUNT; l++) {
+			if (m->states[i].path == chartLeaves[l].path) m->states[i].leaf = l;
+		}
+		if (m->states[i].leaf < 0) {
+			printf("ERROR: Chart state '%s' has no StateMachine state (see chartLeaves in SlxImport.cpp).\n", m->states[i].path.c_str());
+			return false;
+		}
+	}
+
+	for (i = 0; i < m->transitions.size(); i++) {
+		chartTransition & t = m->transitions[i];
+		if (t.src >= 0) {
+			m->states[t.src].outgoing.push_back((int)i);
+			if (t.label.find("after") != std::string::npos) m->states[t.src].usesAfter = true;
+		}
+		else if (t.container >= 0) m->states[t.container].defaults.push_back((int)i);
+		else m->topDefaults.push_back((int)i);
+	}
+	for (i = 0; i < m->states.size(); i++) {
+		byOrder(m, &m->states[i].defaults);
+		byOrder(m, &m->states[i].outgoing);
+		if (!m->states[i].usesAfter) continue;
+		for (j = 0; j < m->states.size(); j++) {
+			if (j != i && m->states[j].usesAfter && (isAncestor(*m, (int)i, (int)j) || isAncestor(*m, (int)j, (int)i))) {
+				printf("ERROR: Nested states '%s' and '%s' both use after(); StateMachine has one tick count.\n",
+					m->states[i].path.c_str(), m->states[j].path.c_str());
+				return false;
+			}
+		}
+	}
+	byOrder(m, &m->topDefaults);
+
+	/* Power on state */
+	if (m->topDefaults.empty()) {
+		printf("ERROR: Chart has no default transition.\n");
+		return false;
+	}
+	for (i = 0; i < m->topDefaults.size() && m->transitions[m->topDefaults[i]].guard.type != EXPR_TRUE; i++);
+	if (i == m->topDefaults.size()) {
+		printf("ERROR: Chart has no unconditional default transition.\n");
+		return false;
+	}
+	mode = 0;
+	leafStates(*m, m->transitions[m->topDefaults[i]].dst, &mode);
+	entries.clear();
+	if (!enterState(*m, m->transitions[m->topDefaults[i]].dst, dnfTrue(), (mode == AUTO_MODE) ? CHART_AUTO_READABLE : CHART_MANUAL_READABLE, &entries)) return false;
+	*initialState = chartLeaves[m->states[entries.back().leaf].leaf].state;
+
+	/* Outer states first, each state's transitions in execution order */
+	for (i = 0; i < m->states.size(); i++) sources.push_back((int)i);
+	for (i = 1; i < sources.size(); i++) {
+		for (j = i; j > 0 && m->states[sources[j]].depth < m->states[sources[j - 1]].depth; j--) std::swap(sources[j], sources[j - 1]);
+	}
+
+	for (i = 0; i < sources.size(); i++) {
+		const chartState & s = m->states[sources[i]];
+		mode = 0;
+		uint32_t applies = leafStates(*m, sources[i], &mode);
+		uint16_t readable = (mode == AUTO_MODE) ? CHART_AUTO_READABLE : CHART_MANUAL_READABLE;
+		if (mode < 0) {
+			printf("ERROR: State '%s' contains both Manual and Auto mode states.\n", s.path.c_str());
+			return false;
+		}
+
+		for (j = 0; j < s.outgoing.size(); j++) {
+			const chartTransition & t = m->transitions[s.outgoing[j]];
+			condDnf d = dnfProject(t.terms, readable);
+			if (!checkGuard(t.guard, d, readable, &error)) {
+				printf("ERROR: Transition %d '%s' from '%s' %s.\n", t.ssid, t.label.c_str(), s.path.c_str(), error.c_str());
+				return false;
+			}
+
+			entries.clear();
+			if (!enterState(*m, t.dst, d, readable, &entries)) return false;
+			for (k = 0; k < entries.size(); k++) {
+				const chartEntry & e = entries[k];
+				const chartLeaf & leaf = chartLeaves[m->states[e.leaf].leaf];
+				int actions = 0;
+
+				/* States entered: those on the destination's path below the transition's common parent */
+				for (int a = e.leaf; a >= 0 && !(isAncestor(*m, a, sources[i]) && a != sources[i]); a = m->states[a].parent) {
+					if (m->states[a].usesAfter) actions |= FSM_ACT_RESET_TICKS;
+				}
+				for (l = 0; l < (int)e.terms.size(); l++) {
+					specRow r;
+					r.row.states = applies;
+					r.row.all = e.terms[l].all;
+					r.row.any = 0;
+					r.row.none = e.terms[l].none;
+					r.row.next = leaf.state;
+					r.row.output = leaf.command;
+					r.row.actions = actions;
+					r.comment = s.path + " -> " + m->states[t.dst].path + e.via + " " + t.label;
+					rows->push_back(r);
+				}
+			}
+		}
+	}
+
+	/* No transition: stay and repeat the state's command */
+	for (i = 0; i < m->states.size(); i++) {
+		if (m->states[i].leaf < 0) continue;
+		specRow r;
+		r.row.states = FSM_STATE_BIT(chartLeaves[m->states[i].leaf].state);
+		r.row.all = r.row.any = r.row.none = 0;
+		r.row.next = FSM_SAME_STATE;
+		r.row.output = chartLeaves[m->states[i].leaf].command;
+		r.row.actions = 0;
+		r.comment = m->states[i].path;
+		rows->push_back(r);
+	}
+	return true;
+}
+
+static std::string stateBits(uint32_t states)
+{
+	std::string s;
+
+	for (int c = 0; c < FSM_STATE_CODES; c++) {
+		if (states & FSM_STATE_BIT(c)) s += (s.empty() ? "" : " | ") + std::string("FSM_STATE_BIT(") + stateNames[c] + ")";
+	}
+	return s;
+}
+
+static std::string oneLine(const std::string & text)
+{
+	std::string s;
+
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '\r') continue;
+		if (text[i] == '\n') s += ' ';
+		else if (text[i] == '*' && i + 1 < text.size() && text[i + 1] == '/') s += "* ";
+		else s += text[i];
+	}
+	return s;
+}
+
+static void writeSpec(FILE* out, const char* model, const std::string & chart, const std::vector<specRow> & rows, int initialState)
+{
+	const char* base = strrchr(model, '/');
+	std::map<uint32_t, std::string> groups;
+	size_t i;
+
+	base = base ? base + 1 : model;
+	fprintf(out, "/*****************************************************\n");
+	fprintf(out, "*\tStateMachineChart.h\n");
+	fprintf(out, "*\n");
+	fprintf(out, "*\tGenerated by SlxImport from %s, chart \"%s\".\n", base, chart.c_str());
+	fprintf(out, "*\tDo not edit: change the model and run\n");
+	fprintf(out, "*\tSlxImport again.\n");
+	fprintf(out, "*****************************************************/\n\n");
+	fprintf(out, "#pragma once\n\n#include \"StateMachine.h\"\n\n");
+	fprintf(out, "#define FSM_CHART_INITIAL_STATE\t%s\n\n", stateNames[initialState]);
+
+	/* State sets of superstate transitions */
+	for (i = 0; i < rows.size(); i++) {
+		uint32_t s = rows[i].row.states;
+		if ((s & (s - 1)) == 0 || groups.count(s)) continue;
+		std::string name = "FSM_CHART_" + rows[i].comment.substr(0, rows[i].comment.find(" -> "));
+		for (size_t c = 0; c < name.size(); c++) name[c] = isalnum((unsigned char)name[c]) ? (char)toupper((unsigned char)name[c]) : '_';
+		groups[s] = name;
+		fprintf(out, "#define %s\t(%s)\n", name.c_str(), stateBits(s).c_str());
+	}
+
+	fprintf(out, "\nstatic const fsmTransition fsmChartSpec[] = {\n");
+	for (i = 0; i < rows.size(); i++) {
+		const fsmTransition & r = rows[i].row;
+		fprintf(out, "\t/* %s */\n", oneLine(rows[i].comment).c_str());
+		fprintf(out, "\t{ %s, %s, %s, %s, %s, %s, %s },\n",
+			groups.count(r.states) ? groups[r.states].c_str() : stateBits(r.states).c_str(),
+			conditionNames(r.all).c_str(), conditionNames(r.any).c_str(), conditionNames(r.none).c_str(),
+			(r.next == FSM_SAME_STATE) ? "FSM_SAME_STATE" : stateNames[r.next], commandName(r.output).c_str(),
+			(r.actions & FSM_ACT_RESET_TICKS) ? "FSM_ACT_RESET_TICKS" : "0");
+	}
+	fprintf(out, "};\n");
+	fprintf(out, "#define FSM_CHART_SPEC_COUNT\t(sizeof(fsmChartSpec) / sizeof(fsmChartSpec[0]))\n");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* model = NULL;
+	const char* outPath = NULL;
+	std::string chartName = SLX_DEFAULT_CHART;
+	std::string doc, command;
+	xmlNode root;
+	chartModel m;
+	std::vector<specRow> rows;
+	int initialState = STOP_STATE, i;
+	char buf[4096];
+	size_t n;
+
+	bool usage = false;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-chart") == 0 && (i + 1) < argc) chartName = argv[++i];
+		else if (strcmp(argv[i], "-o") == 0 && (i + 1) < argc) outPath = argv[++i];
+		else if (model == NULL && argv[i][0] != '-') model = argv[i];
+		else usage = true;
+	}
+	if (usage || model == NULL || strchr(model, '\'') != NULL) {
+		printf("Usage: %s <model.slx> [-chart <name>] [-o <header>]\n", argv[0]);
+		return 1;
+	}
+
+	/* .slx is a zip archive; the charts are in simulink/stateflow.xml */
+	command = std::string("unzip -p '") + model + "' simulink/stateflow.xml";
+	FILE* zip = popen(command.c_str(), "r");
+	if (zip == NULL) {
+		printf("ERROR: Failed to run unzip.\n");
+		return 1;
+	}
+	while ((n = fread(buf, 1, sizeof(buf), zip)) > 0) doc.append(buf, n);
+	if (pclose(zip) != 0 || doc.empty()) {
+		printf("ERROR: %s has no simulink/stateflow.xml.\n", model);
+		return 1;
+	}
+	if (!xmlParse(doc, &root)) {
+		printf("ERROR: Failed to parse stateflow.xml in %s.\n", model);
+		return 1;
+	}
+
+	const xmlNode* chart = findChart(root, chartName);
+	if (chart == NULL) {
+		printf("ERROR: %s has no chart \"%s\".\n", model, chartName.c_str());
+		return 1;
+	}
+	if (!readStates(*chart, -1, &m) || !readTransitions(*chart, -1, &m) || !buildSpec(&m, &rows, &initialState)) return 1;
+
+	/* The result must compile */
+	std::vector<fsmTransition> spec;
+	static fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS];
+	for (n = 0; n < rows.size(); n++) spec.push_back(rows[n].row);
+	if (StateMachine::compileTransitions(&spec[0], (int)spec.size(), table) != 0) return 1;
+
+	FILE* out = stdout;
+	if (outPath != NULL && (out = fopen(outPath, "w")) == NULL) {
+		printf("ERROR: Failed to open %s.\n", outPath);
+		return 1;
+	}
+	writeSpec(out, model, chartName, rows, initialState);
+	if (out != stdout) {
+		fclose(out);
+		printf("%s: %d states, %d transitions -> %d rows in %s\n", model, (int)m.states.size(), (int)m.transitions.size(), (int)rows.size(), outPath);
+	}
+	return 0;
+}
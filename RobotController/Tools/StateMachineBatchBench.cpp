@@ -0,0 +1,118 @@
+/*****************************************************
+*	StateMachineBatchBench.cpp
+*
+*	Steps a fleet of state machines with the batched
+*	SIMD stepper and with one StateMachine object per
+*	robot, checks both reach the same states and
+*	commands, and times a fleet tick against the
+*	STATE_MACHINE_TICK_TIME_MS budget.
+*
+*	Usage: StateMachineBatchBench [machines] [ticks] [passes]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+#include "StateMachineBatch.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+/* Random input biased toward what the gesture recognizer and sensors actually send */
+static uint16_t randomInput(std::mt19937 & rng)
+{
+	static const uint16_t common[] = {
+		STOP_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK,
+		STOP_TURN_CMD_MASK, MANUAL_MODE_CMD_MASK, AUTO_MODE_CMD_MASK, WALL_SENSOR_MASK, LEFT_SENSOR_MASK, RIGHT_SENSOR_MASK
+	};
+	uint32_t r = rng();
+
+	if ((r & 0x0F) < 10) return NULL_CMD_MASK;
+	if ((r & 0x0F) < 15) return common[(r >> 4) % (sizeof(common) / sizeof(common[0]))];
+	return (uint16_t)((r >> 8) & 0x07FF);
+}
+
+int main(int argc, char* argv[])
+{
+	int machines, ticks, passes, t, m, r, invalid;
+	uint64_t mismatches, commands;
+
+	machines = (argc > 1) ? atoi(argv[1]) : 100000;
+	ticks = (argc > 2) ? atoi(argv[2]) : 64;
+	passes = (argc > 3) ? atoi(argv[3]) : 10;
+	if (machines < 1 || ticks < 1 || passes < 1) {
+		printf("Usage: %s [machines] [ticks] [passes]\n", argv[0]);
+		return 1;
+	}
+
+	StateMachineBatch batch(machines);
+	if (batch.getCapacity() < machines) return 1;
+	batch.setCount(machines);
+
+	/* Inputs for every tick, one in eight ticks without a timer tick as when commands arrive between ticks */
+	std::mt19937 rng(1234);
+	std::vector<int32_t> inputs((size_t)ticks * machines);
+	std::vector<float> args(inputs.size());
+	std::vector<bool> timerTicks(ticks);
+	for (t = 0; t < ticks; t++) {
+		timerTicks[t] = (rng() & 0x07) != 0;
+		for (m = 0; m < machines; m++) {
+			inputs[(size_t)t * machines + m] = randomInput(rng);
+			args[(size_t)t * machines + m] = (float)(rng() & 0xFF) * 0.25f;
+		}
+	}
+
+	/* Verification pass */
+	std::vector<StateMachine> scalar(machines);
+	mismatches = 0;
+	commands = 0;
+	invalid = 0;
+	for (t = 0; t < ticks; t++) {
+		memcpy(batch.getInputs(), &inputs[(size_t)t * machines], machines * sizeof(int32_t));
+		memcpy(batch.getInputArgs(), &args[(size_t)t * machines], machines * sizeof(float));
+		invalid += batch.stepAll(timerTicks[t]);
+		for (m = 0; m < machines; m++) {
+			scalar[m].setInput((uint16_t)inputs[(size_t)t * machines + m], args[(size_t)t * machines + m]);
+			scalar[m].stepMachine(timerTicks[t]);
+			if (scalar[m].getCurrentState() != batch.getCurrentState(m) ||
+				scalar[m].getOutputCmd() != batch.getOutputCmd(m) || scalar[m].getOutputArg() != batch.getOutputArg(m)) mismatches++;
+			if (batch.getOutputCmd(m) != NULL_CMD) commands++;
+		}
+	}
+
+	/* One StateMachine per robot */
+	volatile int32_t sink = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (r = 0; r < passes; r++) {
+		for (t = 0; t < ticks; t++) {
+			for (m = 0; m < machines; m++) {
+				scalar[m].setInput((uint16_t)inputs[(size_t)t * machines + m], args[(size_t)t * machines + m]);
+				scalar[m].stepMachine(timerTicks[t]);
+				sink += scalar[m].getOutputCmd();
+			}
+		}
+	}
+	std::chrono::duration<double, std::milli> scalarTime = std::chrono::steady_clock::now() - start;
+
+	/* Batch, copying each tick's inputs in */
+	start = std::chrono::steady_clock::now();
+	for (r = 0; r < passes; r++) {
+		for (t = 0; t < ticks; t++) {
+			memcpy(batch.getInputs(), &inputs[(size_t)t * machines], machines * sizeof(int32_t));
+			memcpy(batch.getInputArgs(), &args[(size_t)t * machines], machines * sizeof(float));
+			batch.stepAll(timerTicks[t]);
+			sink += batch.getOutputCmds()[0];
+		}
+	}
+	std::chrono::duration<double, std::milli> batchTime = std::chrono::steady_clock::now() - start;
+
+	double steps = (double)ticks * passes;
+	printf("Verified %d machines x %d ticks: %llu commands, %d undefined states, %llu mismatches\n",
+		machines, ticks, (unsigned long long)commands, invalid, (unsigned long long)mismatches);
+	printf("Scalar: %.3f ms per fleet tick\n", scalarTime.count() / steps);
+	printf("Batch:  %.3f ms per fleet tick (%.1fx), %.1f%% of the %d ms tick\n", batchTime.count() / steps,
+		scalarTime.count() / batchTime.count(), 100.0 * batchTime.count() / steps / STATE_MACHINE_TICK_TIME_MS, STATE_MACHINE_TICK_TIME_MS);
+
+	return (mismatches == 0 && invalid == 0) ? 0 : 1;
+}
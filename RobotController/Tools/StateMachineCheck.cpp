@@ -0,0 +1,248 @@
+/*****************************************************
+*	StateMachineCheck.cpp
+*
+*	Checks the table driven StateMachine against the
+*	switch statement implementation it replaced
+*	(StateMachineReference). Every reachable machine
+*	configuration is stepped with every input mask,
+*	with and without a timer tick, then long random
+*	input sequences are run through both machines.
+*	Any difference in return value, state, output
+*	command, output argument, tick count or left sensor
+*	latch is reported. Also checks that compileHierarchy
+*	adds the entry and exit actions of nested composite
+*	states to exactly the transitions crossing their
+*	boundaries, and times both implementations.
+*
+*	With -chart the machine generated from cps.slx
+*	(StateMachineChart.h) is compared instead, listing
+*	where the model and the controller disagree.
+*
+*	Usage: StateMachineCheck [sequences] [steps] [-chart]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+#include "StateMachineChart.h"
+#include "StateMachineReference.h"
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define CHECK_INPUTS		0x0800		// every combination of the StateMachineDefs.h masks
+#define CHECK_TICK_CAP		(AUTO_AVOIDANCE_TURN_DELAY_TICKS + 1)	// larger tick counts behave the same
+#define CHECK_MAX_REPORTS	10
+#define CHECK_TIMING_ROUNDS	5
+
+typedef struct {
+	StateMachine			machine;
+	StateMachineReference	reference;
+}checkPair;
+
+static uint64_t mismatches = 0;
+static bool checkChart = false;
+static fsmEntry chartTable[FSM_STATE_CODES][FSM_SYMBOLS];
+
+static checkPair newPair()
+{
+	checkPair p;
+
+	if (checkChart) p.machine = StateMachine(chartTable, FSM_CHART_INITIAL_STATE);
+	return p;
+}
+
+/* Step both machines with one input and compare what they produce */
+static void stepPair(checkPair* p, uint16_t input, bool timerTick, const char* where)
+{
+	int ret, refRet, cmd, refCmd;
+	double arg, refArg;
+	int before;
+	fsmConfiguration config;
+
+	before = p->reference.getCurrentState();
+	p->machine.setInput(input, input * 0.5);
+	p->reference.setInput(input, input * 0.5);
+	ret = p->machine.stepMachine(timerTick);
+	refRet = p->reference.stepMachine(timerTick);
+	cmd = p->machine.getOutputCmd();
+	refCmd = p->reference.getOutputCmd();
+	arg = p->machine.getOutputArg();
+	refArg = p->reference.getOutputArg();
+	p->machine.getConfiguration(&config);
+
+	if (ret == refRet && cmd == refCmd && arg == refArg && config.state == p->reference.getCurrentState() &&
+		config.tickCount == p->reference.tickCount && config.leftSensorTripped == p->reference.left_sensor_tripped) return;
+	if (mismatches++ < CHECK_MAX_REPORTS) {
+		fprintf(stderr, "MISMATCH (%s): state 0x%02X input 0x%03X tick %d: table state 0x%02X cmd 0x%02X ret %d ticks %d latch %d, "
+			"reference state 0x%02X cmd 0x%02X ret %d ticks %d latch %d\n",
+			where, before, input, timerTick ? 1 : 0, config.state, cmd, ret, config.tickCount, config.leftSensorTripped ? 1 : 0,
+			p->reference.getCurrentState(), refCmd, refRet, p->reference.tickCount, p->reference.left_sensor_tripped ? 1 : 0);
+	}
+}
+
+/* Entry and exit actions of composite states: Stop holds Turning (STOP_L_STATE, STOP_R_STATE), which holds
+ * TurningRight (STOP_R_STATE). Every change of state must take the actions of the boundaries it crosses, plus
+ * those of its row (only the TURN_R_CMD row has any); staying in a state takes only those of its row. Returns the number of wrong transitions. */
+static uint64_t checkCompositeActions()
+{
+	static const fsmTransition stopRows[] = {
+		{ 0, 0, TURN_L_CMD_MASK, 0, STOP_L_STATE, TURN_L_CMD, 0 },
+		{ 0, 0, TURN_R_CMD_MASK, 0, STOP_R_STATE, TURN_R_CMD, FSM_ACT_OBSTACLE_MSG },
+		{ 0, 0, STOP_CMD_MASK, 0, STOP_STATE, STOP_CMD, 0 },
+		{ 0, 0, 0, 0, FSM_SAME_STATE, STOP_CMD, 0 },
+	};
+	static const fsmComposite composites[] = {
+		{ "Stop", -1, FSM_STATE_BIT(STOP_STATE) | FSM_STATE_BIT(STOP_L_STATE) | FSM_STATE_BIT(STOP_R_STATE), stopRows, 4, 0, 0 },
+		{ "Turning", 0, FSM_STATE_BIT(STOP_L_STATE) | FSM_STATE_BIT(STOP_R_STATE), NULL, 0, FSM_ACT_RESET_TICKS, FSM_ACT_SET_LEFT_TRIPPED },
+		{ "TurningRight", 1, FSM_STATE_BIT(STOP_R_STATE), NULL, 0, FSM_ACT_CLEAR_LEFT_TRIPPED, FSM_ACT_OBSTACLE_MSG },
+	};
+	/* Boundary actions by state before and after: STOP_STATE, STOP_L_STATE, STOP_R_STATE */
+	static const int crossing[3][3] = {
+		{ 0, FSM_ACT_RESET_TICKS, FSM_ACT_RESET_TICKS | FSM_ACT_CLEAR_LEFT_TRIPPED },
+		{ FSM_ACT_SET_LEFT_TRIPPED, 0, FSM_ACT_CLEAR_LEFT_TRIPPED },
+		{ FSM_ACT_SET_LEFT_TRIPPED | FSM_ACT_OBSTACLE_MSG, FSM_ACT_OBSTACLE_MSG, 0 },
+	};
+	static fsmEntry table[FSM_STATE_CODES][FSM_SYMBOLS];
+	uint64_t wrong = 0;
+	int from, symbol, expected;
+
+	if (StateMachine::compileHierarchy(composites, 3, table) != 0) return 1;
+	for (from = STOP_STATE; from <= STOP_R_STATE; from++) {
+		for (symbol = 0; symbol < FSM_SYMBOLS; symbol++) {
+			const fsmEntry & e = table[from][symbol];
+			expected = crossing[from - STOP_STATE][e.next - STOP_STATE] | ((e.output == TURN_R_CMD) ? FSM_ACT_OBSTACLE_MSG : 0);
+			if (e.valid && e.next >= STOP_STATE && e.next <= STOP_R_STATE && e.actions == expected) continue;
+			if (wrong++ < CHECK_MAX_REPORTS) {
+				fprintf(stderr, "COMPOSITE ACTIONS: state 0x%02X symbol 0x%03X -> state 0x%02X actions 0x%02X, expected 0x%02X\n",
+					from, symbol, e.next, e.actions, expected);
+			}
+		}
+	}
+	return wrong;
+}
+
+/* Configuration of the reference machine that determines its future behavior */
+static uint32_t configKey(const StateMachineReference & r)
+{
+	int ticks = (r.tickCount < CHECK_TICK_CAP) ? r.tickCount : CHECK_TICK_CAP;
+
+	return (uint32_t)r.currentState | ((uint32_t)r.machineMode << 8) | ((uint32_t)ticks << 16) | ((uint32_t)r.left_sensor_tripped << 24);
+}
+
+/* Random input biased toward what the gesture recognizer and sensors actually send */
+static uint16_t randomInput(std::mt19937 & rng)
+{
+	static const uint16_t common[] = {
+		NULL_CMD_MASK, STOP_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK,
+		STOP_TURN_CMD_MASK, MANUAL_MODE_CMD_MASK, AUTO_MODE_CMD_MASK, WALL_SENSOR_MASK, LEFT_SENSOR_MASK, RIGHT_SENSOR_MASK
+	};
+	uint32_t r = rng();
+
+	if ((r & 0x0F) < 6) return NULL_CMD_MASK;
+	if ((r & 0x0F) < 14) return common[(r >> 4) % (sizeof(common) / sizeof(common[0]))];
+	return (uint16_t)((r >> 8) & (CHECK_INPUTS - 1));
+}
+
+int main(int argc, char* argv[])
+{
+	int sequences, steps, s, i, input, tick, savedStdout;
+	uint64_t exhaustive, random, configs, compositeErrors;
+
+	if (argc > 1 && strcmp(argv[argc - 1], "-chart") == 0) {
+		checkChart = true;
+		argc--;
+		if (StateMachine::compileTransitions(fsmChartSpec, FSM_CHART_SPEC_COUNT, chartTable) != 0) return 1;
+	}
+	sequences = (argc > 1) ? atoi(argv[1]) : 200;
+	steps = (argc > 2) ? atoi(argv[2]) : 5000;
+	if (sequences < 1 || steps < 1) {
+		printf("Usage: %s [sequences] [steps] [-chart]\n", argv[0]);
+		return 1;
+	}
+
+	compositeErrors = checkCompositeActions();
+
+	/* The reference machine prints "Obstacle Detected." on every obstacle step */
+	fflush(stdout);
+	savedStdout = dup(1);
+	i = open("/dev/null", O_WRONLY);
+	dup2(i, 1);
+	close(i);
+
+	/* Breadth first over the configurations the reference machine can reach from power on */
+	std::map<uint32_t, bool> seen;
+	std::vector<checkPair> queue(1, newPair());
+	exhaustive = 0;
+	seen[configKey(queue[0].reference)] = true;
+	for (i = 0; i < (int)queue.size(); i++) {
+		for (input = 0; input < CHECK_INPUTS; input++) {
+			for (tick = 0; tick < 2; tick++) {
+				checkPair next = queue[i];
+				stepPair(&next, (uint16_t)input, tick != 0, "exhaustive");
+				exhaustive++;
+				uint32_t key = configKey(next.reference);
+				if (!seen[key]) {
+					seen[key] = true;
+					queue.push_back(next);
+				}
+			}
+		}
+	}
+	configs = queue.size();
+
+	/* Random sequences, mostly timer ticks */
+	std::mt19937 rng(4321);
+	random = 0;
+	for (s = 0; s < sequences; s++) {
+		checkPair p = newPair();
+		for (i = 0; i < steps; i++) {
+			stepPair(&p, randomInput(rng), (rng() & 0x07) != 0, "random");
+			random++;
+		}
+	}
+
+	/* Timing, without obstacles so printing does not dominate */
+	std::vector<uint16_t> inputs((size_t)steps * 16);
+	for (i = 0; i < (int)inputs.size(); i++) inputs[i] = randomInput(rng) & ~(WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK);
+	StateMachine machine = newPair().machine;
+	StateMachineReference reference;
+	uint64_t sum = 0;
+	double tableNs = 0.0, referenceNs = 0.0, ns;
+	/* Best of CHECK_TIMING_ROUNDS, interleaved, so a busy host slows both alike */
+	for (int round = 0; round < CHECK_TIMING_ROUNDS; round++) {
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (i = 0; i < (int)inputs.size(); i++) {
+			machine.setInput(inputs[i], 0.0);
+			machine.stepMachine();
+			sum += machine.getOutputCmd();
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		for (i = 0; i < (int)inputs.size(); i++) {
+			reference.setInput(inputs[i], 0.0);
+			reference.stepMachine();
+			sum -= reference.getOutputCmd();
+		}
+		auto t2 = std::chrono::high_resolution_clock::now();
+		ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / inputs.size();
+		if (round == 0 || ns < tableNs) tableNs = ns;
+		ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / inputs.size();
+		if (round == 0 || ns < referenceNs) referenceNs = ns;
+	}
+
+	fflush(stdout);
+	dup2(savedStdout, 1);
+	close(savedStdout);
+
+	printf("Configurations reached: %llu\n", (unsigned long long)configs);
+	printf("Exhaustive steps: %llu\n", (unsigned long long)exhaustive);
+	printf("Random steps: %llu (%d sequences)\n", (unsigned long long)random, sequences);
+	printf("Step time: table %.1f ns, reference %.1f ns%s\n", tableNs, referenceNs, sum ? " (outputs differ)" : "");
+	printf("Composite entry/exit action errors: %llu\n", (unsigned long long)compositeErrors);
+	printf("Mismatches: %llu\n", (unsigned long long)mismatches);
+	return (mismatches || sum || compositeErrors) ? 1 : 0;
+}
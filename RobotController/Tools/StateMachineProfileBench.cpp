@@ -0,0 +1,120 @@
+/*****************************************************
+*	StateMachineProfileBench.cpp
+*
+*	Runs the StateMachine on random input with and
+*	without a StateMachineProfile attached and reports
+*	the cost of profiling per step. While the profiled
+*	machine runs, another thread takes snapshots as
+*	fast as it can; every snapshot must be consistent
+*	(one more visit than changes of state, times in
+*	states adding up to the time elapsed). Prints the
+*	profile at the end.
+*
+*	Usage: StateMachineProfileBench [steps]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+#include "StateMachineProfile.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+static StateMachineProfile profile;
+static std::atomic<bool> running(false);
+static volatile uint64_t outputSum;
+
+/* Random input biased toward what the gesture recognizer and sensors actually send */
+static uint16_t randomInput(std::mt19937 & rng)
+{
+	static const uint16_t common[] = {
+		STOP_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK, STOP_TURN_CMD_MASK,
+		MANUAL_MODE_CMD_MASK, AUTO_MODE_CMD_MASK, WALL_SENSOR_MASK, LEFT_SENSOR_MASK, RIGHT_SENSOR_MASK
+	};
+	uint32_t r = rng();
+
+	if ((r & 0x1F) < 28) return NULL_CMD_MASK;
+	return common[(r >> 5) % (sizeof(common) / sizeof(common[0]))];
+}
+
+static void snapshotReader(uint64_t* snapshots, uint64_t* inconsistent)
+{
+	fsmProfileSnapshot* s;
+	uint64_t entries, changes;
+	int64_t time;
+	int from, to;
+
+	s = (fsmProfileSnapshot*)malloc(sizeof(fsmProfileSnapshot));
+	while (running.load()) {
+		profile.getSnapshot(s);
+		(*snapshots)++;
+		if (s->steps == 0) continue;
+		entries = 0;
+		changes = 0;
+		time = 0;
+		for (from = 0; from < FSM_STATE_CODES; from++) {
+			entries += s->entries[from];
+			time += s->timeIn[from];
+			for (to = 0; to < FSM_STATE_CODES; to++) changes += s->changes[from][to];
+		}
+		if (entries != changes + 1 || time != s->elapsed) (*inconsistent)++;
+	}
+	free(s);
+}
+
+static double run(const std::vector<uint16_t> & inputs, bool profiled)
+{
+	StateMachine machine;
+	uint64_t sum;
+	size_t i;
+
+	if (profiled) machine.setProfile(&profile);
+	sum = 0;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (i = 0; i < inputs.size(); i++) {
+		machine.setInput(inputs[i], 0.0);
+		machine.stepMachine((i & 0x03) != 0);
+		sum += machine.getOutputCmd();
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	outputSum = outputSum + sum;
+	return std::chrono::duration<double, std::nano>(t1 - t0).count() / inputs.size();
+}
+
+int main(int argc, char* argv[])
+{
+	int steps;
+	uint64_t snapshots, inconsistent;
+	double plainNs, profiledNs, contendedNs;
+
+	steps = (argc > 1) ? atoi(argv[1]) : 20000000;
+	if (steps < 1) {
+		printf("Usage: %s [steps]\n", argv[0]);
+		return 1;
+	}
+
+	std::mt19937 rng(77);
+	std::vector<uint16_t> inputs(steps);
+	for (int i = 0; i < steps; i++) inputs[i] = randomInput(rng);
+
+	plainNs = run(inputs, false);
+	profiledNs = run(inputs, true);
+	profile.Clear();
+
+	snapshots = 0;
+	inconsistent = 0;
+	running = true;
+	std::thread reader(snapshotReader, &snapshots, &inconsistent);
+	contendedNs = run(inputs, true);
+	running = false;
+	reader.join();
+
+	printf("Step time: %.1f ns plain, %.1f ns profiled, %.1f ns profiled while snapshotting\n", plainNs, profiledNs, contendedNs);
+	printf("Snapshots: %llu taken, %llu inconsistent\n", (unsigned long long)snapshots, (unsigned long long)inconsistent);
+	profile.Print(stdout, StateMachine::getDefaultTable());
+	return (inconsistent == 0 && snapshots > 0) ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+/*****************************************************
+*	StateMachineReference.h
+*
+*	The switch statement StateMachine that preceded the
+*	table driven one, kept unchanged apart from the
+*	class name (and initializing left_sensor_tripped
+*	and externalInput, which it read uninitialized) so
+*	StateMachineCheck can compare the two. The one
+*	change of behavior since, an obstacle interrupting
+*	an AUTO turn and holding off the turn after a
+*	reverse (StateMachineSafety obstacle-stops), is
+*	made in both. Not part of RobotController.
+*****************************************************/
+
+#pragma once
+
+#include "StateMachine.h"
+
+class StateMachineReference
+{
+public:
+	/* Public Functions */
+	StateMachineReference();
+	int getCurrentState();
+	void setInput(uint16_t input, double arg);
+	int getOutputCmd();
+	double getOutputArg();
+	int stepMachine(bool timerTick = true);
+
+	/* Public so the checker can tell configurations apart */
+	int currentState;
+	int machineMode;
+	int outputCmd;
+	double inputArg;
+	double outputArg;
+	int tickCount;
+	bool left_sensor_tripped;
+	uint16_t externalInput;
+};
@@ -0,0 +1,274 @@
+/*****************************************************
+*	StateMachineReplay.cpp
+*
+*	Replays a state machine log (RobotController
+*	-fsmlog, StateMachineLog.h) against the StateMachine
+*	in this tree and lists every step where it now
+*	ends in another state or sends another command.
+*	After a difference the machine is put back in the
+*	logged state, so each difference is reported once
+*	rather than everything after it.
+*
+*	-table replays against the built in, chart or
+*	wall following machine instead of the one the log
+*	was recorded with. -profile prints a StateMachineProfile of the
+*	replayed steps.
+*
+*	-synth writes a log of simulated driving (random
+*	gestures and obstacles) through the
+*	StateMachineLogWriter: tickless, as the controller
+*	runs now, or with -ticks one step per 20 ms tick as
+*	it used to.
+*
+*	Usage: StateMachineReplay <log> [-table builtin | chart | wallfollow] [-profile]
+*	       StateMachineReplay -synth <log> [hours] [-ticks]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+#include "StateMachineChart.h"
+#include "StateMachineLog.h"
+#include "StateMachineProfile.h"
+
+#include <chrono>
+#include <random>
+#include <unistd.h>
+
+#define REPLAY_MAX_REPORTS	20
+#define REPLAY_DAY_STEPS	(24.0 * 3600.0 * 1000.0 / STATE_MACHINE_TICK_TIME_MS)
+
+static fsmEntry chartTable[FSM_STATE_CODES][FSM_SYMBOLS];
+
+static const char* replayStateNames[FSM_STATE_CODES] = {
+	"NULL_STATE", "FORWARD_STATE", "FORWARD_L_STATE", "FORWARD_R_STATE", "STOP_STATE", "STOP_L_STATE", "STOP_R_STATE",
+	"REVERSE_STATE", "REVERSE_L_STATE", "REVERSE_R_STATE", "", "", "", "", "", "", "AVOID_OBSTACLE_STATE",
+	"AUTO_FORWARD_STATE", "AUTO_REVERSE_STATE", "AUTO_TURN_L_STATE", "AUTO_TURN_R_STATE",
+	"WALL_FOLLOW_STATE"
+};
+
+static const char* stateName(int state)
+{
+	return (state >= 0 && state < FSM_STATE_CODES) ? replayStateNames[state] : "?";
+}
+
+static const char* tableName(int table)
+{
+	switch (table) {
+	case FSM_LOG_TABLE_BUILT_IN:	return "built in";
+	case FSM_LOG_TABLE_CHART:		return "chart";
+	case FSM_LOG_TABLE_WALL_FOLLOW:	return "wall following";
+	default:						return "unknown";
+	}
+}
+
+/* Gesture command, mostly the ones an operator gives most */
+static uint16_t randomCommand(std::mt19937 & rng)
+{
+	static const uint16_t commands[] = {
+		STOP_CMD_MASK, FORWARD_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK,
+		STOP_TURN_CMD_MASK, MANUAL_MODE_CMD_MASK, AUTO_MODE_CMD_MASK, AUTO_MODE_CMD_MASK
+	};
+
+	return commands[rng() % (sizeof(commands) / sizeof(commands[0]))];
+}
+
+/* Simulated driving: a gesture every few seconds, obstacles coming and going, AUTO mode delays.
+ * Tickless steps on each input and deadline; with ticks, a step every tick plus one on each input. */
+static int synthesize(const char* path, double hours, bool ticks)
+{
+	StateMachineLogWriter log;
+	StateMachine machine;
+	std::mt19937 rng(2017);
+	int64_t now, end, nextGesture, nextSensor, nextTick, deadline;
+	uint16_t sensors, input;
+	double arg;
+	uint64_t steps;
+	int before, flags, waits;
+
+	if (log.Open(path, StateMachine::getDefaultTable(), FSM_LOG_TABLE_BUILT_IN, machine.getCurrentState()) != 0) return 1;
+
+	auto t0 = std::chrono::steady_clock::now();
+	end = (int64_t)(hours * 3600e6);
+	now = 0;
+	sensors = 0;
+	nextGesture = 1000000;
+	nextSensor = 5000000;
+	nextTick = STATE_MACHINE_TICK_TIME_US;
+	steps = 0;
+	waits = 0;
+	while (now < end) {
+		/* Next thing to happen */
+		input = 0;
+		flags = 0;
+		arg = 0.0;
+		deadline = ticks ? nextTick : machine.getNextDeadline();
+		if (nextGesture <= nextSensor && nextGesture < deadline) {
+			now = nextGesture;
+			input = randomCommand(rng);
+			if (input & (TURN_L_CMD_MASK | TURN_R_CMD_MASK)) arg = (double)(int)(rng() % 90) - 45.0;
+			nextGesture = now + 500000 + (int64_t)(rng() % 8000000);
+		}
+		else if (nextSensor < deadline) {
+			now = nextSensor;
+			sensors = sensors ? 0 : (uint16_t)(WALL_SENSOR_MASK << (rng() % 3));
+			nextSensor = now + (sensors ? 100000 + (int64_t)(rng() % 400000) : 1000000 + (int64_t)(rng() % 20000000));
+		}
+		else {
+			now = deadline;
+			if (ticks) {
+				nextTick += STATE_MACHINE_TICK_TIME_US;
+				flags = FSM_LOG_TIMER_TICK;
+			}
+		}
+
+		before = machine.getCurrentState();
+		machine.setInput(input | sensors, arg);
+		if (ticks) machine.stepMachine(flags != 0);
+		else {
+			machine.stepMachineAt(now);
+			flags = FSM_LOG_STEP_AT;
+		}
+
+		/* Simulated time runs far ahead of the writer thread. Keep a quarter of the ring free. */
+		while (log.getQueued() >= FSM_LOG_RING_RECORDS * 3 / 4) {
+			usleep(200);
+			waits++;
+		}
+		log.Log(now, input | sensors, arg, flags, before, machine.getCurrentState(), machine.getOutputCmd());
+		steps++;
+	}
+	log.Close();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+
+	printf("Wrote %llu %s steps (%.1f hours) to %s in %.2f s: %lu written, %lu dropped, waited for the writer %d times\n",
+		(unsigned long long)steps, ticks ? "ticked" : "tickless", hours, path, elapsed.count(), (unsigned long)log.getLogged(),
+		(unsigned long)log.getDropped(), waits);
+	return (log.getDropped() == 0) ? 0 : 1;
+}
+
+static int replay(const char* path, int tableChoice, bool profiled)
+{
+	StateMachineLogReader reader;
+	StateMachineProfile profile;
+	const fsmLogHeader* header;
+	const fsmLogRecord* r;
+	const fsmEntry (*table)[FSM_SYMBOLS];
+	fsmConfiguration config;
+	uint64_t i, count, differences, gaps, missing;
+	uint32_t expected;
+	int cmd, state;
+	double outputArg;
+
+	if (reader.Open(path) != 0) return 1;
+	header = reader.getHeader();
+	count = reader.getRecordCount();
+
+	if (tableChoice < 0) tableChoice = header->table;
+	if (tableChoice == FSM_LOG_TABLE_CHART) {
+		if (StateMachine::compileTransitions(fsmChartSpec, FSM_CHART_SPEC_COUNT, chartTable) != 0) return 1;
+		table = chartTable;
+	}
+	else if (tableChoice == FSM_LOG_TABLE_WALL_FOLLOW) table = StateMachine::getWallFollowTable();
+	else {
+		tableChoice = FSM_LOG_TABLE_BUILT_IN;
+		table = StateMachine::getDefaultTable();
+	}
+
+	printf("%s: %llu steps recorded with the %s machine, replayed against the %s machine\n", path, (unsigned long long)count,
+		tableName(header->table), tableName(tableChoice));
+	if (StateMachineLogWriter::tableHash(table) != header->tableHash) {
+		printf("The log was recorded with a different state machine; differences show where the behavior changed.\n");
+	}
+
+	StateMachine machine(table, header->initialState);
+	if (profiled) machine.setProfile(&profile);
+
+	differences = 0;
+	gaps = 0;
+	missing = 0;
+	expected = 1;
+	auto t0 = std::chrono::steady_clock::now();
+	for (i = 0; i < count; i++) {
+		r = reader.getRecord(i);
+
+		/* Dropped records: carry on from the state the next record starts in */
+		if (r->sequence != expected || machine.getCurrentState() != r->stateBefore) {
+			if (r->sequence != expected) {
+				gaps++;
+				missing += (uint32_t)(r->sequence - expected);
+			}
+			machine.getConfiguration(&config);
+			config.state = r->stateBefore;
+			machine.setConfiguration(config);
+		}
+		expected = r->sequence + 1;
+
+		machine.setInput(r->input, r->arg);
+		if (r->flags & FSM_LOG_STEP_AT) machine.stepMachineAt(r->time);
+		else machine.stepMachine((r->flags & FSM_LOG_TIMER_TICK) != 0);
+		cmd = machine.getOutputCmd();
+		outputArg = machine.getOutputArg();
+		state = machine.getCurrentState();
+
+		if (state == r->state && cmd == r->output && outputArg == r->arg) continue;
+		if (differences++ < REPLAY_MAX_REPORTS) {
+			fprintf(stderr, "step %llu at %.3f s: %s input 0x%03X -> logged %s cmd 0x%02X, replayed %s cmd 0x%02X\n",
+				(unsigned long long)i, (r->time - reader.getRecord(0)->time) / 1e6, stateName(r->stateBefore), r->input,
+				stateName(r->state), r->output, stateName(state), cmd);
+		}
+		/* Report each difference once */
+		machine.getConfiguration(&config);
+		config.state = r->state;
+		machine.setConfiguration(config);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+
+	printf("Replayed %llu steps in %.3f s (%.1f M steps/s, a day of 20 ms ticks in %.2f s)\n", (unsigned long long)count,
+		elapsed.count(), count / elapsed.count() / 1e6, (count > 0) ? REPLAY_DAY_STEPS * elapsed.count() / count : 0.0);
+	if (gaps) printf("%llu gaps in the log, %llu steps missing\n", (unsigned long long)gaps, (unsigned long long)missing);
+	printf("Differences: %llu\n", (unsigned long long)differences);
+	if (profiled) profile.Print(stdout, table);
+	return (differences == 0) ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	int tableChoice, i;
+	bool profiled, ticks;
+	double hours;
+
+	if (argc >= 3 && strcmp(argv[1], "-synth") == 0) {
+		hours = 24.0;
+		ticks = false;
+		for (i = 3; i < argc; i++) {
+			if (strcmp(argv[i], "-ticks") == 0) ticks = true;
+			else hours = atof(argv[i]);
+		}
+		if (hours <= 0.0) {
+			printf("Usage: %s -synth <log> [hours] [-ticks]\n", argv[0]);
+			return 1;
+		}
+		return synthesize(argv[2], hours, ticks);
+	}
+
+	tableChoice = -1;
+	profiled = false;
+	for (i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-table") == 0 && (i + 1) < argc) {
+			i++;
+			if (strcmp(argv[i], "chart") == 0) tableChoice = FSM_LOG_TABLE_CHART;
+			else if (strcmp(argv[i], "builtin") == 0) tableChoice = FSM_LOG_TABLE_BUILT_IN;
+			else if (strcmp(argv[i], "wallfollow") == 0) tableChoice = FSM_LOG_TABLE_WALL_FOLLOW;
+			else argc = 0;
+		}
+		else if (strcmp(argv[i], "-profile") == 0) profiled = true;
+		else argc = 0;
+	}
+	if (argc < 2) {
+		printf("Usage: %s <log> [-table builtin | chart | wallfollow] [-profile]\n", argv[0]);
+		printf("       %s -synth <log> [hours] [-ticks]\n", argv[0]);
+		return 1;
+	}
+	return replay(argv[1], tableChoice, profiled);
+}
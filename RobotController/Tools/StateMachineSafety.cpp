@@ -0,0 +1,375 @@
+/*****************************************************
+*	StateMachineSafety.cpp
+*
+*	Proves safety properties of the StateMachine by
+*	exploring every configuration it can reach from
+*	power on. Each configuration (state, tick count,
+*	left sensor latch; the mode follows from the state)
+*	is stepped with every 12 bit input mask, with and
+*	without a timer tick. Tick counts past the turn
+*	delay behave the same and are merged, so the space
+*	is finite and fits a 4096 entry visited set.
+*
+*	The search is breadth first, one level at a time,
+*	with the configurations of a level dealt out to
+*	worker threads. Counterexamples are the shortest
+*	input trace from power on, the same on every run.
+*
+*	Properties:
+*	  obstacle-stops	an obstacle sensor makes the output REVERSE_CMD or STOP_CMD,
+*						at once or on the next step if the obstacle persists
+*	  auto-exit			MANUAL_MODE_CMD_MASK leaves AUTO mode from every AUTO configuration
+*	  defined			no reachable configuration is in a state the table does not define
+*
+*	With -chart the machine generated from cps.slx
+*	(StateMachineChart.h) is checked instead.
+*
+*	Any violation fails the check.
+*
+*	Usage: StateMachineSafety [-threads <n>] [-chart]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+#include "StateMachineChart.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define SAFETY_INPUT_BITS	12
+#define SAFETY_INPUTS		(1 << SAFETY_INPUT_BITS)
+#define SAFETY_MOVES		(2 * SAFETY_INPUTS)		// input, plus timer tick as bit 12
+#define SAFETY_TICK_CAP		AUTO_AVOIDANCE_TURN_DELAY_TICKS		// larger tick counts behave the same
+#define SAFETY_KEYS			(1 << 12)				// state (5 bits), capped tick count (6 bits), latch (1 bit)
+#define SAFETY_NONE			0xFFFFFFFFu
+#define SAFETY_SENSOR_MASK	(WALL_SENSOR_MASK | LEFT_SENSOR_MASK | RIGHT_SENSOR_MASK)
+
+#define PROPERTY_OBSTACLE_STOPS		0
+#define PROPERTY_AUTO_EXIT			1
+#define PROPERTY_DEFINED			2
+#define PROPERTY_COUNT				3
+
+static const char* propertyNames[PROPERTY_COUNT] = { "obstacle-stops", "auto-exit", "defined" };
+
+static const char* stateNames[FSM_STATE_CODES] = {
+	"NULL_STATE", "FORWARD_STATE", "FORWARD_L_STATE", "FORWARD_R_STATE", "STOP_STATE", "STOP_L_STATE", "STOP_R_STATE",
+	"REVERSE_STATE", "REVERSE_L_STATE", "REVERSE_R_STATE", "", "", "", "", "", "", "AVOID_OBSTACLE_STATE",
+	"AUTO_FORWARD_STATE", "AUTO_REVERSE_STATE", "AUTO_TURN_L_STATE", "AUTO_TURN_R_STATE",
+	"WALL_FOLLOW_STATE"
+};
+
+/* Shortest counterexample of a property: configuration at the given depth, the move that breaks
+ * it and, for obstacle-stops, the move on the next step */
+typedef struct {
+	bool		found;
+	uint32_t	depth;
+	uint32_t	key;
+	uint32_t	move;
+	uint32_t	nextMove;
+}safetyViolation;
+
+typedef struct {
+	const fsmEntry			(*table)[FSM_SYMBOLS];
+	int						initialState;
+	const std::vector<uint32_t>*	frontier;
+	std::atomic<size_t>		nextItem;
+	uint32_t				depth;
+	bool					obstaclePass;		// second pass over every reachable configuration
+
+	const uint8_t*			visited;
+	const uint32_t*			depths;
+	std::atomic<uint32_t>*	candidate;			// smallest parent << 13 | move that reached an unvisited key this level
+	uint8_t*				obstacleSafe;		// every obstacle input gives REVERSE_CMD or STOP_CMD
+	uint32_t*				obstacleFail;		// first move that does not
+
+	std::mutex				lock;
+	safetyViolation			violations[PROPERTY_COUNT];
+	std::atomic<uint64_t>	steps;
+}safetyShared;
+
+static uint32_t packKey(const fsmConfiguration & c)
+{
+	int ticks = (c.tickCount < SAFETY_TICK_CAP) ? c.tickCount : SAFETY_TICK_CAP;
+
+	return (uint32_t)c.state | ((uint32_t)ticks << 5) | ((uint32_t)(c.leftSensorTripped ? 1 : 0) << 11);
+}
+
+static fsmConfiguration unpackKey(uint32_t key)
+{
+	fsmConfiguration c;
+
+	c.state = (int)(key & 0x1F);
+	c.tickCount = (int)((key >> 5) & 0x3F);
+	c.leftSensorTripped = ((key >> 11) & 1) != 0;
+	return c;
+}
+
+/* Keep the violation found earliest in the search, ties broken by key and moves */
+static void recordViolation(safetyShared* shared, int property, uint32_t depth, uint32_t key, uint32_t move, uint32_t nextMove)
+{
+	safetyViolation* v = &shared->violations[property];
+	std::lock_guard<std::mutex> guard(shared->lock);
+
+	if (v->found) {
+		if (v->depth != depth) { if (v->depth < depth) return; }
+		else if (v->key != key) { if (v->key < key) return; }
+		else if (v->move != move) { if (v->move < move) return; }
+		else if (v->nextMove <= nextMove) return;
+	}
+	v->found = true;
+	v->depth = depth;
+	v->key = key;
+	v->move = move;
+	v->nextMove = nextMove;
+}
+
+static bool isStop(int cmd)
+{
+	return cmd == REVERSE_CMD || cmd == STOP_CMD;
+}
+
+/* Step every move from one configuration, checking auto-exit and defined and queueing new configurations */
+static void expandConfiguration(safetyShared* shared, StateMachine* m, uint32_t key)
+{
+	fsmConfiguration c = unpackKey(key), n;
+	bool autoMode = StateMachine::stateMode(c.state) == AUTO_MODE;
+	uint32_t move, nextKey, edge, seen;
+	uint16_t input;
+	int cmd;
+
+	shared->obstacleSafe[key] = 1;
+	shared->obstacleFail[key] = SAFETY_NONE;
+	for (move = 0; move < SAFETY_MOVES; move++) {
+		input = (uint16_t)(move & (SAFETY_INPUTS - 1));
+		m->setConfiguration(c);
+		m->setInput(input, 0.0);
+		if (m->stepMachine((move >> SAFETY_INPUT_BITS) != 0) != 0) {
+			recordViolation(shared, PROPERTY_DEFINED, shared->depth, key, move, SAFETY_NONE);
+			continue;
+		}
+		cmd = m->getOutputCmd();
+		m->getConfiguration(&n);
+		nextKey = packKey(n);
+
+		if (autoMode && (input & MANUAL_MODE_CMD_MASK) && StateMachine::stateMode(n.state) != MANUAL_MODE) {
+			recordViolation(shared, PROPERTY_AUTO_EXIT, shared->depth, key, move, SAFETY_NONE);
+		}
+		if ((input & SAFETY_SENSOR_MASK) && !isStop(cmd) && shared->obstacleSafe[key]) {
+			shared->obstacleSafe[key] = 0;
+			shared->obstacleFail[key] = move;
+		}
+
+		if (shared->visited[nextKey]) continue;
+		edge = (key << (SAFETY_INPUT_BITS + 1)) | move;
+		seen = shared->candidate[nextKey].load();
+		while (edge < seen && !shared->candidate[nextKey].compare_exchange_weak(seen, edge)) {}
+	}
+	shared->steps += SAFETY_MOVES;
+}
+
+/* obstacle-stops: an obstacle step that does not stop must reach a configuration where every obstacle input stops */
+static void checkObstacle(safetyShared* shared, StateMachine* m, uint32_t key)
+{
+	fsmConfiguration c = unpackKey(key), n;
+	uint32_t move, nextKey, steps;
+	uint16_t input;
+
+	steps = 0;
+	for (move = 0; move < SAFETY_MOVES; move++) {
+		input = (uint16_t)(move & (SAFETY_INPUTS - 1));
+		if (!(input & SAFETY_SENSOR_MASK)) continue;
+		m->setConfiguration(c);
+		m->setInput(input, 0.0);
+		steps++;
+		if (m->stepMachine((move >> SAFETY_INPUT_BITS) != 0) != 0) continue;
+		if (isStop(m->getOutputCmd())) continue;
+		m->getConfiguration(&n);
+		nextKey = packKey(n);
+		if (!shared->obstacleSafe[nextKey]) {
+			recordViolation(shared, PROPERTY_OBSTACLE_STOPS, shared->depths[key], key, move, shared->obstacleFail[nextKey]);
+		}
+	}
+	shared->steps += steps;
+}
+
+static void worker(safetyShared* shared)
+{
+	StateMachine m(shared->table, shared->initialState);
+	size_t item;
+
+	while ((item = shared->nextItem++) < shared->frontier->size()) {
+		if (shared->obstaclePass) checkObstacle(shared, &m, (*shared->frontier)[item]);
+		else expandConfiguration(shared, &m, (*shared->frontier)[item]);
+	}
+}
+
+static void runWorkers(safetyShared* shared, const std::vector<uint32_t> & items, size_t threadCount)
+{
+	std::vector<std::thread> threads;
+	size_t i;
+
+	shared->frontier = &items;
+	shared->nextItem = 0;
+	if (threadCount > items.size()) threadCount = items.size();
+	for (i = 0; i < threadCount; i++) threads.push_back(std::thread(worker, shared));
+	for (i = 0; i < threadCount; i++) threads[i].join();
+}
+
+static void appendf(std::string* s, const char* format, ...)
+{
+	char buffer[512];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	*s += buffer;
+}
+
+static std::string inputNames(uint16_t input)
+{
+	static const char* names[] = { "STOP_CMD_MASK", "FORWARD_CMD_MASK", "REVERSE_CMD_MASK", "TURN_L_CMD_MASK", "TURN_R_CMD_MASK",
+		"STOP_TURN_CMD_MASK", "MANUAL_MODE_CMD_MASK", "AUTO_MODE_CMD_MASK", "WALL_SENSOR_MASK", "LEFT_SENSOR_MASK",
+		"RIGHT_SENSOR_MASK", "0x0800" };
+	std::string s;
+
+	for (int b = 0; b < SAFETY_INPUT_BITS; b++) {
+		if (input & (1 << b)) s += (s.empty() ? "" : " | ") + std::string(names[b]);
+	}
+	return s.empty() ? "NULL_CMD_MASK" : s;
+}
+
+static std::string commandName(int command)
+{
+	static const char* names[] = { "STOP_CMD", "FORWARD_CMD", "REVERSE_CMD", "TURN_L_CMD", "TURN_R_CMD",
+		"FORWARD_L_CMD", "FORWARD_R_CMD", "REVERSE_L_CMD", "REVERSE_R_CMD" };
+
+	if (command >= STOP_CMD && command <= REVERSE_R_CMD) return names[command - STOP_CMD];
+	return "NULL_CMD";
+}
+
+/* Replay the moves from power on, listing each step */
+static void appendTrace(std::string* s, safetyShared* shared, const std::vector<uint32_t> & moves)
+{
+	StateMachine m(shared->table, shared->initialState);
+	fsmConfiguration c;
+	size_t i;
+	int ret, cmd;
+
+	appendf(s, "    power on: %s\n", stateNames[shared->initialState]);
+	for (i = 0; i < moves.size(); i++) {
+		m.setInput((uint16_t)(moves[i] & (SAFETY_INPUTS - 1)), 0.0);
+		ret = m.stepMachine((moves[i] >> SAFETY_INPUT_BITS) != 0);
+		cmd = m.getOutputCmd();
+		m.getConfiguration(&c);
+		appendf(s, "    step %d: %s%s -> ", (int)i + 1, inputNames((uint16_t)(moves[i] & (SAFETY_INPUTS - 1))).c_str(),
+			(moves[i] >> SAFETY_INPUT_BITS) ? ", timer tick" : "");
+		if (ret != 0) appendf(s, "undefined state %d\n", c.state);
+		else appendf(s, "%s, %s, tick count %d%s\n", stateNames[c.state], commandName(cmd).c_str(), c.tickCount,
+			c.leftSensorTripped ? ", left tripped" : "");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	static fsmEntry chartTable[FSM_STATE_CODES][FSM_SYMBOLS];
+	std::vector<uint8_t> visited(SAFETY_KEYS, 0), obstacleSafe(SAFETY_KEYS, 0);
+	std::vector<uint32_t> parents(SAFETY_KEYS, SAFETY_NONE), depths(SAFETY_KEYS, 0), obstacleFail(SAFETY_KEYS, SAFETY_NONE);
+	std::vector<std::atomic<uint32_t> > candidate(SAFETY_KEYS);
+	std::vector<uint32_t> frontier, reachable, moves;
+	size_t threadCount;
+	uint32_t key;
+	int c, p, failed;
+	bool useChart = false;
+	safetyShared shared;
+
+	threadCount = std::thread::hardware_concurrency();
+	if (threadCount < 1) threadCount = 1;
+	for (c = 1; c < argc; c++) {
+		if (strcmp(argv[c], "-threads") == 0 && c + 1 < argc) threadCount = (size_t)atoi(argv[++c]);
+		else if (strcmp(argv[c], "-chart") == 0) useChart = true;
+		else threadCount = 0;
+	}
+	if (threadCount < 1) {
+		printf("Usage: %s [-threads <n>] [-chart]\n", argv[0]);
+		return 1;
+	}
+
+	shared.table = StateMachine::getDefaultTable();
+	shared.initialState = STOP_STATE;
+	if (useChart) {
+		if (StateMachine::compileTransitions(fsmChartSpec, FSM_CHART_SPEC_COUNT, chartTable) != 0) return 1;
+		shared.table = chartTable;
+		shared.initialState = FSM_CHART_INITIAL_STATE;
+	}
+	shared.visited = &visited[0];
+	shared.depths = &depths[0];
+	shared.candidate = &candidate[0];
+	shared.obstacleSafe = &obstacleSafe[0];
+	shared.obstacleFail = &obstacleFail[0];
+	shared.obstaclePass = false;
+	shared.steps = 0;
+	for (p = 0; p < PROPERTY_COUNT; p++) shared.violations[p].found = false;
+	for (key = 0; key < SAFETY_KEYS; key++) candidate[key] = SAFETY_NONE;
+
+	auto start = std::chrono::steady_clock::now();
+	fsmConfiguration initial;
+	StateMachine(shared.table, shared.initialState).getConfiguration(&initial);
+	key = packKey(initial);
+	visited[key] = 1;
+	frontier.push_back(key);
+	for (shared.depth = 0; !frontier.empty(); shared.depth++) {
+		runWorkers(&shared, frontier, threadCount);
+		reachable.insert(reachable.end(), frontier.begin(), frontier.end());
+
+		/* New configurations in key order, each with its smallest parent edge */
+		frontier.clear();
+		for (key = 0; key < SAFETY_KEYS; key++) {
+			if (candidate[key] == SAFETY_NONE) continue;
+			visited[key] = 1;
+			parents[key] = candidate[key];
+			depths[key] = shared.depth + 1;
+			candidate[key] = SAFETY_NONE;
+			frontier.push_back(key);
+		}
+	}
+	shared.obstaclePass = true;
+	runWorkers(&shared, reachable, threadCount);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	/* Counterexamples */
+	std::string report;
+	failed = 0;
+	for (p = 0; p < PROPERTY_COUNT; p++) {
+		const safetyViolation & v = shared.violations[p];
+		if (!v.found) {
+			appendf(&report, "%s: holds\n", propertyNames[p]);
+			continue;
+		}
+		failed++;
+		appendf(&report, "%s: VIOLATED, counterexample:\n", propertyNames[p]);
+		moves.clear();
+		if (v.nextMove != SAFETY_NONE) moves.push_back(v.nextMove);
+		moves.push_back(v.move);
+		for (key = v.key; parents[key] != SAFETY_NONE; key = parents[key] >> (SAFETY_INPUT_BITS + 1)) {
+			moves.push_back(parents[key] & (SAFETY_MOVES - 1));
+		}
+		std::reverse(moves.begin(), moves.end());
+		appendTrace(&report, &shared, moves);
+	}
+
+	printf("%s machine: %d configurations reached, depth %d\n", useChart ? "Chart" : "Built in",
+		(int)reachable.size(), (int)shared.depth - 1);
+	printf("%llu steps on %d threads in %.2f s (%.1f M steps/s)\n", (unsigned long long)shared.steps.load(), (int)threadCount,
+		elapsed.count(), shared.steps.load() / elapsed.count() / 1e6);
+	printf("%s", report.c_str());
+	printf("%s\n", failed ? "FAIL" : "PASS");
+	return failed ? 1 : 0;
+}
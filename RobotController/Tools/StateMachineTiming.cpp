@@ -0,0 +1,398 @@
+/*****************************************************
+*	StateMachineTiming.cpp
+*
+*	Checks the tickless state machine timing used by
+*	the main loop against the timer tick stepping it
+*	replaced, on simulated time.
+*
+*	1. TimerWheel against a plain list of deadlines,
+*	   with random arming, cancelling and expiring over
+*	   short and long clock jumps.
+*	2. stepMachineAt, stepped only on input and at
+*	   getNextDeadline, against stepMachine stepped
+*	   every tick, with inputs on tick boundaries. The
+*	   state after every tick and the last command sent
+*	   must be the same.
+*	3. AUTO mode avoidance with inputs at any time and
+*	   late wakeups, timing how long each reverse and
+*	   turn lasts in both loops, from the wakeup that
+*	   sends its command to the one that sends the next,
+*	   and the wakeups taken while idle. The tickless
+*	   loop must be off by no more than one wakeup's
+*	   lateness.
+*
+*	Usage: StateMachineTiming [seconds]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define TICK_US				STATE_MACHINE_TICK_TIME_US
+#define TIMING_MAX_REPORTS	10
+#define TIMING_STALL_US		40000	// occasional late wakeup, e.g. another thread holding the CPU
+#define TIMING_MANEUVER_US	((int64_t)(AUTO_AVOIDANCE_REVERSE_DELAY_TICKS + AUTO_AVOIDANCE_TURN_DELAY_TICKS + 5) * TICK_US)
+
+static uint64_t errors = 0;
+
+/* Part 1 */
+static void checkWheel(int rounds)
+{
+	std::mt19937 rng(99);
+	std::vector<int64_t> reference(TIMER_WHEEL_TIMERS, TIMER_WHEEL_NEVER);
+	int64_t now, deadline, expected;
+	uint64_t expired;
+	int round, timer, i;
+
+	now = 123456789;
+	TimerWheel wheel(now);
+	expired = 0;
+	for (round = 0; round < rounds; round++) {
+		timer = rng() % TIMER_WHEEL_TIMERS;
+		switch (rng() % 4) {
+		case 0:
+		case 1:
+			/* Mostly within one turn, some far ahead or already passed */
+			deadline = now + (int64_t)(rng() % (TIMER_WHEEL_SLOTS * TIMER_WHEEL_RESOLUTION));
+			if ((rng() & 0x0F) == 0) deadline = now + (int64_t)(rng() % 5000000);
+			if ((rng() & 0x0F) == 1) deadline = now - (int64_t)(rng() % 5000);
+			wheel.Schedule(timer, deadline);
+			reference[timer] = deadline;
+			break;
+		case 2:
+			wheel.Cancel(timer);
+			reference[timer] = TIMER_WHEEL_NEVER;
+			break;
+		default:
+			now += (rng() & 0x07) ? (int64_t)(rng() % 20000) : (int64_t)(rng() % 3000000);
+			while (1) {
+				/* Due timers must come out earliest first */
+				expected = TIMER_WHEEL_NEVER;
+				for (i = 0; i < TIMER_WHEEL_TIMERS; i++) {
+					if (reference[i] <= now && reference[i] < expected) expected = reference[i];
+				}
+				timer = wheel.Expire(now, &deadline);
+				if (timer < 0) {
+					if (expected != TIMER_WHEEL_NEVER && errors++ < TIMING_MAX_REPORTS) {
+						fprintf(stderr, "ERROR: timer due at %lld not expired at %lld\n", (long long)expected, (long long)now);
+					}
+					break;
+				}
+				if ((deadline != expected || reference[timer] != deadline) && errors++ < TIMING_MAX_REPORTS) {
+					fprintf(stderr, "ERROR: timer %d expired at %lld with deadline %lld, expected deadline %lld\n", timer,
+						(long long)now, (long long)deadline, (long long)expected);
+				}
+				reference[timer] = TIMER_WHEEL_NEVER;
+				expired++;
+			}
+			break;
+		}
+
+		expected = *std::min_element(reference.begin(), reference.end());
+		if (wheel.nextDeadline() != expected && errors++ < TIMING_MAX_REPORTS) {
+			fprintf(stderr, "ERROR: next deadline %lld, expected %lld\n", (long long)wheel.nextDeadline(), (long long)expected);
+		}
+		for (i = 0; i < TIMER_WHEEL_TIMERS; i++) {
+			if (wheel.isScheduled(i) != (reference[i] != TIMER_WHEEL_NEVER) && errors++ < TIMING_MAX_REPORTS) {
+				fprintf(stderr, "ERROR: timer %d armed state differs\n", i);
+			}
+		}
+	}
+	printf("Timer wheel: %d operations, %llu expired\n", rounds, (unsigned long long)expired);
+}
+
+/* Gesture command for one tick, mostly none */
+static uint16_t randomCommand(std::mt19937 & rng)
+{
+	static const uint16_t commands[] = {
+		STOP_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK,
+		STOP_TURN_CMD_MASK, MANUAL_MODE_CMD_MASK, AUTO_MODE_CMD_MASK, AUTO_MODE_CMD_MASK
+	};
+
+	if (rng() % 40) return NULL_CMD_MASK;
+	return commands[rng() % (sizeof(commands) / sizeof(commands[0]))];
+}
+
+/* Sensors tripped for the next tick */
+static uint16_t randomSensors(std::mt19937 & rng, uint16_t sensors)
+{
+	static const uint16_t masks[] = { WALL_SENSOR_MASK, LEFT_SENSOR_MASK, RIGHT_SENSOR_MASK };
+
+	if (rng() % 30) return sensors;
+	return sensors ^ masks[rng() % 3];
+}
+
+/* Part 2 */
+static void checkEquivalence(int sequences, int ticks, uint64_t* steps, uint64_t* ticklessSteps)
+{
+	std::mt19937 rng(2024);
+	int64_t now, deadline;
+	uint16_t command, sensors, lastSensors;
+	int s, k, tickCmd, sentCmd, cmd;
+
+	*steps = 0;
+	*ticklessSteps = 0;
+	for (s = 0; s < sequences; s++) {
+		StateMachine ticked;
+		StateMachine tickless;
+		sensors = 0;
+		lastSensors = 0;
+		sentCmd = NULL_CMD;
+		now = 1000000;
+
+		tickless.setInput(0, 0.0);
+		tickless.stepMachineAt(now);
+		sentCmd = tickless.getOutputCmd();
+		for (k = 1; k <= ticks; k++) {
+			now += TICK_US;
+			command = randomCommand(rng);
+			sensors = randomSensors(rng, sensors);
+
+			ticked.setInput(command | sensors, 0.0);
+			ticked.stepMachine(true);
+			tickCmd = ticked.getOutputCmd();
+			(*steps)++;
+
+			/* Tickless: on a command, a sensor change or the machine's deadline */
+			deadline = tickless.getNextDeadline();
+			if (command || sensors != lastSensors || deadline <= now) {
+				if (deadline < now && errors++ < TIMING_MAX_REPORTS) {
+					fprintf(stderr, "ERROR: deadline %lld between ticks\n", (long long)deadline);
+				}
+				tickless.setInput(command | sensors, 0.0);
+				tickless.stepMachineAt(now);
+				cmd = tickless.getOutputCmd();
+				if (cmd != NULL_CMD) sentCmd = cmd;
+				lastSensors = sensors;
+				(*ticklessSteps)++;
+			}
+
+			if ((ticked.getCurrentState() != tickless.getCurrentState() || tickCmd != sentCmd) && errors++ < TIMING_MAX_REPORTS) {
+				fprintf(stderr, "ERROR: sequence %d tick %d: ticked state 0x%02X cmd 0x%02X, tickless state 0x%02X last cmd 0x%02X\n",
+					s, k, ticked.getCurrentState(), tickCmd, tickless.getCurrentState(), sentCmd);
+			}
+		}
+	}
+}
+
+/* Part 3 */
+typedef struct {
+	int64_t		time;
+	uint16_t	input;
+	bool		sensor;		// input is the sensors tripped from now on, else a gesture command
+}timedInput;
+
+typedef struct {
+	int			state;
+	int			from;		// state before it
+	int64_t		since;
+	uint64_t	wakeups;
+	uint64_t	idleWakeups;
+	std::vector<int64_t> reverse;	// duration of each completed AUTO_REVERSE started from AUTO_FORWARD
+	std::vector<int64_t> turn;		// and AUTO_TURN_L/R
+}loopStats;
+
+/* Note the time spent in the state left at time */
+static void stateAt(loopStats* stats, int state, int64_t time)
+{
+	if (state == stats->state) return;
+	/* A reverse after a turn ends on the next step, the turn delay having already passed */
+	if (stats->state == AUTO_REVERSE_STATE && stats->from == AUTO_FORWARD_STATE && state != STOP_STATE) {
+		stats->reverse.push_back(time - stats->since);
+	}
+	if ((stats->state == AUTO_TURN_L_STATE || stats->state == AUTO_TURN_R_STATE) && state != STOP_STATE) {
+		stats->turn.push_back(time - stats->since);
+	}
+	stats->from = stats->state;
+	stats->state = state;
+	stats->since = time;
+}
+
+static int64_t lateness(std::mt19937 & rng)
+{
+	if (rng() % 100 == 0) return TIMING_STALL_US;
+	return (int64_t)(rng() % 2000);
+}
+
+/* The previous main loop: a tick every STATE_MACHINE_TICK_TIME_US after the last, ticks missed by a late
+ * wakeup are skipped, and inputs step the machine without a tick as they arrive */
+static void runTicked(const std::vector<timedInput> & inputs, int64_t end, uint32_t seed, loopStats* stats)
+{
+	std::mt19937 rng(seed);
+	StateMachine machine;
+	int64_t nextTick, wake;
+	uint16_t sensors;
+	size_t i;
+
+	sensors = 0;
+	nextTick = TICK_US;
+	i = 0;
+	stats->state = machine.getCurrentState();
+	while (1) {
+		wake = nextTick + lateness(rng);
+		if (i < inputs.size() && inputs[i].time < wake) {
+			if (inputs[i].sensor) sensors = inputs[i].input;
+			machine.setInput((inputs[i].sensor ? 0 : inputs[i].input) | sensors, 0.0);
+			machine.stepMachine(false);
+			stateAt(stats, machine.getCurrentState(), inputs[i].time);
+			stats->wakeups++;
+			i++;
+			continue;
+		}
+		if (wake > end) break;
+		nextTick += TICK_US;
+		if (nextTick < wake) nextTick = wake + TICK_US;
+		machine.setInput(sensors, 0.0);
+		machine.stepMachine(true);
+		stateAt(stats, machine.getCurrentState(), wake);
+		stats->wakeups++;
+		if (machine.getCurrentState() == STOP_STATE) stats->idleWakeups++;
+	}
+}
+
+/* The tickless main loop: inputs step the machine at their time, deadlines at the deadline however late the
+ * loop wakes for them. The command is sent when the loop wakes, so that is when the maneuver changes. */
+static void runTickless(const std::vector<timedInput> & inputs, int64_t end, uint32_t seed, loopStats* stats)
+{
+	std::mt19937 rng(seed);
+	StateMachine machine;
+	TimerWheel timers(0);
+	int64_t deadline, wake;
+	uint16_t sensors;
+	size_t i;
+
+	sensors = 0;
+	i = 0;
+	machine.stepMachineAt(0);
+	stats->state = machine.getCurrentState();
+	while (1) {
+		deadline = timers.nextDeadline();
+		wake = (deadline == TIMER_WHEEL_NEVER) ? TIMER_WHEEL_NEVER : deadline + lateness(rng);
+		if (i < inputs.size() && inputs[i].time < wake) {
+			wake = inputs[i].time;
+		}
+		if (wake > end) break;
+		stats->wakeups++;
+		if (machine.getCurrentState() == STOP_STATE) stats->idleWakeups++;
+
+		while (timers.Expire(wake, &deadline) >= 0) {
+			machine.setInput(sensors, 0.0);
+			machine.stepMachineAt(deadline);
+			stateAt(stats, machine.getCurrentState(), wake);
+			deadline = machine.getNextDeadline();
+			if (deadline == FSM_NO_DEADLINE) timers.Cancel(0);
+			else timers.Schedule(0, deadline);
+		}
+		if (i < inputs.size() && inputs[i].time == wake) {
+			if (inputs[i].sensor) sensors = inputs[i].input;
+			machine.setInput((inputs[i].sensor ? 0 : inputs[i].input) | sensors, 0.0);
+			machine.stepMachineAt(wake);
+			stateAt(stats, machine.getCurrentState(), wake);
+			deadline = machine.getNextDeadline();
+			if (deadline == FSM_NO_DEADLINE) timers.Cancel(0);
+			else timers.Schedule(0, deadline);
+			i++;
+		}
+	}
+}
+
+static void printDurations(const char* loop, const char* phase, std::vector<int64_t> & d, int64_t nominal)
+{
+	int64_t worst;
+	double sum;
+	size_t i;
+
+	if (d.empty()) return;
+	sum = 0.0;
+	worst = 0;
+	for (i = 0; i < d.size(); i++) {
+		sum += (double)(d[i] - nominal);
+		if (std::llabs(d[i] - nominal) > std::llabs(worst)) worst = d[i] - nominal;
+	}
+	printf("  %-9s %-8s %5lu times, %4lld ms nominal, error mean %+8.3f ms, worst %+8.3f ms\n", loop, phase, (unsigned long)d.size(),
+		(long long)(nominal / 1000), sum / d.size() / 1000.0, worst / 1000.0);
+}
+
+static void compareLoops(int seconds)
+{
+	std::mt19937 rng(7);
+	std::vector<timedInput> inputs;
+	loopStats ticked = loopStats(), tickless = loopStats();
+	timedInput in;
+	int64_t t, end, idleStart;
+	size_t i;
+
+	/* AUTO mode with obstacles at random times for the first part, then idle in manual STOP. Obstacles are
+	 * at least a reverse and a turn apart and clear before the reverse ends, as one seen during a maneuver
+	 * cuts it short or holds it (StateMachineSafety obstacle-stops). */
+	end = (int64_t)seconds * 1000000;
+	idleStart = end / 2;
+	in.time = 1000;
+	in.input = AUTO_MODE_CMD_MASK;
+	in.sensor = false;
+	inputs.push_back(in);
+	for (t = in.time + 1000; t < idleStart; ) {
+		t += TIMING_MANEUVER_US + (int64_t)(rng() % 3000000);
+		in.time = t;
+		in.input = (rng() & 1) ? WALL_SENSOR_MASK : LEFT_SENSOR_MASK;
+		in.sensor = true;
+		inputs.push_back(in);
+		t += 50000 + (int64_t)(rng() % 200000);
+		in.time = t;
+		in.input = 0;
+		inputs.push_back(in);
+	}
+	in.time = t + 1000;
+	in.input = MANUAL_MODE_CMD_MASK;
+	in.sensor = false;
+	inputs.push_back(in);
+
+	runTicked(inputs, end, 11, &ticked);
+	runTickless(inputs, end, 11, &tickless);
+
+	printf("Avoidance over %d s, %lu inputs at any time, wakeups up to %d ms late:\n", seconds, (unsigned long)inputs.size(),
+		TIMING_STALL_US / 1000);
+	printDurations("ticked", "reverse", ticked.reverse, (int64_t)AUTO_AVOIDANCE_REVERSE_DELAY_TICKS * TICK_US);
+	printDurations("tickless", "reverse", tickless.reverse, (int64_t)AUTO_AVOIDANCE_REVERSE_DELAY_TICKS * TICK_US);
+	printDurations("ticked", "turn", ticked.turn, (int64_t)AUTO_AVOIDANCE_TURN_DELAY_TICKS * TICK_US);
+	printDurations("tickless", "turn", tickless.turn, (int64_t)AUTO_AVOIDANCE_TURN_DELAY_TICKS * TICK_US);
+	printf("  Wakeups: ticked %llu (%llu in STOP), tickless %llu (%llu in STOP)\n", (unsigned long long)ticked.wakeups,
+		(unsigned long long)ticked.idleWakeups, (unsigned long long)tickless.wakeups, (unsigned long long)tickless.idleWakeups);
+
+	/* Delays are timed from the deadline, not the late wakeup, so lateness does not add up over the ticks of
+	 * a maneuver: each one is off by at most the lateness of the wakeups that start and end it */
+	for (i = 0; i < tickless.reverse.size(); i++) {
+		if (std::llabs(tickless.reverse[i] - (int64_t)AUTO_AVOIDANCE_REVERSE_DELAY_TICKS * TICK_US) > TIMING_STALL_US) errors++;
+	}
+	for (i = 0; i < tickless.turn.size(); i++) {
+		if (std::llabs(tickless.turn[i] - (int64_t)AUTO_AVOIDANCE_TURN_DELAY_TICKS * TICK_US) > TIMING_STALL_US) errors++;
+	}
+	if (tickless.reverse.empty() || tickless.turn.empty()) errors++;
+}
+
+int main(int argc, char* argv[])
+{
+	int seconds;
+	uint64_t steps, ticklessSteps;
+
+	seconds = (argc > 1) ? atoi(argv[1]) : 600;
+	if (seconds < 10) {
+		printf("Usage: %s [seconds]\n", argv[0]);
+		return 1;
+	}
+
+	checkWheel(2000000);
+
+	checkEquivalence(200, 5000, &steps, &ticklessSteps);
+	printf("Tick equivalence: %llu ticks, %llu tickless steps (%.1f%%)\n", (unsigned long long)steps,
+		(unsigned long long)ticklessSteps, 100.0 * ticklessSteps / steps);
+
+	compareLoops(seconds);
+	printf("Errors: %llu\n", (unsigned long long)errors);
+	return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/*****************************************************
+*	TemplateBench.cpp
+*
+*	Matches a synthetic motion stream against a library
+*	of synthetic gesture templates, checking the pruned
+*	matcher reports the same commands as an unpruned
+*	DTW over every template, and timing the per-frame
+*	cost against the 1 ms budget.
+*
+*	Usage: TemplateBench [templates] [frames] [template file]
+*	The library is written to the template file if given.
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "TemplateMatcher.h"
+#include "StateMachineDefs.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#define BENCH_FRAME_BUDGET_US	1000.0
+
+static const uint16_t benchCommands[] = {
+	STOP_CMD_MASK, FORWARD_CMD_MASK, REVERSE_CMD_MASK, TURN_L_CMD_MASK, TURN_R_CMD_MASK, MANUAL_MODE_CMD_MASK, AUTO_MODE_CMD_MASK
+};
+#define BENCH_COMMAND_COUNT	(sizeof(benchCommands) / sizeof(benchCommands[0]))
+
+/* Smooth random arm trajectory: each feature is a sum of two sinusoids */
+static void makeMotion(std::mt19937 & rng, float* frames, int length)
+{
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	int i, k;
+
+	for (k = 0; k < TEMPLATE_FEATURES; k++) {
+		float a = 0.3f + 0.7f * uni(rng), b = 0.2f * uni(rng);
+		float w = 1.0f + 3.0f * uni(rng), p = 6.28f * uni(rng), base = 2.0f * uni(rng) - 1.0f;
+		for (i = 0; i < length; i++) {
+			float t = (float)i / (float)(length - 1);
+			frames[i * TEMPLATE_FEATURES + k] = base + a * sinf(w * t + p) + b * sinf(3.0f * w * t);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	TemplateLibrary library;
+	TemplateMatcher matcher;
+	int templateCount, frameCount, i, f, k, length, inserted;
+	uint64_t pruned, computed, commands, mismatches;
+	double totalUs, fullUs;
+
+	templateCount = (argc > 1) ? atoi(argv[1]) : 48;
+	frameCount = (argc > 2) ? atoi(argv[2]) : 20000;
+	if (templateCount < 1 || templateCount > TEMPLATE_MAX_COUNT || frameCount < 1) {
+		printf("Usage: %s [templates (1-%d)] [frames] [template file]\n", argv[0], TEMPLATE_MAX_COUNT);
+		return 1;
+	}
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	std::vector<float> frames(TEMPLATE_MAX_LENGTH * TEMPLATE_FEATURES);
+	for (i = 0; i < templateCount; i++) {
+		length = 20 + (int)(uni(rng) * (float)(TEMPLATE_MAX_LENGTH - 20));
+		makeMotion(rng, &frames[0], length);
+		library.addTemplate(benchCommands[i % BENCH_COMMAND_COUNT], &frames[0], length, 0.05f);
+	}
+	if (argc > 3 && library.Save(argv[3]) == 0) printf("Wrote %d templates to %s\n", templateCount, argv[3]);
+
+	/* Stream: random motion with noisy copies of templates inserted now and then. Each copy speeds up
+	 * and slows down within the warping band. Half of the copies are also exaggerated so they come close
+	 * to a template without matching it. */
+	std::vector<float> stream((size_t)frameCount * TEMPLATE_FEATURES);
+	inserted = 0;
+	for (f = 0; f < frameCount; ) {
+		if (uni(rng) < 0.5f) {
+			const gestureTemplate* t = library.getTemplate((int)(uni(rng) * templateCount) % templateCount);
+			float warp = (float)t->band * (2.0f * uni(rng) - 1.0f);
+			float scale = (uni(rng) < 0.5f) ? 1.0f : 1.2f + 0.2f * uni(rng);
+			for (i = 0; i < t->length && f < frameCount; i++, f++) {
+				float pos = (float)i + warp * sinf(3.14159f * (float)i / (float)(t->length - 1));
+				int j = (int)pos;
+				float frac = pos - (float)j;
+				if (j >= t->length - 1) { j = t->length - 2; frac = 1.0f; }
+				for (k = 0; k < TEMPLATE_FEATURES; k++) {
+					stream[(size_t)f * TEMPLATE_FEATURES + k] = scale * (t->frames[j * TEMPLATE_FEATURES + k] * (1.0f - frac)
+						+ t->frames[(j + 1) * TEMPLATE_FEATURES + k] * frac) + 0.05f * (uni(rng) - 0.5f);
+				}
+			}
+			inserted++;
+		}
+		else {
+			length = 20 + (int)(uni(rng) * 40.0f);
+			makeMotion(rng, &frames[0], length);
+			for (i = 0; i < length && f < frameCount; i++, f++) {
+				memcpy(&stream[(size_t)f * TEMPLATE_FEATURES], &frames[i * TEMPLATE_FEATURES], TEMPLATE_FEATURES * sizeof(float));
+			}
+		}
+	}
+
+	/* Pruned matcher, checked against full DTW over every template on the same window */
+	std::vector<float> history;
+	pruned = computed = commands = mismatches = 0;
+	std::vector<double> frameUs(frameCount);
+	totalUs = fullUs = 0.0;
+	for (f = 0; f < frameCount; f++) {
+		const float* features = &stream[(size_t)f * TEMPLATE_FEATURES];
+		uint16_t expected = NULL_CMD_MASK, command;
+		float best = FLT_MAX;
+
+		std::chrono::steady_clock::time_point fullStart = std::chrono::steady_clock::now();
+		history.insert(history.end(), features, features + TEMPLATE_FEATURES);
+		if (history.size() > TEMPLATE_MAX_LENGTH * TEMPLATE_FEATURES) history.erase(history.begin(), history.begin() + TEMPLATE_FEATURES);
+		for (i = 0; i < library.getCount(); i++) {
+			const gestureTemplate* t = library.getTemplate(i);
+			int filled = (int)(history.size() / TEMPLATE_FEATURES);
+			if (t->length > filled) continue;
+			float d = TemplateMatcher::dtwDistance(&history[(size_t)(filled - t->length) * TEMPLATE_FEATURES], *t, FLT_MAX) / (float)t->length;
+			if (d <= t->threshold && d <= best) {
+				best = d;
+				expected = t->command;
+			}
+		}
+		fullUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - fullStart).count();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		matcher.Push(features);
+		command = matcher.Match(library);
+		double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		totalUs += us;
+		frameUs[f] = us;
+		pruned += matcher.getLastPruned();
+		computed += matcher.getLastComputed();
+		if (command != expected) mismatches++;
+		if (command != NULL_CMD_MASK) {
+			commands++;
+			history.clear();
+		}
+	}
+
+	printf("%d templates, %d frames, %d gestures inserted: %llu matched, %llu mismatches against full DTW\n",
+		templateCount, frameCount, inserted, (unsigned long long)commands, (unsigned long long)mismatches);
+	printf("LB_Keogh pruned %.2f%% of template comparisons (%llu full DTW)\n",
+		100.0 * (double)pruned / (double)(pruned + computed > 0 ? pruned + computed : 1), (unsigned long long)computed);
+	/* Single frame maxima include scheduler preemption, so the budget is checked at p99.9 */
+	std::sort(frameUs.begin(), frameUs.end());
+	double p999 = frameUs[(size_t)((double)(frameCount - 1) * 0.999)];
+	printf("Per frame: mean %.1f us, p99.9 %.1f us, max %.1f us (budget %.0f us), full DTW mean %.1f us\n",
+		totalUs / frameCount, p999, frameUs[frameCount - 1], BENCH_FRAME_BUDGET_US, fullUs / frameCount);
+
+	return (mismatches == 0 && p999 < BENCH_FRAME_BUDGET_US) ? 0 : 1;
+}
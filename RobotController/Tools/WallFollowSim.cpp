@@ -0,0 +1,431 @@
+/*****************************************************
+*	WallFollowSim.cpp
+*
+*	Drives a kinematic model of the Create around the
+*	upper floors of the figure8 and test_world courses
+*	(walls and floor taken from the gazebo worlds) with the
+*	ray sensors of the robot in those worlds, stepping
+*	the StateMachine as the controller's main loop does:
+*	on each change of the sensor bits and at
+*	getNextDeadline, every 20 ms tick at the most.
+*
+*	  auto			AUTO mode: bump, reverse and turn on the
+*					WALL/LEFT/RIGHT bits of the listener thread
+*	  wallfollow	WALL_FOLLOW_STATE steered by WallFollower on
+*					the raw ranges (RobotController -wallfollow)
+*
+*	Reports distance driven, the share of the floor
+*	visited, stop-start commands (STOP, REVERSE and turns
+*	in place), time spent scraping a wall, and falls.
+*	Fails if wall following sends a stop-start command,
+*	falls, or scrapes more than SIM_SCRAPE_BOUND of the
+*	run and more than SIM_SCRAPE_MARGIN over AUTO mode on
+*	the same course. The margin allows for walls met at
+*	under about 58 degrees, where the body touches before
+*	the wall sensor sees them, on the 45 degree corners
+*	of figure8 that AUTO scrapes too.
+*
+*	The robot is a disc that slides along the walls it
+*	touches, swinging parallel to them as a driven robot
+*	pushed against a wall does. Commands set a speed that holds until the
+*	next one: forward or reverse at -speed m/s (0.3 by
+*	default) and a turn rate of twice the turn argument
+*	in rad/s, positive left, as gazeboInterface does.
+*
+*	Usage: WallFollowSim [minutes] [-speed <m/s>] [-left]
+*****************************************************/
+
+#include "stdafx.h"
+
+#include "StateMachine.h"
+#include "WallFollower.h"
+
+#include <vector>
+
+#define SIM_TICK_US			STATE_MACHINE_TICK_TIME_US
+#define SIM_SUBSTEPS		4
+#define SIM_ROBOT_RADIUS	0.17		// Create body
+#define SIM_WALL_HALF_WIDTH	0.075		// walls are 0.15 thick
+#define SIM_WALL_SENSOR_X	0.16		// wall_sensor, facing forward
+#define SIM_WALL_SENSOR_MIN	0.01
+#define SIM_WALL_SENSOR_MAX	0.04
+#define SIM_ALIGN_RATE		2.0			// rad/s, swing of a robot pushed against a wall
+#define SIM_CELL			0.5			// floor coverage grid, meters
+#define SIM_SCRAPE_BOUND	8.0			// % of the run wall following may scrape
+#define SIM_SCRAPE_MARGIN	3.0			// % over AUTO mode it may scrape beyond the bound
+
+typedef struct {
+	double	x, y, yaw, length;
+}simWall;
+
+typedef struct {
+	double	x0, y0, x1, y1;
+}simFloor;
+
+typedef struct {
+	const char*		name;
+	const simWall*	walls;
+	int				wallCount;
+	const simFloor*	floors;
+	int				floorCount;
+	double			startX, startY, startYaw;
+}simCourse;
+
+/* figure8.sdf: Wall_67 to Wall_88 on Floor_1, the robot between the two loops */
+static const simWall figure8Walls[] = {
+	{ 1.73076, -0.023134, 1.5708, 4.75 }, { 2.91517, 3.46127, 0.785398, 3.5 }, { 7.52457, 4.64568, 0.0, 7.0 },
+	{ 12.134, 3.46127, -0.785398, 3.5 }, { 13.3184, -0.023134, -1.5708, 4.75 }, { 12.2224, -3.41915, -2.35619, 3.25 },
+	{ 12.134, -5.5228, -0.785398, 3.0 }, { 13.1416, -9.20542, -1.5708, 5.5 }, { 12.2224, -12.7997, -2.35619, 2.75 },
+	{ 7.75313, -13.7189, 3.14159, 7.25 }, { 3.1955, -12.7113, 2.35619, 3.0 }, { 2.18787, -9.02864, 1.5708, 5.5 },
+	{ 3.10711, -5.43441, 0.785398, 2.75 }, { 2.87855, -3.41915, 2.37927, 3.32407 }, { 5.07665, 0.040596, -1.5708, 4.25 },
+	{ 7.50166, -2.0094, 0.0, 5.0 }, { 9.92665, -0.084404, 1.5708, 4.0 }, { 7.50166, 1.9656, 3.09009, 5.00644 },
+	{ 7.53416, -7.12973, 0.0, 5.0 }, { 9.95916, -9.05473, -1.5708, 4.0 }, { 7.65916, -10.9797, 3.14159, 4.75 },
+	{ 5.23416, -9.05473, 1.63564, 4.00811 },
+};
+static const simFloor figure8Floors[] = {
+	{ 7.52457 - 5.89985, -4.53661 - 9.28835, 7.52457 + 5.89985, -4.53661 + 9.28835 },
+};
+
+/* test_world.sdf: Square_Building upper floor, Wall_19 to Wall_24 (Wall_24 has a door), and Floor_1 around
+ * the stair well along the west wall */
+static const simWall testWorldWalls[] = {
+	{ 0.184893, -3.15654, 0.0, 7.0 }, { 3.6099, 0.268465, 1.5708, 7.0 }, { 0.184893, 3.69346, 3.14159, 7.0 },
+	{ -3.2401, 0.268465, -1.5708, 7.0 }, { 0.260259, 2.27526, -1.5708, 3.0 },
+	{ 1.93526 - 1.10366, 0.850263, 0.0, 1.29268 }, { 1.93526 + 1.09634, 0.850263, 0.0, 1.30732 },
+};
+#define TW_FLOOR(w, h, x, y)	{ 0.185076 + (x) - (w) / 2, 0.271864 + (y) - (h) / 2, 0.185076 + (x) + (w) / 2, 0.271864 + (y) + (h) / 2 }
+static const simFloor testWorldFloors[] = {
+	TW_FLOOR(0.079016, 7.0068, -3.46049, 0.0), TW_FLOOR(6.92098, 1.70511, 0.039508, -2.65084),
+	TW_FLOOR(5.92098, 5.30168, 0.539508, 0.852556), TW_FLOOR(1.0, 1.80168, -2.92098, 2.60256),
+	TW_FLOOR(5.92098, 0.1, 0.539508, 3.5034),
+};
+
+#define SIM_COUNT(a)	(int)(sizeof(a) / sizeof(a[0]))
+
+static const simCourse courses[] = {
+	{ "figure8", figure8Walls, SIM_COUNT(figure8Walls), figure8Floors, SIM_COUNT(figure8Floors), 7.56595, -4.61509, 2.44202 },
+	{ "test_world", testWorldWalls, SIM_COUNT(testWorldWalls), testWorldFloors, SIM_COUNT(testWorldFloors), 0.281937, -0.439671, 0.047369 },
+};
+
+/* Cliff sensors in the robot frame, in gazeboSensorData order after the wall sensor */
+static const double cliffX[] = { 0.07, 0.15, 0.07, 0.15 };
+static const double cliffY[] = { 0.14, 0.04, -0.14, -0.04 };
+
+typedef struct {
+	double		distance;
+	double		coverage;		// share of the reachable floor cells visited
+	int			stopStarts;
+	double		scrapeTime;		// s
+	double		fallTime;		// s, 0 if it did not fall
+	uint64_t	steps;
+}simResult;
+
+static void toWall(const simWall & w, double x, double y, double* lx, double* ly)
+{
+	double c = cos(w.yaw), s = sin(w.yaw);
+
+	*lx = (x - w.x) * c + (y - w.y) * s;
+	*ly = -(x - w.x) * s + (y - w.y) * c;
+}
+
+static bool onFloor(const simCourse & course, double x, double y)
+{
+	int i;
+
+	for (i = 0; i < course.floorCount; i++) {
+		if (x >= course.floors[i].x0 && x <= course.floors[i].x1 && y >= course.floors[i].y0 && y <= course.floors[i].y1) return true;
+	}
+	return false;
+}
+
+/* Distance from a point to the nearest wall, 0 inside one; the direction to push out along in nx, ny */
+static double wallDistance(const simCourse & course, double x, double y, double* nx, double* ny)
+{
+	double best, lx, ly, cx, cy, d, ex, ey;
+	int i;
+
+	best = INFINITY;
+	for (i = 0; i < course.wallCount; i++) {
+		const simWall & w = course.walls[i];
+		toWall(w, x, y, &lx, &ly);
+		cx = fmax(-w.length / 2, fmin(w.length / 2, lx));
+		cy = fmax(-SIM_WALL_HALF_WIDTH, fmin(SIM_WALL_HALF_WIDTH, ly));
+		d = hypot(lx - cx, ly - cy);
+		if (d >= best) continue;
+		best = d;
+		if (d > 0.0) {
+			ex = (lx - cx) / d;
+			ey = (ly - cy) / d;
+		}
+		else {
+			ex = 0.0;
+			ey = (ly >= 0.0) ? 1.0 : -1.0;
+			best = -(SIM_WALL_HALF_WIDTH - fabs(ly));
+		}
+		*nx = ex * cos(w.yaw) - ey * sin(w.yaw);
+		*ny = ex * sin(w.yaw) + ey * cos(w.yaw);
+	}
+	return best;
+}
+
+/* Distance along a ray to the nearest wall */
+static double rayDistance(const simCourse & course, double x, double y, double dx, double dy)
+{
+	double best, ox, oy, rx, ry, t0, t1, lo, hi, half[2], o[2], r[2];
+	int i, a;
+
+	best = INFINITY;
+	for (i = 0; i < course.wallCount; i++) {
+		const simWall & w = course.walls[i];
+		toWall(w, x, y, &ox, &oy);
+		rx = dx * cos(w.yaw) + dy * sin(w.yaw);
+		ry = -dx * sin(w.yaw) + dy * cos(w.yaw);
+		half[0] = w.length / 2;
+		half[1] = SIM_WALL_HALF_WIDTH;
+		o[0] = ox;
+		o[1] = oy;
+		r[0] = rx;
+		r[1] = ry;
+		lo = 0.0;
+		hi = INFINITY;
+		for (a = 0; a < 2; a++) {
+			if (fabs(r[a]) < 1e-12) {
+				if (fabs(o[a]) > half[a]) hi = -1.0;
+				continue;
+			}
+			t0 = (-half[a] - o[a]) / r[a];
+			t1 = (half[a] - o[a]) / r[a];
+			if (t0 > t1) std::swap(t0, t1);
+			lo = fmax(lo, t0);
+			hi = fmin(hi, t1);
+		}
+		if (lo <= hi && lo < best) best = lo;
+	}
+	return best;
+}
+
+/* Ray sensor readings at a pose, INFINITY when nothing is in range */
+static void readSensors(const simCourse & course, double x, double y, double yaw, gazeboSensorData* data)
+{
+	double c = cos(yaw), s = sin(yaw), range;
+	int i;
+
+	range = rayDistance(course, x + SIM_WALL_SENSOR_X * c, y + SIM_WALL_SENSOR_X * s, c, s);
+	if (range > SIM_WALL_SENSOR_MAX) range = INFINITY;
+	else if (range < SIM_WALL_SENSOR_MIN) range = SIM_WALL_SENSOR_MIN;
+	data->sensor_ranges[WALL_ID % GAZEBO_SENSOR_BASE] = range;
+
+	for (i = 0; i < 4; i++) {
+		data->sensor_ranges[1 + i] = onFloor(course, x + cliffX[i] * c - cliffY[i] * s, y + cliffX[i] * s + cliffY[i] * c) ?
+			WALL_FOLLOW_FLOOR_RANGE : INFINITY;
+	}
+}
+
+/* The listener thread's sensor bits */
+static uint16_t sensorMask(const gazeboSensorData & data)
+{
+	uint16_t mask = 0;
+
+	if (data.sensor_ranges[WALL_ID % GAZEBO_SENSOR_BASE] < WALL_SENSOR_TRIP_RANGE) mask |= WALL_SENSOR_MASK;
+	if (data.sensor_ranges[LEFT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ||
+		data.sensor_ranges[LEFTFRONT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE) mask |= LEFT_SENSOR_MASK;
+	if (data.sensor_ranges[RIGHT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE ||
+		data.sensor_ranges[RIGHTFRONT_ID % GAZEBO_SENSOR_BASE] > TILT_SENSOR_TRIP_RANGE) mask |= RIGHT_SENSOR_MASK;
+	return mask;
+}
+
+/* Floor cells the robot can reach from the start, by flood fill over cells it fits in */
+static void reachableCells(const simCourse & course, double x0, double y0, int columns, int rows, std::vector<uint8_t> & reachable)
+{
+	std::vector<int> stack;
+	double nx, ny, cx, cy;
+	int cell, c, r, d;
+	static const int dc[] = { 1, -1, 0, 0 }, dr[] = { 0, 0, 1, -1 };
+
+	reachable.assign(columns * rows, 0);
+	std::vector<uint8_t> clear(columns * rows, 0);
+	for (r = 0; r < rows; r++) {
+		for (c = 0; c < columns; c++) {
+			cx = x0 + (c + 0.5) * SIM_CELL;
+			cy = y0 + (r + 0.5) * SIM_CELL;
+			clear[r * columns + c] = onFloor(course, cx, cy) && wallDistance(course, cx, cy, &nx, &ny) >= SIM_ROBOT_RADIUS;
+		}
+	}
+
+	c = (int)((course.startX - x0) / SIM_CELL);
+	r = (int)((course.startY - y0) / SIM_CELL);
+	reachable[r * columns + c] = 1;
+	stack.push_back(r * columns + c);
+	while (!stack.empty()) {
+		cell = stack.back();
+		stack.pop_back();
+		for (d = 0; d < 4; d++) {
+			c = cell % columns + dc[d];
+			r = cell / columns + dr[d];
+			if (c < 0 || c >= columns || r < 0 || r >= rows || reachable[r * columns + c] || !clear[r * columns + c]) continue;
+			/* Not through a wall */
+			cx = x0 + (cell % columns + 0.5 + dc[d] * 0.5) * SIM_CELL;
+			cy = y0 + (cell / columns + 0.5 + dr[d] * 0.5) * SIM_CELL;
+			if (wallDistance(course, cx, cy, &nx, &ny) < SIM_ROBOT_RADIUS) continue;
+			reachable[r * columns + c] = 1;
+			stack.push_back(r * columns + c);
+		}
+	}
+}
+
+static void simulate(const simCourse & course, bool wallFollow, int side, double minutes, double speed, simResult* result)
+{
+	const fsmEntry (*table)[FSM_SYMBOLS] = wallFollow ? StateMachine::getWallFollowTable() : StateMachine::getDefaultTable();
+	StateMachine machine(table, STOP_STATE);
+	WallFollower follower;
+	gazeboSensorData data;
+	std::vector<uint8_t> reachable, visited;
+	double x, y, yaw, v, w, turnAngle, dt, d, nx, ny, x0, y0, x1, y1, into, along;
+	int64_t now, end, deadline;
+	uint16_t mask, lastMask, input;
+	int cmd, stateBefore, i, columns, rows, cell, reachableCount, visitedCount;
+	bool scraping;
+
+	follower.setSide(side);
+	memset(result, 0x00, sizeof(*result));
+
+	/* Coverage grid over the floor */
+	x0 = y0 = INFINITY;
+	x1 = y1 = -INFINITY;
+	for (i = 0; i < course.floorCount; i++) {
+		x0 = fmin(x0, course.floors[i].x0);
+		y0 = fmin(y0, course.floors[i].y0);
+		x1 = fmax(x1, course.floors[i].x1);
+		y1 = fmax(y1, course.floors[i].y1);
+	}
+	columns = (int)ceil((x1 - x0) / SIM_CELL);
+	rows = (int)ceil((y1 - y0) / SIM_CELL);
+	reachableCells(course, x0, y0, columns, rows, reachable);
+	visited.assign(columns * rows, 0);
+	reachableCount = 0;
+	for (i = 0; i < columns * rows; i++) reachableCount += reachable[i];
+	visitedCount = 0;
+
+	x = course.startX;
+	y = course.startY;
+	yaw = course.startYaw;
+	v = w = 0.0;
+	turnAngle = 0.0;
+	dt = SIM_TICK_US / 1e6 / SIM_SUBSTEPS;
+	end = (int64_t)(minutes * 60e6);
+	lastMask = 0;
+	deadline = 0;
+	for (now = 0; now < end; now += SIM_TICK_US) {
+		readSensors(course, x, y, yaw, &data);
+		mask = sensorMask(data);
+
+		/* AUTO_MODE_CMD_MASK once at the start, then steps on sensor changes and deadlines as in the main loop */
+		if (now == 0 || mask != lastMask || now >= deadline) {
+			input = (now == 0) ? (uint16_t)(AUTO_MODE_CMD_MASK | mask) : mask;
+			lastMask = mask;
+			stateBefore = machine.getCurrentState();
+			machine.setInput(input, turnAngle);
+			machine.stepMachineAt(now);
+			cmd = machine.getOutputCmd();
+			deadline = machine.getNextDeadline();
+			result->steps++;
+
+			if (machine.getCurrentState() == WALL_FOLLOW_STATE && cmd != NULL_CMD) {
+				if (stateBefore != WALL_FOLLOW_STATE) follower.Reset();
+				cmd = follower.Update(data, (machine.getOutputActions() & FSM_ACT_TOO_CLOSE) != 0, &turnAngle);
+			}
+			else if (machine.getCurrentState() == AUTO_TURN_L_STATE) turnAngle = WALL_FOLLOW_MAX_TURN;
+			else if (machine.getCurrentState() == AUTO_TURN_R_STATE) turnAngle = -WALL_FOLLOW_MAX_TURN;
+
+			switch (cmd) {
+			case STOP_CMD:			v = 0.0; w = 0.0; break;
+			case FORWARD_CMD:		v = speed; w = 0.0; break;
+			case REVERSE_CMD:		v = -speed; w = 0.0; break;
+			case TURN_L_CMD:
+			case TURN_R_CMD:		v = 0.0; w = 2.0 * turnAngle; break;
+			case FORWARD_L_CMD:
+			case FORWARD_R_CMD:		v = speed; w = 2.0 * turnAngle; break;
+			case REVERSE_L_CMD:
+			case REVERSE_R_CMD:		v = -speed; w = 2.0 * turnAngle; break;
+			default:				break;
+			}
+			if (now > 0 && (cmd == STOP_CMD || cmd == REVERSE_CMD || cmd == REVERSE_L_CMD || cmd == REVERSE_R_CMD ||
+				cmd == TURN_L_CMD || cmd == TURN_R_CMD)) result->stopStarts++;
+		}
+
+		/* Move, sliding along walls */
+		scraping = false;
+		for (i = 0; i < SIM_SUBSTEPS; i++) {
+			yaw += w * dt;
+			x += v * cos(yaw) * dt;
+			y += v * sin(yaw) * dt;
+			result->distance += fabs(v) * dt;
+			d = wallDistance(course, x, y, &nx, &ny);
+			if (d < SIM_ROBOT_RADIUS) {
+				x += (SIM_ROBOT_RADIUS - d) * nx;
+				y += (SIM_ROBOT_RADIUS - d) * ny;
+				scraping = true;
+				/* Pushed against a wall, the contact ahead of the axle swings the robot parallel to it */
+				into = -(cos(yaw) * nx + sin(yaw) * ny) * (v >= 0.0 ? 1.0 : -1.0);
+				if (into > 0.0 && v != 0.0) {
+					along = (-sin(yaw) * nx + cos(yaw) * ny) * (v >= 0.0 ? 1.0 : -1.0);
+					yaw += ((along >= 0.0) ? 1.0 : -1.0) * fmin(SIM_ALIGN_RATE * dt, asin(fmin(1.0, into)));
+				}
+			}
+		}
+		if (scraping) result->scrapeTime += SIM_TICK_US / 1e6;
+
+		if (!onFloor(course, x, y)) {
+			result->fallTime = (now + SIM_TICK_US) / 1e6;
+			break;
+		}
+		cell = (int)((y - y0) / SIM_CELL) * columns + (int)((x - x0) / SIM_CELL);
+		if (reachable[cell] && !visited[cell]) {
+			visited[cell] = 1;
+			visitedCount++;
+		}
+	}
+	result->coverage = (reachableCount > 0) ? (double)visitedCount / reachableCount : 0.0;
+}
+
+int main(int argc, char* argv[])
+{
+	simResult result;
+	double minutes, speed;
+	double scraping, autoScraping;
+	int side, c, m, failed;
+
+	minutes = 10.0;
+	speed = 0.3;
+	side = WALL_FOLLOW_RIGHT;
+	for (c = 1; c < argc; c++) {
+		if (strcmp(argv[c], "-speed") == 0 && c + 1 < argc) speed = atof(argv[++c]);
+		else if (strcmp(argv[c], "-left") == 0) side = WALL_FOLLOW_LEFT;
+		else minutes = atof(argv[c]);
+	}
+	if (minutes <= 0.0 || speed <= 0.0) {
+		printf("Usage: %s [minutes] [-speed <m/s>] [-left]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%.1f minutes per run at %.2f m/s, wall following on the %s\n", minutes, speed, (side == WALL_FOLLOW_RIGHT) ? "right" : "left");
+	printf("Course       Mode          distance (m)  floor visited  stop-starts  scraping (%%)  steps/s  fell at (s)\n");
+	failed = 0;
+	autoScraping = 0.0;
+	for (c = 0; c < SIM_COUNT(courses); c++) {
+		for (m = 0; m < 2; m++) {
+			simulate(courses[c], m == 1, side, minutes, speed, &result);
+			scraping = 100.0 * result.scrapeTime / (minutes * 60.0);
+
+			printf("%-12s %-12s %13.1f %13.1f%% %12d %13.1f %8.1f", courses[c].name, (m == 1) ? "wallfollow" : "auto", result.distance,
+				100.0 * result.coverage, result.stopStarts, scraping, result.steps / (minutes * 60.0));
+			if (result.fallTime > 0.0) printf(" %12.1f\n", result.fallTime);
+			else printf(" %12s\n", "-");
+			if (m == 0) autoScraping = scraping;
+			else if (result.stopStarts != 0 || result.fallTime > 0.0 ||
+				(scraping > SIM_SCRAPE_BOUND && scraping > autoScraping + SIM_SCRAPE_MARGIN)) failed++;
+		}
+	}
+	printf("%s\n", failed ? "FAIL: wall following stopped, fell or scraped the walls" : "PASS");
+	return failed ? 1 : 0;
+}
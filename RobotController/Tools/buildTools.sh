@@ -0,0 +1,23 @@
+SRC=../RobotController
+CXXFLAGS="-Wall -O2 -std=c++11 -I$SRC"
+GESTURE_SRC="$SRC/Gesture.cpp $SRC/GestureFeatures.cpp $SRC/LatencyTrace.cpp $SRC/SkeletonLog.cpp $SRC/FileSkeletonSource.cpp $SRC/UdpSkeletonSource.cpp $SRC/TemplateMatcher.cpp $SRC/SkeletonFilter.cpp"
+FSM_SRC="$SRC/StateMachine.cpp $SRC/StateMachineProfile.cpp $SRC/LatencyTrace.cpp"
+mkdir -p build/
+g++ $CXXFLAGS -o build/GestureReplay GestureReplay.cpp $GESTURE_SRC
+g++ $CXXFLAGS -o build/SkeletonStream SkeletonStream.cpp $SRC/SkeletonLog.cpp
+g++ $CXXFLAGS -mavx2 -o build/GestureBatchBench GestureBatchBench.cpp $SRC/GestureBatch.cpp $GESTURE_SRC
+g++ $CXXFLAGS -mavx2 -o build/TemplateBench TemplateBench.cpp $SRC/TemplateMatcher.cpp $SRC/GestureFeatures.cpp
+g++ $CXXFLAGS -o build/SkeletonFilterBench SkeletonFilterBench.cpp $SRC/SkeletonFilter.cpp $SRC/SkeletonLog.cpp
+g++ $CXXFLAGS -o build/GestureSynth GestureSynth.cpp GestureCorpus.cpp $SRC/SkeletonLog.cpp
+g++ $CXXFLAGS -o build/GestureAccuracy GestureAccuracy.cpp GestureCorpus.cpp $GESTURE_SRC
+g++ $CXXFLAGS -pthread -o build/GestureSweep GestureSweep.cpp GestureCorpus.cpp $GESTURE_SRC
+g++ $CXXFLAGS -o build/GestureEarlyCommit GestureEarlyCommit.cpp GestureCorpus.cpp $GESTURE_SRC
+g++ $CXXFLAGS -o build/StateMachineCheck StateMachineCheck.cpp StateMachineReference.cpp $FSM_SRC
+g++ $CXXFLAGS -o build/SlxImport SlxImport.cpp $FSM_SRC
+g++ $CXXFLAGS -mavx2 -o build/StateMachineBatchBench StateMachineBatchBench.cpp $SRC/StateMachineBatch.cpp $FSM_SRC
+g++ $CXXFLAGS -pthread -o build/StateMachineSafety StateMachineSafety.cpp $FSM_SRC
+g++ $CXXFLAGS -pthread -o build/InputQueueStress InputQueueStress.cpp $SRC/InputQueue.cpp $SRC/LatencyTrace.cpp
+g++ $CXXFLAGS -o build/StateMachineTiming StateMachineTiming.cpp $SRC/TimerWheel.cpp $FSM_SRC
+g++ $CXXFLAGS -pthread -o build/StateMachineProfileBench StateMachineProfileBench.cpp $FSM_SRC
+g++ $CXXFLAGS -pthread -o build/StateMachineReplay StateMachineReplay.cpp $SRC/StateMachineLog.cpp $FSM_SRC
+g++ $CXXFLAGS -o build/WallFollowSim WallFollowSim.cpp $SRC/WallFollower.cpp $FSM_SRC
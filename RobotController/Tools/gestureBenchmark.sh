@@ -0,0 +1,9 @@
+# Builds the tools, writes the synthetic benchmark corpus and checks gesture accuracy and
+# throughput (relative to a reference workload timed in the same run) against
+# gestureBaseline.txt. Exits non-zero on a regression.
+# Extra arguments are passed to GestureAccuracy, e.g. -write-baseline gestureBaseline.txt
+cd "$(dirname "$0")" || exit 1
+sh buildTools.sh || exit 1
+mkdir -p build/corpus
+./build/GestureSynth build/corpus 8 1 || exit 1
+./build/GestureAccuracy build/corpus/corpus.txt -baseline gestureBaseline.txt -repeat 10 "$@"
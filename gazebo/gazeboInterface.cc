@@ -50,6 +50,10 @@
 #define LEFTFRONT_ID			0xA2
 #define RIGHT_ID			0xA3
 #define RIGHTFRONT_ID			0xA4
+#define TRACE_ACK_ID			0xA5  /* Acknowledges a published command. Value is the command's trace ID */
+
+/* Command message: int id, double arg, uint32_t trace id */
+#define CMD_MSG_SIZE      (sizeof(int) + sizeof(double) + sizeof(uint32_t))
 
 /* Gazebo/User command ID's */
 #define NULL_CMD			0x00
@@ -196,12 +200,12 @@ int connect_to_server_udp()
   return 0;
 }
 
-int recvCmd(int *id, double *arg)
+int recvCmd(int *id, double *arg, uint32_t *trace_id)
 {
   int status;
   struct sockaddr_storage their_addr;
   socklen_t addr_len;
-  char buf[12];
+  char buf[CMD_MSG_SIZE];
 
   addr_len = sizeof(struct sockaddr);
   memset(&buf, 0, sizeof(buf));
@@ -216,9 +220,10 @@ int recvCmd(int *id, double *arg)
       std::cout << "ERROR: Receiving command failed. errno:" << errno << std::endl;
   }
   else{
-    if(status != 12) std::cout << "Warning: Recieved message with unexpected size." << std::endl;
+    if(status != (int)CMD_MSG_SIZE) std::cout << "Warning: Recieved message with unexpected size." << std::endl;
     memcpy(id, &buf[0], sizeof(int));
     memcpy(arg, &buf[sizeof(int)], sizeof(double));
+    memcpy(trace_id, &buf[sizeof(int) + sizeof(double)], sizeof(uint32_t));
   }
 
   return status;
@@ -236,6 +241,22 @@ void cb_send(void* msg_buf, int msg_size)
   if(status == -1) std::cout << "Send Error. errno: " << errno << std::endl;
 }
 
+// Tell RobotController a traced command has been published so it can close the latency trace
+void send_trace_ack(uint32_t trace_id)
+{
+  int id, size;
+  double value;
+  id = (int)TRACE_ACK_ID;
+  value = (double)trace_id;
+  size = sizeof(value) + sizeof(id);
+
+  uint8_t buf[size];
+  memcpy( &buf[0], &id, sizeof(id) );
+  memcpy( &buf[sizeof(id)], &value, sizeof(value) );
+
+  cb_send( buf, size );
+}
+
 void cb_wall(ConstLaserScanStampedPtr &_msg)
 {
   int id, size;
@@ -364,6 +385,7 @@ int main(int _argc, char **_argv)
   ignition::math::Pose3d *turn = new ignition::math::Pose3d();
   gazebo::msgs::Pose msg;
   int cmd_id, round_arg;
+  uint32_t trace_id;
   bool timed_cmd_executing;
   double cmd_arg;
   char buf[sizeof(int) + sizeof(double)];
@@ -373,7 +395,8 @@ int main(int _argc, char **_argv)
 
   std::cout << "Starting main program loop." << std::endl;
   while (true){
-    recvCmd(&cmd_id, &cmd_arg);
+    trace_id = 0;
+    recvCmd(&cmd_id, &cmd_arg, &trace_id);
     gettimeofday(&curTime, NULL);
     
     if(cmd_id > 0){
@@ -407,6 +430,7 @@ int main(int _argc, char **_argv)
 	break;
       } /* End switch */
       velCmdPub->Publish( msg );
+      if(trace_id != 0) send_trace_ack(trace_id);
     } /* End if */
 
     gazebo::common::Time::MSleep(1);